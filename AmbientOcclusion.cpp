@@ -0,0 +1,848 @@
+///////////////////////////////////////////////////////////////////////////////
+// ambientocclusion.cpp
+// ============
+// screen-space ambient occlusion with runtime quality tiers
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AmbientOcclusion.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// prepass program - view space normal and linear depth of
+	// the closest surface
+	const char* g_PrepassVertexSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 position;\n"
+		"layout(location = 1) in vec3 normal;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"out vec3 viewNormal;\n"
+		"out float viewDepth;\n"
+		"void main()\n"
+		"{\n"
+		"    vec4 viewPosition = view * model * vec4(position, 1.0);\n"
+		"    viewNormal = mat3(transpose(inverse(view * model))) * normal;\n"
+		"    viewDepth = -viewPosition.z;\n"
+		"    gl_Position = projection * viewPosition;\n"
+		"}\n";
+	const char* g_PrepassFragmentSource =
+		"#version 330 core\n"
+		"in vec3 viewNormal;\n"
+		"in float viewDepth;\n"
+		"layout(location = 0) out vec4 normalDepth;\n"
+		"void main()\n"
+		"{\n"
+		"    vec3 normal = normalize(viewNormal) * (gl_FrontFacing ? 1.0 : -1.0);\n"
+		"    normalDepth = vec4(normal, viewDepth);\n"
+		"}\n";
+
+	// one triangle covering the screen, without vertex data -
+	// the scale maps it onto the part of the targets the scene
+	// viewport covers
+	const char* g_FullScreenVertexSource =
+		"#version 330 core\n"
+		"out vec2 texCoord;\n"
+		"uniform vec2 texCoordScale;\n"
+		"void main()\n"
+		"{\n"
+		"    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"    texCoord = corner * texCoordScale;\n"
+		"    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+		"}\n";
+
+	// occlusion estimate - the fraction of a normal oriented
+	// hemisphere of samples that lies behind the prepass
+	// surfaces.  Background texels have a depth of zero.
+	const char* g_OcclusionFragmentSource =
+		"#version 330 core\n"
+		"in vec2 texCoord;\n"
+		"layout(location = 0) out float occlusion;\n"
+		"uniform sampler2D normalDepthTexture;\n"
+		"uniform sampler2D noiseTexture;\n"
+		"uniform vec2 noiseScale;\n"
+		"uniform vec3 samples[64];\n"
+		"uniform int sampleCount;\n"
+		"uniform float radius;\n"
+		"uniform float bias;\n"
+		"uniform mat4 projection;\n"
+		"uniform mat4 inverseProjection;\n"
+		"uniform vec2 texCoordScale;\n"
+		"vec3 ViewPosition(vec2 uv, float depth)\n"
+		"{\n"
+		"    vec2 ndc = uv * 2.0 - 1.0;\n"
+		"    vec4 nearPoint = inverseProjection * vec4(ndc, -1.0, 1.0);\n"
+		"    vec4 farPoint = inverseProjection * vec4(ndc, 1.0, 1.0);\n"
+		"    nearPoint /= nearPoint.w;\n"
+		"    farPoint /= farPoint.w;\n"
+		"    float t = (-depth - nearPoint.z) / (farPoint.z - nearPoint.z);\n"
+		"    return mix(nearPoint.xyz, farPoint.xyz, t);\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"    vec4 normalDepth = texture(normalDepthTexture, texCoord);\n"
+		"    if (normalDepth.w <= 0.0)\n"
+		"    {\n"
+		"        occlusion = 1.0;\n"
+		"        return;\n"
+		"    }\n"
+		"    vec3 position = ViewPosition(texCoord / texCoordScale, normalDepth.w);\n"
+		"    vec3 normal = normalize(normalDepth.xyz);\n"
+		"    vec3 randomVector = vec3(texture(noiseTexture, texCoord * noiseScale).xy, 0.0);\n"
+		"    vec3 tangent = normalize(randomVector - normal * dot(randomVector, normal));\n"
+		"    mat3 tbn = mat3(tangent, cross(normal, tangent), normal);\n"
+		"    float occluded = 0.0;\n"
+		"    for (int i = 0; i < sampleCount; i++)\n"
+		"    {\n"
+		"        vec3 samplePosition = position + tbn * samples[i] * radius;\n"
+		"        vec4 clip = projection * vec4(samplePosition, 1.0);\n"
+		"        vec2 sampleUV = ((clip.xy / clip.w) * 0.5 + 0.5) * texCoordScale;\n"
+		"        float sceneDepth = texture(normalDepthTexture, sampleUV).w;\n"
+		"        float rangeCheck = smoothstep(0.0, 1.0, radius / abs(normalDepth.w - sceneDepth));\n"
+		"        bool bBehind = (sceneDepth > 0.0) && (sceneDepth <= -samplePosition.z - bias);\n"
+		"        occluded += bBehind ? rangeCheck : 0.0;\n"
+		"    }\n"
+		"    occlusion = 1.0 - occluded / float(sampleCount);\n"
+		"}\n";
+
+	// depth-aware filter - averages the 4x4 occlusion texels
+	// around each screen texel, the size of the noise tile,
+	// weighted by how close their depth is to the screen
+	// texel, so neither the blur nor the upsampling bleeds
+	// across edges
+	const char* g_FilterFragmentSource =
+		"#version 330 core\n"
+		"in vec2 texCoord;\n"
+		"layout(location = 0) out float occlusion;\n"
+		"uniform sampler2D rawTexture;\n"
+		"uniform sampler2D normalDepthTexture;\n"
+		"uniform vec2 rawTexelSize;\n"
+		"uniform float depthSharpness;\n"
+		"void main()\n"
+		"{\n"
+		"    float depth = texture(normalDepthTexture, texCoord).w;\n"
+		"    if (depth <= 0.0)\n"
+		"    {\n"
+		"        occlusion = 1.0;\n"
+		"        return;\n"
+		"    }\n"
+		"    vec2 base = floor(texCoord / rawTexelSize - 0.5);\n"
+		"    float total = 0.0;\n"
+		"    float weightSum = 0.0;\n"
+		"    for (int y = -1; y <= 2; y++)\n"
+		"    {\n"
+		"        for (int x = -1; x <= 2; x++)\n"
+		"        {\n"
+		"            vec2 uv = (base + vec2(x, y) + 0.5) * rawTexelSize;\n"
+		"            float sampleDepth = texture(normalDepthTexture, uv).w;\n"
+		"            float weight = exp(-abs(depth - sampleDepth) / depth * depthSharpness);\n"
+		"            total += texture(rawTexture, uv).r * weight;\n"
+		"            weightSum += weight;\n"
+		"        }\n"
+		"    }\n"
+		"    occlusion = (weightSum > 0.0001) ? total / weightSum : texture(rawTexture, texCoord).r;\n"
+		"}\n";
+
+	// settings of each quality tier - off, low, medium, high
+	const int g_TierCount = 4;
+	const struct
+	{
+		int resolutionDivisor;
+		int sampleCount;
+		float radius;
+	} g_Tiers[g_TierCount] = {
+		{ 1, 0, 0.0f },
+		{ 2, 8, 0.4f },
+		{ 2, 16, 0.4f },
+		{ 1, 32, 0.4f } };
+	const char* g_TierNames[g_TierCount] = { "off", "low", "medium", "high" };
+
+	// most samples the occlusion program accepts
+	const int g_MaxSamples = 64;
+	// size of the random rotation tile along each side
+	const int g_NoiseSize = 4;
+	// depth offset that keeps flat surfaces from occluding
+	// themselves
+	const float g_DepthBias = 0.03f;
+	// how fast the filter weights fall off with the relative
+	// depth difference
+	const float g_DepthSharpness = 40.0f;
+
+	// frames the cost has to stay over the budget before the
+	// tier is lowered, and well under it before it is raised
+	const int g_LowerFrames = 30;
+	const int g_RaiseFrames = 240;
+	const float g_RaiseFraction = 0.6f;
+	// weight of the newest measurement in the average cost
+	const float g_CostSmoothing = 0.1f;
+}
+
+/***********************************************************
+ *  AmbientOcclusion()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AmbientOcclusion::AmbientOcclusion()
+{
+	m_requestedQuality = AO_MEDIUM;
+	m_activeQuality = AO_MEDIUM;
+	m_budget = 0.0f;
+	m_width = 0;
+	m_height = 0;
+	m_viewportWidth = 0;
+	m_viewportHeight = 0;
+	m_occlusionWidth = 0;
+	m_occlusionHeight = 0;
+	m_projection = glm::mat4(1.0f);
+	m_prepassFramebufferID = 0;
+	m_normalDepthTextureID = 0;
+	m_depthRenderbufferID = 0;
+	m_rawFramebufferID = 0;
+	m_rawTextureID = 0;
+	m_occlusionFramebufferID = 0;
+	m_occlusionTextureID = 0;
+	m_noiseTextureID = 0;
+	m_emptyVertexArrayID = 0;
+	m_prepassProgramID = 0;
+	m_occlusionProgramID = 0;
+	m_filterProgramID = 0;
+	m_modelLocation = -1;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_queryIDs[i] = 0;
+		m_bQueryPending[i] = false;
+		m_queryQuality[i] = AO_OFF;
+	}
+	m_queryIndex = 0;
+	m_averageCost = 0.0f;
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+	m_bTimerActive = false;
+	m_bBlendEnabled = false;
+	m_savedFramebuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_savedViewport[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~AmbientOcclusion()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AmbientOcclusion::~AmbientOcclusion()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  SetQuality()
+ *
+ *  This method is used for setting the highest tier the
+ *  occlusion is rendered with.  The budget may lower the
+ *  tier in use again, but never raises it past this one.
+ ***********************************************************/
+void AmbientOcclusion::SetQuality(AO_QUALITY quality)
+{
+	if ((quality < AO_OFF) || (quality >= AO_QUALITY_COUNT))
+	{
+		return;
+	}
+
+	m_requestedQuality = quality;
+	SetActiveQuality(quality);
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the GPU time that the
+ *  whole occlusion pass, prepass included, may take.
+ ***********************************************************/
+void AmbientOcclusion::SetBudget(float milliseconds)
+{
+	m_budget = glm::max(milliseconds, 0.0f);
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the full screen normal/
+ *  depth and occlusion targets, the random rotation tile,
+ *  the programs and the timer queries, then sizing the
+ *  occlusion estimate for the requested tier.
+ ***********************************************************/
+bool AmbientOcclusion::Create(int width, int height)
+{
+	Destroy();
+
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	m_width = width;
+	m_height = height;
+
+	m_prepassProgramID = CreateProgram(g_PrepassVertexSource, g_PrepassFragmentSource, "prepass");
+	m_occlusionProgramID = CreateProgram(g_FullScreenVertexSource, g_OcclusionFragmentSource, "occlusion");
+	m_filterProgramID = CreateProgram(g_FullScreenVertexSource, g_FilterFragmentSource, "filter");
+	if ((m_prepassProgramID == 0) || (m_occlusionProgramID == 0) || (m_filterProgramID == 0))
+	{
+		Destroy();
+		return(false);
+	}
+	m_modelLocation = glGetUniformLocation(m_prepassProgramID, "model");
+
+	// normal in xyz and linear depth in w, sampled texel by
+	// texel
+	glGenTextures(1, &m_normalDepthTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_normalDepthTextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, m_width, m_height, 0, GL_RGBA, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenTextures(1, &m_occlusionTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_occlusionTextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_width, m_height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// random rotations around the normal, tiled over the
+	// screen so neighboring texels use different samples
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<float> noise;
+	for (int i = 0; i < g_NoiseSize * g_NoiseSize; i++)
+	{
+		noise.push_back(unit(random));
+		noise.push_back(unit(random));
+		noise.push_back(0.0f);
+	}
+	glGenTextures(1, &m_noiseTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_noiseTextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, g_NoiseSize, g_NoiseSize, 0, GL_RGB, GL_FLOAT, noise.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthRenderbufferID);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenFramebuffers(1, &m_prepassFramebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_prepassFramebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_normalDepthTextureID, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbufferID);
+	GLenum prepassStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	glGenFramebuffers(1, &m_occlusionFramebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_occlusionFramebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_occlusionTextureID, 0);
+	GLenum occlusionStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if ((prepassStatus != GL_FRAMEBUFFER_COMPLETE) || (occlusionStatus != GL_FRAMEBUFFER_COMPLETE))
+	{
+		std::cout << "Ambient occlusion framebuffer is not complete" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	// the full screen passes draw without vertex data, but the
+	// core profile still needs a vertex array bound
+	glGenVertexArrays(1, &m_emptyVertexArrayID);
+	glGenQueries(QUERY_COUNT, m_queryIDs);
+
+	// the sampler units never change
+	glUseProgram(m_occlusionProgramID);
+	glUniform1i(glGetUniformLocation(m_occlusionProgramID, "normalDepthTexture"), 0);
+	glUniform1i(glGetUniformLocation(m_occlusionProgramID, "noiseTexture"), 1);
+	glUniform1f(glGetUniformLocation(m_occlusionProgramID, "bias"), g_DepthBias);
+	glUseProgram(m_filterProgramID);
+	glUniform1i(glGetUniformLocation(m_filterProgramID, "rawTexture"), 0);
+	glUniform1i(glGetUniformLocation(m_filterProgramID, "normalDepthTexture"), 1);
+	glUniform1f(glGetUniformLocation(m_filterProgramID, "depthSharpness"), g_DepthSharpness);
+	glUseProgram(0);
+
+	SetActiveQuality(m_requestedQuality);
+	if (m_rawFramebufferID == 0)
+	{
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the targets, programs
+ *  and timer queries.
+ ***********************************************************/
+void AmbientOcclusion::Destroy()
+{
+	GLuint framebuffers[] = { m_prepassFramebufferID, m_rawFramebufferID, m_occlusionFramebufferID };
+	GLuint textures[] = { m_normalDepthTextureID, m_rawTextureID, m_occlusionTextureID, m_noiseTextureID };
+	GLuint programs[] = { m_prepassProgramID, m_occlusionProgramID, m_filterProgramID };
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (framebuffers[i] != 0)
+		{
+			glDeleteFramebuffers(1, &framebuffers[i]);
+		}
+		if (programs[i] != 0)
+		{
+			glDeleteProgram(programs[i]);
+		}
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		if (textures[i] != 0)
+		{
+			glDeleteTextures(1, &textures[i]);
+		}
+	}
+	if (m_depthRenderbufferID != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthRenderbufferID);
+	}
+	if (m_emptyVertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArrayID);
+	}
+	if (m_queryIDs[0] != 0)
+	{
+		glDeleteQueries(QUERY_COUNT, m_queryIDs);
+	}
+
+	m_prepassFramebufferID = 0;
+	m_rawFramebufferID = 0;
+	m_occlusionFramebufferID = 0;
+	m_normalDepthTextureID = 0;
+	m_rawTextureID = 0;
+	m_occlusionTextureID = 0;
+	m_noiseTextureID = 0;
+	m_depthRenderbufferID = 0;
+	m_emptyVertexArrayID = 0;
+	m_prepassProgramID = 0;
+	m_occlusionProgramID = 0;
+	m_filterProgramID = 0;
+	m_modelLocation = -1;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_queryIDs[i] = 0;
+		m_bQueryPending[i] = false;
+	}
+}
+
+/***********************************************************
+ *  GetTier()
+ *
+ *  This method is used for getting the resolution, sample
+ *  count and radius of a quality tier.
+ ***********************************************************/
+AmbientOcclusion::TIER AmbientOcclusion::GetTier(AO_QUALITY quality)
+{
+	TIER tier;
+	int index = glm::clamp((int)quality, 0, g_TierCount - 1);
+
+	tier.resolutionDivisor = g_Tiers[index].resolutionDivisor;
+	tier.sampleCount = g_Tiers[index].sampleCount;
+	tier.radius = g_Tiers[index].radius;
+
+	return(tier);
+}
+
+/***********************************************************
+ *  SetActiveQuality()
+ *
+ *  This method is used for switching the tier in use.  The
+ *  occlusion estimate is resized for the tier and a new
+ *  sample kernel is generated, with the samples packed
+ *  closer to the surface where occlusion matters most.
+ ***********************************************************/
+void AmbientOcclusion::SetActiveQuality(AO_QUALITY quality)
+{
+	m_activeQuality = quality;
+	m_averageCost = 0.0f;
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+
+	if ((m_prepassFramebufferID == 0) || (quality == AO_OFF))
+	{
+		return;
+	}
+
+	TIER tier = GetTier(quality);
+	m_occlusionWidth = glm::max(m_width / tier.resolutionDivisor, 1);
+	m_occlusionHeight = glm::max(m_height / tier.resolutionDivisor, 1);
+	if (CreateRawTarget() == false)
+	{
+		return;
+	}
+
+	std::mt19937 random(11);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<glm::vec3> samples;
+	int sampleCount = glm::min(tier.sampleCount, g_MaxSamples);
+	for (int i = 0; i < sampleCount; i++)
+	{
+		glm::vec3 sample(
+			unit(random) * 2.0f - 1.0f,
+			unit(random) * 2.0f - 1.0f,
+			unit(random));
+		if (glm::length(sample) < 0.0001f)
+		{
+			sample = glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+		float scale = (float)i / (float)sampleCount;
+		scale = 0.1f + 0.9f * scale * scale;
+		samples.push_back(glm::normalize(sample) * unit(random) * scale);
+	}
+
+	glUseProgram(m_occlusionProgramID);
+	glUniform3fv(glGetUniformLocation(m_occlusionProgramID, "samples"), sampleCount, glm::value_ptr(samples[0]));
+	glUniform1i(glGetUniformLocation(m_occlusionProgramID, "sampleCount"), sampleCount);
+	glUniform1f(glGetUniformLocation(m_occlusionProgramID, "radius"), tier.radius);
+	glUniform2f(
+		glGetUniformLocation(m_occlusionProgramID, "noiseScale"),
+		(float)m_occlusionWidth / (float)g_NoiseSize,
+		(float)m_occlusionHeight / (float)g_NoiseSize);
+	glUseProgram(m_filterProgramID);
+	glUniform2f(
+		glGetUniformLocation(m_filterProgramID, "rawTexelSize"),
+		1.0f / (float)m_occlusionWidth,
+		1.0f / (float)m_occlusionHeight);
+	glUseProgram(0);
+}
+
+/***********************************************************
+ *  CreateRawTarget()
+ *
+ *  This method is used for creating the texture and
+ *  framebuffer that the unfiltered occlusion is estimated
+ *  into, at the size of the tier in use.
+ ***********************************************************/
+bool AmbientOcclusion::CreateRawTarget()
+{
+	if (m_rawFramebufferID != 0)
+	{
+		glDeleteFramebuffers(1, &m_rawFramebufferID);
+		m_rawFramebufferID = 0;
+	}
+	if (m_rawTextureID != 0)
+	{
+		glDeleteTextures(1, &m_rawTextureID);
+		m_rawTextureID = 0;
+	}
+
+	glGenTextures(1, &m_rawTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_rawTextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, m_occlusionWidth, m_occlusionHeight, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenFramebuffers(1, &m_rawFramebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_rawFramebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_rawTextureID, 0);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Ambient occlusion framebuffer is not complete" << std::endl;
+		glDeleteFramebuffers(1, &m_rawFramebufferID);
+		m_rawFramebufferID = 0;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateProgram()
+ *
+ *  This method is used for compiling and linking one of the
+ *  occlusion programs - returns 0 when it fails.
+ ***********************************************************/
+GLuint AmbientOcclusion::CreateProgram(
+	const char* vertexSource,
+	const char* fragmentSource,
+	const char* name)
+{
+	const char* sources[2] = { vertexSource, fragmentSource };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint shaders[2] = { 0, 0 };
+	GLint success = 0;
+	char infoLog[512];
+
+	GLuint programID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+			std::cout << "Ambient occlusion " << name << " shader compilation failed\n" << infoLog << std::endl;
+		}
+		glAttachShader(programID, shaders[i]);
+	}
+	glLinkProgram(programID);
+	for (int i = 0; i < 2; i++)
+	{
+		glDeleteShader(shaders[i]);
+	}
+
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Ambient occlusion " << name << " program linking failed\n" << infoLog << std::endl;
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  BeginPrepass()
+ *
+ *  This method is used for starting the timed occlusion
+ *  pass - the normal/depth target is bound and cleared and
+ *  the prepass program is set up with the frame camera.
+ ***********************************************************/
+void AmbientOcclusion::BeginPrepass(const glm::mat4& view, const glm::mat4& projection)
+{
+	UpdateCost();
+
+	// a query that is still in flight after a full ring of
+	// frames is left alone, and this frame goes untimed
+	if (m_bQueryPending[m_queryIndex] == false)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, m_queryIDs[m_queryIndex]);
+		m_bTimerActive = true;
+	}
+
+	m_projection = projection;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+	m_bBlendEnabled = (glIsEnabled(GL_BLEND) == GL_TRUE);
+
+	// the prepass matches the scene viewport, which is smaller
+	// than the targets while the resolution is scaled down
+	m_viewportWidth = glm::clamp((int)m_savedViewport[2], 1, m_width);
+	m_viewportHeight = glm::clamp((int)m_savedViewport[3], 1, m_height);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_prepassFramebufferID);
+	glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glUseProgram(m_prepassProgramID);
+	glUniformMatrix4fv(glGetUniformLocation(m_prepassProgramID, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(m_prepassProgramID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+}
+
+/***********************************************************
+ *  SetPrepassModel()
+ *
+ *  This method is used for setting the model matrix of the
+ *  next object drawn into the prepass.
+ ***********************************************************/
+void AmbientOcclusion::SetPrepassModel(const glm::mat4& model)
+{
+	glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method is used for estimating the occlusion from
+ *  the prepass into the tier sized target, filtering it to
+ *  full screen size and restoring the render state.  The
+ *  caller binds its own program again.
+ ***********************************************************/
+void AmbientOcclusion::EndPass()
+{
+	// units 0 and 1 hold scene textures that are only bound
+	// once, so they are put back after the passes
+	GLint sceneTextureIDs[2] = { 0, 0 };
+	for (int i = 0; i < 2; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &sceneTextureIDs[i]);
+	}
+
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_emptyVertexArrayID);
+
+	float widthScale = (float)m_viewportWidth / (float)m_width;
+	float heightScale = (float)m_viewportHeight / (float)m_height;
+	glBindFramebuffer(GL_FRAMEBUFFER, m_rawFramebufferID);
+	glViewport(
+		0, 0,
+		glm::max((int)glm::ceil(m_occlusionWidth * widthScale), 1),
+		glm::max((int)glm::ceil(m_occlusionHeight * heightScale), 1));
+	glUseProgram(m_occlusionProgramID);
+	glUniform2f(glGetUniformLocation(m_occlusionProgramID, "texCoordScale"), widthScale, heightScale);
+	glUniformMatrix4fv(glGetUniformLocation(m_occlusionProgramID, "projection"), 1, GL_FALSE, glm::value_ptr(m_projection));
+	glUniformMatrix4fv(
+		glGetUniformLocation(m_occlusionProgramID, "inverseProjection"), 1, GL_FALSE,
+		glm::value_ptr(glm::inverse(m_projection)));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_normalDepthTextureID);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_noiseTextureID);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_occlusionFramebufferID);
+	glViewport(0, 0, m_viewportWidth, m_viewportHeight);
+	glUseProgram(m_filterProgramID);
+	glUniform2f(glGetUniformLocation(m_filterProgramID, "texCoordScale"), widthScale, heightScale);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_rawTextureID);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_normalDepthTextureID);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, sceneTextureIDs[1]);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, sceneTextureIDs[0]);
+	glEnable(GL_DEPTH_TEST);
+	if (m_bBlendEnabled)
+	{
+		glEnable(GL_BLEND);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+	glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+
+	if (m_bTimerActive)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_bQueryPending[m_queryIndex] = true;
+		m_queryQuality[m_queryIndex] = m_activeQuality;
+		m_queryIndex = (m_queryIndex + 1) % QUERY_COUNT;
+		m_bTimerActive = false;
+	}
+}
+
+/***********************************************************
+ *  UpdateCost()
+ *
+ *  This method is used for reading the timer queries of
+ *  earlier frames that the GPU has finished, without ever
+ *  waiting on one, and changing the tier when the average
+ *  cost stays over, or well under, the budget.  Should even
+ *  the lowest tier run over, the occlusion is switched off
+ *  until the quality is set again.
+ ***********************************************************/
+void AmbientOcclusion::UpdateCost()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		int query = (m_queryIndex + i) % QUERY_COUNT;
+		if (m_bQueryPending[query] == false)
+		{
+			continue;
+		}
+
+		GLint bAvailable = 0;
+		glGetQueryObjectiv(m_queryIDs[query], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (!bAvailable)
+		{
+			break;
+		}
+
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(m_queryIDs[query], GL_QUERY_RESULT, &nanoseconds);
+		m_bQueryPending[query] = false;
+
+		// frames timed before a tier change say nothing about
+		// the tier in use
+		if (m_queryQuality[query] != m_activeQuality)
+		{
+			continue;
+		}
+
+		float cost = (float)((double)nanoseconds / 1000000.0);
+		if (m_averageCost == 0.0f)
+		{
+			m_averageCost = cost;
+		}
+		else
+		{
+			m_averageCost += (cost - m_averageCost) * g_CostSmoothing;
+		}
+
+		if (m_budget <= 0.0f)
+		{
+			continue;
+		}
+
+		if (m_averageCost > m_budget)
+		{
+			m_underBudgetFrames = 0;
+			if (++m_overBudgetFrames >= g_LowerFrames)
+			{
+				AO_QUALITY lowered = (AO_QUALITY)(m_activeQuality - 1);
+				std::cout << "Ambient occlusion took " << m_averageCost << " ms of its "
+					<< m_budget << " ms budget, quality lowered to "
+					<< g_TierNames[lowered] << std::endl;
+				SetActiveQuality(lowered);
+				return;
+			}
+		}
+		else if ((m_averageCost < m_budget * g_RaiseFraction) && (m_activeQuality < m_requestedQuality))
+		{
+			m_overBudgetFrames = 0;
+			if (++m_underBudgetFrames >= g_RaiseFrames)
+			{
+				AO_QUALITY raised = (AO_QUALITY)(m_activeQuality + 1);
+				std::cout << "Ambient occlusion quality raised to " << g_TierNames[raised] << std::endl;
+				SetActiveQuality(raised);
+				return;
+			}
+		}
+		else
+		{
+			m_overBudgetFrames = 0;
+			m_underBudgetFrames = 0;
+		}
+	}
+}
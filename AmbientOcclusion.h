@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// ambientocclusion.h
+// ============
+// screen-space ambient occlusion with runtime quality tiers
+//
+//  A prepass writes the view space normal and linear depth of the visible
+//  surfaces.  The occlusion is estimated from that buffer with a hemisphere
+//  of samples, at half resolution on the cheaper tiers, and a depth-aware
+//  filter then removes the noise and brings it back to full resolution.
+//  The GPU time of the whole pass is measured every frame and the tier is
+//  lowered whenever it runs over the budget.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  AmbientOcclusion
+ *
+ *  This class contains the normal/depth and occlusion
+ *  targets, the programs of the three passes and the cost
+ *  measurement of the occlusion.
+ ***********************************************************/
+class AmbientOcclusion
+{
+public:
+	// quality tiers, cheapest first
+	enum AO_QUALITY
+	{
+		AO_OFF = 0,
+		AO_LOW,
+		AO_MEDIUM,
+		AO_HIGH,
+		AO_QUALITY_COUNT
+	};
+
+	// constructor
+	AmbientOcclusion();
+	// destructor
+	~AmbientOcclusion();
+
+	// set the highest tier to render with - can be changed
+	// at any time on the main thread
+	void SetQuality(AO_QUALITY quality);
+	AO_QUALITY GetQuality() const { return(m_requestedQuality); }
+	// get the tier in use after the budget was applied
+	AO_QUALITY GetActiveQuality() const { return(m_activeQuality); }
+	// set the GPU time in milliseconds the pass may take - zero
+	// keeps the tier fixed
+	void SetBudget(float milliseconds);
+	// get the measured GPU time of the pass in milliseconds
+	float GetAverageCost() const { return(m_averageCost); }
+
+	// create the targets at the passed in size and the programs
+	bool Create(int width, int height);
+	// free the occlusion resources
+	void Destroy();
+	bool IsValid() const { return(m_prepassFramebufferID != 0); }
+	GLuint GetOcclusionTexture() const { return(m_occlusionTextureID); }
+
+	// bind the normal/depth target for drawing the scene with
+	// the passed in camera and clear it
+	void BeginPrepass(const glm::mat4& view, const glm::mat4& projection);
+	// set the model matrix of the next object
+	void SetPrepassModel(const glm::mat4& model);
+	// estimate and filter the occlusion of the prepass, then
+	// restore the framebuffer and viewport of the caller
+	void EndPass();
+
+private:
+	// settings of one quality tier
+	struct TIER
+	{
+		// occlusion texels per screen texel along each side
+		int resolutionDivisor;
+		int sampleCount;
+		// view space radius of the sample hemisphere
+		float radius;
+	};
+
+	AO_QUALITY m_requestedQuality;
+	AO_QUALITY m_activeQuality;
+	float m_budget;
+	// full screen size and the size of the occlusion estimate
+	int m_width;
+	int m_height;
+	int m_occlusionWidth;
+	int m_occlusionHeight;
+	// part of the targets the scene viewport covers this frame
+	int m_viewportWidth;
+	int m_viewportHeight;
+	// camera of the frame being rendered
+	glm::mat4 m_projection;
+	// OpenGL resources
+	GLuint m_prepassFramebufferID;
+	GLuint m_normalDepthTextureID;
+	GLuint m_depthRenderbufferID;
+	GLuint m_rawFramebufferID;
+	GLuint m_rawTextureID;
+	GLuint m_occlusionFramebufferID;
+	GLuint m_occlusionTextureID;
+	GLuint m_noiseTextureID;
+	GLuint m_emptyVertexArrayID;
+	GLuint m_prepassProgramID;
+	GLuint m_occlusionProgramID;
+	GLuint m_filterProgramID;
+	GLint m_modelLocation;
+	// GPU timer queries, one per frame in flight
+	static const int QUERY_COUNT = 4;
+	GLuint m_queryIDs[QUERY_COUNT];
+	bool m_bQueryPending[QUERY_COUNT];
+	AO_QUALITY m_queryQuality[QUERY_COUNT];
+	int m_queryIndex;
+	// measured cost and the frames it stayed over or well
+	// under the budget
+	float m_averageCost;
+	int m_overBudgetFrames;
+	int m_underBudgetFrames;
+	// true while the pass of this frame is being timed
+	bool m_bTimerActive;
+	// state restored at the end of the pass
+	bool m_bBlendEnabled;
+	GLint m_savedFramebuffer;
+	GLint m_savedViewport[4];
+
+	// get the settings of a tier
+	static TIER GetTier(AO_QUALITY quality);
+	// switch to a tier and size the occlusion estimate for it
+	void SetActiveQuality(AO_QUALITY quality);
+	// create the texture the occlusion is estimated into
+	bool CreateRawTarget();
+	// compile and link a program from inline sources
+	static GLuint CreateProgram(
+		const char* vertexSource,
+		const char* fragmentSource,
+		const char* name);
+	// read the finished timer queries and apply the budget
+	void UpdateCost();
+};
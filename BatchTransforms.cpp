@@ -0,0 +1,485 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchtransforms.cpp
+// ============
+// compose model matrices for many objects at once from scale, rotation
+// and position streams
+//
+//  The vector sine and cosine use the Cephes single precision range
+//  reduction and polynomials, which stay within a few ulp of the C
+//  library for the angles used in a scene.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchTransforms.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#if defined(__AVX2__)
+#define BATCH_TRANSFORMS_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define BATCH_TRANSFORMS_SSE
+#endif
+
+#if defined(BATCH_TRANSFORMS_SSE) || defined(BATCH_TRANSFORMS_AVX2)
+#include <immintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	const float g_DegreesToRadians = 0.01745329251994329577f;
+
+	// Cephes constants for the sine and cosine
+	const float g_FourOverPi = 1.27323954473516f;
+	const float g_DP1 = -0.78515625f;
+	const float g_DP2 = -2.4187564849853515625e-4f;
+	const float g_DP3 = -3.77489497744594108e-8f;
+	const float g_SinCoef0 = -1.9515295891e-4f;
+	const float g_SinCoef1 = 8.3321608736e-3f;
+	const float g_SinCoef2 = -1.6666654611e-1f;
+	const float g_CosCoef0 = 2.443315711809948e-5f;
+	const float g_CosCoef1 = -1.388731625493765e-3f;
+	const float g_CosCoef2 = 4.166664568298827e-2f;
+
+#if defined(BATCH_TRANSFORMS_SSE)
+	/***********************************************************
+	 *  SSE_OPS
+	 *
+	 *  4-wide vector operations for the shared kernel.
+	 ***********************************************************/
+	struct SSE_OPS
+	{
+		typedef __m128 vfloat;
+		typedef __m128i vint;
+		static const int WIDTH = 4;
+
+		static vfloat Load(const float* p) { return(_mm_loadu_ps(p)); }
+		static vfloat Set(float value) { return(_mm_set1_ps(value)); }
+		static vfloat Add(vfloat a, vfloat b) { return(_mm_add_ps(a, b)); }
+		static vfloat Sub(vfloat a, vfloat b) { return(_mm_sub_ps(a, b)); }
+		static vfloat Mul(vfloat a, vfloat b) { return(_mm_mul_ps(a, b)); }
+		static vfloat And(vfloat a, vfloat b) { return(_mm_and_ps(a, b)); }
+		static vfloat AndNot(vfloat a, vfloat b) { return(_mm_andnot_ps(a, b)); }
+		static vfloat Xor(vfloat a, vfloat b) { return(_mm_xor_ps(a, b)); }
+		static vint SetInt(int value) { return(_mm_set1_epi32(value)); }
+		static vint ToInt(vfloat a) { return(_mm_cvttps_epi32(a)); }
+		static vfloat ToFloat(vint a) { return(_mm_cvtepi32_ps(a)); }
+		static vint AddInt(vint a, vint b) { return(_mm_add_epi32(a, b)); }
+		static vint SubInt(vint a, vint b) { return(_mm_sub_epi32(a, b)); }
+		static vint AndInt(vint a, vint b) { return(_mm_and_si128(a, b)); }
+		static vint AndNotInt(vint a, vint b) { return(_mm_andnot_si128(a, b)); }
+		static vint EqualInt(vint a, vint b) { return(_mm_cmpeq_epi32(a, b)); }
+		static vint ShiftLeft29(vint a) { return(_mm_slli_epi32(a, 29)); }
+		static vfloat AsFloat(vint a) { return(_mm_castsi128_ps(a)); }
+
+		// transpose one matrix column of 4 objects and store it
+		static void StoreColumn(const vfloat rows[4], glm::mat4* pModels, int column)
+		{
+			__m128 r0 = rows[0];
+			__m128 r1 = rows[1];
+			__m128 r2 = rows[2];
+			__m128 r3 = rows[3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(&pModels[0][column][0], r0);
+			_mm_storeu_ps(&pModels[1][column][0], r1);
+			_mm_storeu_ps(&pModels[2][column][0], r2);
+			_mm_storeu_ps(&pModels[3][column][0], r3);
+		}
+	};
+#endif
+
+#if defined(BATCH_TRANSFORMS_AVX2)
+	/***********************************************************
+	 *  AVX2_OPS
+	 *
+	 *  8-wide vector operations for the shared kernel.
+	 ***********************************************************/
+	struct AVX2_OPS
+	{
+		typedef __m256 vfloat;
+		typedef __m256i vint;
+		static const int WIDTH = 8;
+
+		static vfloat Load(const float* p) { return(_mm256_loadu_ps(p)); }
+		static vfloat Set(float value) { return(_mm256_set1_ps(value)); }
+		static vfloat Add(vfloat a, vfloat b) { return(_mm256_add_ps(a, b)); }
+		static vfloat Sub(vfloat a, vfloat b) { return(_mm256_sub_ps(a, b)); }
+		static vfloat Mul(vfloat a, vfloat b) { return(_mm256_mul_ps(a, b)); }
+		static vfloat And(vfloat a, vfloat b) { return(_mm256_and_ps(a, b)); }
+		static vfloat AndNot(vfloat a, vfloat b) { return(_mm256_andnot_ps(a, b)); }
+		static vfloat Xor(vfloat a, vfloat b) { return(_mm256_xor_ps(a, b)); }
+		static vint SetInt(int value) { return(_mm256_set1_epi32(value)); }
+		static vint ToInt(vfloat a) { return(_mm256_cvttps_epi32(a)); }
+		static vfloat ToFloat(vint a) { return(_mm256_cvtepi32_ps(a)); }
+		static vint AddInt(vint a, vint b) { return(_mm256_add_epi32(a, b)); }
+		static vint SubInt(vint a, vint b) { return(_mm256_sub_epi32(a, b)); }
+		static vint AndInt(vint a, vint b) { return(_mm256_and_si256(a, b)); }
+		static vint AndNotInt(vint a, vint b) { return(_mm256_andnot_si256(a, b)); }
+		static vint EqualInt(vint a, vint b) { return(_mm256_cmpeq_epi32(a, b)); }
+		static vint ShiftLeft29(vint a) { return(_mm256_slli_epi32(a, 29)); }
+		static vfloat AsFloat(vint a) { return(_mm256_castsi256_ps(a)); }
+
+		// transpose one matrix column of 8 objects and store it,
+		// one 128 bit half of the lanes at a time
+		static void StoreColumn(const vfloat rows[4], glm::mat4* pModels, int column)
+		{
+			for (int half = 0; half < 2; half++)
+			{
+				__m128 r0 = (half == 0) ? _mm256_castps256_ps128(rows[0]) : _mm256_extractf128_ps(rows[0], 1);
+				__m128 r1 = (half == 0) ? _mm256_castps256_ps128(rows[1]) : _mm256_extractf128_ps(rows[1], 1);
+				__m128 r2 = (half == 0) ? _mm256_castps256_ps128(rows[2]) : _mm256_extractf128_ps(rows[2], 1);
+				__m128 r3 = (half == 0) ? _mm256_castps256_ps128(rows[3]) : _mm256_extractf128_ps(rows[3], 1);
+				_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+				glm::mat4* pHalf = pModels + half * 4;
+				_mm_storeu_ps(&pHalf[0][column][0], r0);
+				_mm_storeu_ps(&pHalf[1][column][0], r1);
+				_mm_storeu_ps(&pHalf[2][column][0], r2);
+				_mm_storeu_ps(&pHalf[3][column][0], r3);
+			}
+		}
+	};
+#endif
+
+#if defined(BATCH_TRANSFORMS_SSE) || defined(BATCH_TRANSFORMS_AVX2)
+	/***********************************************************
+	 *  SinCos()
+	 *
+	 *  Vector sine and cosine of angles in radians.
+	 ***********************************************************/
+	template <class OPS>
+	void SinCos(typename OPS::vfloat x, typename OPS::vfloat& sine, typename OPS::vfloat& cosine)
+	{
+		typedef typename OPS::vfloat vfloat;
+		typedef typename OPS::vint vint;
+
+		vfloat signMask = OPS::AsFloat(OPS::SetInt((int)0x80000000));
+
+		// take the sign of the sine and work with |x|
+		vfloat signSin = OPS::And(x, signMask);
+		x = OPS::AndNot(signMask, x);
+
+		// find the octant - rounded up to an even number
+		vfloat y = OPS::Mul(x, OPS::Set(g_FourOverPi));
+		vint octant = OPS::ToInt(y);
+		octant = OPS::AddInt(octant, OPS::SetInt(1));
+		octant = OPS::AndInt(octant, OPS::SetInt(~1));
+		y = OPS::ToFloat(octant);
+
+		vfloat swapSignSin = OPS::AsFloat(OPS::ShiftLeft29(OPS::AndInt(octant, OPS::SetInt(4))));
+		vfloat polyMask = OPS::AsFloat(OPS::EqualInt(OPS::AndInt(octant, OPS::SetInt(2)), OPS::SetInt(0)));
+		vint cosOctant = OPS::SubInt(octant, OPS::SetInt(2));
+		vfloat signCos = OPS::AsFloat(OPS::ShiftLeft29(OPS::AndNotInt(cosOctant, OPS::SetInt(4))));
+		signSin = OPS::Xor(signSin, swapSignSin);
+
+		// extended precision reduction into [-pi/4, pi/4]
+		x = OPS::Add(x, OPS::Mul(y, OPS::Set(g_DP1)));
+		x = OPS::Add(x, OPS::Mul(y, OPS::Set(g_DP2)));
+		x = OPS::Add(x, OPS::Mul(y, OPS::Set(g_DP3)));
+		vfloat z = OPS::Mul(x, x);
+
+		// cosine polynomial
+		vfloat polyCos = OPS::Set(g_CosCoef0);
+		polyCos = OPS::Add(OPS::Mul(polyCos, z), OPS::Set(g_CosCoef1));
+		polyCos = OPS::Add(OPS::Mul(polyCos, z), OPS::Set(g_CosCoef2));
+		polyCos = OPS::Mul(OPS::Mul(polyCos, z), z);
+		polyCos = OPS::Sub(polyCos, OPS::Mul(z, OPS::Set(0.5f)));
+		polyCos = OPS::Add(polyCos, OPS::Set(1.0f));
+
+		// sine polynomial
+		vfloat polySin = OPS::Set(g_SinCoef0);
+		polySin = OPS::Add(OPS::Mul(polySin, z), OPS::Set(g_SinCoef1));
+		polySin = OPS::Add(OPS::Mul(polySin, z), OPS::Set(g_SinCoef2));
+		polySin = OPS::Add(OPS::Mul(OPS::Mul(polySin, z), x), x);
+
+		// pick the polynomial that belongs to each result
+		vfloat sinFromSin = OPS::And(polyMask, polySin);
+		vfloat sinFromCos = OPS::AndNot(polyMask, polyCos);
+		vfloat cosFromSin = OPS::Sub(polySin, sinFromSin);
+		vfloat cosFromCos = OPS::Sub(polyCos, sinFromCos);
+
+		sine = OPS::Xor(OPS::Add(sinFromSin, sinFromCos), signSin);
+		cosine = OPS::Xor(OPS::Add(cosFromSin, cosFromCos), signCos);
+	}
+
+	/***********************************************************
+	 *  ComposeKernel()
+	 *
+	 *  Compose OPS::WIDTH model matrices per step.  Returns the
+	 *  number of objects done; the rest is left to the scalar
+	 *  kernel.
+	 ***********************************************************/
+	template <class OPS>
+	int ComposeKernel(const TRANSFORM_STREAMS& streams, int count, glm::mat4* pModels)
+	{
+		typedef typename OPS::vfloat vfloat;
+
+		const vfloat toRadians = OPS::Set(g_DegreesToRadians);
+		const vfloat zero = OPS::Set(0.0f);
+		const vfloat one = OPS::Set(1.0f);
+		int done = 0;
+
+		for (; done + OPS::WIDTH <= count; done += OPS::WIDTH)
+		{
+			vfloat sx, cx, sy, cy, sz, cz;
+			SinCos<OPS>(OPS::Mul(OPS::Load(streams.rotationX + done), toRadians), sx, cx);
+			SinCos<OPS>(OPS::Mul(OPS::Load(streams.rotationY + done), toRadians), sy, cy);
+			SinCos<OPS>(OPS::Mul(OPS::Load(streams.rotationZ + done), toRadians), sz, cz);
+
+			vfloat scaleX = OPS::Load(streams.scaleX + done);
+			vfloat scaleY = OPS::Load(streams.scaleY + done);
+			vfloat scaleZ = OPS::Load(streams.scaleZ + done);
+
+			// rotationZ * rotationY * rotationX expanded in closed form
+			vfloat szsy = OPS::Mul(sz, sy);
+			vfloat czsy = OPS::Mul(cz, sy);
+			vfloat columns[4][4];
+
+			columns[0][0] = OPS::Mul(OPS::Mul(cz, cy), scaleX);
+			columns[0][1] = OPS::Mul(OPS::Mul(sz, cy), scaleX);
+			columns[0][2] = OPS::Sub(zero, OPS::Mul(sy, scaleX));
+			columns[0][3] = zero;
+
+			columns[1][0] = OPS::Mul(OPS::Sub(OPS::Mul(czsy, sx), OPS::Mul(sz, cx)), scaleY);
+			columns[1][1] = OPS::Mul(OPS::Add(OPS::Mul(szsy, sx), OPS::Mul(cz, cx)), scaleY);
+			columns[1][2] = OPS::Mul(OPS::Mul(cy, sx), scaleY);
+			columns[1][3] = zero;
+
+			columns[2][0] = OPS::Mul(OPS::Add(OPS::Mul(czsy, cx), OPS::Mul(sz, sx)), scaleZ);
+			columns[2][1] = OPS::Mul(OPS::Sub(OPS::Mul(szsy, cx), OPS::Mul(cz, sx)), scaleZ);
+			columns[2][2] = OPS::Mul(OPS::Mul(cy, cx), scaleZ);
+			columns[2][3] = zero;
+
+			columns[3][0] = OPS::Load(streams.positionX + done);
+			columns[3][1] = OPS::Load(streams.positionY + done);
+			columns[3][2] = OPS::Load(streams.positionZ + done);
+			columns[3][3] = one;
+
+			for (int column = 0; column < 4; column++)
+			{
+				OPS::StoreColumn(columns[column], pModels + done, column);
+			}
+		}
+
+		return(done);
+	}
+#endif
+
+	/***********************************************************
+	 *  ComposeTail()
+	 *
+	 *  Compose the objects [begin, count) with the scalar code.
+	 ***********************************************************/
+	void ComposeTail(const TRANSFORM_STREAMS& streams, int begin, int count, glm::mat4* pModels)
+	{
+		for (int i = begin; i < count; i++)
+		{
+			float sx = sinf(streams.rotationX[i] * g_DegreesToRadians);
+			float cx = cosf(streams.rotationX[i] * g_DegreesToRadians);
+			float sy = sinf(streams.rotationY[i] * g_DegreesToRadians);
+			float cy = cosf(streams.rotationY[i] * g_DegreesToRadians);
+			float sz = sinf(streams.rotationZ[i] * g_DegreesToRadians);
+			float cz = cosf(streams.rotationZ[i] * g_DegreesToRadians);
+			float scaleX = streams.scaleX[i];
+			float scaleY = streams.scaleY[i];
+			float scaleZ = streams.scaleZ[i];
+
+			glm::mat4& model = pModels[i];
+			model[0] = glm::vec4(cz * cy, sz * cy, -sy, 0.0f) * scaleX;
+			model[1] = glm::vec4(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx, 0.0f) * scaleY;
+			model[2] = glm::vec4(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx, 0.0f) * scaleZ;
+			model[3] = glm::vec4(streams.positionX[i], streams.positionY[i], streams.positionZ[i], 1.0f);
+		}
+	}
+
+	/***********************************************************
+	 *  ComposeReference()
+	 *
+	 *  Compose the objects one at a time with the glm matrix
+	 *  products the closed form replaces - translation *
+	 *  rotationZ * rotationY * rotationX * scale.
+	 ***********************************************************/
+	void ComposeReference(const TRANSFORM_STREAMS& streams, int count, glm::mat4* pModels)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			glm::mat4 scale = glm::scale(glm::vec3(streams.scaleX[i], streams.scaleY[i], streams.scaleZ[i]));
+			glm::mat4 rotationX = glm::rotate(glm::radians(streams.rotationX[i]), glm::vec3(1.0f, 0.0f, 0.0f));
+			glm::mat4 rotationY = glm::rotate(glm::radians(streams.rotationY[i]), glm::vec3(0.0f, 1.0f, 0.0f));
+			glm::mat4 rotationZ = glm::rotate(glm::radians(streams.rotationZ[i]), glm::vec3(0.0f, 0.0f, 1.0f));
+			glm::mat4 translation = glm::translate(glm::vec3(streams.positionX[i], streams.positionY[i], streams.positionZ[i]));
+
+			pModels[i] = translation * rotationZ * rotationY * rotationX * scale;
+		}
+	}
+
+	/***********************************************************
+	 *  ReportKernel()
+	 *
+	 *  Print the largest error of a kernel against the glm
+	 *  reference and get whether it is within the tolerance.
+	 ***********************************************************/
+	bool ReportKernel(const char* name, float error, float tolerance)
+	{
+		bool bPassed = (error <= tolerance);
+
+		std::cout << "Transform kernel " << name << (bPassed ? " matches" : " does not match")
+			<< ", largest error:" << error << std::endl;
+
+		return(bPassed);
+	}
+
+	/***********************************************************
+	 *  CompareKernel()
+	 *
+	 *  Get the largest difference between two sets of matrices,
+	 *  relative to the size of each reference element.
+	 ***********************************************************/
+	float CompareKernel(const std::vector<glm::mat4>& reference, const std::vector<glm::mat4>& result)
+	{
+		float maxError = 0.0f;
+
+		for (size_t i = 0; i < reference.size(); i++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					float expected = reference[i][column][row];
+					float error = fabsf(result[i][column][row] - expected) / (1.0f + fabsf(expected));
+					if (!(error <= maxError))
+					{
+						maxError = error;
+					}
+				}
+			}
+		}
+
+		return(maxError);
+	}
+}
+
+/***********************************************************
+ *  ComposeTransforms()
+ *
+ *  This function is used for composing the model matrices
+ *  with the widest kernel this file was built with.
+ ***********************************************************/
+void ComposeTransforms(
+	const TRANSFORM_STREAMS& streams,
+	int count,
+	glm::mat4* pModels)
+{
+	int done = 0;
+
+#if defined(BATCH_TRANSFORMS_AVX2)
+	done = ComposeKernel<AVX2_OPS>(streams, count, pModels);
+#elif defined(BATCH_TRANSFORMS_SSE)
+	done = ComposeKernel<SSE_OPS>(streams, count, pModels);
+#endif
+
+	ComposeTail(streams, done, count, pModels);
+}
+
+/***********************************************************
+ *  ComposeTransformsScalar()
+ *
+ *  This function is used for composing the model matrices
+ *  one object at a time.
+ ***********************************************************/
+void ComposeTransformsScalar(
+	const TRANSFORM_STREAMS& streams,
+	int count,
+	glm::mat4* pModels)
+{
+	ComposeTail(streams, 0, count, pModels);
+}
+
+/***********************************************************
+ *  GetTransformKernelName()
+ *
+ *  This function is used for getting the name of the kernel
+ *  that ComposeTransforms() uses.
+ ***********************************************************/
+const char* GetTransformKernelName()
+{
+#if defined(BATCH_TRANSFORMS_AVX2)
+	return("AVX2");
+#elif defined(BATCH_TRANSFORMS_SSE)
+	return("SSE2");
+#else
+	return("scalar");
+#endif
+}
+
+/***********************************************************
+ *  ValidateTransformKernels()
+ *
+ *  This function is used for checking the scalar kernel and
+ *  every SIMD kernel against the glm matrix products on
+ *  random transforms, with a count that leaves a tail for
+ *  the scalar code.
+ ***********************************************************/
+bool ValidateTransformKernels()
+{
+	const int count = 1003;
+	const float tolerance = 1.0e-5f;
+	std::vector<float> values[9];
+	bool bPassed = true;
+
+	srand(330);
+	for (int stream = 0; stream < 9; stream++)
+	{
+		values[stream].resize(count);
+		for (int i = 0; i < count; i++)
+		{
+			float unit = (float)rand() / (float)RAND_MAX;
+			// scales, then rotations in degrees, then positions
+			if (stream < 3)
+				values[stream][i] = unit * 20.0f - 10.0f;
+			else if (stream < 6)
+				values[stream][i] = unit * 1440.0f - 720.0f;
+			else
+				values[stream][i] = unit * 200.0f - 100.0f;
+		}
+	}
+
+	TRANSFORM_STREAMS streams;
+	streams.scaleX = values[0].data();
+	streams.scaleY = values[1].data();
+	streams.scaleZ = values[2].data();
+	streams.rotationX = values[3].data();
+	streams.rotationY = values[4].data();
+	streams.rotationZ = values[5].data();
+	streams.positionX = values[6].data();
+	streams.positionY = values[7].data();
+	streams.positionZ = values[8].data();
+
+	std::vector<glm::mat4> reference(count);
+	std::vector<glm::mat4> result(count);
+	ComposeReference(streams, count, reference.data());
+
+	ComposeTransformsScalar(streams, count, result.data());
+	bPassed = ReportKernel("scalar", CompareKernel(reference, result), tolerance) && bPassed;
+#if defined(BATCH_TRANSFORMS_SSE)
+	{
+		int done = ComposeKernel<SSE_OPS>(streams, count, result.data());
+		ComposeTail(streams, done, count, result.data());
+		bPassed = ReportKernel("SSE2", CompareKernel(reference, result), tolerance) && bPassed;
+	}
+#endif
+#if defined(BATCH_TRANSFORMS_AVX2)
+	{
+		int done = ComposeKernel<AVX2_OPS>(streams, count, result.data());
+		ComposeTail(streams, done, count, result.data());
+		bPassed = ReportKernel("AVX2", CompareKernel(reference, result), tolerance) && bPassed;
+	}
+#endif
+
+	return(bPassed);
+}
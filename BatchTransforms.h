@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchtransforms.h
+// ============
+// compose model matrices for many objects at once from scale, rotation
+// and position streams
+//
+//  The result for every object matches SceneManager::SetTransformations() -
+//  translation * rotationZ * rotationY * rotationX * scale - but the
+//  rotations are expanded in closed form and 4 (SSE) or 8 (AVX2) objects
+//  are computed per step.  The AVX2 kernel is used when the file is built
+//  with AVX2 enabled (/arch:AVX2 or -mavx2); otherwise SSE2 is used on x86
+//  and the scalar kernel everywhere else.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  TRANSFORM_STREAMS
+ *
+ *  Structure-of-arrays input for the batch composition.
+ *  Every pointer addresses count floats; the rotations are
+ *  in degrees, like the SetTransformations() parameters.
+ ***********************************************************/
+struct TRANSFORM_STREAMS
+{
+	const float* scaleX;
+	const float* scaleY;
+	const float* scaleZ;
+	const float* rotationX;
+	const float* rotationY;
+	const float* rotationZ;
+	const float* positionX;
+	const float* positionY;
+	const float* positionZ;
+};
+
+// compose the model matrices with the fastest kernel available
+void ComposeTransforms(
+	const TRANSFORM_STREAMS& streams,
+	int count,
+	glm::mat4* pModels);
+
+// compose the model matrices one object at a time with the
+// closed form, which the SIMD kernels use for the tails
+void ComposeTransformsScalar(
+	const TRANSFORM_STREAMS& streams,
+	int count,
+	glm::mat4* pModels);
+
+// get the name of the kernel used by ComposeTransforms()
+const char* GetTransformKernelName();
+
+// compare the scalar and SIMD kernels with the glm matrix
+// products of SetTransformations() on random transforms -
+// prints the largest error of every kernel and returns
+// false when one of them does not agree
+bool ValidateTransformKernels();
@@ -0,0 +1,202 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.cpp
+// ============
+// recording and replay of the camera's path through the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// path file identification and layout version
+	const char g_FileMagic[4] = { 'C', 'P', 'T', 'H' };
+	const int32_t g_FileVersion = 1;
+
+	// order of poses by their time
+	bool IsEarlier(const CameraPath::CAMERA_POSE& pose, float time)
+	{
+		return(pose.time < time);
+	}
+}
+
+/***********************************************************
+ *  CameraPath()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraPath::CameraPath()
+{
+	m_recordStartTime = 0.0;
+	m_lastRecordedTime = 0.0f;
+	m_bRecordStarted = false;
+	m_replayStartTime = 0.0;
+	m_bReplayStarted = false;
+	m_bReplaying = false;
+}
+
+/***********************************************************
+ *  ~CameraPath()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraPath::~CameraPath()
+{
+	StopRecording();
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method is used for opening a path file.  The poses
+ *  follow a small header until the file is closed.
+ ***********************************************************/
+bool CameraPath::StartRecording(const char* filename)
+{
+	StopRecording();
+
+	m_recordFile.open(filename, std::ios::binary);
+	if (!m_recordFile)
+	{
+		std::cout << "Could not write camera path:" << filename << std::endl;
+		return(false);
+	}
+
+	m_recordFile.write(g_FileMagic, sizeof(g_FileMagic));
+	m_recordFile.write((const char*)&g_FileVersion, sizeof(g_FileVersion));
+	m_bRecordStarted = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopRecording()
+ *
+ *  This method is used for closing the path file.
+ ***********************************************************/
+void CameraPath::StopRecording()
+{
+	if (m_recordFile.is_open())
+	{
+		m_recordFile.close();
+	}
+}
+
+/***********************************************************
+ *  RecordPose()
+ *
+ *  This method is used for writing the pose of a frame,
+ *  with its time from the first recorded frame.
+ ***********************************************************/
+void CameraPath::RecordPose(double clockTime, const CAMERA_POSE& pose)
+{
+	if (m_recordFile.is_open() == false)
+	{
+		return;
+	}
+
+	if (m_bRecordStarted == false)
+	{
+		m_recordStartTime = clockTime;
+		m_lastRecordedTime = -1.0f;
+		m_bRecordStarted = true;
+	}
+
+	CAMERA_POSE recorded = pose;
+	recorded.time = (float)(clockTime - m_recordStartTime);
+	if (recorded.time <= m_lastRecordedTime)
+	{
+		return;
+	}
+	m_recordFile.write((const char*)&recorded, sizeof(recorded));
+	m_lastRecordedTime = recorded.time;
+}
+
+/***********************************************************
+ *  StartReplay()
+ *
+ *  This method is used for reading a path file written by
+ *  StartRecording().
+ ***********************************************************/
+bool CameraPath::StartReplay(const char* filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not read camera path:" << filename << std::endl;
+		return(false);
+	}
+
+	char magic[4];
+	int32_t version = 0;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	if (!file || (memcmp(magic, g_FileMagic, sizeof(magic)) != 0) || (version != g_FileVersion))
+	{
+		std::cout << "Not a supported camera path:" << filename << std::endl;
+		return(false);
+	}
+
+	std::vector<CAMERA_POSE> poses;
+	CAMERA_POSE pose;
+	while (file.read((char*)&pose, sizeof(pose)))
+	{
+		poses.push_back(pose);
+	}
+	if (poses.empty())
+	{
+		std::cout << "Camera path has no poses:" << filename << std::endl;
+		return(false);
+	}
+
+	m_poses.swap(poses);
+	m_bReplayStarted = false;
+	m_bReplaying.store(true, std::memory_order_release);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SamplePose()
+ *
+ *  This method is used for getting the pose at a time of
+ *  the replay, blended between the poses recorded around
+ *  it.  The projection mode switches at the later pose.
+ ***********************************************************/
+CameraPath::CAMERA_POSE CameraPath::SamplePose(double clockTime)
+{
+	if (m_bReplayStarted == false)
+	{
+		m_replayStartTime = clockTime;
+		m_bReplayStarted = true;
+	}
+
+	float time = (float)(clockTime - m_replayStartTime);
+	std::vector<CAMERA_POSE>::const_iterator next =
+		std::lower_bound(m_poses.begin(), m_poses.end(), time, IsEarlier);
+	if (next == m_poses.end())
+	{
+		m_bReplaying.store(false, std::memory_order_release);
+		return(m_poses.back());
+	}
+	if (next == m_poses.begin())
+	{
+		return(m_poses.front());
+	}
+
+	const CAMERA_POSE& previous = *(next - 1);
+	float blend = (time - previous.time) / (next->time - previous.time);
+	CAMERA_POSE pose;
+	pose.time = time;
+	pose.position = glm::mix(previous.position, next->position, blend);
+	pose.front = glm::mix(previous.front, next->front, blend);
+	pose.up = glm::mix(previous.up, next->up, blend);
+	pose.zoom = glm::mix(previous.zoom, next->zoom, blend);
+	pose.bOrthographic = next->bOrthographic;
+
+	return(pose);
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerapath.h
+// ============
+// recording and replay of the camera's path through the scene
+//
+//  The pose of the camera shown in each frame is written with its time on
+//  the simulation clock, counted from the first recorded frame.  A replay
+//  reads the poses back and gives the pose at any time between them, so
+//  the camera follows the recorded path at the speed it was recorded at,
+//  whatever the frame rate of the replay.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/***********************************************************
+ *  CameraPath
+ *
+ *  This class contains the recording file and the poses of
+ *  a path being replayed.
+ ***********************************************************/
+class CameraPath
+{
+public:
+	// pose of the camera at a time in seconds from the start
+	// of the path
+	struct CAMERA_POSE
+	{
+		float time;
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float zoom;
+		int32_t bOrthographic;
+	};
+
+	// constructor
+	CameraPath();
+	// destructor
+	~CameraPath();
+
+	// write the poses passed to RecordPose() to a file
+	bool StartRecording(const char* filename);
+	// close the recording file
+	void StopRecording();
+	bool IsRecording() const { return(m_recordFile.is_open()); }
+	// write the pose shown at a time on the simulation clock -
+	// poses that are not later than the last one are skipped
+	void RecordPose(double clockTime, const CAMERA_POSE& pose);
+
+	// read a recorded path to replay from the next frame on
+	bool StartReplay(const char* filename);
+	// true until the replay has passed the last pose - only
+	// SamplePose() ends it, so other threads should take the
+	// end from the frames it sampled
+	bool IsReplaying() const { return(m_bReplaying.load(std::memory_order_acquire)); }
+	// get the pose at a time on the simulation clock - the
+	// first call sets the start of the path, and a time past
+	// the end gives the last pose and ends the replay
+	CAMERA_POSE SamplePose(double clockTime);
+
+private:
+	// recording file, the clock time of its first pose and
+	// the time of the last pose written
+	std::ofstream m_recordFile;
+	double m_recordStartTime;
+	float m_lastRecordedTime;
+	bool m_bRecordStarted;
+	// poses being replayed and the clock time the replay
+	// started at
+	std::vector<CAMERA_POSE> m_poses;
+	double m_replayStartTime;
+	bool m_bReplayStarted;
+	std::atomic<bool> m_bReplaying;
+};
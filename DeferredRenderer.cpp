@@ -0,0 +1,845 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.cpp
+// ============
+// deferred shading - a G-buffer pass and a lighting pass over light volumes
+//
+//  The lighting follows the same rules as the lightmap baker - every light
+//  adds its ambient term, times the attenuation for point and spot lights,
+//  and its diffuse and specular terms times the spot cone, and a baked
+//  texel stands in for the ambient and diffuse terms of every light.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DeferredRenderer.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// geometry pass - the surface values of the closest object
+	const char* g_GeometryVertexSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 position;\n"
+		"layout(location = 1) in vec3 normal;\n"
+		"layout(location = 2) in vec2 textureCoordinate;\n"
+		"layout(location = 3) in vec2 lightmapCoordinate;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"out vec3 worldNormal;\n"
+		"out vec2 texCoord;\n"
+		"out vec2 lightmapCoord;\n"
+		"void main()\n"
+		"{\n"
+		"    worldNormal = mat3(transpose(inverse(model))) * normal;\n"
+		"    texCoord = textureCoordinate;\n"
+		"    lightmapCoord = lightmapCoordinate;\n"
+		"    gl_Position = projection * view * model * vec4(position, 1.0);\n"
+		"}\n";
+	const char* g_GeometryFragmentSource =
+		"#version 330 core\n"
+		"in vec3 worldNormal;\n"
+		"in vec2 texCoord;\n"
+		"in vec2 lightmapCoord;\n"
+		"layout(location = 0) out vec4 albedo;\n"
+		"layout(location = 1) out vec4 normalShininess;\n"
+		"layout(location = 2) out vec4 diffuseMaterial;\n"
+		"layout(location = 3) out vec4 specularMaterial;\n"
+		"layout(location = 4) out vec4 bakedLight;\n"
+		"uniform vec4 objectColor;\n"
+		"uniform bool bUseTexture;\n"
+		"uniform sampler2D objectTexture;\n"
+		"uniform vec3 diffuseColor;\n"
+		"uniform vec3 specularColor;\n"
+		"uniform float shininess;\n"
+		"uniform sampler2D lightmapTexture;\n"
+		"uniform vec4 lightmapRect;\n"
+		"void main()\n"
+		"{\n"
+		"    vec3 color = bUseTexture ? texture(objectTexture, texCoord).rgb : objectColor.rgb;\n"
+		"    albedo = vec4(color, 1.0);\n"
+		"    normalShininess = vec4(normalize(worldNormal), shininess);\n"
+		"    diffuseMaterial = vec4(diffuseColor, 1.0);\n"
+		"    specularMaterial = vec4(specularColor, 1.0);\n"
+		"    bakedLight = vec4(0.0);\n"
+		"    if (lightmapRect.z > 0.0)\n"
+		"    {\n"
+		"        vec2 uv = lightmapRect.xy + lightmapCoord * lightmapRect.zw;\n"
+		"        bakedLight = vec4(texture(lightmapTexture, uv).rgb, 1.0);\n"
+		"    }\n"
+		"}\n";
+
+	// G-buffer reads and the light model shared by both
+	// lighting programs
+	const char* g_LightingCommonSource =
+		"#version 330 core\n"
+		"uniform sampler2D albedoTexture;\n"
+		"uniform sampler2D normalTexture;\n"
+		"uniform sampler2D diffuseTexture;\n"
+		"uniform sampler2D specularTexture;\n"
+		"uniform sampler2D bakedTexture;\n"
+		"uniform sampler2D depthTexture;\n"
+		"uniform sampler2D ambientOcclusionTexture;\n"
+		"uniform bool bUseAmbientOcclusion;\n"
+		"uniform mat4 inverseViewProjection;\n"
+		"uniform vec3 viewPosition;\n"
+		"uniform vec2 viewportSize;\n"
+		"out vec4 fragmentColor;\n"
+		"struct SURFACE\n"
+		"{\n"
+		"    vec3 albedo;\n"
+		"    vec3 position;\n"
+		"    vec3 normal;\n"
+		"    float shininess;\n"
+		"    vec3 diffuse;\n"
+		"    vec3 specular;\n"
+		"    vec4 baked;\n"
+		"    float occlusion;\n"
+		"};\n"
+		"bool ReadSurface(ivec2 texel, out SURFACE surface)\n"
+		"{\n"
+		"    vec4 albedo = texelFetch(albedoTexture, texel, 0);\n"
+		"    if (albedo.a == 0.0)\n"
+		"    {\n"
+		"        return false;\n"
+		"    }\n"
+		"    float depth = texelFetch(depthTexture, texel, 0).r;\n"
+		"    vec2 ndc = (vec2(texel) + 0.5) / viewportSize * 2.0 - 1.0;\n"
+		"    vec4 world = inverseViewProjection * vec4(ndc, depth * 2.0 - 1.0, 1.0);\n"
+		"    vec4 normalShininess = texelFetch(normalTexture, texel, 0);\n"
+		"    surface.albedo = albedo.rgb;\n"
+		"    surface.position = world.xyz / world.w;\n"
+		"    surface.normal = normalize(normalShininess.xyz);\n"
+		"    surface.shininess = normalShininess.w;\n"
+		"    surface.diffuse = texelFetch(diffuseTexture, texel, 0).rgb;\n"
+		"    surface.specular = texelFetch(specularTexture, texel, 0).rgb;\n"
+		"    surface.baked = texelFetch(bakedTexture, texel, 0);\n"
+		"    surface.occlusion = bUseAmbientOcclusion ? texelFetch(ambientOcclusionTexture, texel, 0).r : 1.0;\n"
+		"    return true;\n"
+		"}\n"
+		"vec3 ShadeLight(SURFACE surface, vec3 toLight, vec3 ambient, vec3 diffuse, vec3 specular,\n"
+		"    float attenuation, float intensity)\n"
+		"{\n"
+		"    float diffuseFactor = max(dot(surface.normal, toLight), 0.0);\n"
+		"    float specularFactor = 0.0;\n"
+		"    if (diffuseFactor > 0.0)\n"
+		"    {\n"
+		"        vec3 viewDirection = normalize(viewPosition - surface.position);\n"
+		"        vec3 reflectDirection = reflect(-toLight, surface.normal);\n"
+		"        specularFactor = pow(max(dot(viewDirection, reflectDirection), 0.0), surface.shininess);\n"
+		"    }\n"
+		"    vec3 result = specular * specularFactor * surface.specular * intensity;\n"
+		"    if (surface.baked.a == 0.0)\n"
+		"    {\n"
+		"        result += (ambient * surface.occlusion + diffuse * diffuseFactor * intensity) * surface.diffuse;\n"
+		"    }\n"
+		"    return result * attenuation * surface.albedo;\n"
+		"}\n";
+
+	// one triangle covering the screen, without vertex data
+	const char* g_ScreenVertexSource =
+		"#version 330 core\n"
+		"void main()\n"
+		"{\n"
+		"    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+		"}\n";
+	// directional lights, with the cascaded shadows on one of
+	// them, and the baked light
+	const char* g_ScreenFragmentSource =
+		"uniform int directionalCount;\n"
+		"uniform vec3 lightDirections[4];\n"
+		"uniform vec3 lightAmbient[4];\n"
+		"uniform vec3 lightDiffuse[4];\n"
+		"uniform vec3 lightSpecular[4];\n"
+		"uniform int shadowLight;\n"
+		"uniform sampler2DArrayShadow shadowMap;\n"
+		"uniform int cascadeCount;\n"
+		"uniform vec4 cascadeSplits;\n"
+		"uniform mat4 lightSpaceMatrices[4];\n"
+		"uniform mat4 view;\n"
+		"float CalculateShadow(vec3 position)\n"
+		"{\n"
+		"    float viewDepth = -(view * vec4(position, 1.0)).z;\n"
+		"    for (int cascade = 0; cascade < cascadeCount; cascade++)\n"
+		"    {\n"
+		"        if (viewDepth < cascadeSplits[cascade])\n"
+		"        {\n"
+		"            vec4 lightClip = lightSpaceMatrices[cascade] * vec4(position, 1.0);\n"
+		"            vec3 coords = (lightClip.xyz / lightClip.w) * 0.5 + 0.5;\n"
+		"            return texture(shadowMap, vec4(coords.xy, float(cascade), coords.z));\n"
+		"        }\n"
+		"    }\n"
+		"    return 1.0;\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"    SURFACE surface;\n"
+		"    if (!ReadSurface(ivec2(gl_FragCoord.xy), surface))\n"
+		"    {\n"
+		"        discard;\n"
+		"    }\n"
+		"    vec3 color = surface.baked.rgb * surface.diffuse * surface.albedo;\n"
+		"    for (int i = 0; i < directionalCount; i++)\n"
+		"    {\n"
+		"        float shadow = (i == shadowLight) ? CalculateShadow(surface.position) : 1.0;\n"
+		"        color += ShadeLight(surface, -normalize(lightDirections[i]),\n"
+		"            lightAmbient[i], lightDiffuse[i], lightSpecular[i], 1.0, shadow);\n"
+		"    }\n"
+		"    fragmentColor = vec4(color, 1.0);\n"
+		"}\n";
+
+	// light volume - a box around the range of each instance
+	const char* g_VolumeVertexSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 position;\n"
+		"layout(location = 1) in vec4 positionRange;\n"
+		"layout(location = 2) in vec4 directionSpot;\n"
+		"layout(location = 3) in vec4 ambientInner;\n"
+		"layout(location = 4) in vec4 diffuseOuter;\n"
+		"layout(location = 5) in vec4 specular;\n"
+		"uniform mat4 viewProjection;\n"
+		"flat out vec4 lightPositionRange;\n"
+		"flat out vec4 lightDirectionSpot;\n"
+		"flat out vec4 lightAmbientInner;\n"
+		"flat out vec4 lightDiffuseOuter;\n"
+		"flat out vec3 lightSpecular;\n"
+		"void main()\n"
+		"{\n"
+		"    lightPositionRange = positionRange;\n"
+		"    lightDirectionSpot = directionSpot;\n"
+		"    lightAmbientInner = ambientInner;\n"
+		"    lightDiffuseOuter = diffuseOuter;\n"
+		"    lightSpecular = specular.rgb;\n"
+		"    gl_Position = viewProjection * vec4(positionRange.xyz + position * positionRange.w, 1.0);\n"
+		"}\n";
+	// point and spot lights, with the attenuation of
+	// LightManager::CalculateAttenuation()
+	const char* g_VolumeFragmentSource =
+		"flat in vec4 lightPositionRange;\n"
+		"flat in vec4 lightDirectionSpot;\n"
+		"flat in vec4 lightAmbientInner;\n"
+		"flat in vec4 lightDiffuseOuter;\n"
+		"flat in vec3 lightSpecular;\n"
+		"void main()\n"
+		"{\n"
+		"    SURFACE surface;\n"
+		"    if (!ReadSurface(ivec2(gl_FragCoord.xy), surface))\n"
+		"    {\n"
+		"        discard;\n"
+		"    }\n"
+		"    vec3 toLight = lightPositionRange.xyz - surface.position;\n"
+		"    float lightDistance = length(toLight);\n"
+		"    if ((lightDistance > lightPositionRange.w) || (lightDistance <= 0.0))\n"
+		"    {\n"
+		"        discard;\n"
+		"    }\n"
+		"    toLight /= lightDistance;\n"
+		"    float attenuation = 1.0 / (1.0 + 0.09 * lightDistance + 0.032 * lightDistance * lightDistance);\n"
+		"    float intensity = 1.0;\n"
+		"    if (lightDirectionSpot.w > 0.0)\n"
+		"    {\n"
+		"        float theta = dot(toLight, -normalize(lightDirectionSpot.xyz));\n"
+		"        float epsilon = lightAmbientInner.w - lightDiffuseOuter.w;\n"
+		"        intensity = (epsilon > 0.0) ?\n"
+		"            clamp((theta - lightDiffuseOuter.w) / epsilon, 0.0, 1.0) :\n"
+		"            ((theta >= lightDiffuseOuter.w) ? 1.0 : 0.0);\n"
+		"    }\n"
+		"    fragmentColor = vec4(ShadeLight(surface, toLight, lightAmbientInner.rgb,\n"
+		"        lightDiffuseOuter.rgb, lightSpecular, attenuation, intensity), 1.0);\n"
+		"}\n";
+
+	// names of the G-buffer samplers, in target order with the
+	// depth last
+	const char* g_TargetSamplerNames[] = {
+		"albedoTexture",
+		"normalTexture",
+		"diffuseTexture",
+		"specularTexture",
+		"bakedTexture",
+		"depthTexture" };
+
+	// G-buffer target formats - normals and baked light need
+	// more range and precision than the colors
+	const GLenum g_TargetFormats[] = { GL_RGBA8, GL_RGBA16F, GL_RGBA8, GL_RGBA8, GL_RGBA16F };
+}
+
+/***********************************************************
+ *  DeferredRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DeferredRenderer::DeferredRenderer()
+{
+	m_width = 0;
+	m_height = 0;
+	m_firstTextureUnit = 0;
+	m_view = glm::mat4(1.0f);
+	m_projection = glm::mat4(1.0f);
+	m_geometryFramebufferID = 0;
+	for (int i = 0; i < GBUFFER_TARGETS; i++)
+	{
+		m_targetTextureIDs[i] = 0;
+	}
+	m_depthTextureID = 0;
+	m_volumeVertexArrayID = 0;
+	m_volumeBufferIDs[0] = 0;
+	m_volumeBufferIDs[1] = 0;
+	m_instanceBufferID = 0;
+	m_emptyVertexArrayID = 0;
+	m_geometryProgramID = 0;
+	m_screenProgramID = 0;
+	m_volumeProgramID = 0;
+	m_modelLocation = -1;
+	m_colorLocation = -1;
+	m_useTextureLocation = -1;
+	m_textureLocation = -1;
+	m_lightmapRectLocation = -1;
+	m_savedFramebuffer = 0;
+}
+
+/***********************************************************
+ *  ~DeferredRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DeferredRenderer::~DeferredRenderer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the G-buffer targets,
+ *  the light volume mesh and the three programs.
+ ***********************************************************/
+bool DeferredRenderer::Create(int width, int height, int firstTextureUnit)
+{
+	Destroy();
+
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	m_width = width;
+	m_height = height;
+	m_firstTextureUnit = firstTextureUnit;
+
+	std::string screenSource = std::string(g_LightingCommonSource) + g_ScreenFragmentSource;
+	std::string volumeSource = std::string(g_LightingCommonSource) + g_VolumeFragmentSource;
+	m_geometryProgramID = CreateProgram(g_GeometryVertexSource, g_GeometryFragmentSource, "geometry");
+	m_screenProgramID = CreateProgram(g_ScreenVertexSource, screenSource.c_str(), "screen lighting");
+	m_volumeProgramID = CreateProgram(g_VolumeVertexSource, volumeSource.c_str(), "volume lighting");
+	if ((m_geometryProgramID == 0) || (m_screenProgramID == 0) || (m_volumeProgramID == 0))
+	{
+		Destroy();
+		return(false);
+	}
+	m_modelLocation = glGetUniformLocation(m_geometryProgramID, "model");
+	m_colorLocation = glGetUniformLocation(m_geometryProgramID, "objectColor");
+	m_useTextureLocation = glGetUniformLocation(m_geometryProgramID, "bUseTexture");
+	m_textureLocation = glGetUniformLocation(m_geometryProgramID, "objectTexture");
+	m_lightmapRectLocation = glGetUniformLocation(m_geometryProgramID, "lightmapRect");
+
+	glGenTextures(GBUFFER_TARGETS, m_targetTextureIDs);
+	for (int i = 0; i < GBUFFER_TARGETS; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_targetTextureIDs[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, g_TargetFormats[i], m_width, m_height, 0, GL_RGBA, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// depth with stencil, the usual format of the window, so
+	// the depth can be copied into it after the lighting
+	glGenTextures(1, &m_depthTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_depthTextureID);
+	glTexImage2D(
+		GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, m_width, m_height,
+		0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	GLenum drawBuffers[GBUFFER_TARGETS];
+	glGenFramebuffers(1, &m_geometryFramebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_geometryFramebufferID);
+	for (int i = 0; i < GBUFFER_TARGETS; i++)
+	{
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+		glFramebufferTexture2D(GL_FRAMEBUFFER, drawBuffers[i], GL_TEXTURE_2D, m_targetTextureIDs[i], 0);
+	}
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTextureID, 0);
+	glDrawBuffers(GBUFFER_TARGETS, drawBuffers);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "G-buffer framebuffer is not complete" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	CreateVolumeMesh();
+	glGenVertexArrays(1, &m_emptyVertexArrayID);
+
+	// the G-buffer samplers always read the same units
+	GLuint lightingPrograms[] = { m_screenProgramID, m_volumeProgramID };
+	for (int program = 0; program < 2; program++)
+	{
+		glUseProgram(lightingPrograms[program]);
+		for (int i = 0; i <= GBUFFER_TARGETS; i++)
+		{
+			glUniform1i(
+				glGetUniformLocation(lightingPrograms[program], g_TargetSamplerNames[i]),
+				m_firstTextureUnit + i);
+		}
+	}
+	glUseProgram(0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the G-buffer, the light
+ *  volume mesh and the programs.
+ ***********************************************************/
+void DeferredRenderer::Destroy()
+{
+	GLuint programs[] = { m_geometryProgramID, m_screenProgramID, m_volumeProgramID };
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (programs[i] != 0)
+		{
+			glDeleteProgram(programs[i]);
+		}
+	}
+	if (m_geometryFramebufferID != 0)
+	{
+		glDeleteFramebuffers(1, &m_geometryFramebufferID);
+	}
+	if (m_targetTextureIDs[0] != 0)
+	{
+		glDeleteTextures(GBUFFER_TARGETS, m_targetTextureIDs);
+	}
+	if (m_depthTextureID != 0)
+	{
+		glDeleteTextures(1, &m_depthTextureID);
+	}
+	if (m_volumeVertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &m_volumeVertexArrayID);
+		glDeleteBuffers(2, m_volumeBufferIDs);
+		glDeleteBuffers(1, &m_instanceBufferID);
+	}
+	if (m_emptyVertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArrayID);
+	}
+
+	m_geometryProgramID = 0;
+	m_screenProgramID = 0;
+	m_volumeProgramID = 0;
+	m_geometryFramebufferID = 0;
+	for (int i = 0; i < GBUFFER_TARGETS; i++)
+	{
+		m_targetTextureIDs[i] = 0;
+	}
+	m_depthTextureID = 0;
+	m_volumeVertexArrayID = 0;
+	m_volumeBufferIDs[0] = 0;
+	m_volumeBufferIDs[1] = 0;
+	m_instanceBufferID = 0;
+	m_emptyVertexArrayID = 0;
+}
+
+/***********************************************************
+ *  CreateVolumeMesh()
+ *
+ *  This method is used for creating the box that bounds the
+ *  range of a light, with its faces wound outward, and the
+ *  instance buffer that places one box per light.
+ ***********************************************************/
+void DeferredRenderer::CreateVolumeMesh()
+{
+	// corner i has x, y and z at +1 for bits 0, 1 and 2
+	GLfloat corners[8 * 3];
+	for (int i = 0; i < 8; i++)
+	{
+		corners[i * 3 + 0] = (i & 1) ? 1.0f : -1.0f;
+		corners[i * 3 + 1] = (i & 2) ? 1.0f : -1.0f;
+		corners[i * 3 + 2] = (i & 4) ? 1.0f : -1.0f;
+	}
+	GLuint indices[] = {
+		4, 5, 7, 4, 7, 6,
+		0, 2, 3, 0, 3, 1,
+		1, 3, 7, 1, 7, 5,
+		0, 4, 6, 0, 6, 2,
+		2, 6, 7, 2, 7, 3,
+		0, 1, 5, 0, 5, 4 };
+
+	glGenVertexArrays(1, &m_volumeVertexArrayID);
+	glBindVertexArray(m_volumeVertexArrayID);
+
+	glGenBuffers(2, m_volumeBufferIDs);
+	glBindBuffer(GL_ARRAY_BUFFER, m_volumeBufferIDs[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_volumeBufferIDs[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GLfloat) * 3, 0);
+	glEnableVertexAttribArray(0);
+
+	// five vec4 values per light, advanced once per instance
+	glGenBuffers(1, &m_instanceBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBufferID);
+	for (int i = 0; i < 5; i++)
+	{
+		GLuint location = 1 + i;
+		glVertexAttribPointer(
+			location, 4, GL_FLOAT, GL_FALSE, sizeof(LIGHT_INSTANCE),
+			(void*)(sizeof(glm::vec4) * i));
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  CreateProgram()
+ *
+ *  This method is used for compiling and linking one of the
+ *  deferred programs - returns 0 when it fails.
+ ***********************************************************/
+GLuint DeferredRenderer::CreateProgram(
+	const char* vertexSource,
+	const char* fragmentSource,
+	const char* name)
+{
+	const char* sources[2] = { vertexSource, fragmentSource };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint shaders[2] = { 0, 0 };
+	GLint success = 0;
+	char infoLog[512];
+
+	GLuint programID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+			std::cout << "Deferred " << name << " shader compilation failed\n" << infoLog << std::endl;
+		}
+		glAttachShader(programID, shaders[i]);
+	}
+	glLinkProgram(programID);
+	for (int i = 0; i < 2; i++)
+	{
+		glDeleteShader(shaders[i]);
+	}
+
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Deferred " << name << " program linking failed\n" << infoLog << std::endl;
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  BeginGeometry()
+ *
+ *  This method is used for binding and clearing the
+ *  G-buffer and setting up the geometry program.  A zero
+ *  albedo alpha marks the pixels no object covers.
+ ***********************************************************/
+void DeferredRenderer::BeginGeometry(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_view = view;
+	m_projection = projection;
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_geometryFramebufferID);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glUseProgram(m_geometryProgramID);
+	glUniformMatrix4fv(glGetUniformLocation(m_geometryProgramID, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(m_geometryProgramID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	glUniform4f(m_lightmapRectLocation, 0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+/***********************************************************
+ *  SetObject()
+ *
+ *  This method is used for setting the model matrix and the
+ *  color or texture of the next object.
+ ***********************************************************/
+void DeferredRenderer::SetObject(const glm::mat4& model, const glm::vec4& color, int textureSlot)
+{
+	glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+	glUniform4fv(m_colorLocation, 1, glm::value_ptr(color));
+	glUniform1i(m_useTextureLocation, textureSlot >= 0);
+	if (textureSlot >= 0)
+	{
+		glUniform1i(m_textureLocation, textureSlot);
+	}
+}
+
+/***********************************************************
+ *  SetMaterial()
+ *
+ *  This method is used for setting the material of the
+ *  next objects.
+ ***********************************************************/
+void DeferredRenderer::SetMaterial(glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess)
+{
+	glUniform3fv(glGetUniformLocation(m_geometryProgramID, "diffuseColor"), 1, glm::value_ptr(diffuseColor));
+	glUniform3fv(glGetUniformLocation(m_geometryProgramID, "specularColor"), 1, glm::value_ptr(specularColor));
+	glUniform1f(glGetUniformLocation(m_geometryProgramID, "shininess"), shininess);
+}
+
+/***********************************************************
+ *  SetLightmap()
+ *
+ *  This method is used for setting the lightmap unit and the
+ *  tile of the next object.
+ ***********************************************************/
+void DeferredRenderer::SetLightmap(int textureUnit, const glm::vec4& lightmapRect)
+{
+	glUniform1i(glGetUniformLocation(m_geometryProgramID, "lightmapTexture"), textureUnit);
+	glUniform4fv(m_lightmapRectLocation, 1, glm::value_ptr(lightmapRect));
+}
+
+/***********************************************************
+ *  EndGeometry()
+ *
+ *  This method is used for binding the framebuffer of the
+ *  caller again.  Blending is turned back on for the scene.
+ ***********************************************************/
+void DeferredRenderer::EndGeometry()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+	glEnable(GL_BLEND);
+}
+
+/***********************************************************
+ *  RenderLighting()
+ *
+ *  This method is used for lighting the G-buffer into the
+ *  bound framebuffer and copying the G-buffer depth there,
+ *  so that anything drawn forward afterwards is hidden by
+ *  the deferred surfaces.
+ ***********************************************************/
+void DeferredRenderer::RenderLighting(const LIGHTING_INPUTS& inputs)
+{
+	for (int i = 0; i < GBUFFER_TARGETS; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + m_firstTextureUnit + i);
+		glBindTexture(GL_TEXTURE_2D, m_targetTextureIDs[i]);
+	}
+	glActiveTexture(GL_TEXTURE0 + m_firstTextureUnit + GBUFFER_TARGETS);
+	glBindTexture(GL_TEXTURE_2D, m_depthTextureID);
+	glActiveTexture(GL_TEXTURE0);
+
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+
+	glDisable(GL_BLEND);
+	RenderScreenPass(inputs);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	RenderVolumePass(inputs);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glDepthMask(GL_TRUE);
+	glEnable(GL_DEPTH_TEST);
+
+	// only the part the viewport covers was rendered, which
+	// is less than the targets while the resolution is scaled
+	GLint drawFramebuffer = 0;
+	GLint viewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLint width = glm::min((int)viewport[2], m_width);
+	GLint height = glm::min((int)viewport[3], m_height);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_geometryFramebufferID);
+	glBlitFramebuffer(
+		0, 0, width, height,
+		0, 0, width, height,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, drawFramebuffer);
+}
+
+/***********************************************************
+ *  SetLightingInputs()
+ *
+ *  This method is used for binding a lighting program and
+ *  setting the camera and the ambient occlusion it reads.
+ ***********************************************************/
+void DeferredRenderer::SetLightingInputs(GLuint programID, const LIGHTING_INPUTS& inputs)
+{
+	glm::mat4 inverseViewProjection = glm::inverse(m_projection * m_view);
+	glm::vec3 viewPosition = glm::vec3(glm::inverse(m_view)[3]);
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glUseProgram(programID);
+	glUniformMatrix4fv(
+		glGetUniformLocation(programID, "inverseViewProjection"), 1, GL_FALSE,
+		glm::value_ptr(inverseViewProjection));
+	glUniform3fv(glGetUniformLocation(programID, "viewPosition"), 1, glm::value_ptr(viewPosition));
+	glUniform2f(glGetUniformLocation(programID, "viewportSize"), (float)viewport[2], (float)viewport[3]);
+	glUniform1i(glGetUniformLocation(programID, "bUseAmbientOcclusion"), inputs.occlusionTextureUnit >= 0);
+	if (inputs.occlusionTextureUnit >= 0)
+	{
+		glUniform1i(glGetUniformLocation(programID, "ambientOcclusionTexture"), inputs.occlusionTextureUnit);
+	}
+}
+
+/***********************************************************
+ *  RenderScreenPass()
+ *
+ *  This method is used for applying the baked light and the
+ *  enabled directional lights to every covered pixel.  The
+ *  first of them is shadowed by the cascades when they were
+ *  rendered this frame.
+ ***********************************************************/
+void DeferredRenderer::RenderScreenPass(const LIGHTING_INPUTS& inputs)
+{
+	const std::vector<LightManager::LIGHT>& lights = *inputs.pLights;
+	int directionalCount = 0;
+
+	SetLightingInputs(m_screenProgramID, inputs);
+
+	for (size_t i = 0; (i < lights.size()) && (directionalCount < MAX_DIRECTIONAL_LIGHTS); i++)
+	{
+		const LightManager::LIGHT& light = lights[i];
+		if ((light.type != LightManager::LIGHT_DIRECTIONAL) || (light.bEnabled == false))
+		{
+			continue;
+		}
+
+		std::string index = "[" + std::to_string(directionalCount) + "]";
+		glUniform3fv(glGetUniformLocation(m_screenProgramID, ("lightDirections" + index).c_str()), 1, glm::value_ptr(light.direction));
+		glUniform3fv(glGetUniformLocation(m_screenProgramID, ("lightAmbient" + index).c_str()), 1, glm::value_ptr(light.ambient));
+		glUniform3fv(glGetUniformLocation(m_screenProgramID, ("lightDiffuse" + index).c_str()), 1, glm::value_ptr(light.diffuse));
+		glUniform3fv(glGetUniformLocation(m_screenProgramID, ("lightSpecular" + index).c_str()), 1, glm::value_ptr(light.specular));
+		directionalCount++;
+	}
+	glUniform1i(glGetUniformLocation(m_screenProgramID, "directionalCount"), directionalCount);
+
+	// the cascades follow the first enabled directional light
+	const ShadowCascades::SHADOW_FRAME* pShadows = inputs.pShadowFrame;
+	bool bShadows = (inputs.shadowTextureUnit >= 0) && (NULL != pShadows) && (pShadows->cascadeCount > 0);
+	glUniform1i(glGetUniformLocation(m_screenProgramID, "shadowLight"), bShadows ? 0 : -1);
+	if (bShadows)
+	{
+		glm::vec4 splits(0.0f);
+		for (int cascade = 0; cascade < pShadows->cascadeCount; cascade++)
+		{
+			splits[cascade] = pShadows->splitDepths[cascade];
+		}
+		glUniform1i(glGetUniformLocation(m_screenProgramID, "shadowMap"), inputs.shadowTextureUnit);
+		glUniform1i(glGetUniformLocation(m_screenProgramID, "cascadeCount"), pShadows->cascadeCount);
+		glUniform4fv(glGetUniformLocation(m_screenProgramID, "cascadeSplits"), 1, glm::value_ptr(splits));
+		glUniformMatrix4fv(
+			glGetUniformLocation(m_screenProgramID, "lightSpaceMatrices"), pShadows->cascadeCount, GL_FALSE,
+			glm::value_ptr(pShadows->lightViewProjection[0]));
+		glUniformMatrix4fv(glGetUniformLocation(m_screenProgramID, "view"), 1, GL_FALSE, glm::value_ptr(m_view));
+	}
+
+	glBindVertexArray(m_emptyVertexArrayID);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  RenderVolumePass()
+ *
+ *  This method is used for adding every enabled point and
+ *  spot light to the pixels inside its volume, with one
+ *  instanced draw.  Only the back faces of the boxes are
+ *  drawn, so every pixel is shaded once per light, and a
+ *  camera inside a box still sees its light.
+ ***********************************************************/
+void DeferredRenderer::RenderVolumePass(const LIGHTING_INPUTS& inputs)
+{
+	const std::vector<LightManager::LIGHT>& lights = *inputs.pLights;
+
+	m_instances.clear();
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const LightManager::LIGHT& light = lights[i];
+		if ((light.type == LightManager::LIGHT_DIRECTIONAL) || (light.bEnabled == false) || (light.range <= 0.0f))
+		{
+			continue;
+		}
+
+		LIGHT_INSTANCE instance;
+		instance.positionRange = glm::vec4(light.position, light.range);
+		instance.directionSpot = glm::vec4(light.direction, (light.type == LightManager::LIGHT_SPOT) ? 1.0f : 0.0f);
+		instance.ambientInner = glm::vec4(light.ambient, light.innerCutoff);
+		instance.diffuseOuter = glm::vec4(light.diffuse, light.outerCutoff);
+		instance.specular = glm::vec4(light.specular, 0.0f);
+		m_instances.push_back(instance);
+	}
+	if (m_instances.empty())
+	{
+		return;
+	}
+
+	SetLightingInputs(m_volumeProgramID, inputs);
+	glm::mat4 viewProjection = m_projection * m_view;
+	glUniformMatrix4fv(glGetUniformLocation(m_volumeProgramID, "viewProjection"), 1, GL_FALSE, glm::value_ptr(viewProjection));
+
+	// a new store every frame, so the GPU never waits on the
+	// instances of an earlier frame
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBufferID);
+	glBufferData(
+		GL_ARRAY_BUFFER, m_instances.size() * sizeof(LIGHT_INSTANCE),
+		m_instances.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	GLboolean bCullFace = glIsEnabled(GL_CULL_FACE);
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_FRONT);
+
+	glBindVertexArray(m_volumeVertexArrayID);
+	glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)0, (GLsizei)m_instances.size());
+	glBindVertexArray(0);
+
+	glCullFace(GL_BACK);
+	if (bCullFace == GL_FALSE)
+	{
+		glDisable(GL_CULL_FACE);
+	}
+}
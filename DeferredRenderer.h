@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.h
+// ============
+// deferred shading - a G-buffer pass and a lighting pass over light volumes
+//
+//  The geometry pass writes the surface of every pixel - albedo, normal,
+//  material and baked light - into the G-buffer, and the lights are then
+//  applied in screen space.  The directional lights and the ambient terms
+//  cover the screen once, and every point and spot light only shades the
+//  pixels inside the box around its range, in one instanced draw.  The
+//  cost of a light follows its size on screen, not the number of objects.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightManager.h"
+#include "ShadowCascades.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  DeferredRenderer
+ *
+ *  This class contains the G-buffer, the geometry and
+ *  lighting programs and the light volume mesh.
+ ***********************************************************/
+class DeferredRenderer
+{
+public:
+	// most directional lights the screen pass applies
+	static const int MAX_DIRECTIONAL_LIGHTS = 4;
+
+	// textures and data the lighting pass reads besides the
+	// G-buffer - a unit of -1 leaves the effect out
+	struct LIGHTING_INPUTS
+	{
+		const std::vector<LightManager::LIGHT>* pLights;
+		const ShadowCascades::SHADOW_FRAME* pShadowFrame;
+		int shadowTextureUnit;
+		int occlusionTextureUnit;
+	};
+
+	// constructor
+	DeferredRenderer();
+	// destructor
+	~DeferredRenderer();
+
+	// create the G-buffer at the passed in size and the
+	// programs - the G-buffer textures are bound to the units
+	// from firstTextureUnit on during the lighting pass
+	bool Create(int width, int height, int firstTextureUnit);
+	// free the deferred resources
+	void Destroy();
+	bool IsValid() const { return(m_geometryFramebufferID != 0); }
+
+	// bind and clear the G-buffer and set up the geometry
+	// program with the frame camera
+	void BeginGeometry(const glm::mat4& view, const glm::mat4& projection);
+	// set the placement and color of the next object - a
+	// texture slot of -1 uses the color
+	void SetObject(const glm::mat4& model, const glm::vec4& color, int textureSlot);
+	// set the material of the next objects
+	void SetMaterial(glm::vec3 diffuseColor, glm::vec3 specularColor, float shininess);
+	// set the baked light of the next object - a zero scale
+	// lights it at runtime
+	void SetLightmap(int textureUnit, const glm::vec4& lightmapRect);
+	// restore the framebuffer that was bound before the
+	// geometry pass
+	void EndGeometry();
+
+	// light the G-buffer into the bound framebuffer and copy
+	// the G-buffer depth into it for the passes that follow -
+	// the caller binds its own program again
+	void RenderLighting(const LIGHTING_INPUTS& inputs);
+
+private:
+	// point or spot light as one instance of the volume mesh
+	struct LIGHT_INSTANCE
+	{
+		// position, and range
+		glm::vec4 positionRange;
+		// spot direction, and 1 for a spot light
+		glm::vec4 directionSpot;
+		// w - cosine of the inner spot cone
+		glm::vec4 ambientInner;
+		// w - cosine of the outer spot cone
+		glm::vec4 diffuseOuter;
+		glm::vec4 specular;
+	};
+
+	// G-buffer size and the first unit of its textures
+	int m_width;
+	int m_height;
+	int m_firstTextureUnit;
+	// camera of the frame being rendered
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	// G-buffer - albedo, normal and shininess, diffuse and
+	// specular material, baked light, and depth
+	static const int GBUFFER_TARGETS = 5;
+	GLuint m_geometryFramebufferID;
+	GLuint m_targetTextureIDs[GBUFFER_TARGETS];
+	GLuint m_depthTextureID;
+	// light volume box and the per-light instance data
+	GLuint m_volumeVertexArrayID;
+	GLuint m_volumeBufferIDs[2];
+	GLuint m_instanceBufferID;
+	std::vector<LIGHT_INSTANCE> m_instances;
+	GLuint m_emptyVertexArrayID;
+	// programs
+	GLuint m_geometryProgramID;
+	GLuint m_screenProgramID;
+	GLuint m_volumeProgramID;
+	GLint m_modelLocation;
+	GLint m_colorLocation;
+	GLint m_useTextureLocation;
+	GLint m_textureLocation;
+	GLint m_lightmapRectLocation;
+	// framebuffer restored after the geometry pass
+	GLint m_savedFramebuffer;
+
+	// create the light volume box and its instance buffer
+	void CreateVolumeMesh();
+	// apply the directional lights, the ambient terms and the
+	// baked light over the whole screen
+	void RenderScreenPass(const LIGHTING_INPUTS& inputs);
+	// add the point and spot lights inside their volumes
+	void RenderVolumePass(const LIGHTING_INPUTS& inputs);
+	// set the G-buffer samplers and the camera of a lighting
+	// program
+	void SetLightingInputs(GLuint programID, const LIGHTING_INPUTS& inputs);
+	// compile and link a program from inline sources
+	static GLuint CreateProgram(
+		const char* vertexSource,
+		const char* fragmentSource,
+		const char* name);
+};
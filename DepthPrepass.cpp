@@ -0,0 +1,463 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.cpp
+// ============
+// depth-only prepass and a view of the lit fragments shaded per pixel
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DepthPrepass.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// vertex stage shared by the depth-only and the counting
+	// programs - invariant and the same expression as the
+	// scene vertex shader, so the depths match exactly
+	const char* g_DepthVertexSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 position;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"invariant gl_Position;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = projection * view * model * vec4(position, 1.0);\n"
+		"}\n";
+	const char* g_DepthFragmentSource =
+		"#version 330 core\n"
+		"void main()\n"
+		"{\n"
+		"}\n";
+
+	// one added per invocation - the depth test runs before
+	// the shader, as it does for the lighting, so every
+	// fragment the lighting would shade is counted once
+	const char* g_CountFragmentSource =
+		"#version 420 core\n"
+		"layout(early_fragment_tests) in;\n"
+		"layout(location = 0) out float count;\n"
+		"void main()\n"
+		"{\n"
+		"    count = 1.0;\n"
+		"}\n";
+
+	// one triangle covering the screen, without vertex data
+	const char* g_FullScreenVertexSource =
+		"#version 330 core\n"
+		"void main()\n"
+		"{\n"
+		"    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+		"}\n";
+
+	// counts as colors - black for none, then blue, green,
+	// yellow and red from one up to the top of the scale
+	const char* g_HeatMapFragmentSource =
+		"#version 330 core\n"
+		"out vec4 fragmentColor;\n"
+		"uniform sampler2D countTexture;\n"
+		"uniform float maxCount;\n"
+		"void main()\n"
+		"{\n"
+		"    float count = texelFetch(countTexture, ivec2(gl_FragCoord.xy), 0).r;\n"
+		"    if (count < 0.5)\n"
+		"    {\n"
+		"        fragmentColor = vec4(0.0, 0.0, 0.0, 1.0);\n"
+		"        return;\n"
+		"    }\n"
+		"    float t = clamp((count - 1.0) / (maxCount - 1.0), 0.0, 1.0) * 3.0;\n"
+		"    vec3 color = mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), clamp(t, 0.0, 1.0));\n"
+		"    color = mix(color, vec3(1.0, 1.0, 0.0), clamp(t - 1.0, 0.0, 1.0));\n"
+		"    color = mix(color, vec3(1.0, 0.0, 0.0), clamp(t - 2.0, 0.0, 1.0));\n"
+		"    fragmentColor = vec4(color, 1.0);\n"
+		"}\n";
+
+	// count that maps to the top of the heat map
+	const float g_HeatMapMaxCount = 8.0f;
+	// frames of the overdraw view between two reports
+	const int g_ReportFrames = 120;
+}
+
+/***********************************************************
+ *  DepthPrepass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DepthPrepass::DepthPrepass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_view = glm::mat4(1.0f);
+	m_projection = glm::mat4(1.0f);
+	m_depthProgramID = 0;
+	m_countProgramID = 0;
+	m_heatMapProgramID = 0;
+	m_overdrawFramebufferID = 0;
+	m_countTextureID = 0;
+	m_depthRenderbufferID = 0;
+	m_emptyVertexArrayID = 0;
+	m_currentProgramID = 0;
+	m_modelLocation = -1;
+	m_framesSinceReport = 0;
+	m_bBlendEnabled = false;
+	m_savedFramebuffer = 0;
+}
+
+/***********************************************************
+ *  ~DepthPrepass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DepthPrepass::~DepthPrepass()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the depth-only program.
+ *  The overdraw view is optional, so when its target or
+ *  programs can not be created the prepass still works.
+ ***********************************************************/
+bool DepthPrepass::Create(int width, int height)
+{
+	Destroy();
+
+	m_depthProgramID = CreateProgram(g_DepthVertexSource, g_DepthFragmentSource, "depth");
+	if (m_depthProgramID == 0)
+	{
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	if ((m_width <= 0) || (m_height <= 0))
+	{
+		return(true);
+	}
+
+	m_countProgramID = CreateProgram(g_DepthVertexSource, g_CountFragmentSource, "count");
+	m_heatMapProgramID = CreateProgram(g_FullScreenVertexSource, g_HeatMapFragmentSource, "heat map");
+	if ((m_countProgramID == 0) || (m_heatMapProgramID == 0))
+	{
+		return(true);
+	}
+
+	// float counts so that blending adds them up exactly
+	glGenTextures(1, &m_countTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_countTextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_width, m_height, 0, GL_RED, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthRenderbufferID);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenFramebuffers(1, &m_overdrawFramebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_overdrawFramebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_countTextureID, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbufferID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Overdraw framebuffer is not complete" << std::endl;
+		glDeleteFramebuffers(1, &m_overdrawFramebufferID);
+		m_overdrawFramebufferID = 0;
+		return(true);
+	}
+
+	glGenVertexArrays(1, &m_emptyVertexArrayID);
+
+	glUseProgram(m_heatMapProgramID);
+	glUniform1i(glGetUniformLocation(m_heatMapProgramID, "countTexture"), 0);
+	glUniform1f(glGetUniformLocation(m_heatMapProgramID, "maxCount"), g_HeatMapMaxCount);
+	glUseProgram(0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the programs and the
+ *  overdraw target.
+ ***********************************************************/
+void DepthPrepass::Destroy()
+{
+	GLuint programs[] = { m_depthProgramID, m_countProgramID, m_heatMapProgramID };
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (programs[i] != 0)
+		{
+			glDeleteProgram(programs[i]);
+		}
+	}
+	if (m_overdrawFramebufferID != 0)
+	{
+		glDeleteFramebuffers(1, &m_overdrawFramebufferID);
+	}
+	if (m_countTextureID != 0)
+	{
+		glDeleteTextures(1, &m_countTextureID);
+	}
+	if (m_depthRenderbufferID != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthRenderbufferID);
+	}
+	if (m_emptyVertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArrayID);
+	}
+
+	m_depthProgramID = 0;
+	m_countProgramID = 0;
+	m_heatMapProgramID = 0;
+	m_overdrawFramebufferID = 0;
+	m_countTextureID = 0;
+	m_depthRenderbufferID = 0;
+	m_emptyVertexArrayID = 0;
+	m_currentProgramID = 0;
+	m_modelLocation = -1;
+}
+
+/***********************************************************
+ *  CreateProgram()
+ *
+ *  This method is used for compiling and linking one of the
+ *  prepass programs - returns 0 when it fails.
+ ***********************************************************/
+GLuint DepthPrepass::CreateProgram(
+	const char* vertexSource,
+	const char* fragmentSource,
+	const char* name)
+{
+	const char* sources[2] = { vertexSource, fragmentSource };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint shaders[2] = { 0, 0 };
+	GLint success = 0;
+	char infoLog[512];
+
+	GLuint programID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+			std::cout << "Prepass " << name << " shader compilation failed\n" << infoLog << std::endl;
+		}
+		glAttachShader(programID, shaders[i]);
+	}
+	glLinkProgram(programID);
+	for (int i = 0; i < 2; i++)
+	{
+		glDeleteShader(shaders[i]);
+	}
+
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Prepass " << name << " program linking failed\n" << infoLog << std::endl;
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  SetCamera()
+ *
+ *  This method is used for binding one of the programs that
+ *  draw the scene objects and setting its camera.
+ ***********************************************************/
+void DepthPrepass::SetCamera(GLuint programID, const glm::mat4& view, const glm::mat4& projection)
+{
+	glUseProgram(programID);
+	glUniformMatrix4fv(glGetUniformLocation(programID, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	glUniformMatrix4fv(glGetUniformLocation(programID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	m_currentProgramID = programID;
+	m_modelLocation = glGetUniformLocation(programID, "model");
+}
+
+/***********************************************************
+ *  BeginPrepass()
+ *
+ *  This method is used for setting up the depth-only pass
+ *  into the bound framebuffer, with color writes masked off.
+ ***********************************************************/
+void DepthPrepass::BeginPrepass(const glm::mat4& view, const glm::mat4& projection)
+{
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	SetCamera(m_depthProgramID, view, projection);
+}
+
+/***********************************************************
+ *  SetModel()
+ *
+ *  This method is used for setting the model matrix of the
+ *  next object drawn by the bound prepass program.
+ ***********************************************************/
+void DepthPrepass::SetModel(const glm::mat4& model)
+{
+	glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+}
+
+/***********************************************************
+ *  EndPrepass()
+ *
+ *  This method is used for turning color writes back on and
+ *  setting the depth test so that only the closest surface
+ *  of each pixel, already in the depth buffer, is shaded.
+ *  The caller binds its own program again.
+ ***********************************************************/
+void DepthPrepass::EndPrepass()
+{
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthFunc(GL_EQUAL);
+	glDepthMask(GL_FALSE);
+}
+
+/***********************************************************
+ *  RestoreDepthState()
+ *
+ *  This method is used for restoring the depth test and the
+ *  depth writes, which the depth buffer clear of the next
+ *  frame depends on.
+ ***********************************************************/
+void DepthPrepass::RestoreDepthState()
+{
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+}
+
+/***********************************************************
+ *  BeginOverdraw()
+ *
+ *  This method is used for binding the overdraw target and
+ *  clearing its counts and depth.
+ ***********************************************************/
+void DepthPrepass::BeginOverdraw(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_view = view;
+	m_projection = projection;
+	m_bBlendEnabled = (glIsEnabled(GL_BLEND) == GL_TRUE);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_overdrawFramebufferID);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+/***********************************************************
+ *  BeginCounting()
+ *
+ *  This method is used for setting up the counting program
+ *  with additive blending.  The depth test is left as the
+ *  prepass, or the lack of one, set it.
+ ***********************************************************/
+void DepthPrepass::BeginCounting()
+{
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	SetCamera(m_countProgramID, m_view, m_projection);
+}
+
+/***********************************************************
+ *  EndOverdraw()
+ *
+ *  This method is used for drawing the counts over the
+ *  framebuffer that was bound before the overdraw view and
+ *  restoring the render state.  The caller binds its own
+ *  program again.
+ ***********************************************************/
+void DepthPrepass::EndOverdraw(bool bPrepass)
+{
+	RestoreDepthState();
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	if (m_bBlendEnabled == false)
+	{
+		glDisable(GL_BLEND);
+	}
+
+	if (++m_framesSinceReport >= g_ReportFrames)
+	{
+		ReportOverdraw(bPrepass);
+		m_framesSinceReport = 0;
+	}
+
+	// unit 0 holds the first scene texture, which is only
+	// bound once, so it is put back after the heat map
+	GLint sceneTextureID = 0;
+	glActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &sceneTextureID);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+	glDisable(GL_DEPTH_TEST);
+	glUseProgram(m_heatMapProgramID);
+	glBindVertexArray(m_emptyVertexArrayID);
+	glBindTexture(GL_TEXTURE_2D, m_countTextureID);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, sceneTextureID);
+	glEnable(GL_DEPTH_TEST);
+}
+
+/***********************************************************
+ *  ReportOverdraw()
+ *
+ *  This method is used for reading the counts back and
+ *  printing how many fragments the lighting shades for
+ *  every pixel the scene covers.  Reading back waits for
+ *  the GPU, which is only done in the overdraw view.
+ ***********************************************************/
+void DepthPrepass::ReportOverdraw(bool bPrepass)
+{
+	std::vector<float> counts((size_t)m_width * (size_t)m_height);
+	double total = 0.0;
+	int covered = 0;
+	float maximum = 0.0f;
+
+	glReadPixels(0, 0, m_width, m_height, GL_RED, GL_FLOAT, counts.data());
+	for (size_t i = 0; i < counts.size(); i++)
+	{
+		if (counts[i] > 0.0f)
+		{
+			total += counts[i];
+			covered++;
+			maximum = glm::max(maximum, counts[i]);
+		}
+	}
+
+	std::cout << "Overdraw with the depth prepass " << (bPrepass ? "on" : "off") << ": "
+		<< (long long)total << " fragments shaded, "
+		<< ((covered > 0) ? total / covered : 0.0) << " per covered pixel, at most "
+		<< maximum << std::endl;
+}
@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.h
+// ============
+// depth-only prepass and a view of the lit fragments shaded per pixel
+//
+//  The prepass fills the depth buffer with a program that has no fragment
+//  work, so the lighting pass that follows with an equal depth test shades
+//  every pixel once, no matter how many surfaces overlap it.  The overdraw
+//  view counts the fragments the lighting pass would shade, with the same
+//  depth test, and draws the counts as a heat map.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  DepthPrepass
+ *
+ *  This class contains the depth-only and fragment counting
+ *  programs, the overdraw target and the code for switching
+ *  the depth state between the passes.
+ ***********************************************************/
+class DepthPrepass
+{
+public:
+	// constructor
+	DepthPrepass();
+	// destructor
+	~DepthPrepass();
+
+	// create the depth-only program, and the overdraw target
+	// at the passed in size
+	bool Create(int width, int height);
+	// free the prepass resources
+	void Destroy();
+	bool IsValid() const { return(m_depthProgramID != 0); }
+	bool IsOverdrawValid() const { return(m_overdrawFramebufferID != 0); }
+
+	// set up the depth-only program with the frame camera -
+	// nothing but depth is written until EndPrepass()
+	void BeginPrepass(const glm::mat4& view, const glm::mat4& projection);
+	// set the model matrix of the next object of the prepass
+	// or of the overdraw count
+	void SetModel(const glm::mat4& model);
+	// switch to the equal depth test for the lighting pass
+	void EndPrepass();
+	// restore the default depth test after the lighting pass
+	void RestoreDepthState();
+
+	// bind and clear the overdraw target - the prepass, when
+	// used, and the counted draws follow
+	void BeginOverdraw(const glm::mat4& view, const glm::mat4& projection);
+	// set up the counting program in place of the lighting
+	void BeginCounting();
+	// draw the counts as a heat map into the framebuffer of
+	// the caller and report the totals now and then
+	void EndOverdraw(bool bPrepass);
+
+private:
+	// full screen size of the overdraw target
+	int m_width;
+	int m_height;
+	// camera of the frame being counted
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	// OpenGL resources
+	GLuint m_depthProgramID;
+	GLuint m_countProgramID;
+	GLuint m_heatMapProgramID;
+	GLuint m_overdrawFramebufferID;
+	GLuint m_countTextureID;
+	GLuint m_depthRenderbufferID;
+	GLuint m_emptyVertexArrayID;
+	// program the model matrix goes to, and its location
+	GLuint m_currentProgramID;
+	GLint m_modelLocation;
+	// frames of the overdraw view since the last report
+	int m_framesSinceReport;
+	// state restored at the end of the overdraw view
+	bool m_bBlendEnabled;
+	GLint m_savedFramebuffer;
+
+	// compile and link a program from inline sources
+	static GLuint CreateProgram(
+		const char* vertexSource,
+		const char* fragmentSource,
+		const char* name);
+	// set the camera of a program
+	void SetCamera(GLuint programID, const glm::mat4& view, const glm::mat4& projection);
+	// read the counts back and print the fragments shaded
+	void ReportOverdraw(bool bPrepass);
+};
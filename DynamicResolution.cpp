@@ -0,0 +1,472 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// offscreen scene target with a resolution that follows the GPU time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// one triangle covering the screen, without vertex data
+	const char* g_FullScreenVertexSource =
+		"#version 330 core\n"
+		"out vec2 texCoord;\n"
+		"void main()\n"
+		"{\n"
+		"    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"    texCoord = corner;\n"
+		"    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+		"}\n";
+
+	// bilinear stretch of the rendered part of the target -
+	// the coordinates stop half a texel inside its edge, so
+	// the unrendered texels next to it never bleed in
+	const char* g_UpscaleFragmentSource =
+		"#version 330 core\n"
+		"in vec2 texCoord;\n"
+		"out vec4 fragmentColor;\n"
+		"uniform sampler2D sceneTexture;\n"
+		"uniform vec2 uvScale;\n"
+		"uniform vec2 uvLimit;\n"
+		"void main()\n"
+		"{\n"
+		"    vec2 uv = min(texCoord * uvScale, uvLimit);\n"
+		"    fragmentColor = vec4(texture(sceneTexture, uv).rgb, 1.0);\n"
+		"}\n";
+
+	// share of the budget the scale aims for, leaving room for
+	// the frames that cost more than the average
+	const float g_TargetFraction = 0.9f;
+	// smallest change of the scale worth making, and the
+	// frames measured at a scale before it is moved again
+	const float g_ScaleStep = 0.05f;
+	const int g_SettleFrames = 8;
+	// weight of the newest frame in the average cost
+	const float g_CostSmoothing = 0.2f;
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution()
+{
+	m_width = 0;
+	m_height = 0;
+	m_outputWidth = 0;
+	m_outputHeight = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_minimumScale = 0.5f;
+	m_maximumScale = 1.0f;
+	m_renderScale = 1.0f;
+	m_budget = 0.0f;
+	m_framebufferID = 0;
+	m_colorTextureID = 0;
+	m_depthRenderbufferID = 0;
+	m_upscaleProgramID = 0;
+	m_emptyVertexArrayID = 0;
+	m_uvScaleLocation = -1;
+	m_uvLimitLocation = -1;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_queryIDs[i][0] = 0;
+		m_queryIDs[i][1] = 0;
+		m_bQueryPending[i] = false;
+		m_queryScale[i] = 0.0f;
+	}
+	m_queryIndex = 0;
+	m_bTimerActive = false;
+	m_averageCost = 0.0f;
+	m_measuredFrames = 0;
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the scene target at the
+ *  window size, the largest the scene is ever rendered at,
+ *  and the upscale program.
+ ***********************************************************/
+bool DynamicResolution::Create(int width, int height)
+{
+	Destroy();
+
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	m_width = width;
+	m_height = height;
+	m_outputWidth = width;
+	m_outputHeight = height;
+
+	m_upscaleProgramID = CreateProgram(g_FullScreenVertexSource, g_UpscaleFragmentSource);
+	if (m_upscaleProgramID == 0)
+	{
+		return(false);
+	}
+
+	glGenTextures(1, &m_colorTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_colorTextureID);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// depth with stencil, the format of the window, since the
+	// transparency and deferred passes copy depth to and from
+	// the framebuffer the scene is drawn into
+	glGenRenderbuffers(1, &m_depthRenderbufferID);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenFramebuffers(1, &m_framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTextureID, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbufferID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Dynamic resolution framebuffer is not complete" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	glGenVertexArrays(1, &m_emptyVertexArrayID);
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		glGenQueries(2, m_queryIDs[i]);
+	}
+
+	glUseProgram(m_upscaleProgramID);
+	glUniform1i(glGetUniformLocation(m_upscaleProgramID, "sceneTexture"), 0);
+	m_uvScaleLocation = glGetUniformLocation(m_upscaleProgramID, "uvScale");
+	m_uvLimitLocation = glGetUniformLocation(m_upscaleProgramID, "uvLimit");
+	glUseProgram(0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the target, the upscale
+ *  program and the timer queries.
+ ***********************************************************/
+void DynamicResolution::Destroy()
+{
+	if (m_upscaleProgramID != 0)
+	{
+		glDeleteProgram(m_upscaleProgramID);
+	}
+	if (m_framebufferID != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebufferID);
+	}
+	if (m_colorTextureID != 0)
+	{
+		glDeleteTextures(1, &m_colorTextureID);
+	}
+	if (m_depthRenderbufferID != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthRenderbufferID);
+	}
+	if (m_emptyVertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArrayID);
+	}
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		if (m_queryIDs[i][0] != 0)
+		{
+			glDeleteQueries(2, m_queryIDs[i]);
+		}
+		m_queryIDs[i][0] = 0;
+		m_queryIDs[i][1] = 0;
+		m_bQueryPending[i] = false;
+	}
+
+	m_upscaleProgramID = 0;
+	m_framebufferID = 0;
+	m_colorTextureID = 0;
+	m_depthRenderbufferID = 0;
+	m_emptyVertexArrayID = 0;
+	m_queryIndex = 0;
+	m_bTimerActive = false;
+	m_averageCost = 0.0f;
+	m_measuredFrames = 0;
+}
+
+/***********************************************************
+ *  SetScaleRange()
+ *
+ *  This method is used for setting the range the render
+ *  scale is kept in.
+ ***********************************************************/
+void DynamicResolution::SetScaleRange(float minimum, float maximum)
+{
+	m_maximumScale = glm::clamp(maximum, 0.1f, 1.0f);
+	m_minimumScale = glm::clamp(minimum, 0.1f, m_maximumScale);
+	m_renderScale = glm::clamp(m_renderScale, m_minimumScale, m_maximumScale);
+	m_averageCost = 0.0f;
+	m_measuredFrames = 0;
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the GPU time per frame
+ *  the render scale keeps to.
+ ***********************************************************/
+void DynamicResolution::SetBudget(float milliseconds)
+{
+	m_budget = (milliseconds > 0.0f) ? milliseconds : 0.0f;
+	if (m_budget == 0.0f)
+	{
+		m_renderScale = m_maximumScale;
+	}
+	m_averageCost = 0.0f;
+	m_measuredFrames = 0;
+}
+
+/***********************************************************
+ *  SetOutputSize()
+ *
+ *  This method is used for setting the window size the
+ *  scene is scaled from and stretched over.
+ ***********************************************************/
+void DynamicResolution::SetOutputSize(int width, int height)
+{
+	if ((width > 0) && (height > 0))
+	{
+		m_outputWidth = width;
+		m_outputHeight = height;
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for picking the scale of the frame
+ *  and binding the scene target with a viewport of that
+ *  size, which never runs past the target.  Every pass that
+ *  saves and restores the viewport then renders at the
+ *  scale.  The frame is timed with
+ *  timestamps, since the elapsed time query of the ambient
+ *  occlusion can not be nested in another one.
+ ***********************************************************/
+void DynamicResolution::BeginFrame()
+{
+	UpdateScale();
+
+	m_renderWidth = glm::clamp((int)(m_outputWidth * m_renderScale + 0.5f), 1, m_width);
+	m_renderHeight = glm::clamp((int)(m_outputHeight * m_renderScale + 0.5f), 1, m_height);
+
+	// a query that is still in flight after a full ring of
+	// frames is left alone, and this frame goes untimed
+	if (m_bQueryPending[m_queryIndex] == false)
+	{
+		glQueryCounter(m_queryIDs[m_queryIndex][0], GL_TIMESTAMP);
+		m_bTimerActive = true;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for stretching the rendered part of
+ *  the scene target over the window with bilinear
+ *  filtering, and restoring the render state.
+ ***********************************************************/
+void DynamicResolution::EndFrame()
+{
+	// unit 0 holds a scene texture that is only bound once,
+	// so it is put back after the pass, as is the program
+	GLint sceneTextureID = 0;
+	GLint programID = 0;
+	glActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &sceneTextureID);
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	bool bBlendEnabled = (glIsEnabled(GL_BLEND) == GL_TRUE);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_outputWidth, m_outputHeight);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	glUseProgram(m_upscaleProgramID);
+	glUniform2f(
+		m_uvScaleLocation,
+		(float)m_renderWidth / (float)m_width,
+		(float)m_renderHeight / (float)m_height);
+	glUniform2f(
+		m_uvLimitLocation,
+		((float)m_renderWidth - 0.5f) / (float)m_width,
+		((float)m_renderHeight - 0.5f) / (float)m_height);
+	glBindTexture(GL_TEXTURE_2D, m_colorTextureID);
+	glBindVertexArray(m_emptyVertexArrayID);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glBindTexture(GL_TEXTURE_2D, sceneTextureID);
+	glUseProgram(programID);
+	glEnable(GL_DEPTH_TEST);
+	if (bBlendEnabled)
+	{
+		glEnable(GL_BLEND);
+	}
+
+	if (m_bTimerActive)
+	{
+		glQueryCounter(m_queryIDs[m_queryIndex][1], GL_TIMESTAMP);
+		m_bQueryPending[m_queryIndex] = true;
+		m_queryScale[m_queryIndex] = m_renderScale;
+		m_queryIndex = (m_queryIndex + 1) % QUERY_COUNT;
+		m_bTimerActive = false;
+	}
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method is used for reading the timestamps of
+ *  earlier frames that the GPU has finished, without ever
+ *  waiting on one, and moving the scale to the one that
+ *  fits the budget.  The cost is taken to follow the pixel
+ *  count, so the scale along each side goes with the square
+ *  root of the budget over the cost.
+ ***********************************************************/
+void DynamicResolution::UpdateScale()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		int query = (m_queryIndex + i) % QUERY_COUNT;
+		if (m_bQueryPending[query] == false)
+		{
+			continue;
+		}
+
+		GLint bAvailable = 0;
+		glGetQueryObjectiv(m_queryIDs[query][1], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (!bAvailable)
+		{
+			break;
+		}
+
+		GLuint64 startTime = 0;
+		GLuint64 endTime = 0;
+		glGetQueryObjectui64v(m_queryIDs[query][0], GL_QUERY_RESULT, &startTime);
+		glGetQueryObjectui64v(m_queryIDs[query][1], GL_QUERY_RESULT, &endTime);
+		m_bQueryPending[query] = false;
+
+		// frames rendered before a scale change say nothing
+		// about the scale in use
+		if (m_queryScale[query] != m_renderScale)
+		{
+			continue;
+		}
+
+		float cost = (float)((double)(endTime - startTime) / 1000000.0);
+		if (m_measuredFrames == 0)
+		{
+			m_averageCost = cost;
+		}
+		else
+		{
+			m_averageCost += (cost - m_averageCost) * g_CostSmoothing;
+		}
+		m_measuredFrames++;
+	}
+
+	if ((m_budget <= 0.0f) || (m_measuredFrames < g_SettleFrames) || (m_averageCost <= 0.0f))
+	{
+		return;
+	}
+
+	float scale = m_renderScale * glm::sqrt(m_budget * g_TargetFraction / m_averageCost);
+	scale = glm::clamp(scale, m_minimumScale, m_maximumScale);
+	if ((glm::abs(scale - m_renderScale) >= g_ScaleStep) ||
+		((scale != m_renderScale) && ((scale == m_minimumScale) || (scale == m_maximumScale))))
+	{
+		m_renderScale = scale;
+		m_averageCost = 0.0f;
+		m_measuredFrames = 0;
+	}
+}
+
+/***********************************************************
+ *  CreateProgram()
+ *
+ *  This method is used for compiling and linking the
+ *  upscale program - returns 0 when it fails.
+ ***********************************************************/
+GLuint DynamicResolution::CreateProgram(
+	const char* vertexSource,
+	const char* fragmentSource)
+{
+	const char* sources[2] = { vertexSource, fragmentSource };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint shaders[2] = { 0, 0 };
+	GLint success = 0;
+	char infoLog[512];
+
+	GLuint programID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+			std::cout << "Upscale shader compilation failed\n" << infoLog << std::endl;
+		}
+		glAttachShader(programID, shaders[i]);
+	}
+	glLinkProgram(programID);
+	for (int i = 0; i < 2; i++)
+	{
+		glDeleteShader(shaders[i]);
+	}
+
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Upscale program linking failed\n" << infoLog << std::endl;
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
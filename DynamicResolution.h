@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// offscreen scene target with a resolution that follows the GPU time
+//
+//  The scene is rendered into the lower left part of a window sized target,
+//  so changing the resolution never reallocates anything, and a bilinear
+//  pass stretches that part over the window.  A window resized past the
+//  target is stretched too, until the target is created again.  The GPU time of every frame
+//  is measured with timestamps, and the render scale is moved towards the
+//  one that keeps the frame inside the budget, assuming the cost follows
+//  the number of pixels rendered.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  This class contains the scene target, the upscale
+ *  program and the GPU time measurement that picks the
+ *  render scale.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	// constructor
+	DynamicResolution();
+	// destructor
+	~DynamicResolution();
+
+	// create the scene target at the window size and the
+	// upscale program - can be called again to resize it
+	bool Create(int width, int height);
+	// free the target and the program
+	void Destroy();
+	bool IsValid() const { return(m_framebufferID != 0); }
+
+	// set the smallest and largest render scale along each side
+	void SetScaleRange(float minimum, float maximum);
+	// set the GPU time in milliseconds a frame may take - zero
+	// keeps the largest scale
+	void SetBudget(float milliseconds);
+	// get the render scale in use and the measured GPU time of
+	// a frame in milliseconds
+	float GetRenderScale() const { return(m_renderScale); }
+	float GetAverageCost() const { return(m_averageCost); }
+	// set the window size the target is stretched over, which
+	// may differ from the target size while the window is
+	// being resized
+	void SetOutputSize(int width, int height);
+	// get the size of the part rendered this frame
+	int GetRenderWidth() const { return(m_renderWidth); }
+	int GetRenderHeight() const { return(m_renderHeight); }
+
+	// pick the scale of this frame, then bind the scene target
+	// with the scaled viewport - the scene is drawn next
+	void BeginFrame();
+	// stretch the rendered part of the target over the window
+	void EndFrame();
+
+private:
+	// size of the target, of the window and of the part
+	// being rendered
+	int m_width;
+	int m_height;
+	int m_outputWidth;
+	int m_outputHeight;
+	int m_renderWidth;
+	int m_renderHeight;
+	// scale range, the scale in use and the budget
+	float m_minimumScale;
+	float m_maximumScale;
+	float m_renderScale;
+	float m_budget;
+	// OpenGL resources
+	GLuint m_framebufferID;
+	GLuint m_colorTextureID;
+	GLuint m_depthRenderbufferID;
+	GLuint m_upscaleProgramID;
+	GLuint m_emptyVertexArrayID;
+	GLint m_uvScaleLocation;
+	GLint m_uvLimitLocation;
+	// GPU timestamps at the start and end of each frame in
+	// flight, and the scale each frame was rendered at
+	static const int QUERY_COUNT = 4;
+	GLuint m_queryIDs[QUERY_COUNT][2];
+	bool m_bQueryPending[QUERY_COUNT];
+	float m_queryScale[QUERY_COUNT];
+	int m_queryIndex;
+	// true while the frame being rendered is timed
+	bool m_bTimerActive;
+	// measured cost at the scale in use and the frames it was
+	// measured over
+	float m_averageCost;
+	int m_measuredFrames;
+
+	// read the finished timestamps and move the scale
+	void UpdateScale();
+	// compile and link the upscale program
+	static GLuint CreateProgram(
+		const char* vertexSource,
+		const char* fragmentSource);
+};
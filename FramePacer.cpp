@@ -0,0 +1,256 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.cpp
+// ============
+// swap interval, frame rate limit and frame time governor
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacer.h"
+
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// object detail scale of each governor level
+	const float g_DetailScales[FramePacer::DETAIL_LEVEL_COUNT] = { 1.0f, 0.7f, 0.5f, 0.35f };
+	// the last part of a wait is spun, since sleeps can wake up
+	// this late
+	const std::chrono::microseconds g_SpinTime(1500);
+	// frames the work has to stay over the budget before the
+	// detail is lowered, and well under it before it is raised
+	const int g_LowerFrames = 30;
+	const int g_RaiseFrames = 240;
+	const float g_RaiseFraction = 0.7f;
+	// weight of the newest frame in the averages
+	const float g_TimeSmoothing = 0.1f;
+}
+
+/***********************************************************
+ *  FramePacer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePacer::FramePacer()
+{
+	m_swapMode = SWAP_ON;
+	m_framePeriod = CLOCK::duration::zero();
+	m_budget = 0.0f;
+	m_bStarted = false;
+	m_averageWork = 0.0f;
+	m_averagePresent = 0.0f;
+	m_detailLevel = 0;
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+}
+
+/***********************************************************
+ *  ~FramePacer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FramePacer::~FramePacer()
+{
+}
+
+/***********************************************************
+ *  SetSwapMode()
+ *
+ *  This method is used for setting the swap interval of the
+ *  current context.  The adaptive mode is a negative
+ *  interval, which needs the swap control tear extension.
+ ***********************************************************/
+FramePacer::SWAP_MODE FramePacer::SetSwapMode(SWAP_MODE mode)
+{
+	if ((mode == SWAP_ADAPTIVE) &&
+		!glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+		!glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+	{
+		std::cout << "Adaptive vsync is not supported, using vsync" << std::endl;
+		mode = SWAP_ON;
+	}
+
+	switch (mode)
+	{
+	case SWAP_OFF:
+		glfwSwapInterval(0);
+		break;
+	case SWAP_ON:
+		glfwSwapInterval(1);
+		break;
+	case SWAP_ADAPTIVE:
+		glfwSwapInterval(-1);
+		break;
+	}
+	m_swapMode = mode;
+
+	return(mode);
+}
+
+/***********************************************************
+ *  SetTargetFrameRate()
+ *
+ *  This method is used for setting the highest frame rate.
+ ***********************************************************/
+void FramePacer::SetTargetFrameRate(float framesPerSecond)
+{
+	m_framePeriod = CLOCK::duration::zero();
+	if (framesPerSecond > 0.0f)
+	{
+		m_framePeriod = std::chrono::duration_cast<CLOCK::duration>(
+			std::chrono::duration<double>(1.0 / framesPerSecond));
+	}
+	m_bStarted = false;
+}
+
+/***********************************************************
+ *  SetBudget()
+ *
+ *  This method is used for setting the work time per frame
+ *  the governor keeps to.
+ ***********************************************************/
+void FramePacer::SetBudget(float milliseconds)
+{
+	m_budget = (milliseconds > 0.0f) ? milliseconds : 0.0f;
+	m_overBudgetFrames = 0;
+	m_underBudgetFrames = 0;
+}
+
+/***********************************************************
+ *  GetDetailScale()
+ *
+ *  This method is used for getting the object detail scale
+ *  of the governor's level.
+ ***********************************************************/
+float FramePacer::GetDetailScale() const
+{
+	return(g_DetailScales[m_detailLevel]);
+}
+
+/***********************************************************
+ *  PresentFrame()
+ *
+ *  This method is used for presenting a frame.  The work
+ *  time runs from the end of the last present to now, so it
+ *  leaves out the limiter wait and the swap, which only
+ *  wait for the display.  The next present is due a period
+ *  after this one was due, so short and long frames even
+ *  out, unless the frame is already a period late.
+ ***********************************************************/
+void FramePacer::PresentFrame(GLFWwindow* pWindow)
+{
+	CLOCK::time_point workEnd = CLOCK::now();
+
+	if ((m_framePeriod > CLOCK::duration::zero()) && m_bStarted)
+	{
+		WaitUntil(m_nextPresent);
+		m_nextPresent += m_framePeriod;
+		if (m_nextPresent < CLOCK::now())
+		{
+			m_nextPresent = CLOCK::now() + m_framePeriod;
+		}
+	}
+
+	CLOCK::time_point swapStart = CLOCK::now();
+	glfwSwapBuffers(pWindow);
+	CLOCK::time_point swapEnd = CLOCK::now();
+
+	if (m_bStarted == false)
+	{
+		// the first frame has nothing to measure against
+		m_nextPresent = swapEnd + m_framePeriod;
+		m_frameStart = swapEnd;
+		m_bStarted = true;
+		return;
+	}
+
+	float workTime = std::chrono::duration<float, std::milli>(workEnd - m_frameStart).count();
+	float presentTime = std::chrono::duration<float, std::milli>(swapEnd - swapStart).count();
+	m_frameStart = swapEnd;
+
+	m_averageWork += (workTime - m_averageWork) * g_TimeSmoothing;
+	m_averagePresent += (presentTime - m_averagePresent) * g_TimeSmoothing;
+
+	UpdateGovernor();
+}
+
+/***********************************************************
+ *  WaitUntil()
+ *
+ *  This method is used for waiting until a point in time.
+ *  The thread sleeps until shortly before it and spins the
+ *  rest, which is exact without burning a core.
+ ***********************************************************/
+void FramePacer::WaitUntil(CLOCK::time_point time)
+{
+	CLOCK::time_point now = CLOCK::now();
+
+	if (time - now > g_SpinTime)
+	{
+		std::this_thread::sleep_for(time - now - g_SpinTime);
+	}
+	while (CLOCK::now() < time)
+	{
+		std::this_thread::yield();
+	}
+}
+
+/***********************************************************
+ *  GetEffectiveBudget()
+ *
+ *  This method is used for getting the budget in effect -
+ *  the one that was set, or else the target frame period.
+ ***********************************************************/
+float FramePacer::GetEffectiveBudget() const
+{
+	if (m_budget > 0.0f)
+	{
+		return(m_budget);
+	}
+
+	return(std::chrono::duration<float, std::milli>(m_framePeriod).count());
+}
+
+/***********************************************************
+ *  UpdateGovernor()
+ *
+ *  This method is used for lowering the detail level after
+ *  the average work time stayed over the budget, and for
+ *  raising it after it stayed well under the budget.
+ ***********************************************************/
+void FramePacer::UpdateGovernor()
+{
+	float budget = GetEffectiveBudget();
+
+	if (budget <= 0.0f)
+	{
+		return;
+	}
+
+	if ((m_averageWork > budget) && (m_detailLevel < DETAIL_LEVEL_COUNT - 1))
+	{
+		m_underBudgetFrames = 0;
+		if (++m_overBudgetFrames >= g_LowerFrames)
+		{
+			m_detailLevel++;
+			m_overBudgetFrames = 0;
+			std::cout << "Frame work took " << m_averageWork << " ms of its "
+				<< budget << " ms budget, detail lowered to level " << m_detailLevel << std::endl;
+		}
+	}
+	else if ((m_averageWork < budget * g_RaiseFraction) && (m_detailLevel > 0))
+	{
+		m_overBudgetFrames = 0;
+		if (++m_underBudgetFrames >= g_RaiseFrames)
+		{
+			m_detailLevel--;
+			m_underBudgetFrames = 0;
+			std::cout << "Frame detail raised to level " << m_detailLevel << std::endl;
+		}
+	}
+	else
+	{
+		m_overBudgetFrames = 0;
+		m_underBudgetFrames = 0;
+	}
+}
@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.h
+// ============
+// swap interval, frame rate limit and frame time governor
+//
+//  The pacer presents every frame.  It waits out the rest of the frame
+//  period with a coarse sleep and a short spin, so frames leave at an even
+//  rate, and measures the time spent working and the time blocked in the
+//  swap.  When the work keeps running over the frame budget the governor
+//  steps the detail down, and steps it back up once there is room again.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <chrono>
+
+/***********************************************************
+ *  FramePacer
+ *
+ *  This class contains the pacing settings, the frame time
+ *  measurements and the governor's detail level.
+ ***********************************************************/
+class FramePacer
+{
+public:
+	// how the swap waits for the display
+	enum SWAP_MODE
+	{
+		SWAP_OFF = 0,
+		SWAP_ON,
+		// waits like SWAP_ON, but a late frame is shown right
+		// away instead of waiting a whole refresh
+		SWAP_ADAPTIVE
+	};
+
+	// detail levels of the governor, from full detail down
+	static const int DETAIL_LEVEL_COUNT = 4;
+
+	// constructor
+	FramePacer();
+	// destructor
+	~FramePacer();
+
+	// set the swap interval of the current context - returns
+	// the mode that was set, since adaptive needs a driver
+	// extension and falls back to SWAP_ON
+	SWAP_MODE SetSwapMode(SWAP_MODE mode);
+	SWAP_MODE GetSwapMode() const { return(m_swapMode); }
+	// set the highest frame rate, 0 for no limit
+	void SetTargetFrameRate(float framesPerSecond);
+	// set the work time in milliseconds per frame the governor
+	// keeps to, 0 for the period of the target frame rate
+	void SetBudget(float milliseconds);
+
+	// wait for the frame period and swap the window buffers
+	void PresentFrame(GLFWwindow* pWindow);
+
+	// smoothed milliseconds of work per frame and of blocking
+	// in the swap
+	float GetWorkTime() const { return(m_averageWork); }
+	float GetPresentTime() const { return(m_averagePresent); }
+	// detail level chosen by the governor, 0 is full detail,
+	// and the scale of the object detail it stands for
+	int GetDetailLevel() const { return(m_detailLevel); }
+	float GetDetailScale() const;
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	SWAP_MODE m_swapMode;
+	// frame period of the target rate, zero for no limit
+	CLOCK::duration m_framePeriod;
+	// budget set by the caller in milliseconds
+	float m_budget;
+	// end of the last present and the earliest time the next
+	// frame may be presented
+	CLOCK::time_point m_frameStart;
+	CLOCK::time_point m_nextPresent;
+	bool m_bStarted;
+	// smoothed measurements in milliseconds
+	float m_averageWork;
+	float m_averagePresent;
+	// governor state
+	int m_detailLevel;
+	int m_overBudgetFrames;
+	int m_underBudgetFrames;
+
+	// sleep, then spin, until the passed in time
+	static void WaitUntil(CLOCK::time_point time);
+	// get the budget in milliseconds that is in effect
+	float GetEffectiveBudget() const;
+	// move the detail level from the average work time
+	void UpdateGovernor();
+};
@@ -0,0 +1,229 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepipeline.cpp
+// ============
+// overlap the update of the next frame with the submission of this frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePipeline.h"
+
+// declaration of global variables
+namespace
+{
+	// how long to wait on a frame fence before flushing again
+	const GLuint64 g_FenceTimeout = 1000000;  // nanoseconds
+}
+
+/***********************************************************
+ *  FramePipeline()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePipeline::FramePipeline(
+	ViewManager* pViewManager,
+	SceneManager* pSceneManager,
+	int pipelineDepth)
+{
+	m_pViewManager = pViewManager;
+	m_pSceneManager = pSceneManager;
+	m_pipelineDepth = (pipelineDepth < 0) ? 0 : pipelineDepth;
+	m_framesQueued = 0;
+	m_framesUpdated = 0;
+	m_framesSubmitted = 0;
+	m_bShutdown = false;
+	m_submittedView.keyPressCount = 0;
+	m_submittedView.bReplayingPath = false;
+
+	// one slot for the frame being submitted plus one for each
+	// frame the update may run ahead
+	m_frames.resize(m_pipelineDepth + 1);
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		m_frames[i].pQueue = new RenderQueue(m_pSceneManager->GetRecordThreadCount());
+		m_frames[i].fence = NULL;
+	}
+
+	if (m_pipelineDepth > 0)
+	{
+		m_updateThread = std::thread(&FramePipeline::UpdateLoop, this);
+	}
+}
+
+/***********************************************************
+ *  ~FramePipeline()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FramePipeline::~FramePipeline()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bShutdown = true;
+	}
+	m_queuedCondition.notify_all();
+
+	if (m_updateThread.joinable())
+	{
+		m_updateThread.join();
+	}
+
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		if (NULL != m_frames[i].fence)
+		{
+			glDeleteSync(m_frames[i].fence);
+			m_frames[i].fence = NULL;
+		}
+		delete m_frames[i].pQueue;
+		m_frames[i].pQueue = NULL;
+	}
+	m_frames.clear();
+
+	m_pViewManager = NULL;
+	m_pSceneManager = NULL;
+}
+
+/***********************************************************
+ *  RenderFrame()
+ *
+ *  This method is used for keeping the pipeline full and
+ *  submitting the oldest updated frame.  With a depth of 0
+ *  the frame is updated and submitted right away.
+ ***********************************************************/
+void FramePipeline::RenderFrame(int stepCount, float stepBlend)
+{
+	if (m_pipelineDepth == 0)
+	{
+		FRAME_STATE& frame = m_frames[0];
+
+		frame.input = m_pViewManager->PollInput(stepCount, stepBlend);
+		m_pViewManager->UpdateView(frame.input, frame.view);
+		m_pSceneManager->SetViewParameters(
+			frame.view.view,
+			frame.view.projection,
+			frame.view.viewportHeight);
+		m_pSceneManager->SetOrthoViews(
+			frame.view.orthoViewCount,
+			frame.view.orthoViews,
+			frame.view.orthoProjections);
+		m_pSceneManager->RecordScene(frame.pQueue);
+
+		m_pViewManager->ApplyView(frame.view);
+		m_pSceneManager->SubmitScene(frame.pQueue);
+		m_submittedView = frame.view;
+		return;
+	}
+
+	// on the first frames this queues several updates so the
+	// update stage starts ahead by the full pipeline depth -
+	// only the first of them runs the steps
+	while (m_framesQueued - m_framesSubmitted < m_frames.size())
+	{
+		QueueFrame(stepCount, stepBlend);
+		stepCount = 0;
+	}
+
+	SubmitFrame();
+}
+
+/***********************************************************
+ *  QueueFrame()
+ *
+ *  This method is used for sampling the input into the next
+ *  free slot and waking the update thread.
+ ***********************************************************/
+void FramePipeline::QueueFrame(int stepCount, float stepBlend)
+{
+	FRAME_STATE& frame = m_frames[m_framesQueued % m_frames.size()];
+
+	// GLFW input can only be read on the main thread
+	frame.input = m_pViewManager->PollInput(stepCount, stepBlend);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_framesQueued++;
+	}
+	m_queuedCondition.notify_one();
+}
+
+/***********************************************************
+ *  SubmitFrame()
+ *
+ *  This method is used for waiting until the oldest queued
+ *  frame is updated and issuing its OpenGL calls.  Before a
+ *  slot is submitted again, the fence of its previous frame
+ *  is waited on so the GPU never falls more than the pipeline
+ *  depth behind.
+ ***********************************************************/
+void FramePipeline::SubmitFrame()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_updatedCondition.wait(lock, [this]() { return(m_framesUpdated > m_framesSubmitted); });
+	}
+
+	FRAME_STATE& frame = m_frames[m_framesSubmitted % m_frames.size()];
+
+	if (NULL != frame.fence)
+	{
+		GLenum result = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		while ((result == GL_TIMEOUT_EXPIRED) && !m_bShutdown)
+		{
+			result = glClientWaitSync(frame.fence, 0, g_FenceTimeout);
+		}
+		glDeleteSync(frame.fence);
+		frame.fence = NULL;
+	}
+
+	m_pViewManager->ApplyView(frame.view);
+	m_pSceneManager->SubmitScene(frame.pQueue);
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_submittedView = frame.view;
+
+	m_framesSubmitted++;
+}
+
+/***********************************************************
+ *  UpdateLoop()
+ *
+ *  This method is the main loop of the update thread.  It
+ *  moves the camera and records the draw commands for each
+ *  queued frame, in order, without any OpenGL calls.
+ ***********************************************************/
+void FramePipeline::UpdateLoop()
+{
+	while (true)
+	{
+		unsigned int frameIndex = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_queuedCondition.wait(lock, [this]() {
+				return(m_bShutdown || (m_framesUpdated < m_framesQueued)); });
+
+			if (m_bShutdown)
+			{
+				return;
+			}
+			frameIndex = m_framesUpdated;
+		}
+
+		FRAME_STATE& frame = m_frames[frameIndex % m_frames.size()];
+
+		m_pViewManager->UpdateView(frame.input, frame.view);
+		m_pSceneManager->SetViewParameters(
+			frame.view.view,
+			frame.view.projection,
+			frame.view.viewportHeight);
+		m_pSceneManager->SetOrthoViews(
+			frame.view.orthoViewCount,
+			frame.view.orthoViews,
+			frame.view.orthoProjections);
+		m_pSceneManager->RecordScene(frame.pQueue);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_framesUpdated++;
+		}
+		m_updatedCondition.notify_one();
+	}
+}
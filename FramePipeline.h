@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepipeline.h
+// ============
+// overlap the update of the next frame with the submission of this frame
+//
+//  The update stage - camera movement, culling, detail levels and draw
+//  command recording - runs on its own thread while the main thread issues
+//  the OpenGL calls of an earlier frame.  Every frame in flight has its own
+//  state slot, so the two stages never touch the same data.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FramePipeline
+ *
+ *  This class contains the update thread, the per-frame state
+ *  slots and the code for handing frames between the stages.
+ ***********************************************************/
+class FramePipeline
+{
+public:
+	// constructor - the depth is the number of frames that the
+	// update stage may run ahead of submission.  a depth of 0
+	// runs both stages in sequence on the main thread
+	FramePipeline(
+		ViewManager* pViewManager,
+		SceneManager* pSceneManager,
+		int pipelineDepth = 1);
+	// destructor
+	~FramePipeline();
+
+	// queue the update of a new frame that runs the passed in
+	// simulation steps and submit the oldest updated frame -
+	// called once per loop on the main thread
+	void RenderFrame(int stepCount, float stepBlend);
+	// get the view of the frame submitted last - only used on
+	// the main thread
+	const ViewManager::VIEW_STATE& GetSubmittedView() const { return(m_submittedView); }
+
+private:
+	// everything one frame carries from update to submission
+	struct FRAME_STATE
+	{
+		ViewManager::INPUT_STATE input;
+		ViewManager::VIEW_STATE view;
+		RenderQueue* pQueue;
+		// signalled once the GPU has finished the frame
+		// last submitted from this slot
+		GLsync fence;
+	};
+
+	// pointer to view manager object
+	ViewManager* m_pViewManager;
+	// pointer to scene manager object
+	SceneManager* m_pSceneManager;
+	// number of frames the update may run ahead
+	int m_pipelineDepth;
+	// one slot per frame in flight
+	std::vector<FRAME_STATE> m_frames;
+	// view of the frame submitted last
+	ViewManager::VIEW_STATE m_submittedView;
+	// frame counters - queued for update, updated, submitted
+	unsigned int m_framesQueued;
+	unsigned int m_framesUpdated;
+	unsigned int m_framesSubmitted;
+	// update thread and hand-off between the stages
+	std::thread m_updateThread;
+	std::mutex m_mutex;
+	std::condition_variable m_queuedCondition;
+	std::condition_variable m_updatedCondition;
+	bool m_bShutdown;
+
+	// main loop of the update thread
+	void UpdateLoop();
+	// sample the input and queue the next frame for update
+	void QueueFrame(int stepCount, float stepBlend);
+	// wait for the oldest frame to be updated and submit it
+	void SubmitFrame();
+};
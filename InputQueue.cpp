@@ -0,0 +1,284 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputqueue.cpp
+// ============
+// lock-free queue of window input events, with recording and replay
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputQueue.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// recording file identification and layout version
+	const char g_FileMagic[4] = { 'I', 'N', 'P', 'R' };
+	const int32_t g_FileVersion = 1;
+}
+
+/***********************************************************
+ *  InputQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputQueue::InputQueue()
+{
+	m_head = 0;
+	m_tail = 0;
+	m_frame = 0;
+	m_droppedCount = 0;
+	m_recordStartFrame = 0;
+	m_replayIndex = 0;
+	m_replayStartFrame = 0;
+	m_replayFrameCount = 0;
+	m_bReplaying = false;
+}
+
+/***********************************************************
+ *  ~InputQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputQueue::~InputQueue()
+{
+	StopRecording();
+}
+
+/***********************************************************
+ *  PushKey()
+ *
+ *  This method is used for queueing a key press or release.
+ ***********************************************************/
+void InputQueue::PushKey(int key, int action)
+{
+	INPUT_EVENT event = { m_frame, EVENT_KEY, key, action, 0.0f, 0.0f };
+	PushLive(event);
+}
+
+/***********************************************************
+ *  PushMouseMove()
+ *
+ *  This method is used for queueing a mouse movement.
+ ***********************************************************/
+void InputQueue::PushMouseMove(float xOffset, float yOffset)
+{
+	INPUT_EVENT event = { m_frame, EVENT_MOUSE_MOVE, 0, 0, xOffset, yOffset };
+	PushLive(event);
+}
+
+/***********************************************************
+ *  PushScroll()
+ *
+ *  This method is used for queueing a scroll wheel movement.
+ ***********************************************************/
+void InputQueue::PushScroll(float offset)
+{
+	INPUT_EVENT event = { m_frame, EVENT_SCROLL, 0, 0, 0.0f, offset };
+	PushLive(event);
+}
+
+/***********************************************************
+ *  PushLive()
+ *
+ *  This method is used for writing an event from the
+ *  window into the recording and the ring.  The recording
+ *  counts the frames from its own start.
+ ***********************************************************/
+void InputQueue::PushLive(const INPUT_EVENT& event)
+{
+	if (m_bReplaying)
+	{
+		return;
+	}
+
+	if (m_recordFile.is_open())
+	{
+		INPUT_EVENT recorded = event;
+		recorded.frame -= m_recordStartFrame;
+		m_recordFile.write((const char*)&recorded, sizeof(recorded));
+	}
+	Push(event);
+}
+
+/***********************************************************
+ *  Push()
+ *
+ *  This method is used for writing an event into the ring.
+ *  The event is written before the head is published, so
+ *  the taking thread never sees it half written.  An event
+ *  that finds the ring full is dropped.
+ ***********************************************************/
+void InputQueue::Push(const INPUT_EVENT& event)
+{
+	uint32_t head = m_head.load(std::memory_order_relaxed);
+
+	if (head - m_tail.load(std::memory_order_acquire) >= CAPACITY)
+	{
+		m_droppedCount++;
+		return;
+	}
+
+	m_events[head & (CAPACITY - 1)] = event;
+	m_head.store(head + 1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for closing the frame the events
+ *  pushed so far belong to.  A replay pushes the recorded
+ *  events of the frame first, so they are taken by the same
+ *  frame as when they were recorded, and ends after the
+ *  last recorded frame.
+ ***********************************************************/
+uint32_t InputQueue::EndFrame()
+{
+	uint32_t frame = m_frame;
+
+	if (m_bReplaying)
+	{
+		uint32_t replayFrame = frame - m_replayStartFrame;
+		while ((m_replayIndex < m_replayEvents.size()) &&
+			(m_replayEvents[m_replayIndex].frame <= replayFrame))
+		{
+			INPUT_EVENT event = m_replayEvents[m_replayIndex++];
+			event.frame = frame;
+			Push(event);
+		}
+		if (replayFrame + 1 >= m_replayFrameCount)
+		{
+			m_bReplaying = false;
+			m_replayEvents.clear();
+		}
+	}
+
+	m_frame++;
+	return(frame);
+}
+
+/***********************************************************
+ *  TakeEvents()
+ *
+ *  This method is used for taking the events up to the end
+ *  of a frame, oldest first.  Events of later frames stay in
+ *  the ring for their own frame.
+ ***********************************************************/
+int InputQueue::TakeEvents(uint32_t lastFrame, INPUT_EVENT* pEvents, int maxCount)
+{
+	uint32_t tail = m_tail.load(std::memory_order_relaxed);
+	uint32_t head = m_head.load(std::memory_order_acquire);
+	int count = 0;
+
+	while ((tail != head) && (count < maxCount))
+	{
+		const INPUT_EVENT& event = m_events[tail & (CAPACITY - 1)];
+		// the frame numbers may wrap, so they are compared by
+		// their difference
+		if ((int32_t)(event.frame - lastFrame) > 0)
+		{
+			break;
+		}
+		pEvents[count++] = event;
+		tail++;
+	}
+	m_tail.store(tail, std::memory_order_release);
+
+	return(count);
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method is used for opening a recording file.  The
+ *  events are written as they are pushed, with frames
+ *  counted from the next frame.
+ ***********************************************************/
+bool InputQueue::StartRecording(const char* filename)
+{
+	StopRecording();
+
+	m_recordFile.open(filename, std::ios::binary);
+	if (!m_recordFile)
+	{
+		std::cout << "Could not write input recording:" << filename << std::endl;
+		return(false);
+	}
+
+	m_recordFile.write(g_FileMagic, sizeof(g_FileMagic));
+	m_recordFile.write((const char*)&g_FileVersion, sizeof(g_FileVersion));
+	m_recordStartFrame = m_frame;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopRecording()
+ *
+ *  This method is used for ending a recording with the
+ *  number of frames it covers and closing the file.
+ ***********************************************************/
+void InputQueue::StopRecording()
+{
+	if (m_recordFile.is_open() == false)
+	{
+		return;
+	}
+
+	INPUT_EVENT end = { m_frame - m_recordStartFrame, EVENT_END, 0, 0, 0.0f, 0.0f };
+	m_recordFile.write((const char*)&end, sizeof(end));
+	m_recordFile.close();
+}
+
+/***********************************************************
+ *  StartReplay()
+ *
+ *  This method is used for reading a recording written by
+ *  StartRecording().  Its events are pushed from the next
+ *  frame on, and live events are ignored until it ends.
+ ***********************************************************/
+bool InputQueue::StartReplay(const char* filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not read input recording:" << filename << std::endl;
+		return(false);
+	}
+
+	char magic[4];
+	int32_t version = 0;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&version, sizeof(version));
+	if (!file || (memcmp(magic, g_FileMagic, sizeof(magic)) != 0) || (version != g_FileVersion))
+	{
+		std::cout << "Not a supported input recording:" << filename << std::endl;
+		return(false);
+	}
+
+	std::vector<INPUT_EVENT> events;
+	INPUT_EVENT event;
+	bool bEnded = false;
+	while (file.read((char*)&event, sizeof(event)))
+	{
+		if (event.type == EVENT_END)
+		{
+			m_replayFrameCount = event.frame;
+			bEnded = true;
+			break;
+		}
+		events.push_back(event);
+	}
+	if (bEnded == false)
+	{
+		std::cout << "Input recording is truncated:" << filename << std::endl;
+		return(false);
+	}
+
+	m_replayEvents.swap(events);
+	m_replayIndex = 0;
+	m_replayStartFrame = m_frame;
+	m_bReplaying = true;
+
+	return(true);
+}
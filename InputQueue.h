@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputqueue.h
+// ============
+// lock-free queue of window input events, with recording and replay
+//
+//  The window callbacks push each key, mouse and scroll event on the main
+//  thread, stamped with the frame it arrived for, and the view update takes
+//  all the events of its frame in one batch, on whichever thread it runs.
+//  One thread pushes and one takes, so the ring needs no lock.  The events
+//  can be written to a file and pushed from it again on the same frames,
+//  which replays a session exactly for benchmarks.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/***********************************************************
+ *  InputQueue
+ *
+ *  This class contains the event ring, the frame stamp of
+ *  new events and the recording and replay state.
+ ***********************************************************/
+class InputQueue
+{
+public:
+	// kinds of input events
+	enum INPUT_EVENT_TYPE
+	{
+		EVENT_KEY = 0,
+		EVENT_MOUSE_MOVE,
+		EVENT_SCROLL,
+		// last frame of a recording, never queued
+		EVENT_END
+	};
+
+	// one input event - the key and action are GLFW values,
+	// x and y hold the mouse offsets or the scroll offset
+	struct INPUT_EVENT
+	{
+		uint32_t frame;
+		int32_t type;
+		int32_t key;
+		int32_t action;
+		float x;
+		float y;
+	};
+
+	// most events waiting in the ring, a power of two
+	static const uint32_t CAPACITY = 1024;
+
+	// constructor
+	InputQueue();
+	// destructor
+	~InputQueue();
+
+	// push an event that arrived from the window - must be
+	// called on the main thread.  Live events are ignored while
+	// a replay runs
+	void PushKey(int key, int action);
+	void PushMouseMove(float xOffset, float yOffset);
+	void PushScroll(float offset);
+	// close the frame the pushed events belong to and return
+	// its number - must be called on the main thread when the
+	// input of a frame is sampled.  A replay pushes the events
+	// of the frame here
+	uint32_t EndFrame();
+
+	// take the events of the passed in frame and the ones
+	// before it, up to maxCount of them - returns the number
+	// taken.  Only one thread may take events
+	int TakeEvents(uint32_t lastFrame, INPUT_EVENT* pEvents, int maxCount);
+
+	// write every live event to a file from the next frame on
+	bool StartRecording(const char* filename);
+	// end the recording file with its last frame
+	void StopRecording();
+	bool IsRecording() const { return(m_recordFile.is_open()); }
+	// push the events of a recording from the next frame on,
+	// in place of the live ones
+	bool StartReplay(const char* filename);
+	// true until the last frame of the replay was closed
+	bool IsReplaying() const { return(m_bReplaying); }
+	// get the number of events lost to a full ring
+	uint32_t GetDroppedCount() const { return(m_droppedCount); }
+
+private:
+	// ring of events - the head is only moved by the pushing
+	// thread and the tail only by the taking thread
+	INPUT_EVENT m_events[CAPACITY];
+	std::atomic<uint32_t> m_head;
+	std::atomic<uint32_t> m_tail;
+	// frame the next pushed event belongs to
+	uint32_t m_frame;
+	uint32_t m_droppedCount;
+	// recording file and the frame it started on
+	std::ofstream m_recordFile;
+	uint32_t m_recordStartFrame;
+	// recorded events being replayed, the next one to push,
+	// the frame the replay started on and its length
+	std::vector<INPUT_EVENT> m_replayEvents;
+	size_t m_replayIndex;
+	uint32_t m_replayStartFrame;
+	uint32_t m_replayFrameCount;
+	bool m_bReplaying;
+
+	// record and queue an event from the window
+	void PushLive(const INPUT_EVENT& event);
+	// write an event into the ring
+	void Push(const INPUT_EVENT& event);
+};
@@ -0,0 +1,403 @@
+///////////////////////////////////////////////////////////////////////////////
+// lodmeshes.cpp
+// ============
+// generate and draw reduced tessellation levels of the curved basic shapes
+//
+//  The generated meshes use the same vertex layout and the same dimensions
+//  as the ShapeMeshes shapes - position, normal and texture coordinate -
+//  so the same shaders and transformations can be used for every level.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LODMeshes.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// number of floats per vertex - position, normal, texture coordinate
+	const int g_FloatsPerVertex = 8;
+
+	// number of slices around the Y axis for each cylinder level
+	const int g_CylinderSlices[LODMeshes::LOD_LEVEL_COUNT] = { 36, 18, 10, 6 };
+	// number of main and tube segments for each torus level
+	const int g_TorusMainSegments[LODMeshes::LOD_LEVEL_COUNT] = { 40, 24, 14, 8 };
+	const int g_TorusTubeSegments[LODMeshes::LOD_LEVEL_COUNT] = { 20, 12, 8, 5 };
+
+	// projected height in pixels below which an object moves from
+	// level N to level N + 1
+	const float g_LevelThresholds[LODMeshes::LOD_LEVEL_COUNT - 1] = { 160.0f, 60.0f, 20.0f };
+	// fraction around each threshold that must be crossed before
+	// the selected level is changed
+	const float g_Hysteresis = 0.2f;
+}
+
+/***********************************************************
+ *  LODMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LODMeshes::LODMeshes()
+{
+	for (int shape = 0; shape < LOD_SHAPE_COUNT; shape++)
+	{
+		for (int level = 0; level < LOD_LEVEL_COUNT; level++)
+		{
+			m_meshes[shape][level].vao = 0;
+			m_meshes[shape][level].vbos[0] = 0;
+			m_meshes[shape][level].vbos[1] = 0;
+			m_meshes[shape][level].nVertices = 0;
+			m_meshes[shape][level].nIndices = 0;
+		}
+	}
+	m_viewCount = 1;
+}
+
+/***********************************************************
+ *  ~LODMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LODMeshes::~LODMeshes()
+{
+	for (int shape = 0; shape < LOD_SHAPE_COUNT; shape++)
+	{
+		for (int level = 0; level < LOD_LEVEL_COUNT; level++)
+		{
+			DestroyMesh(m_meshes[shape][level]);
+		}
+	}
+	m_objectLevels.clear();
+}
+
+/***********************************************************
+ *  LoadCylinderMeshLODs()
+ *
+ *  This method is used for generating the reduced detail
+ *  levels of the cylinder shape.
+ ***********************************************************/
+void LODMeshes::LoadCylinderMeshLODs()
+{
+	for (int level = 1; level < LOD_LEVEL_COUNT; level++)
+	{
+		BuildCylinder(m_meshes[LOD_CYLINDER][level], 1.0f, 1.0f, g_CylinderSlices[level]);
+	}
+}
+
+/***********************************************************
+ *  LoadTaperedCylinderMeshLODs()
+ *
+ *  This method is used for generating the reduced detail
+ *  levels of the tapered cylinder shape.
+ ***********************************************************/
+void LODMeshes::LoadTaperedCylinderMeshLODs()
+{
+	for (int level = 1; level < LOD_LEVEL_COUNT; level++)
+	{
+		BuildCylinder(m_meshes[LOD_TAPERED_CYLINDER][level], 1.0f, 0.5f, g_CylinderSlices[level]);
+	}
+}
+
+/***********************************************************
+ *  LoadTorusMeshLODs()
+ *
+ *  This method is used for generating the reduced detail
+ *  levels of the torus shape.
+ ***********************************************************/
+void LODMeshes::LoadTorusMeshLODs(float thickness)
+{
+	for (int level = 1; level < LOD_LEVEL_COUNT; level++)
+	{
+		BuildTorus(
+			m_meshes[LOD_TORUS][level],
+			thickness,
+			g_TorusMainSegments[level],
+			g_TorusTubeSegments[level]);
+	}
+}
+
+/***********************************************************
+ *  DrawLODMesh()
+ *
+ *  This method is used for drawing a reduced detail level
+ *  of the passed in shape.
+ ***********************************************************/
+void LODMeshes::DrawLODMesh(LOD_SHAPE shape, int level)
+{
+	if ((level < 1) || (level >= LOD_LEVEL_COUNT))
+	{
+		return;
+	}
+
+	GLMesh& mesh = m_meshes[shape][level];
+	if (mesh.vao == 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(mesh.vao);
+	glDrawElements(GL_TRIANGLES, mesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  SetObjectCount()
+ *
+ *  This method is used for sizing the per-object detail level
+ *  state.  Every object starts without a selected level in
+ *  any view.
+ ***********************************************************/
+void LODMeshes::SetObjectCount(int objectCount, int viewCount)
+{
+	m_viewCount = (viewCount > 0) ? viewCount : 1;
+	m_objectLevels.assign(objectCount * m_viewCount, -1);
+}
+
+/***********************************************************
+ *  SelectLevel()
+ *
+ *  This method is used for choosing the detail level of the
+ *  indexed object in a view.  An object only moves to a
+ *  coarser level once it is clearly below the threshold,
+ *  and only moves back to a finer level once it is clearly
+ *  above it.  Each view keeps its own last level, since an
+ *  object can have a different size in each.
+ ***********************************************************/
+int LODMeshes::SelectLevel(int objectIndex, float projectedPixels, int view)
+{
+	if ((view < 0) || (view >= m_viewCount))
+	{
+		return(0);
+	}
+	int slot = objectIndex * m_viewCount + view;
+	if ((objectIndex < 0) || (slot >= (int)m_objectLevels.size()))
+	{
+		return(0);
+	}
+
+	int level = m_objectLevels[slot];
+
+	// the first time an object is seen there is nothing to
+	// stabilize against, so pick the level directly
+	if (level < 0)
+	{
+		level = 0;
+		while ((level < LOD_LEVEL_COUNT - 1) &&
+			(projectedPixels < g_LevelThresholds[level]))
+		{
+			level++;
+		}
+	}
+	else
+	{
+		while ((level < LOD_LEVEL_COUNT - 1) &&
+			(projectedPixels < g_LevelThresholds[level] * (1.0f - g_Hysteresis)))
+		{
+			level++;
+		}
+		while ((level > 0) &&
+			(projectedPixels > g_LevelThresholds[level - 1] * (1.0f + g_Hysteresis)))
+		{
+			level--;
+		}
+	}
+
+	m_objectLevels[slot] = level;
+
+	return(level);
+}
+
+/***********************************************************
+ *  BuildCylinder()
+ *
+ *  This method is used for generating a capped cylinder of
+ *  height 1 standing on the XZ plane.  Different bottom and
+ *  top radii produce a tapered cylinder.
+ ***********************************************************/
+void LODMeshes::BuildCylinder(
+	GLMesh& mesh,
+	float bottomRadius,
+	float topRadius,
+	int slices)
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+
+	// the side normals lean outwards when the top is narrower
+	float slope = bottomRadius - topRadius;
+	float normalLength = sqrtf(1.0f + slope * slope);
+
+	// side vertices - one column per slice plus a seam column
+	// so the texture wraps around without stretching
+	for (int i = 0; i <= slices; i++)
+	{
+		float u = (float)i / (float)slices;
+		float angle = u * 2.0f * PI;
+		float c = cosf(angle);
+		float s = sinf(angle);
+
+		float nx = c / normalLength;
+		float ny = slope / normalLength;
+		float nz = s / normalLength;
+
+		GLfloat bottom[] = { bottomRadius * c, 0.0f, bottomRadius * s, nx, ny, nz, u, 0.0f };
+		GLfloat top[] = { topRadius * c, 1.0f, topRadius * s, nx, ny, nz, u, 1.0f };
+		vertices.insert(vertices.end(), bottom, bottom + g_FloatsPerVertex);
+		vertices.insert(vertices.end(), top, top + g_FloatsPerVertex);
+	}
+	for (int i = 0; i < slices; i++)
+	{
+		GLuint b0 = i * 2;
+		GLuint t0 = b0 + 1;
+		GLuint b1 = b0 + 2;
+		GLuint t1 = b0 + 3;
+		GLuint side[] = { b0, t0, b1, b1, t0, t1 };
+		indices.insert(indices.end(), side, side + 6);
+	}
+
+	// bottom and top caps are triangle fans around a center vertex
+	for (int cap = 0; cap < 2; cap++)
+	{
+		float y = (cap == 0) ? 0.0f : 1.0f;
+		float ny = (cap == 0) ? -1.0f : 1.0f;
+		float radius = (cap == 0) ? bottomRadius : topRadius;
+
+		GLuint center = (GLuint)(vertices.size() / g_FloatsPerVertex);
+		GLfloat middle[] = { 0.0f, y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f };
+		vertices.insert(vertices.end(), middle, middle + g_FloatsPerVertex);
+
+		for (int i = 0; i <= slices; i++)
+		{
+			float angle = ((float)i / (float)slices) * 2.0f * PI;
+			float c = cosf(angle);
+			float s = sinf(angle);
+			GLfloat rim[] = { radius * c, y, radius * s, 0.0f, ny, 0.0f, 0.5f + 0.5f * c, 0.5f + 0.5f * s };
+			vertices.insert(vertices.end(), rim, rim + g_FloatsPerVertex);
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint fan[] = { center, center + 1 + i, center + 2 + i };
+			indices.insert(indices.end(), fan, fan + 3);
+		}
+	}
+
+	UploadMesh(mesh, vertices, indices);
+}
+
+/***********************************************************
+ *  BuildTorus()
+ *
+ *  This method is used for generating a torus with a main
+ *  radius of 1 around the Z axis.
+ ***********************************************************/
+void LODMeshes::BuildTorus(
+	GLMesh& mesh,
+	float thickness,
+	int mainSegments,
+	int tubeSegments)
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+
+	for (int i = 0; i <= mainSegments; i++)
+	{
+		float u = (float)i / (float)mainSegments;
+		float theta = u * 2.0f * PI;
+
+		for (int j = 0; j <= tubeSegments; j++)
+		{
+			float v = (float)j / (float)tubeSegments;
+			float phi = v * 2.0f * PI;
+
+			float nx = cosf(phi) * cosf(theta);
+			float ny = cosf(phi) * sinf(theta);
+			float nz = sinf(phi);
+
+			GLfloat vertex[] = {
+				cosf(theta) + thickness * nx,
+				sinf(theta) + thickness * ny,
+				thickness * nz,
+				nx, ny, nz,
+				u, v };
+			vertices.insert(vertices.end(), vertex, vertex + g_FloatsPerVertex);
+		}
+	}
+
+	GLuint ringSize = tubeSegments + 1;
+	for (int i = 0; i < mainSegments; i++)
+	{
+		for (int j = 0; j < tubeSegments; j++)
+		{
+			GLuint a = i * ringSize + j;
+			GLuint b = (i + 1) * ringSize + j;
+			GLuint quad[] = { a, b, a + 1, a + 1, b, b + 1 };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	UploadMesh(mesh, vertices, indices);
+}
+
+/***********************************************************
+ *  UploadMesh()
+ *
+ *  This method is used for creating the vertex array object
+ *  and buffers for the generated mesh data.
+ ***********************************************************/
+void LODMeshes::UploadMesh(
+	GLMesh& mesh,
+	const std::vector<GLfloat>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	const GLuint floatsPerVertex = 3;
+	const GLuint floatsPerNormal = 3;
+	const GLuint floatsPerUV = 2;
+	GLint stride = sizeof(GLfloat) * g_FloatsPerVertex;
+
+	DestroyMesh(mesh);
+
+	mesh.nVertices = (GLuint)(vertices.size() / g_FloatsPerVertex);
+	mesh.nIndices = (GLuint)indices.size();
+
+	glGenVertexArrays(1, &mesh.vao);
+	glBindVertexArray(mesh.vao);
+
+	// create the vertex and index buffers
+	glGenBuffers(2, mesh.vbos);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	// create the vertex attribute pointers
+	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * floatsPerVertex));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
+	glEnableVertexAttribArray(2);
+
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DestroyMesh()
+ *
+ *  This method is used for freeing the OpenGL buffers that
+ *  were created for a mesh.
+ ***********************************************************/
+void LODMeshes::DestroyMesh(GLMesh& mesh)
+{
+	if (mesh.vao != 0)
+	{
+		glDeleteVertexArrays(1, &mesh.vao);
+		glDeleteBuffers(2, mesh.vbos);
+	}
+	mesh.vao = 0;
+	mesh.vbos[0] = 0;
+	mesh.vbos[1] = 0;
+	mesh.nVertices = 0;
+	mesh.nIndices = 0;
+}
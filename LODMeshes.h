@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// lodmeshes.h
+// ============
+// generate and draw reduced tessellation levels of the curved basic shapes
+//
+//  Level 0 of every shape is the full resolution mesh that is owned by the
+//  ShapeMeshes object.  This class only generates the coarser levels, so
+//  close-up objects look exactly the same as before.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  LODMeshes
+ *
+ *  This class contains the code for generating several
+ *  tessellation levels for the cylinder, tapered cylinder
+ *  and torus shapes, and for choosing a level per object
+ *  from its projected screen size.
+ ***********************************************************/
+class LODMeshes
+{
+public:
+	// total number of detail levels, including level 0
+	static const int LOD_LEVEL_COUNT = 4;
+
+	// curved shapes that support detail levels
+	enum LOD_SHAPE
+	{
+		LOD_CYLINDER = 0,
+		LOD_TAPERED_CYLINDER,
+		LOD_TORUS,
+		LOD_SHAPE_COUNT
+	};
+
+	// constructor
+	LODMeshes();
+	// destructor
+	~LODMeshes();
+
+	// generate the reduced detail levels for each shape
+	void LoadCylinderMeshLODs();
+	void LoadTaperedCylinderMeshLODs();
+	void LoadTorusMeshLODs(float thickness = 0.1f);
+
+	// draw a reduced detail level (1 and above) of a shape
+	void DrawLODMesh(LOD_SHAPE shape, int level);
+
+	// size the per-object detail level state, kept apart for
+	// each of the passed in number of views - must be called
+	// before SelectLevel() is used from several threads
+	void SetObjectCount(int objectCount, int viewCount = 1);
+
+	// choose the detail level for the indexed object in a view
+	// from its projected height in pixels, using hysteresis so
+	// objects near a threshold do not pop back and forth.
+	// different threads may select levels for different
+	// objects at once
+	int SelectLevel(int objectIndex, float projectedPixels, int view = 0);
+
+private:
+	struct GLMesh
+	{
+		GLuint vao;
+		GLuint vbos[2];
+		GLuint nVertices;
+		GLuint nIndices;
+	};
+
+	// generated meshes - level 0 is never used since it
+	// is drawn from the ShapeMeshes object
+	GLMesh m_meshes[LOD_SHAPE_COUNT][LOD_LEVEL_COUNT];
+	// last selected detail level for each drawn object in each
+	// view, the views of an object next to each other
+	std::vector<int> m_objectLevels;
+	int m_viewCount;
+
+	// build a capped surface of revolution around the Y axis
+	void BuildCylinder(
+		GLMesh& mesh,
+		float bottomRadius,
+		float topRadius,
+		int slices);
+	// build a torus lying in the XY plane
+	void BuildTorus(
+		GLMesh& mesh,
+		float thickness,
+		int mainSegments,
+		int tubeSegments);
+	// upload the vertex and index data into a new VAO
+	void UploadMesh(
+		GLMesh& mesh,
+		const std::vector<GLfloat>& vertices,
+		const std::vector<GLuint>& indices);
+	// free the OpenGL buffers of a mesh
+	void DestroyMesh(GLMesh& mesh);
+};
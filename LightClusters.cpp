@@ -0,0 +1,352 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.cpp
+// ============
+// assign point lights to a 3D grid of view frustum clusters for clustered
+// forward shading
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightClusters.h"
+
+#include <cmath>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// shader storage blocks and their binding points
+	const char* g_ClusterBufferName = "ClusterBuffer";
+	const GLuint g_ClusterBufferBinding = 2;
+	const GLuint g_IndexBufferBinding = 3;
+
+	// closest near plane the depth slices are allowed to use
+	const float g_MinimumNearPlane = 0.01f;
+}
+
+/***********************************************************
+ *  LightClusters()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightClusters::LightClusters(ThreadPool* pThreadPool)
+{
+	m_pThreadPool = pThreadPool;
+	m_bEnabled = false;
+	for (int i = 0; i < 2; i++)
+	{
+		m_bufferIDs[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~LightClusters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightClusters::~LightClusters()
+{
+	if (m_bufferIDs[0] != 0)
+	{
+		glDeleteBuffers(2, m_bufferIDs);
+	}
+	m_pThreadPool = NULL;
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for creating the light list buffers.
+ *  They are only used when the fragment shader declares
+ *
+ *    layout(std430, binding = 2) buffer ClusterBuffer
+ *    {
+ *        uvec2 clusterRanges[];     // offset, count
+ *    };
+ *    layout(std430, binding = 3) buffer ClusterIndexBuffer
+ *    {
+ *        uint clusterLightIndices[];
+ *    };
+ *    uniform vec2 clusterDepthParams;
+ *    uniform vec2 clusterTileScale;
+ *    uniform bool bUseClusteredLights;
+ *
+ *  next to the light manager's LightBuffer, which the light
+ *  indices point into, and finds its cluster with
+ *
+ *    uvec2 tile = uvec2(gl_FragCoord.xy * clusterTileScale);
+ *    uint slice = uint(max(log(viewDepth) * clusterDepthParams.x
+ *                          + clusterDepthParams.y, 0.0));
+ *    uint cluster = (min(slice, 23u) * 9u + tile.y) * 16u + tile.x;
+ *
+ *  otherwise the fixed point light array is used.
+ ***********************************************************/
+bool LightClusters::CreateBuffers(GLuint programID)
+{
+	m_bEnabled = false;
+
+	// shader storage blocks need OpenGL 4.3
+	if (!GLEW_VERSION_4_3)
+	{
+		return(false);
+	}
+	GLuint blockIndex = glGetProgramResourceIndex(
+		programID,
+		GL_SHADER_STORAGE_BLOCK,
+		g_ClusterBufferName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return(false);
+	}
+
+	if (m_bufferIDs[0] == 0)
+	{
+		glGenBuffers(2, m_bufferIDs);
+	}
+	m_clusterLights.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+	m_clusterCounts.resize(CLUSTER_COUNT);
+	m_bEnabled = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AssignLights()
+ *
+ *  This method is used for building the light lists of the
+ *  passed in view.  The depth slices are spread over the
+ *  worker threads - every slice owns its own clusters, so
+ *  no locking is needed - and the lists are then packed
+ *  into one index array.
+ ***********************************************************/
+void LightClusters::AssignLights(
+	const std::vector<LightManager::LIGHT>& lights,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	int viewportHeight,
+	LIGHT_GRID& grid)
+{
+	grid.clusters.resize(CLUSTER_COUNT);
+	grid.lightIndices.clear();
+	if ((m_bEnabled == false) || (viewportHeight <= 0))
+	{
+		return;
+	}
+
+	// directional lights reach every cluster, so only the
+	// enabled point and spot lights are clustered
+	m_viewSpaceLights.clear();
+	m_lightIndices.clear();
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const LightManager::LIGHT& light = lights[i];
+		if ((light.bEnabled == false) || (light.type == LightManager::LIGHT_DIRECTIONAL))
+		{
+			continue;
+		}
+
+		glm::vec4 position = view * glm::vec4(light.position, 1.0f);
+		m_viewSpaceLights.push_back(glm::vec4(position.x, position.y, position.z, light.range));
+		m_lightIndices.push_back((uint32_t)i);
+	}
+
+	// recover the clip planes from the projection matrix
+	float nearPlane;
+	float farPlane;
+	if (projection[3][3] == 0.0f)
+	{
+		// perspective
+		nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+	}
+	else
+	{
+		// orthographic
+		nearPlane = (projection[3][2] + 1.0f) / projection[2][2];
+		farPlane = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+	nearPlane = glm::max(nearPlane, g_MinimumNearPlane);
+	farPlane = glm::max(farPlane, nearPlane * 2.0f);
+
+	float logRatio = std::log(farPlane / nearPlane);
+	grid.depthParams = glm::vec2(
+		CLUSTERS_Z / logRatio,
+		-CLUSTERS_Z * std::log(nearPlane) / logRatio);
+
+	// the viewport width follows from the projection aspect
+	float aspect = projection[1][1] / projection[0][0];
+	grid.tileScale = glm::vec2(
+		CLUSTERS_X / (viewportHeight * aspect),
+		(float)CLUSTERS_Y / (float)viewportHeight);
+
+	std::memset(&m_clusterCounts[0], 0, m_clusterCounts.size() * sizeof(uint32_t));
+
+	m_pThreadPool->ParallelFor(
+		CLUSTERS_Z,
+		1,
+		[this, &projection, nearPlane, farPlane](int begin, int end, int threadIndex) {
+			for (int slice = begin; slice < end; slice++)
+			{
+				float sliceNear = nearPlane * std::pow(farPlane / nearPlane, (float)slice / CLUSTERS_Z);
+				float sliceFar = nearPlane * std::pow(farPlane / nearPlane, (float)(slice + 1) / CLUSTERS_Z);
+				AssignSlice(slice, sliceNear, sliceFar, projection);
+			}
+		});
+
+	// pack the cluster lists into one index array
+	uint32_t total = 0;
+	for (int i = 0; i < CLUSTER_COUNT; i++)
+	{
+		total += m_clusterCounts[i];
+	}
+	grid.lightIndices.resize(total);
+
+	uint32_t offset = 0;
+	for (int i = 0; i < CLUSTER_COUNT; i++)
+	{
+		uint32_t count = m_clusterCounts[i];
+		grid.clusters[i].offset = offset;
+		grid.clusters[i].count = count;
+		if (count > 0)
+		{
+			std::memcpy(
+				&grid.lightIndices[offset],
+				&m_clusterLights[i * MAX_LIGHTS_PER_CLUSTER],
+				count * sizeof(uint32_t));
+		}
+		offset += count;
+	}
+}
+
+/***********************************************************
+ *  AssignSlice()
+ *
+ *  This method is used for adding every light that reaches
+ *  into a depth slice to the clusters it covers.  The part
+ *  of the light sphere inside the slice is bounded by a box
+ *  and the box corners are projected to find the tiles.
+ ***********************************************************/
+void LightClusters::AssignSlice(
+	int slice,
+	float sliceNear,
+	float sliceFar,
+	const glm::mat4& projection)
+{
+	for (size_t i = 0; i < m_viewSpaceLights.size(); i++)
+	{
+		const glm::vec4& light = m_viewSpaceLights[i];
+		float depth = -light.z;
+		float radius = light.w;
+
+		if ((depth + radius < sliceNear) || (depth - radius > sliceFar))
+		{
+			continue;
+		}
+
+		// radius of the sphere where it is widest inside the slice
+		float offset = 0.0f;
+		if (depth < sliceNear)
+		{
+			offset = sliceNear - depth;
+		}
+		else if (depth > sliceFar)
+		{
+			offset = depth - sliceFar;
+		}
+		float extent = std::sqrt(glm::max(radius * radius - offset * offset, 0.0f));
+		float boxNear = glm::max(depth - radius, sliceNear);
+		float boxFar = glm::min(depth + radius, sliceFar);
+
+		float minX = 1.0f;
+		float maxX = -1.0f;
+		float minY = 1.0f;
+		float maxY = -1.0f;
+		bool bFirst = true;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec4 point(
+				light.x + ((corner & 1) ? extent : -extent),
+				light.y + ((corner & 2) ? extent : -extent),
+				-((corner & 4) ? boxFar : boxNear),
+				1.0f);
+			glm::vec4 clip = projection * point;
+			float x = clip.x / clip.w;
+			float y = clip.y / clip.w;
+			if (bFirst)
+			{
+				minX = maxX = x;
+				minY = maxY = y;
+				bFirst = false;
+			}
+			else
+			{
+				minX = glm::min(minX, x);
+				maxX = glm::max(maxX, x);
+				minY = glm::min(minY, y);
+				maxY = glm::max(maxY, y);
+			}
+		}
+		if ((maxX < -1.0f) || (minX > 1.0f) || (maxY < -1.0f) || (minY > 1.0f))
+		{
+			continue;
+		}
+
+		int tileMinX = glm::clamp((int)std::floor((minX * 0.5f + 0.5f) * CLUSTERS_X), 0, CLUSTERS_X - 1);
+		int tileMaxX = glm::clamp((int)std::floor((maxX * 0.5f + 0.5f) * CLUSTERS_X), 0, CLUSTERS_X - 1);
+		int tileMinY = glm::clamp((int)std::floor((minY * 0.5f + 0.5f) * CLUSTERS_Y), 0, CLUSTERS_Y - 1);
+		int tileMaxY = glm::clamp((int)std::floor((maxY * 0.5f + 0.5f) * CLUSTERS_Y), 0, CLUSTERS_Y - 1);
+
+		for (int y = tileMinY; y <= tileMaxY; y++)
+		{
+			for (int x = tileMinX; x <= tileMaxX; x++)
+			{
+				int cluster = (slice * CLUSTERS_Y + y) * CLUSTERS_X + x;
+				uint32_t& count = m_clusterCounts[cluster];
+				if (count < MAX_LIGHTS_PER_CLUSTER)
+				{
+					m_clusterLights[cluster * MAX_LIGHTS_PER_CLUSTER + count] = m_lightIndices[i];
+					count++;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  UploadGrid()
+ *
+ *  This method is used for uploading the light lists of a
+ *  frame and binding them to the shader storage blocks.  The
+ *  old storage is orphaned first, so the upload never waits
+ *  on a frame the GPU is still drawing.
+ ***********************************************************/
+void LightClusters::UploadGrid(const LIGHT_GRID& grid)
+{
+	if (m_bEnabled == false)
+	{
+		return;
+	}
+
+	const void* pData[2] = {
+		grid.clusters.empty() ? NULL : &grid.clusters[0],
+		grid.lightIndices.empty() ? NULL : &grid.lightIndices[0] };
+	GLsizeiptr dataSize[2] = {
+		(GLsizeiptr)(grid.clusters.size() * sizeof(CLUSTER_RANGE)),
+		(GLsizeiptr)(grid.lightIndices.size() * sizeof(uint32_t)) };
+	GLuint binding[2] = {
+		g_ClusterBufferBinding,
+		g_IndexBufferBinding };
+
+	for (int i = 0; i < 2; i++)
+	{
+		// an empty block still needs storage to be bound
+		GLsizeiptr bufferSize = (dataSize[i] > 0) ? dataSize[i] : (GLsizeiptr)sizeof(glm::vec4);
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_bufferIDs[i]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, bufferSize, NULL, GL_STREAM_DRAW);
+		if (dataSize[i] > 0)
+		{
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, dataSize[i], pData[i]);
+		}
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding[i], m_bufferIDs[i]);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,108 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.h
+// ============
+// assign point lights to a 3D grid of view frustum clusters for clustered
+// forward shading
+//
+//  The frustum is split into tiles across the screen and exponential
+//  slices in depth.  Every frame the worker threads find the clusters
+//  that each light's sphere of influence touches, and the per-cluster
+//  ranges and the light index list are uploaded into shader storage
+//  buffers.  A fragment then only loops over the lights listed for its
+//  own cluster.  The light data itself is owned by the light manager.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightManager.h"
+#include "ThreadPool.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  LightClusters
+ *
+ *  This class contains the cluster grid and the code for
+ *  assigning the lights to clusters and uploading the light
+ *  lists.
+ ***********************************************************/
+class LightClusters
+{
+public:
+	// size of the cluster grid - must match the constants in
+	// the fragment shader
+	static const int CLUSTERS_X = 16;
+	static const int CLUSTERS_Y = 9;
+	static const int CLUSTERS_Z = 24;
+	static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+	// lights kept for one cluster - any more are dropped
+	static const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+	// range of the light index list used by one cluster
+	struct CLUSTER_RANGE
+	{
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	// light lists of one frame, built on the worker threads
+	// and uploaded on the main thread
+	struct LIGHT_GRID
+	{
+		std::vector<CLUSTER_RANGE> clusters;
+		std::vector<uint32_t> lightIndices;
+		// scale and bias turning log(view depth) into a slice
+		glm::vec2 depthParams;
+		// scale turning window coordinates into a tile
+		glm::vec2 tileScale;
+	};
+
+	// constructor
+	LightClusters(ThreadPool* pThreadPool);
+	// destructor
+	~LightClusters();
+
+	// create the shader storage buffers when the passed in
+	// program declares the cluster blocks - returns false when
+	// the shader uses the fixed point light array instead
+	bool CreateBuffers(GLuint programID);
+	bool IsEnabled() const { return(m_bEnabled); }
+
+	// build the lists of the enabled point and spot lights for
+	// the passed in view - makes no OpenGL calls, so it can run
+	// on the update thread
+	void AssignLights(
+		const std::vector<LightManager::LIGHT>& lights,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		int viewportHeight,
+		LIGHT_GRID& grid);
+
+	// upload the light lists and bind them for shading
+	void UploadGrid(const LIGHT_GRID& grid);
+
+private:
+	// pointer to the threads that assign the lights
+	ThreadPool* m_pThreadPool;
+	// view space bounds of each clustered light and its index
+	// in the light manager, rebuilt every frame
+	std::vector<glm::vec4> m_viewSpaceLights;
+	std::vector<uint32_t> m_lightIndices;
+	// light indices of every cluster before compaction
+	std::vector<uint32_t> m_clusterLights;
+	std::vector<uint32_t> m_clusterCounts;
+	// shader storage buffers - ranges and indices
+	GLuint m_bufferIDs[2];
+	bool m_bEnabled;
+
+	// assign the lights to the clusters of one depth slice
+	void AssignSlice(
+		int slice,
+		float sliceNear,
+		float sliceFar,
+		const glm::mat4& projection);
+};
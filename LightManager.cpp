@@ -0,0 +1,623 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.cpp
+// ============
+// own every light in the scene and upload only the lights that changed
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightManager.h"
+
+#include <cmath>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// shader storage block of the lights and its binding
+	const char* g_LightBufferName = "LightBuffer";
+	const GLuint g_LightBufferBinding = 1;
+	const char* g_LightCountName = "lightCount";
+
+	// lights the buffer has room for when it is first created
+	const int g_InitialBufferCapacity = 16;
+
+	// size of the fixed point light array in the fragment shader
+	const int g_MaxUniformPointLights = 3;
+
+	// attenuation terms used by the fragment shader
+	const float g_AttenuationConstant = 1.0f;
+	const float g_AttenuationLinear = 0.09f;
+	const float g_AttenuationQuadratic = 0.032f;
+	// light level below which a light is treated as dark
+	const float g_MinimumLightLevel = 5.0f / 256.0f;
+}
+
+/***********************************************************
+ *  LightManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightManager::LightManager(ShaderManager* pShaderManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_bAnyDirty = false;
+	m_bufferID = 0;
+	m_bufferCapacity = 0;
+}
+
+/***********************************************************
+ *  ~LightManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightManager::~LightManager()
+{
+	if (m_bufferID != 0)
+	{
+		glDeleteBuffers(1, &m_bufferID);
+		m_bufferID = 0;
+	}
+	m_pShaderManager = NULL;
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light to the array and
+ *  marking it for upload.
+ ***********************************************************/
+int LightManager::AddLight(const LIGHT& light)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_lights.push_back(light);
+	m_dirty.push_back(false);
+	MarkDirty((int)m_lights.size() - 1);
+
+	return((int)m_lights.size() - 1);
+}
+
+/***********************************************************
+ *  AddDirectionalLight()
+ *
+ *  This method is used for adding a light that shines along
+ *  one direction over the whole scene.
+ ***********************************************************/
+int LightManager::AddDirectionalLight(
+	glm::vec3 direction,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular)
+{
+	LIGHT light;
+
+	light.type = LIGHT_DIRECTIONAL;
+	light.position = glm::vec3(0.0f);
+	light.direction = direction;
+	light.ambient = ambient;
+	light.diffuse = diffuse;
+	light.specular = specular;
+	light.range = 0.0f;
+	light.innerCutoff = 0.0f;
+	light.outerCutoff = 0.0f;
+	light.bEnabled = true;
+	light.shadowSlot = -1;
+
+	return(AddLight(light));
+}
+
+/***********************************************************
+ *  AddPointLight()
+ *
+ *  This method is used for adding a light that shines in
+ *  every direction from a position.
+ ***********************************************************/
+int LightManager::AddPointLight(
+	glm::vec3 position,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular,
+	float range)
+{
+	LIGHT light;
+
+	light.type = LIGHT_POINT;
+	light.position = position;
+	light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	light.ambient = ambient;
+	light.diffuse = diffuse;
+	light.specular = specular;
+	light.range = (range > 0.0f) ? range : CalculateLightRange(diffuse, specular);
+	light.innerCutoff = 0.0f;
+	light.outerCutoff = 0.0f;
+	light.bEnabled = true;
+	light.shadowSlot = -1;
+
+	return(AddLight(light));
+}
+
+/***********************************************************
+ *  AddSpotLight()
+ *
+ *  This method is used for adding a light that shines in a
+ *  cone from a position, fading out between the inner and
+ *  the outer cone angles.
+ ***********************************************************/
+int LightManager::AddSpotLight(
+	glm::vec3 position,
+	glm::vec3 direction,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular,
+	float innerConeDegrees,
+	float outerConeDegrees,
+	float range)
+{
+	LIGHT light;
+
+	light.type = LIGHT_SPOT;
+	light.position = position;
+	light.direction = direction;
+	light.ambient = ambient;
+	light.diffuse = diffuse;
+	light.specular = specular;
+	light.range = (range > 0.0f) ? range : CalculateLightRange(diffuse, specular);
+	light.innerCutoff = std::cos(glm::radians(innerConeDegrees));
+	light.outerCutoff = std::cos(glm::radians(outerConeDegrees));
+	light.bEnabled = true;
+	light.shadowSlot = -1;
+
+	return(AddLight(light));
+}
+
+/***********************************************************
+ *  SetLightEnabled()
+ *
+ *  This method is used for switching a light on or off.
+ ***********************************************************/
+void LightManager::SetLightEnabled(int lightIndex, bool bEnabled)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if ((lightIndex >= 0) && (lightIndex < (int)m_lights.size()) &&
+		(m_lights[lightIndex].bEnabled != bEnabled))
+	{
+		m_lights[lightIndex].bEnabled = bEnabled;
+		MarkDirty(lightIndex);
+	}
+}
+
+/***********************************************************
+ *  SetLightPosition()
+ *
+ *  This method is used for moving a point or spot light.
+ ***********************************************************/
+void LightManager::SetLightPosition(int lightIndex, glm::vec3 position)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if ((lightIndex >= 0) && (lightIndex < (int)m_lights.size()) &&
+		(m_lights[lightIndex].position != position))
+	{
+		m_lights[lightIndex].position = position;
+		MarkDirty(lightIndex);
+	}
+}
+
+/***********************************************************
+ *  SetLightDirection()
+ *
+ *  This method is used for turning a directional or spot
+ *  light.
+ ***********************************************************/
+void LightManager::SetLightDirection(int lightIndex, glm::vec3 direction)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if ((lightIndex >= 0) && (lightIndex < (int)m_lights.size()) &&
+		(m_lights[lightIndex].direction != direction))
+	{
+		m_lights[lightIndex].direction = direction;
+		MarkDirty(lightIndex);
+	}
+}
+
+/***********************************************************
+ *  SetLightColors()
+ *
+ *  This method is used for changing the colors of a light.
+ *  The range of a point or spot light follows the new
+ *  brightness.
+ ***********************************************************/
+void LightManager::SetLightColors(
+	int lightIndex,
+	glm::vec3 ambient,
+	glm::vec3 diffuse,
+	glm::vec3 specular)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if ((lightIndex < 0) || (lightIndex >= (int)m_lights.size()))
+	{
+		return;
+	}
+
+	LIGHT& light = m_lights[lightIndex];
+	light.ambient = ambient;
+	light.diffuse = diffuse;
+	light.specular = specular;
+	if (light.type != LIGHT_DIRECTIONAL)
+	{
+		light.range = CalculateLightRange(diffuse, specular);
+	}
+	MarkDirty(lightIndex);
+}
+
+/***********************************************************
+ *  SetShadowSlot()
+ *
+ *  This method is used for setting the point shadow atlas
+ *  slot that holds the shadow of a light.
+ ***********************************************************/
+void LightManager::SetShadowSlot(int lightIndex, int slot)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if ((lightIndex >= 0) && (lightIndex < (int)m_lights.size()) &&
+		(m_lights[lightIndex].shadowSlot != slot))
+	{
+		m_lights[lightIndex].shadowSlot = slot;
+		MarkDirty(lightIndex);
+	}
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for getting the number of lights.
+ ***********************************************************/
+int LightManager::GetLightCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return((int)m_lights.size());
+}
+
+/***********************************************************
+ *  CopyLights()
+ *
+ *  This method is used for copying the lights into the
+ *  passed in array, so the update thread can work with them
+ *  while they are changed on the main thread.
+ ***********************************************************/
+void LightManager::CopyLights(std::vector<LIGHT>& lights) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	lights = m_lights;
+}
+
+/***********************************************************
+ *  CalculateLightRange()
+ *
+ *  This method is used for calculating the distance at which
+ *  the attenuated light drops below the visible level, by
+ *  solving the attenuation quadratic for the brightest
+ *  color channel.
+ ***********************************************************/
+float LightManager::CalculateLightRange(
+	glm::vec3 diffuse,
+	glm::vec3 specular)
+{
+	float brightest = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		brightest = glm::max(brightest, glm::max(diffuse[i], specular[i]));
+	}
+	if (brightest <= 0.0f)
+	{
+		return(0.0f);
+	}
+
+	// brightest / (c + l*d + q*d*d) = minimum level
+	float c = g_AttenuationConstant - brightest / g_MinimumLightLevel;
+	float l = g_AttenuationLinear;
+	float q = g_AttenuationQuadratic;
+	float discriminant = l * l - 4.0f * q * c;
+
+	return((-l + std::sqrt(glm::max(discriminant, 0.0f))) / (2.0f * q));
+}
+
+/***********************************************************
+ *  CalculateAttenuation()
+ *
+ *  This method is used for calculating how much of a point
+ *  or spot light reaches the passed in distance, the same
+ *  way the fragment shader does.
+ ***********************************************************/
+float LightManager::CalculateAttenuation(float distance)
+{
+	return(1.0f / (g_AttenuationConstant +
+		g_AttenuationLinear * distance +
+		g_AttenuationQuadratic * distance * distance));
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating the light buffer.  It is
+ *  only used when the fragment shader declares
+ *
+ *    struct LightData
+ *    {
+ *        vec4 positionRange;
+ *        vec4 directionType;    // 0 directional, 1 point, 2 spot
+ *        vec4 ambient;          // w - enabled
+ *        vec4 diffuse;          // w - cosine of the inner cone
+ *        vec4 specular;         // w - cosine of the outer cone
+ *        vec4 shadowParams;     // x - point shadow slot or -1
+ *    };
+ *    layout(std430, binding = 1) buffer LightBuffer
+ *    {
+ *        LightData lights[];
+ *    };
+ *    uniform int lightCount;
+ *
+ *  otherwise the fixed directionalLight, pointLights[] and
+ *  spotLight uniforms are set for the first lights of each
+ *  type.
+ ***********************************************************/
+bool LightManager::CreateBuffer(GLuint programID)
+{
+	// shader storage blocks need OpenGL 4.3
+	if (!GLEW_VERSION_4_3)
+	{
+		return(false);
+	}
+	GLuint blockIndex = glGetProgramResourceIndex(
+		programID,
+		GL_SHADER_STORAGE_BLOCK,
+		g_LightBufferName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return(false);
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_bufferID == 0)
+	{
+		glGenBuffers(1, &m_bufferID);
+	}
+	// force the buffer to be allocated on the next upload
+	m_bufferCapacity = 0;
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		MarkDirty((int)i);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  MarkAllDirty()
+ *
+ *  This method is used for marking every light for upload,
+ *  so a new program gets the fixed light uniforms again.
+ ***********************************************************/
+void LightManager::MarkAllDirty()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		MarkDirty((int)i);
+	}
+}
+
+/***********************************************************
+ *  SetProgramUniforms()
+ *
+ *  This method is used for setting the lights on a program
+ *  other than the scene program, whatever was uploaded to
+ *  the scene program before.  With the light buffer only
+ *  the light count is a uniform.
+ ***********************************************************/
+void LightManager::SetProgramUniforms()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_bufferID != 0)
+	{
+		m_pShaderManager->setIntValue(g_LightCountName, (int)m_lights.size());
+		return;
+	}
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		UploadLightUniforms((int)i);
+	}
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for marking a light for upload.
+ ***********************************************************/
+void LightManager::MarkDirty(int lightIndex)
+{
+	m_dirty[lightIndex] = true;
+	m_bAnyDirty = true;
+}
+
+/***********************************************************
+ *  PackLight()
+ *
+ *  This method is used for packing a light into the layout
+ *  of the light buffer.
+ ***********************************************************/
+void LightManager::PackLight(const LIGHT& light, GPU_LIGHT& packed)
+{
+	packed.positionRange = glm::vec4(light.position, light.range);
+	packed.directionType = glm::vec4(light.direction, (float)light.type);
+	packed.ambient = glm::vec4(light.ambient, light.bEnabled ? 1.0f : 0.0f);
+	packed.diffuse = glm::vec4(light.diffuse, light.innerCutoff);
+	packed.specular = glm::vec4(light.specular, light.outerCutoff);
+	packed.shadowParams = glm::vec4((float)light.shadowSlot, 0.0f, 0.0f, 0.0f);
+}
+
+/***********************************************************
+ *  UploadChanges()
+ *
+ *  This method is used for uploading the lights marked since
+ *  the last upload.  Runs of neighbouring dirty lights are
+ *  written with one glBufferSubData call each; the buffer is
+ *  only written whole when it has to grow.
+ ***********************************************************/
+void LightManager::UploadChanges()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_bAnyDirty == false)
+	{
+		return;
+	}
+
+	int lightCount = (int)m_lights.size();
+
+	if (m_bufferID == 0)
+	{
+		for (int i = 0; i < lightCount; i++)
+		{
+			if (m_dirty[i])
+			{
+				UploadLightUniforms(i);
+				m_dirty[i] = false;
+			}
+		}
+		m_bAnyDirty = false;
+		return;
+	}
+
+	std::vector<GPU_LIGHT> packed;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_bufferID);
+
+	if (lightCount > m_bufferCapacity)
+	{
+		m_bufferCapacity = glm::max(glm::max(lightCount, m_bufferCapacity * 2), g_InitialBufferCapacity);
+		packed.resize(m_bufferCapacity);
+		for (int i = 0; i < m_bufferCapacity; i++)
+		{
+			if (i < lightCount)
+			{
+				PackLight(m_lights[i], packed[i]);
+				m_dirty[i] = false;
+			}
+			else
+			{
+				packed[i] = GPU_LIGHT();
+			}
+		}
+		glBufferData(
+			GL_SHADER_STORAGE_BUFFER,
+			m_bufferCapacity * sizeof(GPU_LIGHT),
+			&packed[0],
+			GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_LightBufferBinding, m_bufferID);
+	}
+	else
+	{
+		int first = 0;
+		while (first < lightCount)
+		{
+			if (m_dirty[first] == false)
+			{
+				first++;
+				continue;
+			}
+
+			int last = first;
+			while ((last < lightCount) && m_dirty[last])
+			{
+				last++;
+			}
+
+			packed.resize(last - first);
+			for (int i = first; i < last; i++)
+			{
+				PackLight(m_lights[i], packed[i - first]);
+				m_dirty[i] = false;
+			}
+			glBufferSubData(
+				GL_SHADER_STORAGE_BUFFER,
+				first * sizeof(GPU_LIGHT),
+				(last - first) * sizeof(GPU_LIGHT),
+				&packed[0]);
+
+			first = last;
+		}
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	m_pShaderManager->setIntValue(g_LightCountName, lightCount);
+	m_bAnyDirty = false;
+}
+
+/***********************************************************
+ *  UploadLightUniforms()
+ *
+ *  This method is used for setting the fixed uniforms of a
+ *  light, for shaders without the light buffer.  Only the
+ *  first directional light, the first point lights and the
+ *  first spot light have uniforms.
+ ***********************************************************/
+void LightManager::UploadLightUniforms(int lightIndex)
+{
+	const LIGHT& light = m_lights[lightIndex];
+	std::string name;
+
+	// the uniform index counts only lights of the same type
+	int typeIndex = 0;
+	for (int i = 0; i < lightIndex; i++)
+	{
+		if (m_lights[i].type == light.type)
+		{
+			typeIndex++;
+		}
+	}
+
+	switch (light.type)
+	{
+	case LIGHT_DIRECTIONAL:
+		if (typeIndex > 0)
+			return;
+		name = "directionalLight.";
+		break;
+	case LIGHT_POINT:
+		if (typeIndex >= g_MaxUniformPointLights)
+			return;
+		name = "pointLights[" + std::to_string(typeIndex) + "].";
+		break;
+	case LIGHT_SPOT:
+		if (typeIndex > 0)
+			return;
+		name = "spotLight.";
+		break;
+	}
+
+	if (light.type != LIGHT_POINT)
+	{
+		m_pShaderManager->setVec3Value(name + "direction", light.direction);
+	}
+	if (light.type != LIGHT_DIRECTIONAL)
+	{
+		m_pShaderManager->setVec3Value(name + "position", light.position);
+	}
+	if (light.type == LIGHT_SPOT)
+	{
+		m_pShaderManager->setFloatValue(name + "cutOff", light.innerCutoff);
+		m_pShaderManager->setFloatValue(name + "outerCutOff", light.outerCutoff);
+	}
+	m_pShaderManager->setVec3Value(name + "ambient", light.ambient);
+	m_pShaderManager->setVec3Value(name + "diffuse", light.diffuse);
+	m_pShaderManager->setVec3Value(name + "specular", light.specular);
+	m_pShaderManager->setBoolValue(name + "bActive", light.bEnabled);
+}
@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.h
+// ============
+// own every light in the scene and upload only the lights that changed
+//
+//  Lights are kept in one typed array and addressed by index, so they can
+//  be switched on and off, moved and recolored at runtime without using
+//  shader uniform names.  Every change sets the dirty bit of that light,
+//  and the next upload writes only the dirty ranges of the light buffer.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <mutex>
+#include <vector>
+
+/***********************************************************
+ *  LightManager
+ *
+ *  This class contains the scene lights, their dirty bits
+ *  and the code for uploading the changed lights.
+ ***********************************************************/
+class LightManager
+{
+public:
+	// kinds of light the shaders support
+	enum LIGHT_TYPE
+	{
+		LIGHT_DIRECTIONAL = 0,
+		LIGHT_POINT,
+		LIGHT_SPOT
+	};
+
+	// one light in the scene
+	struct LIGHT
+	{
+		LIGHT_TYPE type;
+		glm::vec3 position;
+		glm::vec3 direction;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		// distance past which a point or spot light is dark
+		float range;
+		// cosines of the spot cone edges
+		float innerCutoff;
+		float outerCutoff;
+		bool bEnabled;
+		// point shadow atlas slot, -1 for none
+		int shadowSlot;
+	};
+
+	// light as stored in the light buffer - matches the
+	// std430 layout of the shader block
+	struct GPU_LIGHT
+	{
+		glm::vec4 positionRange;
+		glm::vec4 directionType;
+		// w - 1 when the light is enabled
+		glm::vec4 ambient;
+		// w - cosine of the inner spot cone
+		glm::vec4 diffuse;
+		// w - cosine of the outer spot cone
+		glm::vec4 specular;
+		// x - point shadow atlas slot, -1 for none
+		glm::vec4 shadowParams;
+	};
+
+	// constructor
+	LightManager(ShaderManager* pShaderManager);
+	// destructor
+	~LightManager();
+
+	// add a light - each returns the index of the new light.
+	// a range of 0 is calculated from the light colors
+	int AddDirectionalLight(
+		glm::vec3 direction,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular);
+	int AddPointLight(
+		glm::vec3 position,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular,
+		float range = 0.0f);
+	int AddSpotLight(
+		glm::vec3 position,
+		glm::vec3 direction,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular,
+		float innerConeDegrees,
+		float outerConeDegrees,
+		float range = 0.0f);
+
+	// change a light at runtime
+	void SetLightEnabled(int lightIndex, bool bEnabled);
+	void SetLightPosition(int lightIndex, glm::vec3 position);
+	void SetLightDirection(int lightIndex, glm::vec3 direction);
+	void SetLightColors(
+		int lightIndex,
+		glm::vec3 ambient,
+		glm::vec3 diffuse,
+		glm::vec3 specular);
+	void SetShadowSlot(int lightIndex, int slot);
+
+	int GetLightCount() const;
+
+	// copy the lights for the frame being updated
+	void CopyLights(std::vector<LIGHT>& lights) const;
+
+	// calculate the distance past which the shader attenuation
+	// makes a light too dim to see
+	static float CalculateLightRange(
+		glm::vec3 diffuse,
+		glm::vec3 specular);
+	// calculate the shader attenuation at a distance from a
+	// point or spot light
+	static float CalculateAttenuation(float distance);
+
+	// create the light buffer when the passed in program
+	// declares the light block - the fixed light uniforms are
+	// used otherwise
+	bool CreateBuffer(GLuint programID);
+	bool IsBufferEnabled() const { return(m_bufferID != 0); }
+
+	// upload the lights that changed since the last upload
+	void UploadChanges();
+	// upload every light again with the next upload - used
+	// after the scene program was replaced
+	void MarkAllDirty();
+	// set the light uniforms of every light on the bound
+	// program, which shares the lights of the scene program
+	void SetProgramUniforms();
+
+private:
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// guards the lights - they are changed on the main thread
+	// and copied on the update thread
+	mutable std::mutex m_mutex;
+	std::vector<LIGHT> m_lights;
+	std::vector<bool> m_dirty;
+	bool m_bAnyDirty;
+	// light buffer and the number of lights it has room for
+	GLuint m_bufferID;
+	int m_bufferCapacity;
+
+	// add a light and mark it for upload
+	int AddLight(const LIGHT& light);
+	// mark a light for upload - the lock must be held
+	void MarkDirty(int lightIndex);
+	// pack a light into the buffer layout
+	static void PackLight(const LIGHT& light, GPU_LIGHT& packed);
+	// set the fixed light uniforms of a light
+	void UploadLightUniforms(int lightIndex);
+};
@@ -0,0 +1,1328 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.cpp
+// ============
+// bake the lighting of the static scene objects into a lightmap atlas
+//
+//  The lightmap holds the ambient and diffuse light of the fragment shader
+//  lighting model - the same attenuation and spot cone terms - with the
+//  shadows and light bounces that the shader cannot afford.  Rays are
+//  first tested against the world space boxes of 4 objects at a time (SSE)
+//  and only the boxes that are hit are intersected with the exact shape in
+//  object space.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightmapBaker.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define LIGHTMAP_BAKER_SSE
+#include <immintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// gap around every chart, as a fraction of the object tile
+	const float g_ChartMargin = 0.02f;
+	// thickness of the torus tube, as loaded by the meshes
+	const float g_TorusThickness = 0.1f;
+	// top radius of the tapered cylinder
+	const float g_TaperedTopRadius = 0.5f;
+
+	// plane, 2 x 2 in the XZ plane
+	const LightmapBaker::CHART g_PlaneCharts[] = {
+		{ LightmapBaker::CHART_GRID, glm::vec4(g_ChartMargin, g_ChartMargin, 1.0f - g_ChartMargin, 1.0f - g_ChartMargin), 1, 1 } };
+	// box faces +X, -X, +Y, -Y, +Z, -Z in a 3 x 2 grid
+	const LightmapBaker::CHART g_BoxCharts[] = {
+		{ LightmapBaker::CHART_GRID, glm::vec4(0.0f / 3.0f + g_ChartMargin, 0.0f + g_ChartMargin, 1.0f / 3.0f - g_ChartMargin, 0.5f - g_ChartMargin), 1, 1 },
+		{ LightmapBaker::CHART_GRID, glm::vec4(1.0f / 3.0f + g_ChartMargin, 0.0f + g_ChartMargin, 2.0f / 3.0f - g_ChartMargin, 0.5f - g_ChartMargin), 1, 1 },
+		{ LightmapBaker::CHART_GRID, glm::vec4(2.0f / 3.0f + g_ChartMargin, 0.0f + g_ChartMargin, 3.0f / 3.0f - g_ChartMargin, 0.5f - g_ChartMargin), 1, 1 },
+		{ LightmapBaker::CHART_GRID, glm::vec4(0.0f / 3.0f + g_ChartMargin, 0.5f + g_ChartMargin, 1.0f / 3.0f - g_ChartMargin, 1.0f - g_ChartMargin), 1, 1 },
+		{ LightmapBaker::CHART_GRID, glm::vec4(1.0f / 3.0f + g_ChartMargin, 0.5f + g_ChartMargin, 2.0f / 3.0f - g_ChartMargin, 1.0f - g_ChartMargin), 1, 1 },
+		{ LightmapBaker::CHART_GRID, glm::vec4(2.0f / 3.0f + g_ChartMargin, 0.5f + g_ChartMargin, 3.0f / 3.0f - g_ChartMargin, 1.0f - g_ChartMargin), 1, 1 } };
+	// cylinder side along the bottom of the tile, and the
+	// bottom and top caps above it
+	const LightmapBaker::CHART g_CylinderCharts[] = {
+		{ LightmapBaker::CHART_GRID, glm::vec4(g_ChartMargin, g_ChartMargin, 1.0f - g_ChartMargin, 0.6f - g_ChartMargin), 36, 1 },
+		{ LightmapBaker::CHART_DISC, glm::vec4(g_ChartMargin, 0.6f + g_ChartMargin, 0.5f - g_ChartMargin, 1.0f - g_ChartMargin), 36, 1 },
+		{ LightmapBaker::CHART_DISC, glm::vec4(0.5f + g_ChartMargin, 0.6f + g_ChartMargin, 1.0f - g_ChartMargin, 1.0f - g_ChartMargin), 36, 1 } };
+	// torus, around the main ring and the tube
+	const LightmapBaker::CHART g_TorusCharts[] = {
+		{ LightmapBaker::CHART_GRID, glm::vec4(g_ChartMargin, g_ChartMargin, 1.0f - g_ChartMargin, 1.0f - g_ChartMargin), 40, 20 } };
+
+	// axes of the box faces - position is the normal / 2 plus
+	// (s - 0.5) * U + (t - 0.5) * V
+	const glm::vec3 g_BoxNormals[6] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+	const glm::vec3 g_BoxAxesU[6] = {
+		glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f) };
+	const glm::vec3 g_BoxAxesV[6] = {
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) };
+
+	// distance rays start away from a surface, so they do
+	// not hit the surface they leave
+	const float g_RayOffset = 2.0e-3f;
+	// closest object space distance counted as a hit
+	const float g_HitEpsilon = 1.0e-5f;
+	// steps and surface distance of the torus sphere tracing
+	const int g_TorusMarchSteps = 128;
+	const float g_TorusSurfaceDistance = 1.0e-4f;
+
+	// fraction of the atlas the tiles are sized to fill,
+	// smallest tile and the gap between the tiles in texels
+	const float g_AtlasFill = 0.8f;
+	const int g_MinTileSize = 16;
+	const int g_TilePadding = 2;
+	// texels filled around the charts after the bake
+	const int g_DilationPasses = 4;
+
+	// lightmap file header
+	const char g_FileMagic[4] = { 'L', 'M', 'A', 'P' };
+	const int32_t g_FileVersion = 1;
+	const int32_t g_MaxFileSize = 16384;
+
+	/***********************************************************
+	 *  RANDOM
+	 *
+	 *  Small xorshift generator, seeded per texel so the bake
+	 *  gives the same result on any number of threads.
+	 ***********************************************************/
+	struct RANDOM
+	{
+		uint32_t state;
+
+		RANDOM(uint32_t seed)
+		{
+			// spread the seed bits so neighboring texels start far
+			// apart in the sequence
+			state = seed * 0x9E3779B9u + 0x7F4A7C15u;
+			state ^= state >> 16;
+			state *= 0x85EBCA6Bu;
+			state ^= state >> 13;
+			if (state == 0)
+			{
+				state = 1;
+			}
+		}
+
+		// next number in [0, 1)
+		float Next()
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return((float)(state >> 8) * (1.0f / 16777216.0f));
+		}
+	};
+
+	/***********************************************************
+	 *  SampleCosineHemisphere()
+	 *
+	 *  Pick a direction around a normal with a probability that
+	 *  follows the cosine, so every sample of a diffuse bounce
+	 *  counts the same.
+	 ***********************************************************/
+	glm::vec3 SampleCosineHemisphere(glm::vec3 normal, RANDOM& random)
+	{
+		glm::vec3 helper = (std::fabs(normal.x) > 0.9f) ?
+			glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 tangent = glm::normalize(glm::cross(helper, normal));
+		glm::vec3 bitangent = glm::cross(normal, tangent);
+
+		float angle = 2.0f * PI * random.Next();
+		float r2 = random.Next();
+		float radius = std::sqrt(r2);
+
+		return(tangent * (std::cos(angle) * radius) +
+			bitangent * (std::sin(angle) * radius) +
+			normal * std::sqrt(1.0f - r2));
+	}
+
+	/***********************************************************
+	 *  FloatToHalf()
+	 *
+	 *  Convert a float to a half float - lightmap values are
+	 *  never negative, and tiny values are flushed to zero.
+	 ***********************************************************/
+	uint16_t FloatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000u;
+		int32_t exponent = (int32_t)((bits >> 23) & 0xFFu) - 127 + 15;
+		uint32_t mantissa = bits & 0x7FFFFFu;
+
+		if (exponent <= 0)
+		{
+			return((uint16_t)sign);
+		}
+		if (exponent >= 31)
+		{
+			// largest finite half
+			return((uint16_t)(sign | 0x7BFFu));
+		}
+
+		// round to the nearest half mantissa
+		uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000u)
+		{
+			half++;
+		}
+		return((uint16_t)half);
+	}
+
+	/***********************************************************
+	 *  IntersectSlab()
+	 *
+	 *  Intersect a ray with an object space box, giving the
+	 *  entry and exit distances.
+	 ***********************************************************/
+	bool IntersectSlab(
+		glm::vec3 origin,
+		glm::vec3 direction,
+		glm::vec3 boxMin,
+		glm::vec3 boxMax,
+		float& tEnter,
+		float& tExit,
+		int& enterAxis,
+		int& exitAxis)
+	{
+		tEnter = -FLT_MAX;
+		tExit = FLT_MAX;
+		enterAxis = 0;
+		exitAxis = 0;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (std::fabs(direction[axis]) < 1.0e-12f)
+			{
+				if ((origin[axis] < boxMin[axis]) || (origin[axis] > boxMax[axis]))
+				{
+					return(false);
+				}
+				continue;
+			}
+
+			float t0 = (boxMin[axis] - origin[axis]) / direction[axis];
+			float t1 = (boxMax[axis] - origin[axis]) / direction[axis];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			if (t0 > tEnter)
+			{
+				tEnter = t0;
+				enterAxis = axis;
+			}
+			if (t1 < tExit)
+			{
+				tExit = t1;
+				exitAxis = axis;
+			}
+		}
+
+		return(tEnter <= tExit);
+	}
+
+	/***********************************************************
+	 *  GetShapeBox()
+	 *
+	 *  Get the object space box around a basic shape.
+	 ***********************************************************/
+	void GetShapeBox(int shape, glm::vec3& boxMin, glm::vec3& boxMax)
+	{
+		switch (shape)
+		{
+		case LightmapBaker::SHAPE_PLANE:
+			boxMin = glm::vec3(-1.0f, -1.0e-3f, -1.0f);
+			boxMax = glm::vec3(1.0f, 1.0e-3f, 1.0f);
+			break;
+		case LightmapBaker::SHAPE_CYLINDER:
+		case LightmapBaker::SHAPE_TAPERED_CYLINDER:
+			boxMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+			boxMax = glm::vec3(1.0f, 1.0f, 1.0f);
+			break;
+		case LightmapBaker::SHAPE_TORUS:
+			boxMin = glm::vec3(-1.0f - g_TorusThickness, -1.0f - g_TorusThickness, -g_TorusThickness);
+			boxMax = glm::vec3(1.0f + g_TorusThickness, 1.0f + g_TorusThickness, g_TorusThickness);
+			break;
+		case LightmapBaker::SHAPE_BOX:
+		default:
+			boxMin = glm::vec3(-0.5f);
+			boxMax = glm::vec3(0.5f);
+			break;
+		}
+	}
+}
+
+/***********************************************************
+ *  LightmapBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightmapBaker::LightmapBaker(ThreadPool* pThreadPool)
+{
+	m_pThreadPool = pThreadPool;
+	m_atlasSize = 1024;
+	m_samplesPerTexel = 64;
+	m_bounceCount = 2;
+}
+
+/***********************************************************
+ *  ~LightmapBaker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightmapBaker::~LightmapBaker()
+{
+	m_pThreadPool = NULL;
+}
+
+/***********************************************************
+ *  SetQuality()
+ *
+ *  This method is used for setting the atlas size, the
+ *  number of paths traced for every texel and how many
+ *  times each path bounces.
+ ***********************************************************/
+void LightmapBaker::SetQuality(int atlasSize, int samplesPerTexel, int bounceCount)
+{
+	m_atlasSize = glm::clamp(atlasSize, g_MinTileSize * 4, (int)g_MaxFileSize);
+	m_samplesPerTexel = glm::max(samplesPerTexel, 1);
+	m_bounceCount = glm::max(bounceCount, 0);
+}
+
+/***********************************************************
+ *  GetChartCount()
+ *
+ *  This method is used for getting the number of charts a
+ *  basic shape is unwrapped into.
+ ***********************************************************/
+int LightmapBaker::GetChartCount(int shape)
+{
+	switch (shape)
+	{
+	case SHAPE_PLANE:
+		return((int)(sizeof(g_PlaneCharts) / sizeof(g_PlaneCharts[0])));
+	case SHAPE_BOX:
+		return((int)(sizeof(g_BoxCharts) / sizeof(g_BoxCharts[0])));
+	case SHAPE_CYLINDER:
+	case SHAPE_TAPERED_CYLINDER:
+		return((int)(sizeof(g_CylinderCharts) / sizeof(g_CylinderCharts[0])));
+	case SHAPE_TORUS:
+		return((int)(sizeof(g_TorusCharts) / sizeof(g_TorusCharts[0])));
+	}
+
+	return(0);
+}
+
+/***********************************************************
+ *  GetChart()
+ *
+ *  This method is used for getting one chart of a basic
+ *  shape.  The chart index must be below GetChartCount().
+ ***********************************************************/
+const LightmapBaker::CHART& LightmapBaker::GetChart(int shape, int chart)
+{
+	switch (shape)
+	{
+	case SHAPE_BOX:
+		return(g_BoxCharts[chart]);
+	case SHAPE_CYLINDER:
+	case SHAPE_TAPERED_CYLINDER:
+		return(g_CylinderCharts[chart]);
+	case SHAPE_TORUS:
+		return(g_TorusCharts[chart]);
+	}
+
+	return(g_PlaneCharts[chart]);
+}
+
+/***********************************************************
+ *  EvaluateChart()
+ *
+ *  This method is used for mapping chart coordinates onto
+ *  the surface of a basic shape.  The shapes have the same
+ *  dimensions as the ShapeMeshes shapes, and the texture
+ *  coordinates follow the same layout.  Disc charts map the
+ *  square linearly, so their corners are off the surface.
+ ***********************************************************/
+bool LightmapBaker::EvaluateChart(
+	int shape,
+	int chart,
+	float s,
+	float t,
+	glm::vec3& position,
+	glm::vec3& normal,
+	glm::vec2& uv)
+{
+	uv = glm::vec2(s, t);
+
+	switch (shape)
+	{
+	case SHAPE_PLANE:
+		position = glm::vec3(2.0f * s - 1.0f, 0.0f, 1.0f - 2.0f * t);
+		normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		return(true);
+
+	case SHAPE_BOX:
+		position = g_BoxNormals[chart] * 0.5f +
+			g_BoxAxesU[chart] * (s - 0.5f) +
+			g_BoxAxesV[chart] * (t - 0.5f);
+		normal = g_BoxNormals[chart];
+		return(true);
+
+	case SHAPE_CYLINDER:
+	case SHAPE_TAPERED_CYLINDER:
+	{
+		float bottomRadius = 1.0f;
+		float topRadius = (shape == SHAPE_TAPERED_CYLINDER) ? g_TaperedTopRadius : 1.0f;
+
+		if (chart == 0)
+		{
+			// the side normals lean outwards when the top is
+			// narrower, like the generated meshes
+			float angle = s * 2.0f * PI;
+			float radius = bottomRadius + (topRadius - bottomRadius) * t;
+			float slope = bottomRadius - topRadius;
+			position = glm::vec3(radius * std::cos(angle), t, radius * std::sin(angle));
+			normal = glm::normalize(glm::vec3(std::cos(angle), slope, std::sin(angle)));
+			return(true);
+		}
+
+		float x = 2.0f * s - 1.0f;
+		float z = 2.0f * t - 1.0f;
+		if (x * x + z * z > 1.0f)
+		{
+			return(false);
+		}
+		if (chart == 1)
+		{
+			position = glm::vec3(x * bottomRadius, 0.0f, z * bottomRadius);
+			normal = glm::vec3(0.0f, -1.0f, 0.0f);
+		}
+		else
+		{
+			position = glm::vec3(x * topRadius, 1.0f, z * topRadius);
+			normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		}
+		return(true);
+	}
+
+	case SHAPE_TORUS:
+	{
+		float theta = s * 2.0f * PI;
+		float phi = t * 2.0f * PI;
+		normal = glm::vec3(
+			std::cos(phi) * std::cos(theta),
+			std::cos(phi) * std::sin(theta),
+			std::sin(phi));
+		position = glm::vec3(std::cos(theta), std::sin(theta), 0.0f) + normal * g_TorusThickness;
+		return(true);
+	}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for baking the lightmap atlas.  The
+ *  tiles are sized so the atlas is mostly filled with an
+ *  even texel density, then every tile row is traced as a
+ *  separate job and the texels around the charts are
+ *  filled in.
+ ***********************************************************/
+bool LightmapBaker::Bake(
+	const std::vector<BAKE_OBJECT>& objects,
+	const std::vector<LightManager::LIGHT>& lights,
+	LIGHTMAP_DATA& lightmap)
+{
+	PrepareObjects(objects);
+	m_lights = lights;
+
+	int objectCount = (int)m_objects.size();
+	std::vector<float> areas(objectCount);
+	float totalArea = 0.0f;
+	for (int i = 0; i < objectCount; i++)
+	{
+		areas[i] = CalculateSurfaceArea(m_objects[i]);
+		totalArea += areas[i];
+	}
+	if ((objectCount == 0) || (totalArea <= 0.0f))
+	{
+		std::cout << "There are no surfaces to bake into the lightmap" << std::endl;
+		return(false);
+	}
+
+	// shrink the texel density until every tile fits
+	std::vector<TILE> tiles;
+	float texelsPerUnit = std::sqrt(g_AtlasFill * (float)m_atlasSize * (float)m_atlasSize / totalArea);
+	int attempts = 0;
+	while (PackTiles(areas, texelsPerUnit, tiles) == false)
+	{
+		texelsPerUnit *= 0.9f;
+		if (++attempts > 100)
+		{
+			std::cout << "The scene objects do not fit into a " << m_atlasSize << " lightmap" << std::endl;
+			return(false);
+		}
+	}
+
+	int texelCount = m_atlasSize * m_atlasSize;
+	std::vector<glm::vec3> irradiance(texelCount, glm::vec3(0.0f));
+	std::vector<uint8_t> coverage(texelCount, 0);
+
+	// one job per tile row keeps the jobs small enough for
+	// the threads to balance
+	std::vector<glm::ivec2> rows;
+	for (int i = 0; i < objectCount; i++)
+	{
+		for (int row = 0; row < tiles[i].size; row++)
+		{
+			rows.push_back(glm::ivec2(i, row));
+		}
+	}
+	m_pThreadPool->ParallelFor(
+		(int)rows.size(),
+		1,
+		[this, &rows, &tiles, &irradiance, &coverage](int begin, int end, int threadIndex) {
+			for (int i = begin; i < end; i++)
+			{
+				BakeTileRow(tiles[rows[i].x], rows[i].x, rows[i].y, irradiance, coverage);
+			}
+		});
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		DilateTile(tiles[i], irradiance, coverage);
+	}
+
+	lightmap.width = m_atlasSize;
+	lightmap.height = m_atlasSize;
+	lightmap.objectShapes.resize(objectCount);
+	lightmap.objectRects.resize(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		float scale = 1.0f / (float)m_atlasSize;
+		lightmap.objectShapes[i] = m_objects[i].shape;
+		lightmap.objectRects[i] = glm::vec4(
+			(float)tiles[i].x * scale,
+			(float)tiles[i].y * scale,
+			(float)tiles[i].size * scale,
+			(float)tiles[i].size * scale);
+	}
+	lightmap.texels.resize(texelCount * 3);
+	for (int i = 0; i < texelCount; i++)
+	{
+		lightmap.texels[i * 3 + 0] = FloatToHalf(irradiance[i].r);
+		lightmap.texels[i * 3 + 1] = FloatToHalf(irradiance[i].g);
+		lightmap.texels[i * 3 + 2] = FloatToHalf(irradiance[i].b);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  PrepareObjects()
+ *
+ *  This method is used for preparing the objects for ray
+ *  tracing and storing their world space boxes, padded to
+ *  a whole number of SIMD groups with boxes no ray hits.
+ ***********************************************************/
+void LightmapBaker::PrepareObjects(const std::vector<BAKE_OBJECT>& objects)
+{
+	int objectCount = (int)objects.size();
+	int paddedCount = (objectCount + 3) & ~3;
+
+	m_objects.resize(objectCount);
+	m_boundsMinX.assign(paddedCount, FLT_MAX);
+	m_boundsMinY.assign(paddedCount, FLT_MAX);
+	m_boundsMinZ.assign(paddedCount, FLT_MAX);
+	m_boundsMaxX.assign(paddedCount, -FLT_MAX);
+	m_boundsMaxY.assign(paddedCount, -FLT_MAX);
+	m_boundsMaxZ.assign(paddedCount, -FLT_MAX);
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		TRACE_OBJECT& object = m_objects[i];
+		object.shape = objects[i].shape;
+		object.model = objects[i].model;
+		object.inverseModel = glm::inverse(object.model);
+		object.normalMatrix = glm::transpose(glm::inverse(glm::mat3(object.model)));
+		object.albedo = objects[i].albedo;
+
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+		GetShapeBox(object.shape, boxMin, boxMax);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 local(
+				(corner & 1) ? boxMax.x : boxMin.x,
+				(corner & 2) ? boxMax.y : boxMin.y,
+				(corner & 4) ? boxMax.z : boxMin.z);
+			glm::vec3 world = glm::vec3(object.model * glm::vec4(local, 1.0f));
+			m_boundsMinX[i] = glm::min(m_boundsMinX[i], world.x);
+			m_boundsMinY[i] = glm::min(m_boundsMinY[i], world.y);
+			m_boundsMinZ[i] = glm::min(m_boundsMinZ[i], world.z);
+			m_boundsMaxX[i] = glm::max(m_boundsMaxX[i], world.x);
+			m_boundsMaxY[i] = glm::max(m_boundsMaxY[i], world.y);
+			m_boundsMaxZ[i] = glm::max(m_boundsMaxZ[i], world.z);
+		}
+	}
+}
+
+/***********************************************************
+ *  CalculateSurfaceArea()
+ *
+ *  This method is used for estimating the world space area
+ *  of an object by adding up small patches of its charts.
+ ***********************************************************/
+float LightmapBaker::CalculateSurfaceArea(const TRACE_OBJECT& object) const
+{
+	const int steps = 8;
+	const float cell = 1.0f / (float)steps;
+	const float delta = cell * 0.25f;
+	float area = 0.0f;
+
+	for (int chart = 0; chart < GetChartCount(object.shape); chart++)
+	{
+		for (int j = 0; j < steps; j++)
+		{
+			for (int i = 0; i < steps; i++)
+			{
+				float s = ((float)i + 0.5f) * cell;
+				float t = ((float)j + 0.5f) * cell;
+				glm::vec3 p0, p1, p2, normal;
+				glm::vec2 uv;
+				if ((EvaluateChart(object.shape, chart, s, t, p0, normal, uv) == false) ||
+					(EvaluateChart(object.shape, chart, s + delta, t, p1, normal, uv) == false) ||
+					(EvaluateChart(object.shape, chart, s, t + delta, p2, normal, uv) == false))
+				{
+					continue;
+				}
+
+				glm::vec3 w0 = glm::vec3(object.model * glm::vec4(p0, 1.0f));
+				glm::vec3 w1 = glm::vec3(object.model * glm::vec4(p1, 1.0f));
+				glm::vec3 w2 = glm::vec3(object.model * glm::vec4(p2, 1.0f));
+				area += glm::length(glm::cross(w1 - w0, w2 - w0)) * (cell * cell) / (delta * delta);
+			}
+		}
+	}
+
+	return(area);
+}
+
+/***********************************************************
+ *  PackTiles()
+ *
+ *  This method is used for placing the square object tiles
+ *  in shelves, largest first.
+ ***********************************************************/
+bool LightmapBaker::PackTiles(
+	const std::vector<float>& areas,
+	float texelsPerUnit,
+	std::vector<TILE>& tiles) const
+{
+	int objectCount = (int)areas.size();
+	std::vector<int> order(objectCount);
+
+	tiles.resize(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		int size = (int)std::ceil(std::sqrt(areas[i]) * texelsPerUnit);
+		tiles[i].size = glm::clamp(size, g_MinTileSize, m_atlasSize / 2);
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(),
+		[&tiles](int a, int b) { return(tiles[a].size > tiles[b].size); });
+
+	int x = 0;
+	int y = 0;
+	int shelfHeight = 0;
+	for (int i = 0; i < objectCount; i++)
+	{
+		TILE& tile = tiles[order[i]];
+		if (x + tile.size > m_atlasSize)
+		{
+			x = 0;
+			y += shelfHeight + g_TilePadding;
+			shelfHeight = 0;
+		}
+		if (y + tile.size > m_atlasSize)
+		{
+			return(false);
+		}
+
+		tile.x = x;
+		tile.y = y;
+		x += tile.size + g_TilePadding;
+		shelfHeight = glm::max(shelfHeight, tile.size);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  TraceRay()
+ *
+ *  This method is used for finding the closest surface along
+ *  a ray.  The object boxes are tested 4 at a time and only
+ *  the objects whose box is hit closer than the closest hit
+ *  so far are intersected exactly.
+ ***********************************************************/
+bool LightmapBaker::TraceRay(
+	glm::vec3 origin,
+	glm::vec3 direction,
+	float maxDistance,
+	RAY_HIT& hit) const
+{
+	float closest = maxDistance;
+	int objectCount = (int)m_objects.size();
+	glm::vec3 inverseDirection;
+
+	hit.objectIndex = -1;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// a huge value instead of infinity keeps 0 * x finite
+		float d = direction[axis];
+		inverseDirection[axis] = 1.0f / ((std::fabs(d) < 1.0e-20f) ? ((d < 0.0f) ? -1.0e-20f : 1.0e-20f) : d);
+	}
+
+	for (int group = 0; group < objectCount; group += 4)
+	{
+		int mask = 0;
+
+#if defined(LIGHTMAP_BAKER_SSE)
+		__m128 tMin = _mm_setzero_ps();
+		__m128 tMax = _mm_set1_ps(closest);
+		const float* pMin[3] = { &m_boundsMinX[group], &m_boundsMinY[group], &m_boundsMinZ[group] };
+		const float* pMax[3] = { &m_boundsMaxX[group], &m_boundsMaxY[group], &m_boundsMaxZ[group] };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			__m128 o = _mm_set1_ps(origin[axis]);
+			__m128 inv = _mm_set1_ps(inverseDirection[axis]);
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pMin[axis]), o), inv);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pMax[axis]), o), inv);
+			tMin = _mm_max_ps(tMin, _mm_min_ps(t0, t1));
+			tMax = _mm_min_ps(tMax, _mm_max_ps(t0, t1));
+		}
+		mask = _mm_movemask_ps(_mm_cmple_ps(tMin, tMax));
+#else
+		for (int lane = 0; lane < 4; lane++)
+		{
+			int i = group + lane;
+			float tMin = 0.0f;
+			float tMax = closest;
+			const float boxMin[3] = { m_boundsMinX[i], m_boundsMinY[i], m_boundsMinZ[i] };
+			const float boxMax[3] = { m_boundsMaxX[i], m_boundsMaxY[i], m_boundsMaxZ[i] };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float t0 = (boxMin[axis] - origin[axis]) * inverseDirection[axis];
+				float t1 = (boxMax[axis] - origin[axis]) * inverseDirection[axis];
+				tMin = glm::max(tMin, glm::min(t0, t1));
+				tMax = glm::min(tMax, glm::max(t0, t1));
+			}
+			if (tMin <= tMax)
+			{
+				mask |= 1 << lane;
+			}
+		}
+#endif
+
+		for (int lane = 0; (lane < 4) && (mask != 0); lane++)
+		{
+			if ((mask & (1 << lane)) == 0)
+			{
+				continue;
+			}
+			mask &= ~(1 << lane);
+
+			float distance = 0.0f;
+			glm::vec3 normal;
+			if (IntersectObject(m_objects[group + lane], origin, direction, closest, distance, normal))
+			{
+				closest = distance;
+				hit.distance = distance;
+				hit.objectIndex = group + lane;
+				hit.normal = normal;
+			}
+		}
+	}
+
+	return(hit.objectIndex >= 0);
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for testing whether a shadow ray is
+ *  blocked before it reaches the light.
+ ***********************************************************/
+bool LightmapBaker::IsOccluded(
+	glm::vec3 origin,
+	glm::vec3 direction,
+	float maxDistance) const
+{
+	RAY_HIT hit;
+
+	return(TraceRay(origin, direction, maxDistance, hit));
+}
+
+/***********************************************************
+ *  IntersectObject()
+ *
+ *  This method is used for intersecting a ray with one
+ *  object.  The ray is moved into object space without
+ *  normalizing its direction, so the hit distance is the
+ *  same in both spaces.  The torus is sphere traced, the
+ *  other shapes are solved directly.
+ ***********************************************************/
+bool LightmapBaker::IntersectObject(
+	const TRACE_OBJECT& object,
+	glm::vec3 origin,
+	glm::vec3 direction,
+	float maxDistance,
+	float& distance,
+	glm::vec3& normal) const
+{
+	glm::vec3 o = glm::vec3(object.inverseModel * glm::vec4(origin, 1.0f));
+	glm::vec3 d = glm::mat3(object.inverseModel) * direction;
+	glm::vec3 localNormal;
+	float best = maxDistance;
+	bool bHit = false;
+
+	switch (object.shape)
+	{
+	case SHAPE_PLANE:
+	{
+		if (std::fabs(d.y) < 1.0e-12f)
+		{
+			return(false);
+		}
+		float t = -o.y / d.y;
+		glm::vec3 p = o + d * t;
+		if ((t > g_HitEpsilon) && (t < best) && (std::fabs(p.x) <= 1.0f) && (std::fabs(p.z) <= 1.0f))
+		{
+			best = t;
+			localNormal = glm::vec3(0.0f, 1.0f, 0.0f);
+			bHit = true;
+		}
+		break;
+	}
+
+	case SHAPE_BOX:
+	{
+		float tEnter, tExit;
+		int enterAxis, exitAxis;
+		if (IntersectSlab(o, d, glm::vec3(-0.5f), glm::vec3(0.5f), tEnter, tExit, enterAxis, exitAxis) == false)
+		{
+			return(false);
+		}
+		// a ray starting inside leaves through the far side
+		float t = (tEnter > g_HitEpsilon) ? tEnter : tExit;
+		int axis = (tEnter > g_HitEpsilon) ? enterAxis : exitAxis;
+		if ((t > g_HitEpsilon) && (t < best))
+		{
+			best = t;
+			localNormal = glm::vec3(0.0f);
+			localNormal[axis] = ((o[axis] + d[axis] * t) > 0.0f) ? 1.0f : -1.0f;
+			bHit = true;
+		}
+		break;
+	}
+
+	case SHAPE_CYLINDER:
+	case SHAPE_TAPERED_CYLINDER:
+	{
+		float bottomRadius = 1.0f;
+		float topRadius = (object.shape == SHAPE_TAPERED_CYLINDER) ? g_TaperedTopRadius : 1.0f;
+		float k = topRadius - bottomRadius;
+
+		// x^2 + z^2 = (bottomRadius + k * y)^2 along the ray
+		float r = bottomRadius + k * o.y;
+		float a = d.x * d.x + d.z * d.z - k * k * d.y * d.y;
+		float b = 2.0f * (o.x * d.x + o.z * d.z - k * d.y * r);
+		float c = o.x * o.x + o.z * o.z - r * r;
+		float roots[2];
+		int rootCount = 0;
+		if (std::fabs(a) > 1.0e-12f)
+		{
+			float discriminant = b * b - 4.0f * a * c;
+			if (discriminant >= 0.0f)
+			{
+				float root = std::sqrt(discriminant);
+				roots[0] = (-b - root) / (2.0f * a);
+				roots[1] = (-b + root) / (2.0f * a);
+				if (roots[0] > roots[1])
+				{
+					std::swap(roots[0], roots[1]);
+				}
+				rootCount = 2;
+			}
+		}
+		else if (std::fabs(b) > 1.0e-12f)
+		{
+			roots[0] = -c / b;
+			rootCount = 1;
+		}
+		for (int i = 0; i < rootCount; i++)
+		{
+			float t = roots[i];
+			float y = o.y + d.y * t;
+			if ((t > g_HitEpsilon) && (t < best) && (y >= 0.0f) && (y <= 1.0f))
+			{
+				glm::vec3 p = o + d * t;
+				best = t;
+				localNormal = glm::vec3(p.x, -k * (bottomRadius + k * y), p.z);
+				bHit = true;
+				break;
+			}
+		}
+
+		// the caps
+		if (std::fabs(d.y) > 1.0e-12f)
+		{
+			for (int cap = 0; cap < 2; cap++)
+			{
+				float y = (float)cap;
+				float radius = (cap == 0) ? bottomRadius : topRadius;
+				float t = (y - o.y) / d.y;
+				glm::vec3 p = o + d * t;
+				if ((t > g_HitEpsilon) && (t < best) && (p.x * p.x + p.z * p.z <= radius * radius))
+				{
+					best = t;
+					localNormal = glm::vec3(0.0f, (cap == 0) ? -1.0f : 1.0f, 0.0f);
+					bHit = true;
+				}
+			}
+		}
+		break;
+	}
+
+	case SHAPE_TORUS:
+	{
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+		float tEnter, tExit;
+		int enterAxis, exitAxis;
+		GetShapeBox(SHAPE_TORUS, boxMin, boxMax);
+		if (IntersectSlab(o, d, boxMin, boxMax, tEnter, tExit, enterAxis, exitAxis) == false)
+		{
+			return(false);
+		}
+
+		float speed = glm::length(d);
+		float t = glm::max(tEnter, g_HitEpsilon);
+		float tEnd = glm::min(tExit, best);
+		for (int step = 0; (step < g_TorusMarchSteps) && (t < tEnd); step++)
+		{
+			glm::vec3 p = o + d * t;
+			float ring = std::sqrt(p.x * p.x + p.y * p.y);
+			float tube = std::sqrt((ring - 1.0f) * (ring - 1.0f) + p.z * p.z);
+			float surfaceDistance = tube - g_TorusThickness;
+
+			if (surfaceDistance < g_TorusSurfaceDistance)
+			{
+				// a ray leaving the tube it starts on is not a hit
+				glm::vec3 center = (ring > 0.0f) ? glm::vec3(p.x / ring, p.y / ring, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+				glm::vec3 n = p - center;
+				if (glm::dot(n, d) < 0.0f)
+				{
+					best = t;
+					localNormal = n;
+					bHit = true;
+					break;
+				}
+				surfaceDistance = g_TorusSurfaceDistance * 2.0f;
+			}
+			t += glm::max(surfaceDistance, g_TorusSurfaceDistance) / speed;
+		}
+		break;
+	}
+	}
+
+	if (bHit == false)
+	{
+		return(false);
+	}
+
+	distance = best;
+	normal = glm::normalize(object.normalMatrix * localNormal);
+	// shade the side the ray arrives on
+	if (glm::dot(normal, direction) > 0.0f)
+	{
+		normal = -normal;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CalculateDirectLight()
+ *
+ *  This method is used for adding up the ambient and diffuse
+ *  light of every enabled light at a surface point, with a
+ *  shadow ray towards each light.
+ ***********************************************************/
+glm::vec3 LightmapBaker::CalculateDirectLight(
+	glm::vec3 position,
+	glm::vec3 normal,
+	bool bIncludeAmbient) const
+{
+	glm::vec3 light(0.0f);
+	glm::vec3 origin = position + normal * g_RayOffset;
+
+	for (size_t i = 0; i < m_lights.size(); i++)
+	{
+		const LightManager::LIGHT& source = m_lights[i];
+		if (source.bEnabled == false)
+		{
+			continue;
+		}
+
+		if (source.type == LightManager::LIGHT_DIRECTIONAL)
+		{
+			glm::vec3 toLight = -glm::normalize(source.direction);
+			float diffuse = glm::dot(normal, toLight);
+			if (bIncludeAmbient)
+			{
+				light += source.ambient;
+			}
+			if ((diffuse > 0.0f) && (IsOccluded(origin, toLight, FLT_MAX) == false))
+			{
+				light += source.diffuse * diffuse;
+			}
+			continue;
+		}
+
+		glm::vec3 toLight = source.position - position;
+		float distance = glm::length(toLight);
+		if ((distance > source.range) || (distance <= 0.0f))
+		{
+			continue;
+		}
+		toLight /= distance;
+
+		float attenuation = LightManager::CalculateAttenuation(distance);
+		float intensity = 1.0f;
+		if (source.type == LightManager::LIGHT_SPOT)
+		{
+			float theta = glm::dot(toLight, -glm::normalize(source.direction));
+			float epsilon = source.innerCutoff - source.outerCutoff;
+			intensity = (epsilon > 0.0f) ?
+				glm::clamp((theta - source.outerCutoff) / epsilon, 0.0f, 1.0f) :
+				((theta >= source.outerCutoff) ? 1.0f : 0.0f);
+		}
+
+		if (bIncludeAmbient)
+		{
+			light += source.ambient * attenuation;
+		}
+		float diffuse = glm::dot(normal, toLight);
+		if ((diffuse > 0.0f) && (intensity > 0.0f) &&
+			(IsOccluded(origin, toLight, distance - g_RayOffset) == false))
+		{
+			light += source.diffuse * (diffuse * attenuation * intensity);
+		}
+	}
+
+	return(light);
+}
+
+/***********************************************************
+ *  BakeTileRow()
+ *
+ *  This method is used for tracing one row of texels of an
+ *  object tile.  Every sample picks a random point inside
+ *  the texel, adds the direct light there and follows one
+ *  cosine weighted path for the bounced light.  Texels
+ *  without a single sample on the surface stay uncovered.
+ ***********************************************************/
+void LightmapBaker::BakeTileRow(
+	const TILE& tile,
+	int objectIndex,
+	int row,
+	std::vector<glm::vec3>& irradiance,
+	std::vector<uint8_t>& coverage) const
+{
+	const TRACE_OBJECT& object = m_objects[objectIndex];
+	int chartCount = GetChartCount(object.shape);
+
+	for (int column = 0; column < tile.size; column++)
+	{
+		int texel = (tile.y + row) * m_atlasSize + tile.x + column;
+		RANDOM random((uint32_t)texel);
+		glm::vec3 sum(0.0f);
+		int validSamples = 0;
+
+		for (int sample = 0; sample < m_samplesPerTexel; sample++)
+		{
+			float u = ((float)column + random.Next()) / (float)tile.size;
+			float v = ((float)row + random.Next()) / (float)tile.size;
+
+			// find the chart under the sample
+			int chart = 0;
+			while ((chart < chartCount) &&
+				((u < GetChart(object.shape, chart).rect.x) || (u > GetChart(object.shape, chart).rect.z) ||
+				(v < GetChart(object.shape, chart).rect.y) || (v > GetChart(object.shape, chart).rect.w)))
+			{
+				chart++;
+			}
+			if (chart == chartCount)
+			{
+				continue;
+			}
+
+			const glm::vec4& rect = GetChart(object.shape, chart).rect;
+			glm::vec3 localPosition;
+			glm::vec3 localNormal;
+			glm::vec2 uv;
+			if (EvaluateChart(
+				object.shape,
+				chart,
+				(u - rect.x) / (rect.z - rect.x),
+				(v - rect.y) / (rect.w - rect.y),
+				localPosition,
+				localNormal,
+				uv) == false)
+			{
+				continue;
+			}
+
+			glm::vec3 position = glm::vec3(object.model * glm::vec4(localPosition, 1.0f));
+			glm::vec3 normal = glm::normalize(object.normalMatrix * localNormal);
+			glm::vec3 light = CalculateDirectLight(position, normal, true);
+
+			// with cosine weighted directions every bounce adds the
+			// albedo weighted direct light of the surface it hits
+			glm::vec3 throughput(1.0f);
+			glm::vec3 origin = position + normal * g_RayOffset;
+			glm::vec3 direction = SampleCosineHemisphere(normal, random);
+			for (int bounce = 0; bounce < m_bounceCount; bounce++)
+			{
+				RAY_HIT hit;
+				if (TraceRay(origin, direction, FLT_MAX, hit) == false)
+				{
+					break;
+				}
+
+				glm::vec3 hitPosition = origin + direction * hit.distance;
+				throughput = throughput * m_objects[hit.objectIndex].albedo;
+				light += throughput * CalculateDirectLight(hitPosition, hit.normal, false);
+
+				origin = hitPosition + hit.normal * g_RayOffset;
+				direction = SampleCosineHemisphere(hit.normal, random);
+			}
+
+			sum += light;
+			validSamples++;
+		}
+
+		// every texel is written by exactly one job
+		if (validSamples > 0)
+		{
+			irradiance[texel] = sum / (float)validSamples;
+			coverage[texel] = 1;
+		}
+	}
+}
+
+/***********************************************************
+ *  DilateTile()
+ *
+ *  This method is used for growing the baked texels of a
+ *  tile into the uncovered texels next to them, a few texels
+ *  at a time, so bilinear filtering along the chart edges
+ *  never blends in black.
+ ***********************************************************/
+void LightmapBaker::DilateTile(
+	const TILE& tile,
+	std::vector<glm::vec3>& irradiance,
+	std::vector<uint8_t>& coverage) const
+{
+	std::vector<int> filled;
+
+	for (int pass = 0; pass < g_DilationPasses; pass++)
+	{
+		filled.clear();
+		for (int y = tile.y; y < tile.y + tile.size; y++)
+		{
+			for (int x = tile.x; x < tile.x + tile.size; x++)
+			{
+				int texel = y * m_atlasSize + x;
+				if (coverage[texel] != 0)
+				{
+					continue;
+				}
+
+				glm::vec3 sum(0.0f);
+				int count = 0;
+				for (int dy = -1; dy <= 1; dy++)
+				{
+					for (int dx = -1; dx <= 1; dx++)
+					{
+						int nx = x + dx;
+						int ny = y + dy;
+						if ((nx < tile.x) || (nx >= tile.x + tile.size) ||
+							(ny < tile.y) || (ny >= tile.y + tile.size))
+						{
+							continue;
+						}
+						int neighbor = ny * m_atlasSize + nx;
+						if (coverage[neighbor] == 1)
+						{
+							sum += irradiance[neighbor];
+							count++;
+						}
+					}
+				}
+				if (count > 0)
+				{
+					irradiance[texel] = sum / (float)count;
+					filled.push_back(texel);
+				}
+			}
+		}
+
+		// the texels filled in this pass only count in the next
+		for (size_t i = 0; i < filled.size(); i++)
+		{
+			coverage[filled[i]] = 1;
+		}
+	}
+}
+
+/***********************************************************
+ *  PrepareLightmapFile()
+ *
+ *  This method is used for creating the directory of a
+ *  lightmap file and checking that the file can be written.
+ *  The file is opened for appending, so a lightmap from an
+ *  earlier bake is kept until the new one is saved.
+ ***********************************************************/
+bool LightmapBaker::PrepareLightmapFile(const char* filename)
+{
+	std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+	std::error_code error;
+	if (directory.empty() == false)
+	{
+		std::filesystem::create_directories(directory, error);
+	}
+	if (error)
+	{
+		std::cout << "Could not create lightmap directory:" << directory.string() << std::endl;
+		return(false);
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::app);
+	if (!file)
+	{
+		std::cout << "Could not write lightmap:" << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SaveLightmap()
+ *
+ *  This method is used for writing a lightmap file - a small
+ *  header, the shape and tile of every object, and the
+ *  half float texels.
+ ***********************************************************/
+bool LightmapBaker::SaveLightmap(const char* filename, const LIGHTMAP_DATA& lightmap)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not write lightmap:" << filename << std::endl;
+		return(false);
+	}
+
+	int32_t header[4] = {
+		g_FileVersion,
+		lightmap.width,
+		lightmap.height,
+		(int32_t)lightmap.objectShapes.size() };
+	file.write(g_FileMagic, sizeof(g_FileMagic));
+	file.write((const char*)header, sizeof(header));
+	for (size_t i = 0; i < lightmap.objectShapes.size(); i++)
+	{
+		int32_t shape = lightmap.objectShapes[i];
+		file.write((const char*)&shape, sizeof(shape));
+		file.write((const char*)&lightmap.objectRects[i], sizeof(glm::vec4));
+	}
+	file.write((const char*)lightmap.texels.data(), lightmap.texels.size() * sizeof(uint16_t));
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  LoadLightmap()
+ *
+ *  This method is used for reading a lightmap file written
+ *  by SaveLightmap().
+ ***********************************************************/
+bool LightmapBaker::LoadLightmap(const char* filename, LIGHTMAP_DATA& lightmap)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+	{
+		return(false);
+	}
+
+	char magic[4];
+	int32_t header[4];
+	file.read(magic, sizeof(magic));
+	file.read((char*)header, sizeof(header));
+	if (!file ||
+		(memcmp(magic, g_FileMagic, sizeof(magic)) != 0) ||
+		(header[0] != g_FileVersion) ||
+		(header[1] <= 0) || (header[1] > g_MaxFileSize) ||
+		(header[2] <= 0) || (header[2] > g_MaxFileSize) ||
+		(header[3] < 0))
+	{
+		std::cout << "Not a supported lightmap file:" << filename << std::endl;
+		return(false);
+	}
+
+	lightmap.width = header[1];
+	lightmap.height = header[2];
+	lightmap.objectShapes.resize(header[3]);
+	lightmap.objectRects.resize(header[3]);
+	for (int i = 0; i < header[3]; i++)
+	{
+		int32_t shape = 0;
+		file.read((char*)&shape, sizeof(shape));
+		file.read((char*)&lightmap.objectRects[i], sizeof(glm::vec4));
+		lightmap.objectShapes[i] = shape;
+	}
+	lightmap.texels.resize((size_t)lightmap.width * lightmap.height * 3);
+	file.read((char*)lightmap.texels.data(), lightmap.texels.size() * sizeof(uint16_t));
+	if (!file)
+	{
+		std::cout << "Lightmap file is truncated:" << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.h
+// ============
+// bake the lighting of the static scene objects into a lightmap atlas
+//
+//  Every basic shape is unwrapped into charts - flat patches with a closed
+//  form mapping from chart coordinates to the surface - so the baker and
+//  the unwrapped meshes agree exactly on where each lightmap texel lies.
+//  Each object gets its own tile of the atlas, sized by its surface area,
+//  and the irradiance of every texel is path traced on the CPU across the
+//  thread pool.  Nothing here makes OpenGL calls.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightManager.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  LightmapBaker
+ *
+ *  This class contains the shape charts, the ray tracing of
+ *  the scene objects and the code for baking, saving and
+ *  loading lightmaps.
+ ***********************************************************/
+class LightmapBaker
+{
+public:
+	// basic shapes that can be baked - same order as the
+	// SceneManager::SCENE_MESH values
+	enum BAKE_SHAPE
+	{
+		SHAPE_PLANE = 0,
+		SHAPE_BOX,
+		SHAPE_CYLINDER,
+		SHAPE_TAPERED_CYLINDER,
+		SHAPE_TORUS,
+		SHAPE_COUNT
+	};
+
+	// how a chart is tessellated by the unwrapped meshes
+	enum CHART_TYPE
+	{
+		CHART_GRID = 0,
+		CHART_DISC
+	};
+
+	// one flat patch of an unwrapped shape
+	struct CHART
+	{
+		CHART_TYPE type;
+		// area of the shape tile the chart covers - x/y minimum
+		// and maximum
+		glm::vec4 rect;
+		// grid cells, or rim segments of a disc
+		int segmentsS;
+		int segmentsT;
+	};
+
+	// one object as seen by the baker
+	struct BAKE_OBJECT
+	{
+		int shape;
+		glm::mat4 model;
+		// diffuse reflectance used for the light bounces
+		glm::vec3 albedo;
+	};
+
+	// baked atlas and the tile of every object
+	struct LIGHTMAP_DATA
+	{
+		int width;
+		int height;
+		// shape of each object, to tell whether the lightmap
+		// still matches the scene
+		std::vector<int> objectShapes;
+		// atlas offset and scale of each object tile - a zero
+		// scale means the object was not baked
+		std::vector<glm::vec4> objectRects;
+		// RGB half floats, bottom row first
+		std::vector<uint16_t> texels;
+	};
+
+	// constructor
+	LightmapBaker(ThreadPool* pThreadPool);
+	// destructor
+	~LightmapBaker();
+
+	// set the atlas size, the paths traced per texel and the
+	// light bounces followed along each path
+	void SetQuality(int atlasSize, int samplesPerTexel, int bounceCount);
+
+	// get the charts a shape is unwrapped into
+	static int GetChartCount(int shape);
+	static const CHART& GetChart(int shape, int chart);
+	// get the object space position, normal and texture
+	// coordinate at chart coordinates [0, 1] - returns false
+	// when the point is outside of the surface
+	static bool EvaluateChart(
+		int shape,
+		int chart,
+		float s,
+		float t,
+		glm::vec3& position,
+		glm::vec3& normal,
+		glm::vec2& uv);
+
+	// bake the lighting of the objects into a new atlas
+	bool Bake(
+		const std::vector<BAKE_OBJECT>& objects,
+		const std::vector<LightManager::LIGHT>& lights,
+		LIGHTMAP_DATA& lightmap);
+
+	// make sure the lightmap file can be written, creating its
+	// directory, before the slow bake starts
+	static bool PrepareLightmapFile(const char* filename);
+	// write and read the lightmap file
+	static bool SaveLightmap(const char* filename, const LIGHTMAP_DATA& lightmap);
+	static bool LoadLightmap(const char* filename, LIGHTMAP_DATA& lightmap);
+
+private:
+	// object prepared for ray tracing
+	struct TRACE_OBJECT
+	{
+		int shape;
+		glm::mat4 model;
+		glm::mat4 inverseModel;
+		glm::mat3 normalMatrix;
+		glm::vec3 albedo;
+	};
+
+	// closest surface a ray hits
+	struct RAY_HIT
+	{
+		float distance;
+		int objectIndex;
+		glm::vec3 normal;
+	};
+
+	// tile of one object in the atlas
+	struct TILE
+	{
+		int x;
+		int y;
+		int size;
+	};
+
+	// pool that the texels are traced on
+	ThreadPool* m_pThreadPool;
+	int m_atlasSize;
+	int m_samplesPerTexel;
+	int m_bounceCount;
+	// scene being baked
+	std::vector<TRACE_OBJECT> m_objects;
+	std::vector<LightManager::LIGHT> m_lights;
+	// world space bounding boxes of the objects, one array
+	// per value and padded for the SIMD tests
+	std::vector<float> m_boundsMinX;
+	std::vector<float> m_boundsMinY;
+	std::vector<float> m_boundsMinZ;
+	std::vector<float> m_boundsMaxX;
+	std::vector<float> m_boundsMaxY;
+	std::vector<float> m_boundsMaxZ;
+
+	// prepare the objects and their bounding boxes
+	void PrepareObjects(const std::vector<BAKE_OBJECT>& objects);
+	// estimate the world space surface area of an object
+	float CalculateSurfaceArea(const TRACE_OBJECT& object) const;
+	// place the object tiles in the atlas - returns false
+	// when they do not fit
+	bool PackTiles(
+		const std::vector<float>& areas,
+		float texelsPerUnit,
+		std::vector<TILE>& tiles) const;
+
+	// find the closest surface along a ray, up to maxDistance
+	bool TraceRay(
+		glm::vec3 origin,
+		glm::vec3 direction,
+		float maxDistance,
+		RAY_HIT& hit) const;
+	// test whether anything blocks a ray before maxDistance
+	bool IsOccluded(
+		glm::vec3 origin,
+		glm::vec3 direction,
+		float maxDistance) const;
+	// intersect a ray with one object in its object space
+	bool IntersectObject(
+		const TRACE_OBJECT& object,
+		glm::vec3 origin,
+		glm::vec3 direction,
+		float maxDistance,
+		float& distance,
+		glm::vec3& normal) const;
+
+	// light arriving straight from the lights at a surface
+	// point - the ambient terms are left out for points that
+	// only pass their light on to other surfaces
+	glm::vec3 CalculateDirectLight(
+		glm::vec3 position,
+		glm::vec3 normal,
+		bool bIncludeAmbient) const;
+	// trace the texels of one atlas row of a tile
+	void BakeTileRow(
+		const TILE& tile,
+		int objectIndex,
+		int row,
+		std::vector<glm::vec3>& irradiance,
+		std::vector<uint8_t>& coverage) const;
+	// fill the texels around the charts from their neighbors
+	// so filtering never reads unbaked texels
+	void DilateTile(
+		const TILE& tile,
+		std::vector<glm::vec3>& irradiance,
+		std::vector<uint8_t>& coverage) const;
+};
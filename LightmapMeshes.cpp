@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapmeshes.cpp
+// ============
+// generate and draw the basic shapes with lightmap texture coordinates
+//
+//  Vertex layout - position, normal, texture coordinate and lightmap
+//  coordinate at attribute locations 0 to 3.  The lightmap coordinate is
+//  in [0, 1] across the object tile; the shader scales it into the atlas
+//  with the tile of the drawn object.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightmapMeshes.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// number of floats per vertex - position, normal, texture
+	// coordinate, lightmap coordinate
+	const int g_FloatsPerVertex = 10;
+}
+
+/***********************************************************
+ *  LightmapMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightmapMeshes::LightmapMeshes()
+{
+	for (int shape = 0; shape < LightmapBaker::SHAPE_COUNT; shape++)
+	{
+		m_meshes[shape].vao = 0;
+		m_meshes[shape].vbos[0] = 0;
+		m_meshes[shape].vbos[1] = 0;
+		m_meshes[shape].nVertices = 0;
+		m_meshes[shape].nIndices = 0;
+	}
+}
+
+/***********************************************************
+ *  ~LightmapMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightmapMeshes::~LightmapMeshes()
+{
+	for (int shape = 0; shape < LightmapBaker::SHAPE_COUNT; shape++)
+	{
+		DestroyMesh(m_meshes[shape]);
+	}
+}
+
+/***********************************************************
+ *  LoadMeshes()
+ *
+ *  This method is used for generating the unwrapped mesh of
+ *  every basic shape from its charts.
+ ***********************************************************/
+void LightmapMeshes::LoadMeshes()
+{
+	for (int shape = 0; shape < LightmapBaker::SHAPE_COUNT; shape++)
+	{
+		std::vector<GLfloat> vertices;
+		std::vector<GLuint> indices;
+
+		for (int chart = 0; chart < LightmapBaker::GetChartCount(shape); chart++)
+		{
+			BuildChart(shape, chart, vertices, indices);
+		}
+		UploadMesh(m_meshes[shape], vertices, indices);
+	}
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the unwrapped mesh of the
+ *  passed in shape.
+ ***********************************************************/
+void LightmapMeshes::DrawMesh(int shape)
+{
+	if ((shape < 0) || (shape >= LightmapBaker::SHAPE_COUNT))
+	{
+		return;
+	}
+
+	GLMesh& mesh = m_meshes[shape];
+	if (mesh.vao == 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(mesh.vao);
+	glDrawElements(GL_TRIANGLES, mesh.nIndices, GL_UNSIGNED_INT, (void*)0);
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  BuildChart()
+ *
+ *  This method is used for tessellating one chart.  Grid
+ *  charts become rows of quads and disc charts a triangle
+ *  fan, and the winding is chosen from the chart normal so
+ *  every triangle faces out of the shape.
+ ***********************************************************/
+void LightmapMeshes::BuildChart(
+	int shape,
+	int chart,
+	std::vector<GLfloat>& vertices,
+	std::vector<GLuint>& indices)
+{
+	const LightmapBaker::CHART& info = LightmapBaker::GetChart(shape, chart);
+	GLuint first = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+	// compare the direction of increasing s and t with the
+	// normal in the middle of the chart
+	glm::vec3 p0, p1, p2, normal;
+	glm::vec2 uv;
+	LightmapBaker::EvaluateChart(shape, chart, 0.51f, 0.5f, p1, normal, uv);
+	LightmapBaker::EvaluateChart(shape, chart, 0.5f, 0.51f, p2, normal, uv);
+	LightmapBaker::EvaluateChart(shape, chart, 0.5f, 0.5f, p0, normal, uv);
+	bool bFlip = glm::dot(glm::cross(p1 - p0, p2 - p0), normal) < 0.0f;
+
+	if (info.type == LightmapBaker::CHART_DISC)
+	{
+		AddVertex(shape, chart, 0.5f, 0.5f, vertices);
+		for (int i = 0; i <= info.segmentsS; i++)
+		{
+			float angle = ((float)i / (float)info.segmentsS) * 2.0f * PI;
+			AddVertex(shape, chart, 0.5f + 0.5f * cosf(angle), 0.5f + 0.5f * sinf(angle), vertices);
+		}
+		for (int i = 0; i < info.segmentsS; i++)
+		{
+			GLuint a = first + 1 + i;
+			GLuint b = first + 2 + i;
+			GLuint fan[] = { first, bFlip ? b : a, bFlip ? a : b };
+			indices.insert(indices.end(), fan, fan + 3);
+		}
+		return;
+	}
+
+	for (int j = 0; j <= info.segmentsT; j++)
+	{
+		for (int i = 0; i <= info.segmentsS; i++)
+		{
+			AddVertex(
+				shape,
+				chart,
+				(float)i / (float)info.segmentsS,
+				(float)j / (float)info.segmentsT,
+				vertices);
+		}
+	}
+
+	GLuint rowSize = info.segmentsS + 1;
+	for (int j = 0; j < info.segmentsT; j++)
+	{
+		for (int i = 0; i < info.segmentsS; i++)
+		{
+			GLuint a = first + j * rowSize + i;
+			GLuint b = a + 1;
+			GLuint c = a + rowSize;
+			GLuint d = c + 1;
+			if (bFlip)
+			{
+				GLuint quad[] = { a, d, b, a, c, d };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+			else
+			{
+				GLuint quad[] = { a, b, d, a, d, c };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  AddVertex()
+ *
+ *  This method is used for adding the vertex at the passed
+ *  in chart coordinates, with its place in the object tile
+ *  as the lightmap coordinate.
+ ***********************************************************/
+void LightmapMeshes::AddVertex(
+	int shape,
+	int chart,
+	float s,
+	float t,
+	std::vector<GLfloat>& vertices)
+{
+	const glm::vec4& rect = LightmapBaker::GetChart(shape, chart).rect;
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 uv;
+
+	LightmapBaker::EvaluateChart(shape, chart, s, t, position, normal, uv);
+
+	GLfloat vertex[] = {
+		position.x, position.y, position.z,
+		normal.x, normal.y, normal.z,
+		uv.x, uv.y,
+		rect.x + (rect.z - rect.x) * s,
+		rect.y + (rect.w - rect.y) * t };
+	vertices.insert(vertices.end(), vertex, vertex + g_FloatsPerVertex);
+}
+
+/***********************************************************
+ *  UploadMesh()
+ *
+ *  This method is used for creating the vertex array object
+ *  and buffers for the generated mesh data.
+ ***********************************************************/
+void LightmapMeshes::UploadMesh(
+	GLMesh& mesh,
+	const std::vector<GLfloat>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	const GLuint floatsPerVertex = 3;
+	const GLuint floatsPerNormal = 3;
+	const GLuint floatsPerUV = 2;
+	GLint stride = sizeof(GLfloat) * g_FloatsPerVertex;
+
+	DestroyMesh(mesh);
+
+	mesh.nVertices = (GLuint)(vertices.size() / g_FloatsPerVertex);
+	mesh.nIndices = (GLuint)indices.size();
+
+	glGenVertexArrays(1, &mesh.vao);
+	glBindVertexArray(mesh.vao);
+
+	// create the vertex and index buffers
+	glGenBuffers(2, mesh.vbos);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vbos[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.vbos[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	// create the vertex attribute pointers
+	glVertexAttribPointer(0, floatsPerVertex, GL_FLOAT, GL_FALSE, stride, 0);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, floatsPerNormal, GL_FLOAT, GL_FALSE, stride, (char*)(sizeof(float) * floatsPerVertex));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(3, floatsPerUV, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(float) * (floatsPerVertex + floatsPerNormal + floatsPerUV)));
+	glEnableVertexAttribArray(3);
+
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DestroyMesh()
+ *
+ *  This method is used for freeing the OpenGL buffers that
+ *  were created for a mesh.
+ ***********************************************************/
+void LightmapMeshes::DestroyMesh(GLMesh& mesh)
+{
+	if (mesh.vao != 0)
+	{
+		glDeleteVertexArrays(1, &mesh.vao);
+		glDeleteBuffers(2, mesh.vbos);
+	}
+	mesh.vao = 0;
+	mesh.vbos[0] = 0;
+	mesh.vbos[1] = 0;
+	mesh.nVertices = 0;
+	mesh.nIndices = 0;
+}
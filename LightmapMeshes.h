@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapmeshes.h
+// ============
+// generate and draw the basic shapes with lightmap texture coordinates
+//
+//  The meshes are tessellated from the LightmapBaker charts, so every
+//  vertex carries the same position, normal and texture coordinate as the
+//  ShapeMeshes shapes plus the place of that point in the object's
+//  lightmap tile.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightmapBaker.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  LightmapMeshes
+ *
+ *  This class contains the code for generating the unwrapped
+ *  basic shapes and drawing them.
+ ***********************************************************/
+class LightmapMeshes
+{
+public:
+	// constructor
+	LightmapMeshes();
+	// destructor
+	~LightmapMeshes();
+
+	// generate the unwrapped mesh of every shape
+	void LoadMeshes();
+
+	// draw the unwrapped mesh of a shape
+	void DrawMesh(int shape);
+
+private:
+	struct GLMesh
+	{
+		GLuint vao;
+		GLuint vbos[2];
+		GLuint nVertices;
+		GLuint nIndices;
+	};
+
+	GLMesh m_meshes[LightmapBaker::SHAPE_COUNT];
+
+	// append the vertices and triangles of one chart
+	void BuildChart(
+		int shape,
+		int chart,
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices);
+	// append one vertex at chart coordinates
+	void AddVertex(
+		int shape,
+		int chart,
+		float s,
+		float t,
+		std::vector<GLfloat>& vertices);
+	// upload the vertex and index data into a new VAO
+	void UploadMesh(
+		GLMesh& mesh,
+		const std::vector<GLfloat>& vertices,
+		const std::vector<GLuint>& indices);
+	// free the OpenGL buffers of a mesh
+	void DestroyMesh(GLMesh& mesh);
+};
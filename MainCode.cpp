@@ -9,6 +9,8 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <algorithm>        // std::min
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -23,6 +25,14 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "BatchTransforms.h"
+#include "DynamicResolution.h"
+#include "FramePacer.h"
+#include "FramePipeline.h"
+#include "ProgramCache.h"
+#include "ShaderHotReload.h"
+#include "ShaderPermutations.h"
+#include "ShaderReflection.h"
 
 // Namespace for declaring global variables
 namespace
@@ -30,6 +40,130 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// length in seconds of one simulation step, and the most
+	// steps a slow frame may catch up before the time is
+	// dropped - the deterministic option runs exactly one step
+	// per frame, so replays give the same frames every run
+	const double SIMULATION_STEP = 1.0 / 120.0;
+	const int MAX_SIMULATION_STEPS = 8;
+	const char* const DETERMINISTIC_OPTION = "--deterministic";
+
+	// write the window input to the file named after the
+	// option, or replay it from there and quit when it ends -
+	// both run the deterministic steps, so a replay moves the
+	// camera exactly as the recording did
+	const char* const RECORD_INPUT_OPTION = "--record-input";
+	const char* const REPLAY_INPUT_OPTION = "--replay-input";
+
+	// write the pose of the shown camera to the file named
+	// after the option, or move the camera along a recorded
+	// path and quit when it ends - the path keeps its recorded
+	// timing at any frame rate, and gives the same frames
+	// every run with the deterministic option
+	const char* const RECORD_CAMERA_OPTION = "--record-camera";
+	const char* const REPLAY_CAMERA_OPTION = "--replay-camera";
+
+	// how the swap waits for the display, the highest frame
+	// rate, and the work time per frame in milliseconds past
+	// which the object detail is lowered - 0 uses the period
+	// of the frame rate
+	const FramePacer::SWAP_MODE SWAP_MODE = FramePacer::SWAP_ADAPTIVE;
+	const float TARGET_FRAME_RATE = 60.0f;
+	const float FRAME_TIME_BUDGET_MS = 0.0f;
+
+	// render the scene offscreen at the part of the window size
+	// that keeps the GPU time of a frame in budget, no smaller
+	// than the lowest scale, and stretch it over the window
+	const bool USE_DYNAMIC_RESOLUTION = true;
+	const float DYNAMIC_RESOLUTION_MIN_SCALE = 0.5f;
+	const float DYNAMIC_RESOLUTION_BUDGET_MS = 14.0f;
+
+	// half height in world units and depth range of the
+	// camera's orthographic view, and whether the window starts
+	// with the fixed top, side and front views of the whole
+	// scene beside the camera view - the L key switches them
+	const float ORTHOGRAPHIC_HALF_HEIGHT = 6.0f;
+	const float ORTHOGRAPHIC_NEAR_PLANE = 0.1f;
+	const float ORTHOGRAPHIC_FAR_PLANE = 100.0f;
+	const ViewManager::VIEW_LAYOUT VIEW_LAYOUT = ViewManager::LAYOUT_SINGLE;
+
+	// seconds the window size has to stay the same before the
+	// render targets are created again at it, so dragging the
+	// window edge does not reallocate them every frame
+	const double RESIZE_DEBOUNCE_SECONDS = 0.25;
+
+	// number of frames the scene update may run ahead of the
+	// OpenGL submission - 0 runs everything in sequence, higher
+	// values trade input latency for CPU/GPU overlap
+	const int FRAME_PIPELINE_DEPTH = 1;
+
+	// size in texels and number of cascades of the directional
+	// light shadow maps - lower them to save frame time
+	const int SHADOW_MAP_RESOLUTION = 2048;
+	const int SHADOW_CASCADE_COUNT = 3;
+
+	// point light shadow atlas size, size of one cube face and
+	// the most light shadows rendered again in one frame
+	const int POINT_SHADOW_ATLAS_SIZE = 4096;
+	const int POINT_SHADOW_TILE_SIZE = 512;
+	const int POINT_SHADOW_UPDATES_PER_FRAME = 2;
+
+	// baked lighting of the static objects - run with the bake
+	// option to write the lightmap file, which is used by every
+	// later run
+	const char* const LIGHTMAP_FILE = "lightmaps/scene.lmap";
+	const char* const BAKE_LIGHTMAPS_OPTION = "--bake-lightmaps";
+	const int LIGHTMAP_ATLAS_SIZE = 1024;
+	const int LIGHTMAP_SAMPLES_PER_TEXEL = 128;
+	const int LIGHTMAP_BOUNCE_COUNT = 2;
+
+	// starting tier of the ambient occlusion, the GPU time in
+	// milliseconds it may take before the tier is lowered, and
+	// the key that steps through the tiers while running
+	const AmbientOcclusion::AO_QUALITY AMBIENT_OCCLUSION_QUALITY = AmbientOcclusion::AO_MEDIUM;
+	const float AMBIENT_OCCLUSION_BUDGET_MS = 3.0f;
+	const int AMBIENT_OCCLUSION_KEY = GLFW_KEY_F1;
+
+	// fill the depth buffer before the lighting so each pixel
+	// is shaded once, the key that turns the prepass on and off
+	// and the key that shows the fragments shaded per pixel
+	const bool USE_DEPTH_PREPASS = true;
+	const int DEPTH_PREPASS_KEY = GLFW_KEY_F2;
+	const int OVERDRAW_VIEW_KEY = GLFW_KEY_F3;
+
+	// lighting pipeline - the option selects deferred shading
+	// for the run, and the benchmark option times both paths
+	// over the listed point light counts and quits
+	const SceneManager::RENDER_PIPELINE RENDER_PIPELINE = SceneManager::PIPELINE_FORWARD;
+	const char* const DEFERRED_OPTION = "--deferred";
+	const char* const BENCHMARK_PIPELINES_OPTION = "--benchmark-pipelines";
+
+	// add a see-through box to the scene, to check the
+	// transparent pass
+	const char* const GLASS_TEST_OPTION = "--glass-test";
+	const int BENCHMARK_LIGHT_COUNTS[] = { 4, 16, 64, 256 };
+	const int BENCHMARK_FRAME_COUNT = 200;
+
+	// scene shader files, the directory their linked binaries
+	// are cached in, and whether edits to the files are built
+	// and swapped in while running
+	const char* const VERTEX_SHADER_FILE = "shaders/vertexShader.glsl";
+	const char* const FRAGMENT_SHADER_FILE = "shaders/fragmentShader.glsl";
+	const char* const PROGRAM_CACHE_DIRECTORY = "shader_cache";
+	const bool USE_SHADER_HOT_RELOAD = true;
+
+	// build the scene program and all its variants in a hidden
+	// window, leaving their binaries in the cache, write the
+	// interface of the program as a header and quit - the
+	// exit code is the result, so a build can run it
+	const char* const VALIDATE_SHADERS_OPTION = "--validate-shaders";
+	const char* const SHADER_REFLECTION_FILE = "shaders/SceneShaderReflection.h";
+
+	// compare the batch transform kernels with the matrix
+	// products they replace and quit, without a window - the
+	// exit code is the result
+	const char* const VALIDATE_TRANSFORMS_OPTION = "--validate-transforms";
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -39,12 +173,23 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// frame pipeline object for overlapping scene update and rendering
+	FramePipeline* g_FramePipeline = nullptr;
+	// frame pacer object for presenting frames at an even rate
+	FramePacer* g_FramePacer = nullptr;
+	// dynamic resolution object for scaling the rendered size
+	DynamicResolution* g_DynamicResolution = nullptr;
+	// program cache object for reusing linked shader binaries
+	ProgramCache* g_ProgramCache = nullptr;
+	// hot reload object for rebuilding edited shaders
+	ShaderHotReload* g_ShaderHotReload = nullptr;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+bool ValidateShaders(GLuint programID);
 
 
 /***********************************************************
@@ -55,17 +200,43 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], VALIDATE_TRANSFORMS_OPTION) == 0)
+		{
+			std::cout << "Batch transforms use the " << GetTransformKernelName() << " kernel" << std::endl;
+			return(ValidateTransformKernels() ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
+	// validation never shows the window
+	bool bValidateShaders = false;
+	for (int i = 1; i < argc; i++)
+	{
+		bValidateShaders = bValidateShaders || (strcmp(argv[i], VALIDATE_SHADERS_OPTION) == 0);
+	}
+	if (bValidateShaders)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
+	g_ViewManager->SetSimulationStep((float)SIMULATION_STEP);
+	g_ViewManager->SetOrthographicExtent(
+		ORTHOGRAPHIC_HALF_HEIGHT,
+		ORTHOGRAPHIC_NEAR_PLANE,
+		ORTHOGRAPHIC_FAR_PLANE);
+	g_ViewManager->SetViewLayout(VIEW_LAYOUT);
 
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
@@ -76,20 +247,338 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
+	// load the shader code from the external GLSL files, or the
+	// binary linked from the same files on an earlier run
+	g_ProgramCache = new ProgramCache(PROGRAM_CACHE_DIRECTORY);
+	g_ShaderManager->m_programID = g_ProgramCache->LoadProgram(
+		VERTEX_SHADER_FILE,
+		FRAGMENT_SHADER_FILE);
+	if (g_ShaderManager->m_programID == 0)
+	{
+		return(EXIT_FAILURE);
+	}
+	if (bValidateShaders)
+	{
+		bool bValid = ValidateShaders(g_ShaderManager->m_programID);
+		delete g_ViewManager;
+		delete g_ShaderManager;
+		delete g_ProgramCache;
+		return(bValid ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
 	g_ShaderManager->use();
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->SetShaderFiles(g_ProgramCache, VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE);
+	g_SceneManager->SetShadowQuality(SHADOW_MAP_RESOLUTION, SHADOW_CASCADE_COUNT);
+	g_SceneManager->SetPointShadowQuality(
+		POINT_SHADOW_ATLAS_SIZE,
+		POINT_SHADOW_TILE_SIZE,
+		POINT_SHADOW_UPDATES_PER_FRAME);
+	g_SceneManager->SetAmbientOcclusionQuality(AMBIENT_OCCLUSION_QUALITY);
+	g_SceneManager->SetAmbientOcclusionBudget(AMBIENT_OCCLUSION_BUDGET_MS);
+	g_SceneManager->SetDepthPrepass(USE_DEPTH_PREPASS);
+
+	bool bBakeLightmaps = false;
+	bool bDeferred = (RENDER_PIPELINE == SceneManager::PIPELINE_DEFERRED);
+	bool bBenchmarkPipelines = false;
+	bool bGlassTest = false;
+	bool bDeterministic = false;
+	const char* recordInputFile = NULL;
+	const char* replayInputFile = NULL;
+	const char* recordCameraFile = NULL;
+	const char* replayCameraFile = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], RECORD_CAMERA_OPTION) == 0) && (i + 1 < argc))
+		{
+			recordCameraFile = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i], REPLAY_CAMERA_OPTION) == 0) && (i + 1 < argc))
+		{
+			replayCameraFile = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i], RECORD_INPUT_OPTION) == 0) && (i + 1 < argc))
+		{
+			recordInputFile = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i], REPLAY_INPUT_OPTION) == 0) && (i + 1 < argc))
+		{
+			replayInputFile = argv[++i];
+			continue;
+		}
+		bDeterministic = bDeterministic || (strcmp(argv[i], DETERMINISTIC_OPTION) == 0);
+		bBakeLightmaps = bBakeLightmaps || (strcmp(argv[i], BAKE_LIGHTMAPS_OPTION) == 0);
+		bDeferred = bDeferred || (strcmp(argv[i], DEFERRED_OPTION) == 0);
+		bBenchmarkPipelines = bBenchmarkPipelines || (strcmp(argv[i], BENCHMARK_PIPELINES_OPTION) == 0);
+		bGlassTest = bGlassTest || (strcmp(argv[i], GLASS_TEST_OPTION) == 0);
+	}
+	g_SceneManager->SetGlassTestObject(bGlassTest);
+	g_SceneManager->SetRenderPipeline(bDeferred ? SceneManager::PIPELINE_DEFERRED : SceneManager::PIPELINE_FORWARD);
 	g_SceneManager->PrepareScene();
 
+	// the fixed views of the layout frame the whole scene
+	glm::vec3 sceneCenter;
+	float sceneRadius = 0.0f;
+	g_SceneManager->GetSceneBounds(sceneCenter, sceneRadius);
+	g_ViewManager->SetLayoutBounds(sceneCenter, sceneRadius);
+
+	// bake the lightmap and quit when asked to, otherwise use
+	// the lightmap from an earlier bake if there is one
+	if (bBakeLightmaps)
+	{
+		bool bBaked = g_SceneManager->BakeLightmaps(
+			LIGHTMAP_FILE,
+			LIGHTMAP_ATLAS_SIZE,
+			LIGHTMAP_SAMPLES_PER_TEXEL,
+			LIGHTMAP_BOUNCE_COUNT);
+		delete g_SceneManager;
+		delete g_ViewManager;
+		delete g_ShaderManager;
+		delete g_ProgramCache;
+		return(bBaked ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	g_SceneManager->LoadLightmaps(LIGHTMAP_FILE);
+
+	// time both pipelines from the starting camera and quit
+	if (bBenchmarkPipelines)
+	{
+		ViewManager::INPUT_STATE input = {};
+		ViewManager::VIEW_STATE view;
+		g_ViewManager->UpdateView(input, view);
+		g_SceneManager->SetViewParameters(view.view, view.projection, view.viewportHeight);
+		g_ViewManager->ApplyView(view);
+
+		std::vector<int> lightCounts(
+			BENCHMARK_LIGHT_COUNTS,
+			BENCHMARK_LIGHT_COUNTS + sizeof(BENCHMARK_LIGHT_COUNTS) / sizeof(BENCHMARK_LIGHT_COUNTS[0]));
+		g_SceneManager->BenchmarkPipelines(lightCounts, BENCHMARK_FRAME_COUNT);
+		delete g_SceneManager;
+		delete g_ViewManager;
+		delete g_ShaderManager;
+		delete g_ProgramCache;
+		return(EXIT_SUCCESS);
+	}
+
+	// record or replay the input from the first frame on
+	bool bReplayInput = false;
+	if (NULL != replayInputFile)
+	{
+		bReplayInput = g_ViewManager->GetInputQueue()->StartReplay(replayInputFile);
+		if (bReplayInput == false)
+		{
+			delete g_SceneManager;
+			delete g_ViewManager;
+			delete g_ShaderManager;
+			delete g_ProgramCache;
+			return(EXIT_FAILURE);
+		}
+		bDeterministic = true;
+	}
+	else if (NULL != recordInputFile)
+	{
+		g_ViewManager->GetInputQueue()->StartRecording(recordInputFile);
+		bDeterministic = true;
+	}
+
+	// record or replay the camera path from the first frame on
+	bool bReplayCamera = false;
+	if (NULL != replayCameraFile)
+	{
+		bReplayCamera = g_ViewManager->GetCameraPath()->StartReplay(replayCameraFile);
+		if (bReplayCamera == false)
+		{
+			delete g_SceneManager;
+			delete g_ViewManager;
+			delete g_ShaderManager;
+			delete g_ProgramCache;
+			return(EXIT_FAILURE);
+		}
+		bDeterministic = true;
+	}
+	else if (NULL != recordCameraFile)
+	{
+		g_ViewManager->GetCameraPath()->StartRecording(recordCameraFile);
+	}
+
+	// a deterministic run renders the same images every time,
+	// so the ambient occlusion tier does not follow the
+	// measured GPU time
+	if (bDeterministic)
+	{
+		g_SceneManager->SetAmbientOcclusionBudget(0.0f);
+	}
+	double replayStartTime = glfwGetTime();
+	int renderedFrames = 0;
+
+	// try to create the frame pipeline that updates and renders the scene
+	g_FramePipeline = new FramePipeline(
+		g_ViewManager,
+		g_SceneManager,
+		FRAME_PIPELINE_DEPTH);
+
+	// rebuild the scene program in the background when one of
+	// its files is saved
+	if (USE_SHADER_HOT_RELOAD)
+	{
+		g_ShaderHotReload = new ShaderHotReload(g_ProgramCache);
+		g_ShaderHotReload->Start(g_Window, VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE);
+	}
+	// variants rebuilt with the program, on their way to the
+	// scene
+	ShaderPermutations reloadedPermutations;
+
+	// present at an even rate and keep the frame work in budget -
+	// a replay presents every frame right away, so the time it
+	// reports is the time the frames took to render
+	g_FramePacer = new FramePacer();
+	if (bReplayInput || bReplayCamera)
+	{
+		g_FramePacer->SetSwapMode(FramePacer::SWAP_OFF);
+		g_FramePacer->SetTargetFrameRate(0.0f);
+	}
+	else
+	{
+		g_FramePacer->SetSwapMode(SWAP_MODE);
+		g_FramePacer->SetTargetFrameRate(TARGET_FRAME_RATE);
+	}
+	g_FramePacer->SetBudget(FRAME_TIME_BUDGET_MS);
+
+	// the render targets were created at the starting window
+	// size and follow it once it stops changing
+	int targetWidth = 0;
+	int targetHeight = 0;
+	g_ViewManager->GetFramebufferSize(targetWidth, targetHeight);
+	int resizeWidth = targetWidth;
+	int resizeHeight = targetHeight;
+	double resizeTime = 0.0;
+
+	// render into a target sized for the window, drawing only
+	// the part the GPU time allows - a deterministic run keeps
+	// the full size
+	if (USE_DYNAMIC_RESOLUTION)
+	{
+		g_DynamicResolution = new DynamicResolution();
+		if (g_DynamicResolution->Create(targetWidth, targetHeight))
+		{
+			g_DynamicResolution->SetScaleRange(bDeterministic ? 1.0f : DYNAMIC_RESOLUTION_MIN_SCALE, 1.0f);
+			g_DynamicResolution->SetBudget(DYNAMIC_RESOLUTION_BUDGET_MS);
+		}
+		else
+		{
+			delete g_DynamicResolution;
+			g_DynamicResolution = NULL;
+		}
+	}
+
+	double previousTime = glfwGetTime();
+	double accumulatedTime = 0.0;
+
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
+		// act on the render keys pressed for the frame submitted
+		// last - they come through the input queue, so they are
+		// recorded and replayed with the camera input
+		const ViewManager::VIEW_STATE& submittedView = g_FramePipeline->GetSubmittedView();
+		for (int i = 0; i < submittedView.keyPressCount; i++)
+		{
+			// step to the next ambient occlusion tier on each press
+			if (submittedView.keyPresses[i] == AMBIENT_OCCLUSION_KEY)
+			{
+				int quality = (g_SceneManager->GetAmbientOcclusionQuality() + 1) % AmbientOcclusion::AO_QUALITY_COUNT;
+				g_SceneManager->SetAmbientOcclusionQuality((AmbientOcclusion::AO_QUALITY)quality);
+			}
+			if (submittedView.keyPresses[i] == DEPTH_PREPASS_KEY)
+			{
+				g_SceneManager->SetDepthPrepass(!g_SceneManager->IsDepthPrepassEnabled());
+			}
+			if (submittedView.keyPresses[i] == OVERDRAW_VIEW_KEY)
+			{
+				g_SceneManager->SetOverdrawView(!g_SceneManager->IsOverdrawViewEnabled());
+			}
+		}
+
+		// swap in a rebuilt scene program between frames
+		GLuint reloadedProgramID = (NULL != g_ShaderHotReload) ?
+			g_ShaderHotReload->TakeReloadedProgram(reloadedPermutations) : 0;
+		if (reloadedProgramID != 0)
+		{
+			glDeleteProgram(g_ShaderManager->m_programID);
+			g_ShaderManager->m_programID = reloadedProgramID;
+			g_SceneManager->OnProgramReloaded(reloadedPermutations);
+		}
+
+		// run the simulation in whole steps for the time the last
+		// frame took, keeping the rest for the next frame, and
+		// show the view that far between the last two steps
+		int stepCount = 1;
+		float stepBlend = 1.0f;
+		if (bDeterministic == false)
+		{
+			double currentTime = glfwGetTime();
+			accumulatedTime += std::min(currentTime - previousTime, SIMULATION_STEP * MAX_SIMULATION_STEPS);
+			previousTime = currentTime;
+			stepCount = (int)(accumulatedTime / SIMULATION_STEP);
+			accumulatedTime -= stepCount * SIMULATION_STEP;
+			stepBlend = (float)(accumulatedTime / SIMULATION_STEP);
+		}
+
+		// the viewport follows the window right away, while the
+		// render targets are only created again once the size
+		// has settled - until then the scene is drawn no larger
+		// than the targets
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		g_ViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+		if ((framebufferWidth != resizeWidth) || (framebufferHeight != resizeHeight))
+		{
+			resizeWidth = framebufferWidth;
+			resizeHeight = framebufferHeight;
+			resizeTime = glfwGetTime();
+		}
+		else if (((resizeWidth != targetWidth) || (resizeHeight != targetHeight)) &&
+			(glfwGetTime() - resizeTime >= RESIZE_DEBOUNCE_SECONDS))
+		{
+			g_SceneManager->ResizeTargets(resizeWidth, resizeHeight);
+			if ((NULL != g_DynamicResolution) &&
+				(g_DynamicResolution->Create(resizeWidth, resizeHeight) == false))
+			{
+				delete g_DynamicResolution;
+				g_DynamicResolution = NULL;
+			}
+			targetWidth = resizeWidth;
+			targetHeight = resizeHeight;
+		}
+
+		// bind the scene target at the scale of this frame - a
+		// window larger than the targets is drawn into at its
+		// own shape, scaled down to fit them, since the camera
+		// projection follows the window
+		float fitScale = std::min(1.0f, std::min(
+			(float)targetWidth / (float)framebufferWidth,
+			(float)targetHeight / (float)framebufferHeight));
+		int renderWidth = std::min((int)(framebufferWidth * fitScale), targetWidth);
+		int renderHeight = std::min((int)(framebufferHeight * fitScale), targetHeight);
+		if (NULL != g_DynamicResolution)
+		{
+			g_DynamicResolution->SetOutputSize(framebufferWidth, framebufferHeight);
+			g_DynamicResolution->BeginFrame();
+			renderWidth = g_DynamicResolution->GetRenderWidth();
+			renderHeight = g_DynamicResolution->GetRenderHeight();
+		}
+		else
+		{
+			glViewport(0, 0, renderWidth, renderHeight);
+		}
+		g_SceneManager->SetRenderScale(
+			(float)renderWidth / (float)framebufferWidth,
+			(float)renderHeight / (float)framebufferHeight);
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -97,21 +586,71 @@ int main(int argc, char* argv[])
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		// convert from 3D object space to 2D view and refresh
+		// the 3D scene, while the next frame is being updated
+		g_FramePipeline->RenderFrame(stepCount, stepBlend);
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		// stretch the rendered part over the window
+		if (NULL != g_DynamicResolution)
+		{
+			g_DynamicResolution->EndFrame();
+		}
 
+		// Flips the the back buffer with the front buffer every frame,
+		// then applies the detail the frame time allows - a
+		// deterministic run keeps the full detail
+		g_FramePacer->PresentFrame(g_Window);
+		if (bDeterministic == false)
+		{
+			g_SceneManager->SetDetailScale(g_FramePacer->GetDetailScale());
+		}
+		renderedFrames++;
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		// report the time the replay took and quit once all of
+		// its input frames were queued, or once the frame just
+		// submitted reached the end of the camera path
+		if (bReplayInput && !g_ViewManager->GetInputQueue()->IsReplaying())
+		{
+			double replayTime = glfwGetTime() - replayStartTime;
+			std::cout << "Input replay of " << renderedFrames << " frames took " << replayTime << " s, "
+				<< replayTime * 1000.0 / renderedFrames << " ms per frame" << std::endl;
+			glfwSetWindowShouldClose(g_Window, true);
+			bReplayInput = false;
+		}
+		if (bReplayCamera && !submittedView.bReplayingPath)
+		{
+			double replayTime = glfwGetTime() - replayStartTime;
+			std::cout << "Camera path replay of " << renderedFrames << " frames took " << replayTime << " s, "
+				<< replayTime * 1000.0 / renderedFrames << " ms per frame" << std::endl;
+			glfwSetWindowShouldClose(g_Window, true);
+			bReplayCamera = false;
+		}
 
 		// query the latest GLFW events
 		glfwPollEvents();
 	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_DynamicResolution)
+	{
+		delete g_DynamicResolution;
+		g_DynamicResolution = NULL;
+	}
+	if (NULL != g_FramePacer)
+	{
+		delete g_FramePacer;
+		g_FramePacer = NULL;
+	}
+	if (NULL != g_ShaderHotReload)
+	{
+		delete g_ShaderHotReload;
+		g_ShaderHotReload = NULL;
+	}
+	if (NULL != g_FramePipeline)
+	{
+		delete g_FramePipeline;
+		g_FramePipeline = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -127,6 +666,11 @@ int main(int argc, char* argv[])
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_ProgramCache)
+	{
+		delete g_ProgramCache;
+		g_ProgramCache = NULL;
+	}
 
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
@@ -184,4 +728,30 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *	ValidateShaders()
+ *
+ *  This function is used to build every variant of the
+ *  scene program, which reports the compile errors of each
+ *  one and caches their binaries, and to write the
+ *  interface of the scene program.
+ ***********************************************************/
+bool ValidateShaders(GLuint programID)
+{
+	ShaderPermutations permutations;
+	int failedCount = 0;
+	int builtCount = 1;
+
+	if (permutations.Create(g_ProgramCache, VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE))
+	{
+		failedCount = permutations.BuildAll();
+		builtCount += ShaderPermutations::PERMUTATION_COUNT - failedCount;
+	}
+	bool bWritten = ShaderReflection::WriteHeader(programID, "g_SceneShader", SHADER_REFLECTION_FILE);
+
+	std::cout << "Shaders built: " << builtCount << ", failed: " << failedCount << std::endl;
+
+	return((failedCount == 0) && bWritten);
+}
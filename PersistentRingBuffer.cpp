@@ -0,0 +1,198 @@
+///////////////////////////////////////////////////////////////////////////////
+// persistentringbuffer.cpp
+// ============
+// persistently mapped buffer split into per-frame regions guarded by fences
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PersistentRingBuffer.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// how long to wait on a region fence before flushing again
+	const GLuint64 g_FenceTimeout = 1000000;  // nanoseconds
+}
+
+/***********************************************************
+ *  PersistentRingBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PersistentRingBuffer::PersistentRingBuffer()
+{
+	m_target = GL_SHADER_STORAGE_BUFFER;
+	m_bufferID = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_currentRegion = 0;
+}
+
+/***********************************************************
+ *  ~PersistentRingBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PersistentRingBuffer::~PersistentRingBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the immutable buffer
+ *  storage and mapping it for the lifetime of the buffer.
+ ***********************************************************/
+bool PersistentRingBuffer::Create(
+	GLenum target,
+	GLsizeiptr regionSize,
+	int regionCount)
+{
+	Destroy();
+
+	// glBufferStorage needs OpenGL 4.4 or the extension
+	if (!GLEW_VERSION_4_4 && !GLEW_ARB_buffer_storage)
+	{
+		std::cout << "Persistent mapped buffers are not supported" << std::endl;
+		return(false);
+	}
+	if ((regionSize <= 0) || (regionCount < 1))
+	{
+		return(false);
+	}
+
+	// every region has to start on a valid binding offset
+	GLint alignment = 1;
+	if (target == GL_SHADER_STORAGE_BUFFER)
+	{
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	}
+	else if (target == GL_UNIFORM_BUFFER)
+	{
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	}
+	if (alignment < 1)
+	{
+		alignment = 1;
+	}
+
+	m_target = target;
+	m_regionSize = ((regionSize + alignment - 1) / alignment) * alignment;
+	m_currentRegion = 0;
+	m_fences.assign(regionCount, (GLsync)NULL);
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	GLsizeiptr totalSize = m_regionSize * regionCount;
+
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(m_target, m_bufferID);
+	glBufferStorage(m_target, totalSize, NULL, flags);
+	m_pMapped = (char*)glMapBufferRange(m_target, 0, totalSize, flags);
+	glBindBuffer(m_target, 0);
+
+	if (NULL == m_pMapped)
+	{
+		std::cout << "Could not map the persistent buffer" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the region fences and
+ *  unmapping and freeing the buffer.
+ ***********************************************************/
+void PersistentRingBuffer::Destroy()
+{
+	for (size_t i = 0; i < m_fences.size(); i++)
+	{
+		if (NULL != m_fences[i])
+		{
+			glDeleteSync(m_fences[i]);
+		}
+	}
+	m_fences.clear();
+
+	if (m_bufferID != 0)
+	{
+		if (NULL != m_pMapped)
+		{
+			glBindBuffer(m_target, m_bufferID);
+			glUnmapBuffer(m_target);
+			glBindBuffer(m_target, 0);
+		}
+		glDeleteBuffers(1, &m_bufferID);
+	}
+
+	m_bufferID = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_currentRegion = 0;
+}
+
+/***********************************************************
+ *  BeginRegion()
+ *
+ *  This method is used for waiting until the GPU has finished
+ *  reading the current region and getting a pointer to it.
+ ***********************************************************/
+void* PersistentRingBuffer::BeginRegion()
+{
+	if (NULL == m_pMapped)
+	{
+		return(NULL);
+	}
+
+	GLsync& fence = m_fences[m_currentRegion];
+	if (NULL != fence)
+	{
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		while (result == GL_TIMEOUT_EXPIRED)
+		{
+			result = glClientWaitSync(fence, 0, g_FenceTimeout);
+		}
+		glDeleteSync(fence);
+		fence = NULL;
+	}
+
+	return(m_pMapped + GetRegionOffset());
+}
+
+/***********************************************************
+ *  EndRegion()
+ *
+ *  This method is used for fencing the draws that read the
+ *  current region and moving on to the next region.
+ ***********************************************************/
+void PersistentRingBuffer::EndRegion()
+{
+	if (NULL == m_pMapped)
+	{
+		return;
+	}
+
+	m_fences[m_currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_currentRegion = (m_currentRegion + 1) % (int)m_fences.size();
+}
+
+/***********************************************************
+ *  BindRegionRange()
+ *
+ *  This method is used for binding the written part of the
+ *  current region to an indexed binding point.
+ ***********************************************************/
+void PersistentRingBuffer::BindRegionRange(GLuint bindingIndex, GLsizeiptr usedSize)
+{
+	if ((m_bufferID == 0) || (usedSize <= 0))
+	{
+		return;
+	}
+
+	glBindBufferRange(m_target, bindingIndex, m_bufferID, GetRegionOffset(), usedSize);
+}
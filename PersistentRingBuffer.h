@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// persistentringbuffer.h
+// ============
+// persistently mapped buffer split into per-frame regions guarded by fences
+//
+//  The buffer is mapped once with GL_MAP_PERSISTENT_BIT and
+//  GL_MAP_COHERENT_BIT, so per-frame data is written straight into memory
+//  the GPU reads from - no glBufferSubData copies and no implicit sync.
+//  Each frame writes into the next region, and a region is only reused
+//  once the fence placed after its last use has signalled.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  PersistentRingBuffer
+ *
+ *  This class contains the mapped buffer, the region fences
+ *  and the code for cycling through the regions.
+ ***********************************************************/
+class PersistentRingBuffer
+{
+public:
+	// constructor
+	PersistentRingBuffer();
+	// destructor
+	~PersistentRingBuffer();
+
+	// create and map the buffer - returns false when the
+	// context does not support persistent mapping
+	bool Create(
+		GLenum target,
+		GLsizeiptr regionSize,
+		int regionCount = 3);
+	// unmap and free the buffer
+	void Destroy();
+
+	// wait until the next region is free and get a pointer
+	// for writing into it
+	void* BeginRegion();
+	// fence the region that was written and move to the next
+	void EndRegion();
+
+	// bind the written part of the current region to an
+	// indexed binding point of the buffer target
+	void BindRegionRange(GLuint bindingIndex, GLsizeiptr usedSize);
+
+	bool IsValid() const { return(m_bufferID != 0); }
+	GLuint GetBufferID() const { return(m_bufferID); }
+	GLsizeiptr GetRegionSize() const { return(m_regionSize); }
+	GLintptr GetRegionOffset() const { return(m_regionSize * m_currentRegion); }
+
+private:
+	// buffer target the regions are bound to
+	GLenum m_target;
+	// OpenGL buffer and its persistent mapping
+	GLuint m_bufferID;
+	char* m_pMapped;
+	// size of one region, rounded up to the offset alignment
+	GLsizeiptr m_regionSize;
+	// region being written this frame
+	int m_currentRegion;
+	// fence placed after the last use of each region
+	std::vector<GLsync> m_fences;
+};
@@ -0,0 +1,656 @@
+///////////////////////////////////////////////////////////////////////////////
+// pointshadowatlas.cpp
+// ============
+// cached omnidirectional shadows for point lights, packed into one atlas
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PointShadowAtlas.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// shader storage block of the slot data and its binding
+	const char* g_PointShadowBufferName = "PointShadowBuffer";
+	const GLuint g_PointShadowBufferBinding = 4;
+
+	// depth program - writes the distance from the light
+	// divided by the light range instead of the window depth
+	const char* g_DistanceVertexSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 position;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 faceViewProjection;\n"
+		"out vec3 worldPosition;\n"
+		"void main()\n"
+		"{\n"
+		"    worldPosition = vec3(model * vec4(position, 1.0));\n"
+		"    gl_Position = faceViewProjection * vec4(worldPosition, 1.0);\n"
+		"}\n";
+	const char* g_DistanceFragmentSource =
+		"#version 330 core\n"
+		"in vec3 worldPosition;\n"
+		"uniform vec4 lightPositionFar;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_FragDepth = length(worldPosition - lightPositionFar.xyz) / lightPositionFar.w;\n"
+		"}\n";
+
+	// near plane of the cube face projections
+	const float g_FaceNearPlane = 0.05f;
+
+	// look and up directions of the cube faces, in the order
+	// +X, -X, +Y, -Y, +Z, -Z
+	const glm::vec3 g_FaceDirections[6] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+	const glm::vec3 g_FaceUps[6] = {
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+}
+
+/***********************************************************
+ *  PointShadowAtlas()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PointShadowAtlas::PointShadowAtlas()
+{
+	m_atlasSize = 4096;
+	m_tileSize = 512;
+	m_updatesPerFrame = 2;
+	m_framebufferID = 0;
+	m_depthTextureID = 0;
+	m_dataBufferID = 0;
+	m_programID = 0;
+	m_modelLocation = -1;
+	m_faceViewProjectionLocation = -1;
+	m_lightPositionFarLocation = -1;
+	m_bPassActive = false;
+	m_savedFramebuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_savedViewport[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~PointShadowAtlas()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PointShadowAtlas::~PointShadowAtlas()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  SetQuality()
+ *
+ *  This method is used for setting the atlas size, the size
+ *  of one cube face tile and the number of lights whose
+ *  shadows may be rendered in one frame.
+ ***********************************************************/
+void PointShadowAtlas::SetQuality(int atlasSize, int tileSize, int updatesPerFrame)
+{
+	m_tileSize = glm::max(tileSize, 64);
+	m_atlasSize = glm::max(atlasSize, m_tileSize);
+	m_updatesPerFrame = glm::max(updatesPerFrame, 1);
+}
+
+/***********************************************************
+ *  GetSlotCount()
+ *
+ *  This method is used for getting the number of lights
+ *  whose six face tiles fit into the atlas.
+ ***********************************************************/
+int PointShadowAtlas::GetSlotCount() const
+{
+	int tilesPerRow = m_atlasSize / m_tileSize;
+
+	return((tilesPerRow * tilesPerRow) / FACE_COUNT);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the depth atlas, the
+ *  slot data buffer and the depth program.  The atlas is
+ *  only used when the fragment shader declares
+ *
+ *    struct PointShadowData
+ *    {
+ *        mat4 faceViewProjection[6];   // +X, -X, +Y, -Y, +Z, -Z
+ *        vec4 atlasRects[6];           // offset.xy, scale.zw
+ *        vec4 lightPositionFar;
+ *    };
+ *    layout(std430, binding = 4) buffer PointShadowBuffer
+ *    {
+ *        PointShadowData pointShadows[];
+ *    };
+ *    uniform sampler2DShadow pointShadowAtlas;
+ *
+ *  The slot of a light is in shadowParams.x of its LightData
+ *  (-1 for none).  A fragment picks the face
+ *  from the major axis of (fragment - light), projects with
+ *  that face matrix into the face tile, and compares
+ *  length(fragment - light) / lightPositionFar.w against the
+ *  stored distance.
+ ***********************************************************/
+bool PointShadowAtlas::Create(GLuint programID)
+{
+	Destroy();
+
+	// shader storage blocks need OpenGL 4.3
+	if (!GLEW_VERSION_4_3)
+	{
+		return(false);
+	}
+	GLuint blockIndex = glGetProgramResourceIndex(
+		programID,
+		GL_SHADER_STORAGE_BLOCK,
+		g_PointShadowBufferName);
+	if ((blockIndex == GL_INVALID_INDEX) || (GetSlotCount() == 0))
+	{
+		return(false);
+	}
+
+	if (CreateDepthProgram() == false)
+	{
+		return(false);
+	}
+
+	glGenTextures(1, &m_depthTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_depthTextureID);
+	glTexImage2D(
+		GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24,
+		m_atlasSize, m_atlasSize,
+		0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenFramebuffers(1, &m_framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTextureID, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	// start with every texel at the light range - unlit tiles
+	// never shadow anything
+	glClearDepth(1.0);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Point shadow atlas framebuffer is not complete" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	std::vector<POINT_SHADOW_DATA> slots(GetSlotCount());
+	glGenBuffers(1, &m_dataBufferID);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_dataBufferID);
+	glBufferData(
+		GL_SHADER_STORAGE_BUFFER,
+		slots.size() * sizeof(POINT_SHADOW_DATA),
+		&slots[0],
+		GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_slotOwners.assign(GetSlotCount(), -1);
+	for (size_t i = 0; i < m_lightStates.size(); i++)
+	{
+		m_lightStates[i].slot = -1;
+		m_lightStates[i].bRendered = false;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the atlas, the slot data
+ *  buffer and the depth program.
+ ***********************************************************/
+void PointShadowAtlas::Destroy()
+{
+	if (m_framebufferID != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebufferID);
+		m_framebufferID = 0;
+	}
+	if (m_depthTextureID != 0)
+	{
+		glDeleteTextures(1, &m_depthTextureID);
+		m_depthTextureID = 0;
+	}
+	if (m_dataBufferID != 0)
+	{
+		glDeleteBuffers(1, &m_dataBufferID);
+		m_dataBufferID = 0;
+	}
+	if (m_programID != 0)
+	{
+		glDeleteProgram(m_programID);
+		m_programID = 0;
+	}
+	m_modelLocation = -1;
+	m_faceViewProjectionLocation = -1;
+	m_lightPositionFarLocation = -1;
+	m_slotOwners.clear();
+}
+
+/***********************************************************
+ *  CreateDepthProgram()
+ *
+ *  This method is used for compiling and linking the program
+ *  that writes the light distance of the shadow casters.
+ ***********************************************************/
+bool PointShadowAtlas::CreateDepthProgram()
+{
+	const char* sources[2] = { g_DistanceVertexSource, g_DistanceFragmentSource };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint shaders[2] = { 0, 0 };
+	GLint success = 0;
+	char infoLog[512];
+
+	m_programID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+			std::cout << "Point shadow shader compilation failed\n" << infoLog << std::endl;
+		}
+		glAttachShader(m_programID, shaders[i]);
+	}
+	glLinkProgram(m_programID);
+	for (int i = 0; i < 2; i++)
+	{
+		glDeleteShader(shaders[i]);
+	}
+
+	glGetProgramiv(m_programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(m_programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Point shadow program linking failed\n" << infoLog << std::endl;
+		glDeleteProgram(m_programID);
+		m_programID = 0;
+		return(false);
+	}
+
+	m_modelLocation = glGetUniformLocation(m_programID, "model");
+	m_faceViewProjectionLocation = glGetUniformLocation(m_programID, "faceViewProjection");
+	m_lightPositionFarLocation = glGetUniformLocation(m_programID, "lightPositionFar");
+
+	return(true);
+}
+
+/***********************************************************
+ *  InvalidateSphere()
+ *
+ *  This method is used for marking the shadows of every
+ *  light whose range overlaps a world space sphere, so they
+ *  are rendered again.  It is called with the old and the
+ *  new bounds of an object that moved.
+ ***********************************************************/
+void PointShadowAtlas::InvalidateSphere(glm::vec3 center, float radius)
+{
+	for (size_t i = 0; i < m_lightStates.size(); i++)
+	{
+		LIGHT_STATE& state = m_lightStates[i];
+		if ((state.slot >= 0) &&
+			(glm::distance(center, state.renderedPosition) < radius + state.renderedRadius))
+		{
+			state.bDirty = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  ScheduleUpdates()
+ *
+ *  This method is used for handing out the atlas slots and
+ *  choosing the shadows to render.  The slots go to the
+ *  lights closest to the camera, taking a slot from a
+ *  farther light when the atlas is full; lights that are
+ *  switched off, or are not point lights, give up theirs.
+ *  Lights that moved, or that just got a slot, are rendered
+ *  closest first until the per-frame budget is used up; the
+ *  rest keep their old shadow until a later frame.
+ ***********************************************************/
+void PointShadowAtlas::ScheduleUpdates(
+	const std::vector<LightManager::LIGHT>& lights,
+	glm::vec3 cameraPosition,
+	SHADOW_FRAME& frame)
+{
+	frame.updates.clear();
+	frame.casters.clear();
+	frame.slotChanges.clear();
+	if (IsEnabled() == false)
+	{
+		return;
+	}
+
+	int lightCount = (int)lights.size();
+	while ((int)m_lightStates.size() < lightCount)
+	{
+		LIGHT_STATE state;
+		state.slot = -1;
+		state.bDirty = true;
+		state.bRendered = false;
+		state.renderedPosition = glm::vec3(0.0f);
+		state.renderedRadius = 0.0f;
+		m_lightStates.push_back(state);
+	}
+
+	// order the lights by the distance to their range
+	m_lightOrder.resize(lightCount);
+	m_lightDistances.resize(lightCount);
+	for (int i = 0; i < lightCount; i++)
+	{
+		const LightManager::LIGHT& light = lights[i];
+		LIGHT_STATE& state = m_lightStates[i];
+
+		m_lightOrder[i] = i;
+		m_lightDistances[i] = glm::max(glm::distance(cameraPosition, light.position) - light.range, 0.0f);
+
+		// only enabled point lights cast atlas shadows
+		if ((light.type != LightManager::LIGHT_POINT) || (light.bEnabled == false))
+		{
+			m_lightDistances[i] = FLT_MAX;
+			if (state.slot >= 0)
+			{
+				m_slotOwners[state.slot] = -1;
+				state.slot = -1;
+				if (state.bRendered)
+				{
+					SLOT_CHANGE change = { i, -1 };
+					frame.slotChanges.push_back(change);
+					state.bRendered = false;
+				}
+			}
+			continue;
+		}
+
+		if ((state.slot >= 0) &&
+			((light.position != state.renderedPosition) || (light.range != state.renderedRadius)))
+		{
+			state.bDirty = true;
+		}
+	}
+	std::sort(m_lightOrder.begin(), m_lightOrder.end(),
+		[this](int a, int b) { return(m_lightDistances[a] < m_lightDistances[b]); });
+
+	// the closest lights own the slots
+	int slotCount = (int)m_slotOwners.size();
+	for (int i = 0; (i < lightCount) && (i < slotCount); i++)
+	{
+		int lightIndex = m_lightOrder[i];
+		if ((m_lightStates[lightIndex].slot >= 0) || (m_lightDistances[lightIndex] == FLT_MAX))
+		{
+			continue;
+		}
+
+		// take a free slot, or the slot of the farthest owner
+		int slot = -1;
+		for (int s = 0; s < slotCount; s++)
+		{
+			int owner = m_slotOwners[s];
+			if (owner < 0)
+			{
+				slot = s;
+				break;
+			}
+			if ((slot < 0) || (m_lightDistances[owner] > m_lightDistances[m_slotOwners[slot]]))
+			{
+				slot = s;
+			}
+		}
+		int owner = m_slotOwners[slot];
+		if (owner >= 0)
+		{
+			// never evict a light closer than this one
+			if (m_lightDistances[owner] <= m_lightDistances[lightIndex])
+			{
+				continue;
+			}
+			m_lightStates[owner].slot = -1;
+			if (m_lightStates[owner].bRendered)
+			{
+				SLOT_CHANGE change = { owner, -1 };
+				frame.slotChanges.push_back(change);
+				m_lightStates[owner].bRendered = false;
+			}
+		}
+
+		m_slotOwners[slot] = lightIndex;
+		m_lightStates[lightIndex].slot = slot;
+		m_lightStates[lightIndex].bDirty = true;
+		m_lightStates[lightIndex].bRendered = false;
+	}
+
+	// render the closest changed shadows within the budget
+	for (int i = 0; (i < lightCount) && ((int)frame.updates.size() < m_updatesPerFrame); i++)
+	{
+		int lightIndex = m_lightOrder[i];
+		LIGHT_STATE& state = m_lightStates[lightIndex];
+		if ((state.slot < 0) || (state.bDirty == false))
+		{
+			continue;
+		}
+
+		const LightManager::LIGHT& light = lights[lightIndex];
+		SHADOW_UPDATE update;
+		update.slot = state.slot;
+		update.lightIndex = lightIndex;
+		BuildShadowData(state.slot, light, update.data);
+		frame.updates.push_back(update);
+
+		// the slot is passed to the shaders once it holds the
+		// shadow of this light
+		if (state.bRendered == false)
+		{
+			SLOT_CHANGE change = { lightIndex, state.slot };
+			frame.slotChanges.push_back(change);
+		}
+
+		state.bDirty = false;
+		state.bRendered = true;
+		state.renderedPosition = light.position;
+		state.renderedRadius = light.range;
+	}
+}
+
+/***********************************************************
+ *  BuildShadowData()
+ *
+ *  This method is used for calculating the six 90 degree
+ *  face projections around a light and the atlas tiles of
+ *  its slot.
+ ***********************************************************/
+void PointShadowAtlas::BuildShadowData(
+	int slot,
+	const LightManager::LIGHT& light,
+	POINT_SHADOW_DATA& data) const
+{
+	int tilesPerRow = m_atlasSize / m_tileSize;
+	float tileScale = (float)m_tileSize / (float)m_atlasSize;
+	float farPlane = glm::max(light.range, g_FaceNearPlane * 2.0f);
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, g_FaceNearPlane, farPlane);
+
+	for (int face = 0; face < FACE_COUNT; face++)
+	{
+		int tile = slot * FACE_COUNT + face;
+		glm::mat4 view = glm::lookAt(
+			light.position,
+			light.position + g_FaceDirections[face],
+			g_FaceUps[face]);
+
+		data.faceViewProjection[face] = projection * view;
+		data.atlasRects[face] = glm::vec4(
+			(float)(tile % tilesPerRow) * tileScale,
+			(float)(tile / tilesPerRow) * tileScale,
+			tileScale,
+			tileScale);
+	}
+	data.lightPositionFar = glm::vec4(light.position, farPlane);
+}
+
+/***********************************************************
+ *  GetFaceMask()
+ *
+ *  This method is used for finding the cube faces whose
+ *  frusta a world space sphere overlaps, by testing it
+ *  against the four 45 degree side planes of each face.
+ ***********************************************************/
+unsigned int PointShadowAtlas::GetFaceMask(
+	const SHADOW_UPDATE& update,
+	glm::vec3 center,
+	float radius)
+{
+	glm::vec3 offset = center - glm::vec3(update.data.lightPositionFar);
+	float range = update.data.lightPositionFar.w;
+	unsigned int mask = 0;
+
+	if (glm::length(offset) > range + radius)
+	{
+		return(0);
+	}
+
+	// the plane distances are scaled by the square root of 2
+	float limit = -radius * 1.41421356f;
+	for (int face = 0; face < FACE_COUNT; face++)
+	{
+		int axis = face / 2;
+		float forward = (face & 1) ? -offset[axis] : offset[axis];
+		float side1 = offset[(axis + 1) % 3];
+		float side2 = offset[(axis + 2) % 3];
+
+		if ((forward - side1 >= limit) && (forward + side1 >= limit) &&
+			(forward - side2 >= limit) && (forward + side2 >= limit))
+		{
+			mask |= (1u << face);
+		}
+	}
+
+	return(mask);
+}
+
+/***********************************************************
+ *  BeginFace()
+ *
+ *  This method is used for binding the tile of one cube face
+ *  for rendering and clearing it.  The bound framebuffer and
+ *  viewport are saved when the pass starts.
+ ***********************************************************/
+void PointShadowAtlas::BeginFace(const SHADOW_UPDATE& update, int face)
+{
+	if (m_bPassActive == false)
+	{
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+		glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+		glUseProgram(m_programID);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_SCISSOR_TEST);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		m_bPassActive = true;
+	}
+
+	const glm::vec4& rect = update.data.atlasRects[face];
+	GLint x = (GLint)(rect.x * m_atlasSize + 0.5f);
+	GLint y = (GLint)(rect.y * m_atlasSize + 0.5f);
+
+	// the scissor keeps the clear inside the tile
+	glViewport(x, y, m_tileSize, m_tileSize);
+	glScissor(x, y, m_tileSize, m_tileSize);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	glUniformMatrix4fv(
+		m_faceViewProjectionLocation, 1, GL_FALSE,
+		glm::value_ptr(update.data.faceViewProjection[face]));
+	glUniform4fv(m_lightPositionFarLocation, 1, glm::value_ptr(update.data.lightPositionFar));
+}
+
+/***********************************************************
+ *  SetCasterModel()
+ *
+ *  This method is used for setting the model matrix of the
+ *  next shadow caster to be drawn.
+ ***********************************************************/
+void PointShadowAtlas::SetCasterModel(const glm::mat4& model)
+{
+	glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method is used for restoring the render state that
+ *  was in use before the shadow pass and uploading the data
+ *  of the rendered slots - the other slots are unchanged.
+ ***********************************************************/
+void PointShadowAtlas::EndPass(const SHADOW_FRAME& frame)
+{
+	if (m_bPassActive)
+	{
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		glDisable(GL_SCISSOR_TEST);
+		glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+		glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+		m_bPassActive = false;
+	}
+
+	if (frame.updates.empty())
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_dataBufferID);
+	for (size_t i = 0; i < frame.updates.size(); i++)
+	{
+		glBufferSubData(
+			GL_SHADER_STORAGE_BUFFER,
+			frame.updates[i].slot * sizeof(POINT_SHADOW_DATA),
+			sizeof(POINT_SHADOW_DATA),
+			&frame.updates[i].data);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BindShadowData()
+ *
+ *  This method is used for binding the slot data buffer to
+ *  the shader storage block.
+ ***********************************************************/
+void PointShadowAtlas::BindShadowData()
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_PointShadowBufferBinding, m_dataBufferID);
+}
@@ -0,0 +1,173 @@
+///////////////////////////////////////////////////////////////////////////////
+// pointshadowatlas.h
+// ============
+// cached omnidirectional shadows for point lights, packed into one atlas
+//
+//  Every shadowed point light owns six tiles of a 2D depth atlas, one per
+//  cube face.  A light's tiles are only rendered again when the light
+//  moves, or when an object inside its range moves, and no more than a
+//  fixed number of lights are rendered per frame.  The cost of the shadows
+//  therefore follows how much the scene changes, not how many lights
+//  there are.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightManager.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  PointShadowAtlas
+ *
+ *  This class contains the shadow atlas, the cache state of
+ *  every light and the code for scheduling and rendering the
+ *  shadow updates.
+ ***********************************************************/
+class PointShadowAtlas
+{
+public:
+	// cube faces rendered for every light
+	static const int FACE_COUNT = 6;
+
+	// shadow data of one atlas slot - matches the std430
+	// layout of the shader storage block
+	struct POINT_SHADOW_DATA
+	{
+		glm::mat4 faceViewProjection[FACE_COUNT];
+		// atlas offset and scale of each face tile
+		glm::vec4 atlasRects[FACE_COUNT];
+		// light position, and the range depths are divided by
+		glm::vec4 lightPositionFar;
+	};
+
+	// one light whose shadow is rendered this frame
+	struct SHADOW_UPDATE
+	{
+		int slot;
+		int lightIndex;
+		POINT_SHADOW_DATA data;
+	};
+
+	// one object drawn into the faces of a shadow update
+	struct SHADOW_CASTER
+	{
+		glm::mat4 model;
+		int mesh;
+		int lodLevel;
+		int updateIndex;
+		unsigned int faceMask;
+	};
+
+	// light whose atlas slot changes with a frame - the slot
+	// is -1 when the light lost its shadow
+	struct SLOT_CHANGE
+	{
+		int lightIndex;
+		int slot;
+	};
+
+	// shadow work of one frame, scheduled on the update thread
+	// and rendered on the main thread
+	struct SHADOW_FRAME
+	{
+		std::vector<SHADOW_UPDATE> updates;
+		std::vector<SHADOW_CASTER> casters;
+		std::vector<SLOT_CHANGE> slotChanges;
+	};
+
+	// constructor
+	PointShadowAtlas();
+	// destructor
+	~PointShadowAtlas();
+
+	// set the atlas and tile sizes and how many lights may be
+	// rendered per frame - the sizes take effect the next time
+	// the atlas is created
+	void SetQuality(int atlasSize, int tileSize, int updatesPerFrame);
+
+	// create the atlas when the passed in program declares the
+	// shadow block - returns false otherwise
+	bool Create(GLuint programID);
+	// free the atlas resources
+	void Destroy();
+	bool IsEnabled() const { return(m_framebufferID != 0); }
+	GLuint GetDepthTexture() const { return(m_depthTextureID); }
+
+	// mark the shadows of every light reaching into a world
+	// space sphere for rendering again
+	void InvalidateSphere(glm::vec3 center, float radius);
+
+	// hand out atlas slots to the enabled point lights closest
+	// to the camera and pick the shadows to render this frame
+	// - makes no OpenGL calls, so it can run on the update
+	// thread
+	void ScheduleUpdates(
+		const std::vector<LightManager::LIGHT>& lights,
+		glm::vec3 cameraPosition,
+		SHADOW_FRAME& frame);
+
+	// get a bit for every cube face of an update that a world
+	// space sphere is inside of
+	static unsigned int GetFaceMask(
+		const SHADOW_UPDATE& update,
+		glm::vec3 center,
+		float radius);
+
+	// bind a face tile of an update for rendering and clear it
+	void BeginFace(const SHADOW_UPDATE& update, int face);
+	// set the model matrix of the next shadow caster
+	void SetCasterModel(const glm::mat4& model);
+	// restore the render state and upload the data of the
+	// slots that were rendered
+	void EndPass(const SHADOW_FRAME& frame);
+	// bind the slot data for the scene shaders
+	void BindShadowData();
+
+private:
+	// cache state of one light
+	struct LIGHT_STATE
+	{
+		int slot;
+		bool bDirty;
+		bool bRendered;
+		glm::vec3 renderedPosition;
+		float renderedRadius;
+	};
+
+	// atlas size, tile size and lights rendered per frame
+	int m_atlasSize;
+	int m_tileSize;
+	int m_updatesPerFrame;
+	// cache state of every light, and the light in each slot
+	std::vector<LIGHT_STATE> m_lightStates;
+	std::vector<int> m_slotOwners;
+	// lights ordered by distance from the camera
+	std::vector<int> m_lightOrder;
+	std::vector<float> m_lightDistances;
+	// OpenGL resources
+	GLuint m_framebufferID;
+	GLuint m_depthTextureID;
+	GLuint m_dataBufferID;
+	GLuint m_programID;
+	GLint m_modelLocation;
+	GLint m_faceViewProjectionLocation;
+	GLint m_lightPositionFarLocation;
+	// state restored at the end of the pass
+	bool m_bPassActive;
+	GLint m_savedFramebuffer;
+	GLint m_savedViewport[4];
+
+	// number of lights that fit into the atlas
+	int GetSlotCount() const;
+	// calculate the face matrices and tiles of a slot
+	void BuildShadowData(
+		int slot,
+		const LightManager::LIGHT& light,
+		POINT_SHADOW_DATA& data) const;
+	// compile and link the distance-writing depth program
+	bool CreateDepthProgram();
+};
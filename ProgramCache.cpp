@@ -0,0 +1,404 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.cpp
+// ============
+// link shader programs from GLSL files, reusing cached program binaries
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// file header of a cached binary
+	const char g_FileMagic[4] = { 'P', 'B', 'I', 'N' };
+	// largest binary that is read back, against corrupt files
+	const int32_t g_MaxBinarySize = 64 * 1024 * 1024;
+	// length of the part of a source name that names the files
+	const size_t g_FileNameLength = 16;
+
+	// 64 bit FNV-1a over a block of bytes, continuing from the
+	// passed in hash
+	uint64_t HashBytes(uint64_t hash, const void* pData, size_t size)
+	{
+		const unsigned char* pBytes = (const unsigned char*)pData;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= pBytes[i];
+			hash *= 1099511628211ull;
+		}
+		return(hash);
+	}
+}
+
+/***********************************************************
+ *  ProgramCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ProgramCache::ProgramCache(const char* cacheDirectory)
+{
+	m_cacheDirectory = cacheDirectory;
+	if ((m_cacheDirectory.empty() == false) && (m_cacheDirectory.back() != '/'))
+	{
+		m_cacheDirectory += '/';
+	}
+
+	// a directory that can not be created only costs every
+	// run the compiles, which SaveBinary() reports
+	std::error_code error;
+	if (m_cacheDirectory.empty() == false)
+	{
+		std::filesystem::create_directories(m_cacheDirectory, error);
+	}
+}
+
+/***********************************************************
+ *  ~ProgramCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ProgramCache::~ProgramCache()
+{
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for linking the program of a pair of
+ *  shader files.  The cached binary is used when the driver
+ *  accepts it, otherwise the sources are compiled and the
+ *  new binary is saved for the next run.  The binaries left
+ *  from earlier versions of the files are removed first.
+ ***********************************************************/
+GLuint ProgramCache::LoadProgram(const char* vertexPath, const char* fragmentPath)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+
+	if ((ReadSourceFile(vertexPath, vertexSource) == false) ||
+		(ReadSourceFile(fragmentPath, fragmentSource) == false))
+	{
+		return(0);
+	}
+
+	std::string sourceName = MakeSourceName(vertexPath, fragmentPath, vertexSource, fragmentSource);
+	RemoveStaleBinaries(sourceName);
+
+	return(LoadProgramSources(vertexSource, fragmentSource, sourceName));
+}
+
+/***********************************************************
+ *  LoadProgramSources()
+ *
+ *  This method is used for linking the program of a pair of
+ *  sources, through the cache like LoadProgram().
+ ***********************************************************/
+GLuint ProgramCache::LoadProgramSources(
+	const std::string& vertexSource,
+	const std::string& fragmentSource,
+	const std::string& sourceName)
+{
+	// binaries need the extension, and at least one format
+	GLint formatCount = 0;
+	if (GLEW_ARB_get_program_binary)
+	{
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	}
+	if (formatCount <= 0)
+	{
+		return(CompileProgram(vertexSource, fragmentSource, false));
+	}
+
+	uint64_t key = MakeCacheKey(vertexSource, fragmentSource);
+	GLuint programID = LoadBinary(sourceName, key);
+	if (programID != 0)
+	{
+		return(programID);
+	}
+
+	programID = CompileProgram(vertexSource, fragmentSource, true);
+	if (programID != 0)
+	{
+		SaveBinary(sourceName, key, programID);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  MakeSourceName()
+ *
+ *  This method is used for naming a pair of shader files,
+ *  followed by the hash of their sources - the binaries of
+ *  all the programs made from the files start with it.
+ ***********************************************************/
+std::string ProgramCache::MakeSourceName(
+	const char* vertexPath,
+	const char* fragmentPath,
+	const std::string& vertexSource,
+	const std::string& fragmentSource)
+{
+	uint64_t fileHash = 14695981039346656037ull;
+	fileHash = HashBytes(fileHash, vertexPath, strlen(vertexPath) + 1);
+	fileHash = HashBytes(fileHash, fragmentPath, strlen(fragmentPath) + 1);
+
+	uint64_t sourceHash = 14695981039346656037ull;
+	sourceHash = HashBytes(sourceHash, vertexSource.data(), vertexSource.size());
+	sourceHash = HashBytes(sourceHash, "", 1);
+	sourceHash = HashBytes(sourceHash, fragmentSource.data(), fragmentSource.size());
+
+	char name[40];
+	snprintf(name, sizeof(name), "%016llx-%016llx",
+		(unsigned long long)fileHash,
+		(unsigned long long)sourceHash);
+
+	return(name);
+}
+
+/***********************************************************
+ *  ReadSourceFile()
+ *
+ *  This method is used for reading a shader source file.
+ ***********************************************************/
+bool ProgramCache::ReadSourceFile(const char* path, std::string& source)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not read shader:" << path << std::endl;
+		return(false);
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	source = stream.str();
+
+	return(true);
+}
+
+/***********************************************************
+ *  CompileProgram()
+ *
+ *  This method is used for compiling and linking a program
+ *  from a vertex and a fragment source.  A retrievable
+ *  program tells the driver to keep its binary around.
+ ***********************************************************/
+GLuint ProgramCache::CompileProgram(
+	const std::string& vertexSource,
+	const std::string& fragmentSource,
+	bool bRetrievable)
+{
+	const char* sources[2] = { vertexSource.c_str(), fragmentSource.c_str() };
+	const char* names[2] = { "vertex", "fragment" };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint shaders[2] = { 0, 0 };
+	GLint success = 0;
+	bool bCompiled = true;
+	char infoLog[1024];
+
+	GLuint programID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+			std::cout << "Scene " << names[i] << " shader compilation failed\n" << infoLog << std::endl;
+			bCompiled = false;
+		}
+		glAttachShader(programID, shaders[i]);
+	}
+
+	if (bCompiled)
+	{
+		if (bRetrievable)
+		{
+			glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		glLinkProgram(programID);
+		glGetProgramiv(programID, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+			std::cout << "Scene program linking failed\n" << infoLog << std::endl;
+			bCompiled = false;
+		}
+	}
+
+	for (int i = 0; i < 2; i++)
+	{
+		glDetachShader(programID, shaders[i]);
+		glDeleteShader(shaders[i]);
+	}
+	if (bCompiled == false)
+	{
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for getting the file name of a
+ *  cache key, after the name of the sources.
+ ***********************************************************/
+std::string ProgramCache::GetCachePath(const std::string& sourceName, uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "-%016llx.bin", (unsigned long long)key);
+
+	return(m_cacheDirectory + sourceName + name);
+}
+
+/***********************************************************
+ *  RemoveStaleBinaries()
+ *
+ *  This method is used for deleting the binaries that name
+ *  the same shader files as a source name but were made
+ *  from other sources, so every edit of the files does not
+ *  leave its binaries behind.
+ ***********************************************************/
+void ProgramCache::RemoveStaleBinaries(const std::string& sourceName) const
+{
+	std::string filePrefix = sourceName.substr(0, g_FileNameLength + 1);
+	std::string sourcePrefix = sourceName + "-";
+	std::error_code error;
+
+	std::filesystem::directory_iterator entry(m_cacheDirectory.empty() ? "." : m_cacheDirectory, error);
+	for (; (!error) && (entry != std::filesystem::directory_iterator()); entry.increment(error))
+	{
+		std::string name = entry->path().filename().string();
+		if ((name.compare(0, filePrefix.size(), filePrefix) == 0) &&
+			(name.compare(0, sourcePrefix.size(), sourcePrefix) != 0))
+		{
+			std::error_code removeError;
+			std::filesystem::remove(entry->path(), removeError);
+		}
+	}
+}
+
+/***********************************************************
+ *  MakeCacheKey()
+ *
+ *  This method is used for hashing the sources together
+ *  with the driver strings, so a driver update or another
+ *  GPU never gets a binary it can not use.
+ ***********************************************************/
+uint64_t ProgramCache::MakeCacheKey(
+	const std::string& vertexSource,
+	const std::string& fragmentSource)
+{
+	const GLenum driverStrings[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	uint64_t hash = 14695981039346656037ull;
+
+	for (int i = 0; i < 3; i++)
+	{
+		const char* pString = (const char*)glGetString(driverStrings[i]);
+		if (NULL != pString)
+		{
+			hash = HashBytes(hash, pString, strlen(pString) + 1);
+		}
+	}
+	hash = HashBytes(hash, vertexSource.data(), vertexSource.size());
+	// a separator, so moving text between the files changes
+	// the key
+	hash = HashBytes(hash, "", 1);
+	hash = HashBytes(hash, fragmentSource.data(), fragmentSource.size());
+
+	return(hash);
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for creating a program from the
+ *  cached binary of a key.  The driver may still reject a
+ *  binary that matches, in which case the program is
+ *  deleted and 0 is returned.
+ ***********************************************************/
+GLuint ProgramCache::LoadBinary(const std::string& sourceName, uint64_t key) const
+{
+	std::string path = GetCachePath(sourceName, key);
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file)
+	{
+		return(0);
+	}
+
+	char magic[4];
+	int32_t header[2];
+	file.read(magic, sizeof(magic));
+	file.read((char*)header, sizeof(header));
+	if (!file ||
+		(memcmp(magic, g_FileMagic, sizeof(magic)) != 0) ||
+		(header[1] <= 0) || (header[1] > g_MaxBinarySize))
+	{
+		return(0);
+	}
+
+	std::vector<char> binary(header[1]);
+	file.read(binary.data(), binary.size());
+	if (!file)
+	{
+		return(0);
+	}
+
+	GLint success = 0;
+	GLuint programID = glCreateProgram();
+	glProgramBinary(programID, (GLenum)header[0], binary.data(), (GLsizei)binary.size());
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  SaveBinary()
+ *
+ *  This method is used for writing the binary of a linked
+ *  program under its key.  A failed write only costs the
+ *  next run a compile, so it is just reported.
+ ***********************************************************/
+void ProgramCache::SaveBinary(const std::string& sourceName, uint64_t key, GLuint programID) const
+{
+	GLint length = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(programID, length, &length, &format, binary.data());
+
+	std::string path = GetCachePath(sourceName, key);
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not write program binary:" << path << std::endl;
+		return;
+	}
+
+	int32_t header[2] = { (int32_t)format, length };
+	file.write(g_FileMagic, sizeof(g_FileMagic));
+	file.write((const char*)header, sizeof(header));
+	file.write(binary.data(), length);
+}
@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.h
+// ============
+// link shader programs from GLSL files, reusing cached program binaries
+//
+//  A linked program is saved with glGetProgramBinary() under a key made
+//  from its sources and the driver strings, so a later run with the same
+//  shaders and driver loads it with glProgramBinary() instead of compiling.
+//  A binary the driver rejects is compiled again and replaced.  The file
+//  name of a binary also names the shader files and sources it was built
+//  from, so loading changed files removes the binaries of the old sources.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  ProgramCache
+ *
+ *  This class contains the cache location and the code for
+ *  loading, compiling and saving program binaries.  It can
+ *  be used from any thread with a current OpenGL context.
+ ***********************************************************/
+class ProgramCache
+{
+public:
+	// constructor - the binaries are kept in the passed in
+	// directory, which is created when it does not exist
+	ProgramCache(const char* cacheDirectory);
+	// destructor
+	~ProgramCache();
+
+	// link a program from a vertex and a fragment shader file
+	// - returns 0 and prints the log when it fails
+	GLuint LoadProgram(const char* vertexPath, const char* fragmentPath);
+	// link a program from a vertex and a fragment source - the
+	// source name from MakeSourceName() ties the binary to the
+	// files the sources were made from
+	GLuint LoadProgramSources(
+		const std::string& vertexSource,
+		const std::string& fragmentSource,
+		const std::string& sourceName);
+
+	// name a pair of shader files and their current sources,
+	// for the binaries of programs made from them
+	static std::string MakeSourceName(
+		const char* vertexPath,
+		const char* fragmentPath,
+		const std::string& vertexSource,
+		const std::string& fragmentSource);
+
+	// read a whole text file - returns false when it can not
+	// be read
+	static bool ReadSourceFile(const char* path, std::string& source);
+	// compile and link a program from sources - returns 0
+	// and prints the log when it fails
+	static GLuint CompileProgram(
+		const std::string& vertexSource,
+		const std::string& fragmentSource,
+		bool bRetrievable);
+
+private:
+	// directory the binaries are kept in
+	std::string m_cacheDirectory;
+
+	// get the file of a cache key
+	std::string GetCachePath(const std::string& sourceName, uint64_t key) const;
+	// remove the binaries of the same files made from other
+	// sources
+	void RemoveStaleBinaries(const std::string& sourceName) const;
+	// make a cache key from the sources and the driver
+	static uint64_t MakeCacheKey(
+		const std::string& vertexSource,
+		const std::string& fragmentSource);
+	// load a cached binary into a new program - returns 0
+	// when there is none or the driver rejects it
+	GLuint LoadBinary(const std::string& sourceName, uint64_t key) const;
+	// save the binary of a linked program
+	void SaveBinary(const std::string& sourceName, uint64_t key, GLuint programID) const;
+};
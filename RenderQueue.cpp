@@ -0,0 +1,357 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// per-thread lists of recorded draw commands, merged and sorted for submit
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// depth bands per doubling of the view depth - coarse
+	// enough that draws with the same state still group
+	const float g_DepthBandsPerDoubling = 4.0f;
+	// radix sort digit size
+	const int g_RadixBits = 8;
+	const int g_RadixBuckets = 1 << g_RadixBits;
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue(int threadCount)
+{
+	if (threadCount < 1)
+	{
+		threadCount = 1;
+	}
+	m_threadLists.resize(threadCount);
+	m_shadowThreadLists.resize(threadCount);
+	m_transparentThreadLists.resize(threadCount);
+	m_orthoThreadLists.resize(threadCount);
+	m_orthoTransparentThreadLists.resize(threadCount);
+	m_shadowFrame.cascadeCount = 0;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_orthoViewCount = 0;
+}
+
+/***********************************************************
+ *  ~RenderQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderQueue::~RenderQueue()
+{
+	m_threadLists.clear();
+	m_commands.clear();
+	m_shadowThreadLists.clear();
+	m_shadowCommands.clear();
+	m_transparentThreadLists.clear();
+	m_transparentCommands.clear();
+	m_orthoThreadLists.clear();
+	m_orthoCommands.clear();
+	m_orthoTransparentThreadLists.clear();
+	m_orthoTransparentCommands.clear();
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for clearing the recorded commands.
+ *  The list capacity is kept so that recording does not
+ *  allocate once the scene size has settled.
+ ***********************************************************/
+void RenderQueue::Reset()
+{
+	for (size_t i = 0; i < m_threadLists.size(); i++)
+	{
+		m_threadLists[i].clear();
+		m_shadowThreadLists[i].clear();
+		m_transparentThreadLists[i].clear();
+		m_orthoThreadLists[i].clear();
+		m_orthoTransparentThreadLists[i].clear();
+	}
+	m_commands.clear();
+	m_shadowCommands.clear();
+	m_transparentCommands.clear();
+	m_orthoCommands.clear();
+	m_orthoTransparentCommands.clear();
+	m_pointShadowFrame.updates.clear();
+	m_pointShadowFrame.casters.clear();
+}
+
+/***********************************************************
+ *  GetThreadList()
+ *
+ *  This method is used for getting the command list owned
+ *  by the indexed thread.
+ ***********************************************************/
+std::vector<RenderQueue::DRAW_COMMAND>& RenderQueue::GetThreadList(int threadIndex)
+{
+	return(m_threadLists[threadIndex]);
+}
+
+/***********************************************************
+ *  GetShadowThreadList()
+ *
+ *  This method is used for getting the shadow caster list
+ *  owned by the indexed thread.
+ ***********************************************************/
+std::vector<RenderQueue::DRAW_COMMAND>& RenderQueue::GetShadowThreadList(int threadIndex)
+{
+	return(m_shadowThreadLists[threadIndex]);
+}
+
+/***********************************************************
+ *  GetTransparentThreadList()
+ *
+ *  This method is used for getting the transparent object
+ *  list owned by the indexed thread.
+ ***********************************************************/
+std::vector<RenderQueue::DRAW_COMMAND>& RenderQueue::GetTransparentThreadList(int threadIndex)
+{
+	return(m_transparentThreadLists[threadIndex]);
+}
+
+/***********************************************************
+ *  GetOrthoThreadList()
+ *
+ *  This method is used for getting the opaque object list
+ *  of the orthographic views owned by the indexed thread.
+ ***********************************************************/
+std::vector<RenderQueue::DRAW_COMMAND>& RenderQueue::GetOrthoThreadList(int threadIndex)
+{
+	return(m_orthoThreadLists[threadIndex]);
+}
+
+/***********************************************************
+ *  GetOrthoTransparentThreadList()
+ *
+ *  This method is used for getting the transparent object
+ *  list of the orthographic views owned by the indexed
+ *  thread.
+ ***********************************************************/
+std::vector<RenderQueue::DRAW_COMMAND>& RenderQueue::GetOrthoTransparentThreadList(int threadIndex)
+{
+	return(m_orthoTransparentThreadLists[threadIndex]);
+}
+
+/***********************************************************
+ *  SetViewMatrices()
+ *
+ *  This method is used for keeping the camera the frame was
+ *  recorded with, for the passes that need it at submit
+ *  time while a newer frame is already being updated.
+ ***********************************************************/
+void RenderQueue::SetViewMatrices(const glm::mat4& view, const glm::mat4& projection)
+{
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+}
+
+/***********************************************************
+ *  SetOrthoViews()
+ *
+ *  This method is used for keeping the orthographic views
+ *  the frame was recorded with.  Views past the most a
+ *  frame holds are left out.
+ ***********************************************************/
+void RenderQueue::SetOrthoViews(
+	int viewCount,
+	const glm::mat4* pViews,
+	const glm::mat4* pProjections)
+{
+	m_orthoViewCount = std::min(std::max(viewCount, 0), MAX_ORTHO_VIEWS);
+	for (int i = 0; i < m_orthoViewCount; i++)
+	{
+		m_orthoViews[i] = pViews[i];
+		m_orthoProjections[i] = pProjections[i];
+	}
+}
+
+/***********************************************************
+ *  MergeAndSort()
+ *
+ *  This method is used for merging the thread lists of the
+ *  draw commands, the shadow casters and the transparent
+ *  objects.  The transparent objects are only sorted by
+ *  depth, with a radix sort on their back to front keys,
+ *  since they must be blended in that order when there is
+ *  no order-independent transparency.  The orthographic
+ *  views look from different sides, so their transparent
+ *  objects are only put back in object order.
+ ***********************************************************/
+void RenderQueue::MergeAndSort()
+{
+	MergeLists(m_threadLists, m_commands);
+	MergeLists(m_shadowThreadLists, m_shadowCommands);
+	AppendLists(m_transparentThreadLists, m_transparentCommands);
+	RadixSort(m_transparentCommands, m_sortScratch);
+	if (m_orthoViewCount > 0)
+	{
+		MergeLists(m_orthoThreadLists, m_orthoCommands);
+		AppendLists(m_orthoTransparentThreadLists, m_orthoTransparentCommands);
+		RadixSort(m_orthoTransparentCommands, m_sortScratch);
+	}
+}
+
+/***********************************************************
+ *  MergeLists()
+ *
+ *  This method is used for appending all the thread lists
+ *  into one list and sorting it by the command sort keys.
+ ***********************************************************/
+void RenderQueue::MergeLists(
+	std::vector< std::vector<DRAW_COMMAND> >& threadLists,
+	std::vector<DRAW_COMMAND>& commands)
+{
+	AppendLists(threadLists, commands);
+
+	std::sort(commands.begin(), commands.end(),
+		[](const DRAW_COMMAND& a, const DRAW_COMMAND& b) { return(a.sortKey < b.sortKey); });
+}
+
+/***********************************************************
+ *  AppendLists()
+ *
+ *  This method is used for appending all the thread lists
+ *  into one list.
+ ***********************************************************/
+void RenderQueue::AppendLists(
+	std::vector< std::vector<DRAW_COMMAND> >& threadLists,
+	std::vector<DRAW_COMMAND>& commands)
+{
+	size_t total = 0;
+	for (size_t i = 0; i < threadLists.size(); i++)
+	{
+		total += threadLists[i].size();
+	}
+
+	commands.clear();
+	commands.reserve(total);
+	for (size_t i = 0; i < threadLists.size(); i++)
+	{
+		commands.insert(commands.end(), threadLists[i].begin(), threadLists[i].end());
+	}
+}
+
+/***********************************************************
+ *  RadixSort()
+ *
+ *  This method is used for sorting commands by their keys,
+ *  eight bits per pass from the lowest.  Every pass keeps
+ *  the order of the one before, and a pass is skipped when
+ *  all the keys share its digit.
+ ***********************************************************/
+void RenderQueue::RadixSort(
+	std::vector<DRAW_COMMAND>& commands,
+	std::vector<DRAW_COMMAND>& scratch)
+{
+	size_t counts[g_RadixBuckets];
+
+	if (commands.size() < 2)
+	{
+		return;
+	}
+
+	scratch.resize(commands.size());
+	for (int shift = 0; shift < 64; shift += g_RadixBits)
+	{
+		memset(counts, 0, sizeof(counts));
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			counts[(commands[i].sortKey >> shift) & (g_RadixBuckets - 1)]++;
+		}
+		if (counts[(commands[0].sortKey >> shift) & (g_RadixBuckets - 1)] == commands.size())
+		{
+			continue;
+		}
+
+		// turn the counts into the first place of each digit
+		size_t offset = 0;
+		for (int digit = 0; digit < g_RadixBuckets; digit++)
+		{
+			size_t count = counts[digit];
+			counts[digit] = offset;
+			offset += count;
+		}
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			scratch[counts[(commands[i].sortKey >> shift) & (g_RadixBuckets - 1)]++] = commands[i];
+		}
+		commands.swap(scratch);
+	}
+}
+
+/***********************************************************
+ *  MakeSortKey()
+ *
+ *  This method is used for packing the draw state into a
+ *  64 bit key - shader permutation in the highest bits, so
+ *  each program is bound once, then depth band, texture,
+ *  material and mesh, and the object index in the lowest
+ *  20 bits.
+ ***********************************************************/
+uint64_t RenderQueue::MakeSortKey(
+	int permutation,
+	int depthBand,
+	int textureSlot,
+	int materialIndex,
+	int meshKey,
+	int objectIndex)
+{
+	uint64_t key = 0;
+
+	// unused slots are -1, so shift everything up by one
+	key |= ((uint64_t)(permutation & 0xFF)) << 56;
+	key |= ((uint64_t)(depthBand & 0xFF)) << 48;
+	key |= ((uint64_t)((textureSlot + 1) & 0xFF)) << 40;
+	key |= ((uint64_t)((materialIndex + 1) & 0xFF)) << 32;
+	key |= ((uint64_t)(meshKey & 0xFFF)) << 20;
+	key |= (uint64_t)(objectIndex & 0xFFFFF);
+
+	return(key);
+}
+
+/***********************************************************
+ *  GetDepthBand()
+ *
+ *  This method is used for getting the depth band of a view
+ *  depth - a fixed number of bands for every doubling of
+ *  the depth, up to the last of 256 bands.
+ ***********************************************************/
+int RenderQueue::GetDepthBand(float viewDepth)
+{
+	float band = std::log2(1.0f + std::max(viewDepth, 0.0f)) * g_DepthBandsPerDoubling;
+
+	return((int)std::min(band, 255.0f));
+}
+
+/***********************************************************
+ *  MakeBackToFrontKey()
+ *
+ *  This method is used for packing a view depth into a key
+ *  that sorts the farthest first.  The bits of a float that
+ *  is not negative grow with its value, so they are turned
+ *  around in the highest 32 bits, and the object index
+ *  keeps the order of equal depths the same every frame.
+ ***********************************************************/
+uint64_t RenderQueue::MakeBackToFrontKey(
+	float viewDepth,
+	int objectIndex)
+{
+	uint32_t depthBits = 0;
+	float depth = std::max(viewDepth, 0.0f);
+
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+
+	return(((uint64_t)(0xFFFFFFFFu - depthBits) << 32) | (uint64_t)(uint32_t)objectIndex);
+}
@@ -0,0 +1,188 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// per-thread lists of recorded draw commands, merged and sorted for submit
+//
+//  Worker threads only ever append to their own list, so recording needs no
+//  locking.  The main thread merges the lists and sorts them by state key
+//  before any OpenGL call is made.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LightClusters.h"
+#include "LightManager.h"
+#include "PointShadowAtlas.h"
+#include "ShadowCascades.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class contains the recorded draw commands, shadow
+ *  work and light lists of one frame and the code for
+ *  merging and sorting the commands.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// everything needed to issue one draw call
+	struct DRAW_COMMAND
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		int textureSlot;
+		int materialIndex;
+		int mesh;
+		int lodLevel;
+		// bit for every shadow cascade the object casts into
+		unsigned int shadowMask;
+		// lightmap tile of the object - a zero scale means it is
+		// lit at runtime
+		glm::vec4 lightmapRect;
+		uint64_t sortKey;
+	};
+
+	// most fixed orthographic views recorded with a frame -
+	// they share one list of commands, culled against all of
+	// them at once
+	static const int MAX_ORTHO_VIEWS = 3;
+
+	// constructor
+	RenderQueue(int threadCount);
+	// destructor
+	~RenderQueue();
+
+	// clear the lists before recording a new frame
+	void Reset();
+
+	// get the list that the indexed thread records into
+	std::vector<DRAW_COMMAND>& GetThreadList(int threadIndex);
+
+	// get the shadow caster list that the indexed thread
+	// records into
+	std::vector<DRAW_COMMAND>& GetShadowThreadList(int threadIndex);
+
+	// get the list of objects with alpha below one that the
+	// indexed thread records into
+	std::vector<DRAW_COMMAND>& GetTransparentThreadList(int threadIndex);
+
+	// get the opaque and transparent lists of the orthographic
+	// views that the indexed thread records into
+	std::vector<DRAW_COMMAND>& GetOrthoThreadList(int threadIndex);
+	std::vector<DRAW_COMMAND>& GetOrthoTransparentThreadList(int threadIndex);
+
+	// merge the thread lists and sort by state key
+	void MergeAndSort();
+
+	// get the merged and sorted commands - the commands are
+	// the opaque objects only
+	const std::vector<DRAW_COMMAND>& GetCommands() const { return(m_commands); }
+	const std::vector<DRAW_COMMAND>& GetShadowCommands() const { return(m_shadowCommands); }
+	const std::vector<DRAW_COMMAND>& GetTransparentCommands() const { return(m_transparentCommands); }
+	const std::vector<DRAW_COMMAND>& GetOrthoCommands() const { return(m_orthoCommands); }
+	const std::vector<DRAW_COMMAND>& GetOrthoTransparentCommands() const { return(m_orthoTransparentCommands); }
+
+	// get the shadow cascades fitted to the frame view
+	ShadowCascades::SHADOW_FRAME& GetShadowFrame() { return(m_shadowFrame); }
+	const ShadowCascades::SHADOW_FRAME& GetShadowFrame() const { return(m_shadowFrame); }
+
+	// get the point light shadows rendered with the frame
+	PointShadowAtlas::SHADOW_FRAME& GetPointShadowFrame() { return(m_pointShadowFrame); }
+	const PointShadowAtlas::SHADOW_FRAME& GetPointShadowFrame() const { return(m_pointShadowFrame); }
+
+	// set and get the camera the frame was recorded with
+	void SetViewMatrices(const glm::mat4& view, const glm::mat4& projection);
+	const glm::mat4& GetViewMatrix() const { return(m_viewMatrix); }
+	const glm::mat4& GetProjectionMatrix() const { return(m_projectionMatrix); }
+
+	// set and get the orthographic views the frame was
+	// recorded with
+	void SetOrthoViews(
+		int viewCount,
+		const glm::mat4* pViews,
+		const glm::mat4* pProjections);
+	int GetOrthoViewCount() const { return(m_orthoViewCount); }
+	const glm::mat4& GetOrthoViewMatrix(int viewIndex) const { return(m_orthoViews[viewIndex]); }
+	const glm::mat4& GetOrthoProjectionMatrix(int viewIndex) const { return(m_orthoProjections[viewIndex]); }
+
+	// get the lights as they were when the frame was recorded
+	std::vector<LightManager::LIGHT>& GetLights() { return(m_lights); }
+	const std::vector<LightManager::LIGHT>& GetLights() const { return(m_lights); }
+
+	// get the light lists assigned to the frame clusters
+	LightClusters::LIGHT_GRID& GetLightGrid() { return(m_lightGrid); }
+	const LightClusters::LIGHT_GRID& GetLightGrid() const { return(m_lightGrid); }
+
+	// build a key that groups draws by shader permutation,
+	// orders them front to back by coarse depth band, then
+	// groups them by texture, material and mesh inside each
+	// band, keeping the object order
+	static uint64_t MakeSortKey(
+		int permutation,
+		int depthBand,
+		int textureSlot,
+		int materialIndex,
+		int meshKey,
+		int objectIndex);
+	// get the coarse depth band of a view depth - nearby
+	// bands are thinner, where the order matters most
+	static int GetDepthBand(float viewDepth);
+	// build a key that orders draws back to front by their
+	// exact view depth
+	static uint64_t MakeBackToFrontKey(
+		float viewDepth,
+		int objectIndex);
+
+private:
+	// commands recorded by each thread
+	std::vector< std::vector<DRAW_COMMAND> > m_threadLists;
+	// merged and sorted commands
+	std::vector<DRAW_COMMAND> m_commands;
+	// shadow casters recorded by each thread, and merged
+	std::vector< std::vector<DRAW_COMMAND> > m_shadowThreadLists;
+	std::vector<DRAW_COMMAND> m_shadowCommands;
+	// transparent objects recorded by each thread, and merged
+	std::vector< std::vector<DRAW_COMMAND> > m_transparentThreadLists;
+	std::vector<DRAW_COMMAND> m_transparentCommands;
+	// objects seen by any orthographic view, recorded by each
+	// thread and merged
+	std::vector< std::vector<DRAW_COMMAND> > m_orthoThreadLists;
+	std::vector<DRAW_COMMAND> m_orthoCommands;
+	std::vector< std::vector<DRAW_COMMAND> > m_orthoTransparentThreadLists;
+	std::vector<DRAW_COMMAND> m_orthoTransparentCommands;
+	// work space of the transparent sort
+	std::vector<DRAW_COMMAND> m_sortScratch;
+	// shadow cascade placement of the frame
+	ShadowCascades::SHADOW_FRAME m_shadowFrame;
+	// point light shadow updates of the frame
+	PointShadowAtlas::SHADOW_FRAME m_pointShadowFrame;
+	// camera of the frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// orthographic views of the frame
+	int m_orthoViewCount;
+	glm::mat4 m_orthoViews[MAX_ORTHO_VIEWS];
+	glm::mat4 m_orthoProjections[MAX_ORTHO_VIEWS];
+	// lights of the frame
+	std::vector<LightManager::LIGHT> m_lights;
+	// point lights of every view cluster
+	LightClusters::LIGHT_GRID m_lightGrid;
+
+	// append the thread lists into one list sorted by key
+	static void MergeLists(
+		std::vector< std::vector<DRAW_COMMAND> >& threadLists,
+		std::vector<DRAW_COMMAND>& commands);
+	// append the thread lists into one list
+	static void AppendLists(
+		std::vector< std::vector<DRAW_COMMAND> >& threadLists,
+		std::vector<DRAW_COMMAND>& commands);
+	// sort commands by key with a stable radix sort
+	static void RadixSort(
+		std::vector<DRAW_COMMAND>& commands,
+		std::vector<DRAW_COMMAND>& scratch);
+};
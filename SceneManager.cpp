@@ -32,6 +32,10 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <random>
+
 // declaration of global variables
 namespace
 {
@@ -40,6 +44,28 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_ObjectIndexName = "objectIndex";
+	const char* g_ObjectBufferName = "ObjectBuffer";
+	const GLuint g_ObjectBufferBinding = 0;
+	// detail level state of the camera view and the one shared
+	// by the orthographic views
+	const int g_CameraLODView = 0;
+	const int g_OrthoLODView = 1;
+	const int g_LODViewCount = 2;
+	const char* g_UseClusteredLightsName = "bUseClusteredLights";
+	const char* g_ClusterDepthParamsName = "clusterDepthParams";
+	const char* g_ClusterTileScaleName = "clusterTileScale";
+	const char* g_UseShadowsName = "bUseShadows";
+	const char* g_ShadowMapName = "shadowMap";
+	const char* g_CascadeCountName = "cascadeCount";
+	const char* g_CascadeSplitsName = "cascadeSplits";
+	const char* g_LightSpaceMatrixName = "lightSpaceMatrices";
+	const char* g_PointShadowAtlasName = "pointShadowAtlas";
+	const char* g_LightmapTextureName = "lightmapTexture";
+	const char* g_LightmapRectName = "lightmapRect";
+	const char* g_AmbientOcclusionTextureName = "ambientOcclusionTexture";
+	const char* g_UseAmbientOcclusionName = "bUseAmbientOcclusion";
+	const char* g_TransparentPassName = "bTransparentPass";
 }
 
 /***********************************************************
@@ -51,6 +77,56 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	m_lodMeshes = new LODMeshes();
+	m_pThreadPool = new ThreadPool();
+	m_pRenderQueue = new RenderQueue(m_pThreadPool->GetThreadCount());
+	m_pLightManager = new LightManager(pShaderManager);
+	m_pLightClusters = new LightClusters(m_pThreadPool);
+	m_pShadowCascades = new ShadowCascades();
+	m_bUseShadows = false;
+	m_bReuseShadowMaps = false;
+	m_shadowTextureUnit = 0;
+	m_pPointShadows = new PointShadowAtlas();
+	m_bUsePointShadows = false;
+	m_pointShadowTextureUnit = 0;
+	m_pLightmapMeshes = new LightmapMeshes();
+	m_bUseLightmaps = false;
+	m_lightmapTextureID = 0;
+	m_lightmapTextureUnit = 0;
+	m_pAmbientOcclusion = new AmbientOcclusion();
+	m_bUseAmbientOcclusion = false;
+	m_ambientOcclusionTextureUnit = 0;
+	m_pDepthPrepass = new DepthPrepass();
+	m_bUseDepthPrepass = false;
+	m_bShowOverdraw = false;
+	m_pDeferredRenderer = new DeferredRenderer();
+	m_renderPipeline = PIPELINE_FORWARD;
+	m_pTransparency = new WeightedTransparency();
+	m_bUseTransparency = false;
+	m_bAddGlassTestObject = false;
+	m_pPermutations = new ShaderPermutations();
+	m_pProgramCache = NULL;
+	m_framePermutation = 0;
+	m_pSubmitQueue = NULL;
+	m_submitView = -1;
+	m_bTransparentPass = false;
+	m_pObjectBuffer = new PersistentRingBuffer();
+	m_bUseObjectBuffer = false;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewportHeight = 0;
+	m_detailScale = 1.0f;
+	m_renderScale = glm::vec2(1.0f, 1.0f);
+	for (int i = 0; i < 6; i++)
+	{
+		m_frustumPlanes[i] = glm::vec4(0.0f);
+	}
+	m_orthoViewCount = 0;
+	m_orthoPixelScale = 0.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		m_layoutViewport[i] = 0;
+	}
 }
 
 /***********************************************************
@@ -63,6 +139,41 @@ SceneManager::~SceneManager()
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_lodMeshes;
+	m_lodMeshes = NULL;
+	delete m_pLightManager;
+	m_pLightManager = NULL;
+	delete m_pLightClusters;
+	m_pLightClusters = NULL;
+	delete m_pShadowCascades;
+	m_pShadowCascades = NULL;
+	delete m_pPointShadows;
+	m_pPointShadows = NULL;
+	delete m_pLightmapMeshes;
+	m_pLightmapMeshes = NULL;
+	if (m_lightmapTextureID != 0)
+	{
+		glDeleteTextures(1, &m_lightmapTextureID);
+		m_lightmapTextureID = 0;
+	}
+	delete m_pAmbientOcclusion;
+	m_pAmbientOcclusion = NULL;
+	delete m_pDepthPrepass;
+	m_pDepthPrepass = NULL;
+	delete m_pDeferredRenderer;
+	m_pDeferredRenderer = NULL;
+	delete m_pTransparency;
+	m_pTransparency = NULL;
+	delete m_pPermutations;
+	m_pPermutations = NULL;
+	m_pProgramCache = NULL;
+	delete m_pThreadPool;
+	m_pThreadPool = NULL;
+	delete m_pRenderQueue;
+	m_pRenderQueue = NULL;
+	delete m_pObjectBuffer;
+	m_pObjectBuffer = NULL;
+	m_sceneObjects.clear();
 }
 
 /***********************************************************
@@ -128,6 +239,7 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		// register the loaded texture and associate it with the special tag string
 		m_textureIDs[m_loadedTextures].ID = textureID;
 		m_textureIDs[m_loadedTextures].tag = tag;
+		m_textureIDs[m_loadedTextures].bHasAlpha = (colorChannels == 4);
 		m_loadedTextures++;
 
 		return true;
@@ -255,12 +367,38 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  FindMaterialIndex()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for getting the index of a previously
+ *  defined material that is associated with the passed in tag.
  ***********************************************************/
-void SceneManager::SetTransformations(
+int SceneManager::FindMaterialIndex(std::string tag)
+{
+	int materialIndex = -1;
+	int index = 0;
+	bool bFound = false;
+
+	while ((index < (int)m_objectMaterials.size()) && (bFound == false))
+	{
+		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		{
+			materialIndex = index;
+			bFound = true;
+		}
+		else
+			index++;
+	}
+
+	return(materialIndex);
+}
+
+/***********************************************************
+ *  CalculateModelMatrix()
+ *
+ *  This method is used for calculating the model matrix
+ *  from the passed in transformation values.
+ ***********************************************************/
+glm::mat4 SceneManager::CalculateModelMatrix(
 	glm::vec3 scaleXYZ,
 	float XrotationDegrees,
 	float YrotationDegrees,
@@ -268,7 +406,6 @@ void SceneManager::SetTransformations(
 	glm::vec3 positionXYZ)
 {
 	// variables for this method
-	glm::mat4 modelView;
 	glm::mat4 scale;
 	glm::mat4 rotationX;
 	glm::mat4 rotationY;
@@ -284,7 +421,31 @@ void SceneManager::SetTransformations(
 	// set the translation value in the transform buffer
 	translation = glm::translate(positionXYZ);
 
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	return(translation * rotationZ * rotationY * rotationX * scale);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 modelView;
+
+	modelView = CalculateModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
 
 	if (NULL != m_pShaderManager)
 	{
@@ -376,1085 +537,2718 @@ void SceneManager::SetShaderMaterial(
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
-void SceneManager::LoadSceneTextures()
+/***********************************************************
+ *  SetViewParameters()
+ *
+ *  This method is used for setting the camera matrices and
+ *  viewport height used for culling the scene objects and
+ *  choosing mesh detail levels.
+ ***********************************************************/
+void SceneManager::SetViewParameters(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	int viewportHeight)
 {
-		bool bReturn = false;
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+	m_viewportHeight = viewportHeight;
 
-		bReturn = CreateGLTexture(
-			"textures/Floor.jpg",
-			"floor");
+	ExtractFrustumPlanes(projection * view, m_frustumPlanes);
+}
 
-		bReturn = CreateGLTexture(
-			"textures/Leg.jpg",
-			"leg");
+/***********************************************************
+ *  SetOrthoViews()
+ *
+ *  This method is used for setting the orthographic views
+ *  that are recorded with the camera view.  An object is
+ *  recorded once for all of them when any of them sees it,
+ *  and its detail level is chosen for the largest of them,
+ *  since the size of an orthographic view does not change
+ *  with distance.  The views share the viewport height of
+ *  the camera view.
+ ***********************************************************/
+void SceneManager::SetOrthoViews(
+	int viewCount,
+	const glm::mat4* pViews,
+	const glm::mat4* pProjections)
+{
+	m_orthoViewCount = glm::clamp(viewCount, 0, RenderQueue::MAX_ORTHO_VIEWS);
+	m_orthoPixelScale = 0.0f;
 
-		bReturn = CreateGLTexture(
-			"textures/Tabletop.jpg",
-			"tabletop");
+	for (int i = 0; i < m_orthoViewCount; i++)
+	{
+		m_orthoViews[i] = pViews[i];
+		m_orthoProjections[i] = pProjections[i];
+		ExtractFrustumPlanes(pProjections[i] * pViews[i], m_orthoFrustumPlanes[i]);
+		m_orthoPixelScale = glm::max(m_orthoPixelScale, pProjections[i][1][1] * (float)m_viewportHeight);
+	}
+}
 
-		bReturn = CreateGLTexture(
-			"textures/Plate.jpg",
-			"plate");
+/***********************************************************
+ *  ExtractFrustumPlanes()
+ *
+ *  This method is used for extracting the frustum planes
+ *  from the rows of a combined matrix - left, right, bottom,
+ *  top, near and far.  It works the same for perspective
+ *  and orthographic projections.
+ ***********************************************************/
+void SceneManager::ExtractFrustumPlanes(
+	const glm::mat4& viewProjection,
+	glm::vec4* pPlanes)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			float sign = (side == 0) ? 1.0f : -1.0f;
+			glm::vec4 plane;
+			for (int column = 0; column < 4; column++)
+			{
+				plane[column] = viewProjection[column][3] + sign * viewProjection[column][i];
+			}
+			pPlanes[i * 2 + side] = plane / glm::length(glm::vec3(plane));
+		}
+	}
+}
 
-		bReturn = CreateGLTexture(
-			"textures/Mug.jpg",
-			"mug");
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object to the scene.
+ *  The texture and material tags are looked up once here
+ *  instead of on every frame, and the object is classified
+ *  as transparent when its color or its texture has alpha.
+ ***********************************************************/
+void SceneManager::AddSceneObject(
+	SCENE_MESH mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	glm::vec4 color,
+	std::string textureTag,
+	std::string materialTag)
+{
+	SCENE_OBJECT object;
 
-		
+	object.mesh = mesh;
+	object.color = color;
+	object.textureSlot = -1;
+	object.materialIndex = -1;
 
-	BindGLTextures();
+	if (textureTag.length() > 0)
+	{
+		object.textureSlot = FindTextureSlot(textureTag);
+	}
+	if (materialTag.length() > 0)
+	{
+		object.materialIndex = FindMaterialIndex(materialTag);
+	}
+	object.bTransparent = (color.a < 1.0f) ||
+		((object.textureSlot >= 0) && m_textureIDs[object.textureSlot].bHasAlpha);
+
+	m_sceneObjects.push_back(object);
+
+	m_objectTransforms.scaleX.push_back(scaleXYZ.x);
+	m_objectTransforms.scaleY.push_back(scaleXYZ.y);
+	m_objectTransforms.scaleZ.push_back(scaleXYZ.z);
+	m_objectTransforms.rotationX.push_back(XrotationDegrees);
+	m_objectTransforms.rotationY.push_back(YrotationDegrees);
+	m_objectTransforms.rotationZ.push_back(ZrotationDegrees);
+	m_objectTransforms.positionX.push_back(positionXYZ.x);
+	m_objectTransforms.positionY.push_back(positionXYZ.y);
+	m_objectTransforms.positionZ.push_back(positionXYZ.z);
+	m_modelMatrices.push_back(glm::mat4(1.0f));
+	m_objectBounds.push_back(glm::vec4(0.0f));
 }
 
-void SceneManager::DefineObjectMaterials() {
-	OBJECT_MATERIAL gravelMaterial;
-
-	gravelMaterial.diffuseColor = glm::vec3(0.502f, 0.502f, 0.502f);
-	gravelMaterial.specularColor = glm::vec3(0.502f, 0.502f, 0.502f); //will project more of a grayish hue
-	gravelMaterial.shininess = 20.0;
-	gravelMaterial.tag = "gravel";
-	m_objectMaterials.push_back(gravelMaterial);
-
-	OBJECT_MATERIAL metalMaterial;
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the object space bounding
+ *  sphere of the passed in basic shape.
+ ***********************************************************/
+void SceneManager::GetMeshBounds(
+	int mesh,
+	glm::vec3& center,
+	float& radius)
+{
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		center = glm::vec3(0.0f, 0.0f, 0.0f);
+		radius = 1.415f;
+		break;
+	case MESH_CYLINDER:
+	case MESH_TAPERED_CYLINDER:
+		center = glm::vec3(0.0f, 0.5f, 0.0f);
+		radius = 1.118f;
+		break;
+	case MESH_TORUS:
+		center = glm::vec3(0.0f, 0.0f, 0.0f);
+		radius = 1.1f;
+		break;
+	case MESH_BOX:
+	default:
+		center = glm::vec3(0.0f, 0.0f, 0.0f);
+		radius = 0.866f;
+		break;
+	}
+}
 
-	metalMaterial.diffuseColor = glm::vec3(0.0f, 0.0f, 0.0f);
-	metalMaterial.specularColor = glm::vec3(0.78f, 0.78f, 0.78f); //projects more of a white-gray hue
-	metalMaterial.shininess = 85.0; //determines the strength of the specular color
-	metalMaterial.tag = "metal";
-	m_objectMaterials.push_back(metalMaterial);
+/***********************************************************
+ *  IsSphereVisible()
+ *
+ *  This method is used for testing whether a world space
+ *  bounding sphere is at least partly inside a frustum.
+ ***********************************************************/
+bool SceneManager::IsSphereVisible(
+	const glm::vec4* pPlanes,
+	glm::vec3 center,
+	float radius)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = pPlanes[i];
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+		{
+			return(false);
+		}
+	}
 
-	OBJECT_MATERIAL woodMaterial;
+	return(true);
+}
 
-	woodMaterial.diffuseColor = glm::vec3(0.3f, 0.25f, 0.24f);
-	woodMaterial.specularColor = glm::vec3(0.66f, 0.26f, 0.18f); //should project more of a reddish brown hue
-	woodMaterial.shininess = 80.0;
-	woodMaterial.tag = "wood";
-	m_objectMaterials.push_back(woodMaterial);
+/***********************************************************
+ *  SelectMeshLOD()
+ *
+ *  This method is used for choosing the detail level of the
+ *  indexed object from the projected height in pixels of its
+ *  world space bounding sphere.
+ ***********************************************************/
+int SceneManager::SelectMeshLOD(
+	int objectIndex,
+	glm::vec3 center,
+	float radius)
+{
+	if (m_viewportHeight <= 0)
+	{
+		return(0);
+	}
 
-	OBJECT_MATERIAL porcelainMaterial;
+	glm::vec3 viewCenter = glm::vec3(m_viewMatrix * glm::vec4(center, 1.0f));
 
-	porcelainMaterial.diffuseColor = glm::vec3(0.96f, 0.96f, 0.96f);
-	porcelainMaterial.specularColor = glm::vec3(0.78f, 0.78f, 0.78f);
-	porcelainMaterial.shininess = 80.0;
-	porcelainMaterial.tag = "porcelain";
-	m_objectMaterials.push_back(porcelainMaterial);
+	// orthographic projections do not shrink with distance
+	float projectedRadius = radius * m_projectionMatrix[1][1];
+	if (m_projectionMatrix[3][3] == 0.0f)
+	{
+		float distance = -viewCenter.z;
+		if (distance <= radius)
+		{
+			return(m_lodMeshes->SelectLevel(objectIndex, (float)m_viewportHeight, g_CameraLODView));
+		}
+		projectedRadius /= distance;
+	}
 
-	OBJECT_MATERIAL glassMaterial;
+	// the projected radius is in normalized device units, which
+	// span two units across the viewport height
+	float projectedPixels = projectedRadius * (float)m_viewportHeight * m_detailScale;
 
-	glassMaterial.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
-	glassMaterial.specularColor = glm::vec3(0.21f, 0.21f, 0.21f);
-	glassMaterial.shininess = 95.0;
-	glassMaterial.tag = "glass";
-	m_objectMaterials.push_back(glassMaterial);
+	return(m_lodMeshes->SelectLevel(objectIndex, projectedPixels, g_CameraLODView));
 }
 
-void SceneManager::SetupSceneLights() {
-	m_pShaderManager->setVec3Value("directionalLight.direction", -6.0f, 5.0f, 5.0f); //creates a light that lights up the entire scene in a bright but slightly dim light
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.6f, 0.6f, 0.6f);
-	m_pShaderManager->setVec3Value("directionalLight.specular", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
-
-
-	m_pShaderManager->setVec3Value("pointLights[0].position", 0.0f, 15.0f, -8.0f); //creates a light that shines above the table
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.03f, 0.03f, 0.0f); //projects a constant dim yellow color
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.4f, 0.4f, 0.0f); //makes the light project yellow color
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 1.0f, 1.0f, 0.0f);
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+/***********************************************************
+ *  RecordDrawCommands()
+ *
+ *  This method is used for calculating the model matrices of
+ *  the objects [begin, end) as one batch, then culling them,
+ *  choosing their detail levels and recording a draw command
+ *  for each visible one.  Objects that cast into a shadow
+ *  cascade are also recorded as shadow casters; the ones
+ *  only seen by the light use the coarsest detail level.
+ *  Objects seen by any orthographic view are recorded once
+ *  more into the list those views share.  It runs on the
+ *  worker threads and must not make any OpenGL calls.
+ ***********************************************************/
+void SceneManager::RecordDrawCommands(
+	int begin,
+	int end,
+	RenderQueue* pQueue,
+	int threadIndex)
+{
+	std::vector<RenderQueue::DRAW_COMMAND>& commands = pQueue->GetThreadList(threadIndex);
+	std::vector<RenderQueue::DRAW_COMMAND>& shadowCommands = pQueue->GetShadowThreadList(threadIndex);
+	std::vector<RenderQueue::DRAW_COMMAND>& transparentCommands = pQueue->GetTransparentThreadList(threadIndex);
+	std::vector<RenderQueue::DRAW_COMMAND>& orthoCommands = pQueue->GetOrthoThreadList(threadIndex);
+	std::vector<RenderQueue::DRAW_COMMAND>& orthoTransparentCommands = pQueue->GetOrthoTransparentThreadList(threadIndex);
+	const ShadowCascades::SHADOW_FRAME& shadowFrame = pQueue->GetShadowFrame();
+
+	TRANSFORM_STREAMS streams;
+	streams.scaleX = m_objectTransforms.scaleX.data() + begin;
+	streams.scaleY = m_objectTransforms.scaleY.data() + begin;
+	streams.scaleZ = m_objectTransforms.scaleZ.data() + begin;
+	streams.rotationX = m_objectTransforms.rotationX.data() + begin;
+	streams.rotationY = m_objectTransforms.rotationY.data() + begin;
+	streams.rotationZ = m_objectTransforms.rotationZ.data() + begin;
+	streams.positionX = m_objectTransforms.positionX.data() + begin;
+	streams.positionY = m_objectTransforms.positionY.data() + begin;
+	streams.positionZ = m_objectTransforms.positionZ.data() + begin;
+	ComposeTransforms(streams, end - begin, m_modelMatrices.data() + begin);
+
+	for (int i = begin; i < end; i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		RenderQueue::DRAW_COMMAND command;
+		glm::vec3 localCenter;
+		float localRadius = 0.0f;
+
+		command.model = m_modelMatrices[i];
+
+		// transform the bounding sphere into world space - the
+		// radius grows by the largest axis scale
+		GetMeshBounds(object.mesh, localCenter, localRadius);
+		glm::vec3 center = glm::vec3(command.model * glm::vec4(localCenter, 1.0f));
+		float maxScale = glm::max(
+			glm::length(glm::vec3(command.model[0])),
+			glm::max(glm::length(glm::vec3(command.model[1])), glm::length(glm::vec3(command.model[2]))));
+		float radius = localRadius * maxScale;
+		m_objectBounds[i] = glm::vec4(center, radius);
+
+		bool bVisible = IsSphereVisible(m_frustumPlanes, center, radius);
+		bool bOrthoVisible = false;
+		for (int view = 0; (view < m_orthoViewCount) && !bOrthoVisible; view++)
+		{
+			bOrthoVisible = IsSphereVisible(m_orthoFrustumPlanes[view], center, radius);
+		}
+		command.shadowMask = 0;
+		if (shadowFrame.cascadeCount > 0)
+		{
+			command.shadowMask = ShadowCascades::GetCasterMask(shadowFrame, center, radius);
+		}
+		if ((bVisible == false) && (command.shadowMask == 0) && (bOrthoVisible == false))
+		{
+			continue;
+		}
 
+		bool bDetailLevels = (object.mesh == MESH_CYLINDER) ||
+			(object.mesh == MESH_TAPERED_CYLINDER) ||
+			(object.mesh == MESH_TORUS);
+		command.lodLevel = 0;
+		if (bDetailLevels)
+		{
+			command.lodLevel = bVisible ?
+				SelectMeshLOD(i, center, radius) : LODMeshes::LOD_LEVEL_COUNT - 1;
+		}
 
-	m_pShaderManager->setVec3Value("pointLights[1].position", 5.0f, 0.0f, 10.0f); //creates a light that shines to the right of the table
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.00f, 0.00f, 0.0f); 
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.2f, 0.2f, 0.0f); //makes the light project yellow color
-	m_pShaderManager->setVec3Value("pointLights[1].specular", 1.0f, 1.0f, 0.0f); //makes the light appear brighter when coming in contact with an object
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+		// lightmapped objects are drawn with the unwrapped shapes,
+		// which have a single detail level
+		command.lightmapRect = glm::vec4(0.0f);
+		if (m_bUseLightmaps)
+		{
+			command.lightmapRect = m_objectLightmapRects[i];
+			if (command.lightmapRect.z > 0.0f)
+			{
+				command.lodLevel = 0;
+				bDetailLevels = false;
+			}
+		}
 
+		command.color = object.color;
+		command.textureSlot = object.textureSlot;
+		command.materialIndex = object.materialIndex;
+		command.mesh = object.mesh;
 
-	m_pShaderManager->setVec3Value("pointLights[2].position", -5.0f, 0.0f, 10.0f); //creates a light that shines to the left of the table
-	m_pShaderManager->setVec3Value("pointLights[2].ambient", 0.00f, 0.00f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].diffuse", 0.2f, 0.2f, 0.0f); //makes the light project yellow color
-	m_pShaderManager->setVec3Value("pointLights[2].specular", 1.0f, 1.0f, 0.0f); //makes the light appear brighter when coming in contact with an object
-	m_pShaderManager->setBoolValue("pointLights[2].bActive", true);
+		if (command.shadowMask != 0)
+		{
+			// shadow casters only need grouping by mesh
+			RenderQueue::DRAW_COMMAND caster = command;
+			caster.sortKey = RenderQueue::MakeSortKey(
+				0,
+				0,
+				-1,
+				-1,
+				object.mesh * LODMeshes::LOD_LEVEL_COUNT + command.lodLevel,
+				i);
+			shadowCommands.push_back(caster);
+		}
+		if (bOrthoVisible)
+		{
+			// the views look from different sides, so the shared
+			// list is only grouped by state - the transparent
+			// objects are sorted for each view when drawn
+			RenderQueue::DRAW_COMMAND orthoCommand = command;
+			if (bDetailLevels)
+			{
+				orthoCommand.lodLevel = m_lodMeshes->SelectLevel(
+					i,
+					radius * m_orthoPixelScale * m_detailScale,
+					g_OrthoLODView);
+			}
+			if (object.bTransparent)
+			{
+				orthoCommand.sortKey = RenderQueue::MakeBackToFrontKey(0.0f, i);
+				orthoTransparentCommands.push_back(orthoCommand);
+			}
+			else
+			{
+				orthoCommand.sortKey = RenderQueue::MakeSortKey(
+					(object.textureSlot >= 0) ? ShaderPermutations::PERMUTATION_TEXTURED : 0,
+					0,
+					object.textureSlot,
+					object.materialIndex,
+					object.mesh * LODMeshes::LOD_LEVEL_COUNT + orthoCommand.lodLevel,
+					i);
+				orthoCommands.push_back(orthoCommand);
+			}
+		}
+		if (bVisible == false)
+		{
+			continue;
+		}
 
-	m_pShaderManager->setBoolValue("bUseLighting", true);
+		// opaque objects go front to back by the depth of their
+		// nearest point, so the depth test rejects what they
+		// hide, and transparent ones back to front by center
+		float viewDepth = -(m_viewMatrix * glm::vec4(center, 1.0f)).z;
+		if (object.bTransparent)
+		{
+			command.sortKey = RenderQueue::MakeBackToFrontKey(viewDepth, i);
+			transparentCommands.push_back(command);
+		}
+		else
+		{
+			// only the texturing differs between the shader
+			// variants of one frame
+			command.sortKey = RenderQueue::MakeSortKey(
+				(object.textureSlot >= 0) ? ShaderPermutations::PERMUTATION_TEXTURED : 0,
+				RenderQueue::GetDepthBand(viewDepth - radius),
+				object.textureSlot,
+				object.materialIndex,
+				object.mesh * LODMeshes::LOD_LEVEL_COUNT + command.lodLevel,
+				i);
+			commands.push_back(command);
+		}
+	}
 }
 
-
-
 /***********************************************************
- *  PrepareScene()
+ *  CreateAmbientOcclusion()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for creating the ambient occlusion
+ *  targets at the size of the viewport.  The shaders sample
+ *  the occlusion of their own screen texel and scale the
+ *  ambient terms of the lighting by it:
+ *
+ *    uniform sampler2D ambientOcclusionTexture;
+ *    uniform bool bUseAmbientOcclusion;
+ *
+ *    float occlusion = bUseAmbientOcclusion ?
+ *        texelFetch(ambientOcclusionTexture, ivec2(gl_FragCoord.xy), 0).r : 1.0;
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::CreateAmbientOcclusion()
 {
-	LoadSceneTextures(); //load the textures of the scene
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
+	m_bUseAmbientOcclusion = false;
 
-	DefineObjectMaterials();
+	if (glGetUniformLocation(m_pShaderManager->m_programID, g_AmbientOcclusionTextureName) < 0)
+	{
+		return;
+	}
 
-	SetupSceneLights();
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (m_pAmbientOcclusion->Create(viewport[2], viewport[3]) == false)
+	{
+		return;
+	}
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadTorusMesh();
+	// the occlusion uses the unit after the lightmap
+	m_ambientOcclusionTextureUnit = m_loadedTextures + 3;
+	m_bUseAmbientOcclusion = true;
 }
 
 /***********************************************************
- *  RenderScene()
+ *  RenderAmbientOcclusion()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for drawing the recorded commands
+ *  into the occlusion prepass with the camera of the queue,
+ *  then binding the filtered occlusion for the scene
+ *  shaders.  Nothing is drawn while the tier is off.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::RenderAmbientOcclusion(const RenderQueue* pQueue)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	const std::vector<RenderQueue::DRAW_COMMAND>& commands = pQueue->GetCommands();
 
-	SetShaderColor(1, 1, 1, 1);
-	SetShaderTexture("floor"); //sets the plane to be a metal texture
-	// draw the mesh with transformation values
-	SetShaderMaterial("gravel");
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
-
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our table leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f; //rotates the table leg upright
-	ZrotationDegrees = 90.0f;
+	if (m_pAmbientOcclusion->GetActiveQuality() == AmbientOcclusion::AO_OFF)
+	{
+		m_pShaderManager->setBoolValue(g_UseAmbientOcclusionName, false);
+		return;
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(3.0f, 1.5f, 3.0f); //places the table leg
+	m_pAmbientOcclusion->BeginPrepass(pQueue->GetViewMatrix(), pQueue->GetProjectionMatrix());
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		m_pAmbientOcclusion->SetPrepassModel(commands[i].model);
+		DrawCommandMesh(commands[i]);
+	}
+	m_pAmbientOcclusion->EndPass();
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// back to the scene program for the occlusion uniforms
+	m_pShaderManager->use();
 
-	SetShaderColor(1, 0, 0, 1); //sets the color to red
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal"); //sets the material to metal for lighting purposes
-	m_basicMeshes->DrawBoxMesh();
+	glActiveTexture(GL_TEXTURE0 + m_ambientOcclusionTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pAmbientOcclusion->GetOcclusionTexture());
+	glActiveTexture(GL_TEXTURE0);
+	m_pShaderManager->setSampler2DValue(g_AmbientOcclusionTextureName, m_ambientOcclusionTextureUnit);
+	m_pShaderManager->setBoolValue(g_UseAmbientOcclusionName, true);
+}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our table leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f; //rotates the table leg upright
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  CreateDepthPrepass()
+ *
+ *  This method is used for creating the depth prepass.  The
+ *  lighting pass after it only shades fragments whose depth
+ *  is equal to the prepass depth, so the scene vertex shader
+ *  has to produce the very same position as the prepass:
+ *
+ *    invariant gl_Position;
+ *
+ *    gl_Position = projection * view * model * vec4(position, 1.0);
+ ***********************************************************/
+void SceneManager::CreateDepthPrepass()
+{
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_pDepthPrepass->Create(viewport[2], viewport[3]);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-3.0f, 1.5f, 3.0f); //places the table leg
+/***********************************************************
+ *  RenderDepthPrepass()
+ *
+ *  This method is used for drawing the recorded commands
+ *  into the depth buffer only, with the camera of the queue,
+ *  and leaving the equal depth test set for the lighting.
+ ***********************************************************/
+void SceneManager::RenderDepthPrepass(const RenderQueue* pQueue)
+{
+	const std::vector<RenderQueue::DRAW_COMMAND>& commands = pQueue->GetCommands();
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_pDepthPrepass->BeginPrepass(pQueue->GetViewMatrix(), pQueue->GetProjectionMatrix());
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		m_pDepthPrepass->SetModel(commands[i].model);
+		DrawCommandMesh(commands[i]);
+	}
+	m_pDepthPrepass->EndPrepass();
+}
 
-	SetShaderColor(1, 0, 0, 1); //sets the color to red
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal"); //sets the material to metal for lighting purposes
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  RenderOverdraw()
+ *
+ *  This method is used for counting the fragments that the
+ *  lighting of a queue would shade, with the depth prepass
+ *  when it is on, and drawing the counts as a heat map.
+ ***********************************************************/
+void SceneManager::RenderOverdraw(const RenderQueue* pQueue)
+{
+	const std::vector<RenderQueue::DRAW_COMMAND>& commands = pQueue->GetCommands();
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our table leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f; //rotates the table leg upright
-	ZrotationDegrees = 90.0f;
+	m_pDepthPrepass->BeginOverdraw(pQueue->GetViewMatrix(), pQueue->GetProjectionMatrix());
+	if (m_bUseDepthPrepass)
+	{
+		RenderDepthPrepass(pQueue);
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-3.0f, 1.5f, -3.0f); //places the table leg
+	m_pDepthPrepass->BeginCounting();
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		m_pDepthPrepass->SetModel(commands[i].model);
+		DrawCommandMesh(commands[i]);
+	}
+	m_pDepthPrepass->EndOverdraw(m_bUseDepthPrepass);
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  CreateDeferredRenderer()
+ *
+ *  This method is used for creating the G-buffer at the
+ *  viewport size.  Its textures use the units after the
+ *  ambient occlusion.
+ ***********************************************************/
+void SceneManager::CreateDeferredRenderer()
+{
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (m_pDeferredRenderer->Create(viewport[2], viewport[3], m_loadedTextures + 4) == false)
+	{
+		std::cout << "Deferred renderer could not be created, using forward" << std::endl;
+	}
+	BindGLTextures();
+}
 
-	SetShaderColor(1, 0, 0, 1); //sets the color to red
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal"); //sets the material to metal for lighting purposes
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  RenderDeferred()
+ *
+ *  This method is used for drawing the recorded commands
+ *  into the G-buffer with the camera of the queue, then
+ *  lighting it with the lights, cascaded shadows and
+ *  ambient occlusion of the same frame.  The point light
+ *  shadows are not applied on this path.
+ ***********************************************************/
+void SceneManager::RenderDeferred(const RenderQueue* pQueue)
+{
+	const std::vector<RenderQueue::DRAW_COMMAND>& commands = pQueue->GetCommands();
+	int currentMaterial = -2;
 
+	if (m_bUseLightmaps)
+	{
+		glActiveTexture(GL_TEXTURE0 + m_lightmapTextureUnit);
+		glBindTexture(GL_TEXTURE_2D, m_lightmapTextureID);
+		glActiveTexture(GL_TEXTURE0);
+	}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our table leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f; //rotates the table leg upright
-	ZrotationDegrees = 90.0f;
+	m_pDeferredRenderer->BeginGeometry(pQueue->GetViewMatrix(), pQueue->GetProjectionMatrix());
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const RenderQueue::DRAW_COMMAND& command = commands[i];
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(3.0f, 1.5f, -3.0f); //places the table leg
+		m_pDeferredRenderer->SetObject(command.model, command.color, command.textureSlot);
+		if ((command.materialIndex != currentMaterial) && (command.materialIndex >= 0))
+		{
+			const OBJECT_MATERIAL& material = m_objectMaterials[command.materialIndex];
+			currentMaterial = command.materialIndex;
+			m_pDeferredRenderer->SetMaterial(material.diffuseColor, material.specularColor, material.shininess);
+		}
+		if (m_bUseLightmaps)
+		{
+			m_pDeferredRenderer->SetLightmap(m_lightmapTextureUnit, command.lightmapRect);
+		}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		DrawCommandMesh(command);
+	}
+	m_pDeferredRenderer->EndGeometry();
 
-	SetShaderColor(1, 0, 0, 1); //sets the color to red
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal"); //sets the material to metal for lighting purposes
-	m_basicMeshes->DrawBoxMesh();
+	bool bOcclusion = m_bUseAmbientOcclusion &&
+		(m_pAmbientOcclusion->GetActiveQuality() != AmbientOcclusion::AO_OFF);
 
+	DeferredRenderer::LIGHTING_INPUTS inputs;
+	inputs.pLights = &pQueue->GetLights();
+	inputs.pShadowFrame = &pQueue->GetShadowFrame();
+	inputs.shadowTextureUnit = m_bUseShadows ? m_shadowTextureUnit : -1;
+	inputs.occlusionTextureUnit = bOcclusion ? m_ambientOcclusionTextureUnit : -1;
+	m_pDeferredRenderer->RenderLighting(inputs);
+}
 
-	scaleXYZ = glm::vec3(8.0f, 1.0f, 7.0f); //scales our tabletop
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f; 
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  SetRenderPipeline()
+ *
+ *  This method is used for selecting the forward or the
+ *  deferred pipeline.  The G-buffer is created the first
+ *  time deferred is selected for a prepared scene.
+ ***********************************************************/
+void SceneManager::SetRenderPipeline(RENDER_PIPELINE pipeline)
+{
+	m_renderPipeline = pipeline;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 4.5f, 0.0f); //places the tabletop
+	if ((pipeline == PIPELINE_DEFERRED) &&
+		(m_sceneObjects.empty() == false) &&
+		(m_pDeferredRenderer->IsValid() == false))
+	{
+		CreateDeferredRenderer();
+	}
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  SetShaderFiles()
+ *
+ *  This method is used for setting where the specialized
+ *  variants of the scene program are built from.
+ ***********************************************************/
+void SceneManager::SetShaderFiles(
+	ProgramCache* pProgramCache,
+	const char* vertexPath,
+	const char* fragmentPath)
+{
+	m_pProgramCache = pProgramCache;
+	m_vertexShaderPath = vertexPath;
+	m_fragmentShaderPath = fragmentPath;
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("tabletop"); //applies a wood texture
-	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  OnProgramReloaded()
+ *
+ *  This method is used for restoring the state of a scene
+ *  program that replaced the one the scene was prepared
+ *  with.  The samplers and switches set each frame follow
+ *  by themselves, the ones set while preparing are set
+ *  here.  A feature the old program did not declare stays
+ *  off until the next start.
+ ***********************************************************/
+void SceneManager::OnProgramReloaded(ShaderPermutations& permutations)
+{
+	m_pShaderManager->use();
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+	if (m_bUseShadows)
+	{
+		m_pShaderManager->setBoolValue(g_UseShadowsName, true);
+	}
+	if (m_bUseLightmaps)
+	{
+		m_pShaderManager->setSampler2DValue(g_LightmapTextureName, m_lightmapTextureUnit);
+	}
+	if (m_pLightManager->IsBufferEnabled() && m_pLightClusters->IsEnabled())
+	{
+		m_pShaderManager->setBoolValue(g_UseClusteredLightsName, true);
+	}
+	if (m_bUseTransparency)
+	{
+		m_pShaderManager->setBoolValue(g_TransparentPassName, false);
+	}
+	m_pShaderManager->setBoolValue("bUseLighting", true);
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(8.0f, 1.0f, 2.0f); //places the chair leg
+	// the fixed light uniforms are uploaded with the next frame
+	m_pLightManager->MarkAllDirty();
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// the variants were built from the changed files along
+	// with the program
+	m_pPermutations->TakeVariants(permutations);
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  ResizeTargets()
+ *
+ *  This method is used for creating the targets of the
+ *  screen space passes again at a new size.  Only the ones
+ *  that were created while preparing the scene are resized,
+ *  and a target that can not be created at the new size
+ *  turns its feature off.
+ ***********************************************************/
+void SceneManager::ResizeTargets(int width, int height)
+{
+	if ((width <= 0) || (height <= 0))
+	{
+		return;
+	}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+	if (m_bUseAmbientOcclusion && (m_pAmbientOcclusion->Create(width, height) == false))
+	{
+		m_bUseAmbientOcclusion = false;
+		m_pShaderManager->setBoolValue(g_UseAmbientOcclusionName, false);
+	}
+	if (m_pDepthPrepass->IsValid())
+	{
+		m_pDepthPrepass->Create(width, height);
+	}
+	if (m_pDeferredRenderer->IsValid() &&
+		(m_pDeferredRenderer->Create(width, height, m_loadedTextures + 4) == false))
+	{
+		std::cout << "Deferred renderer could not be resized, using forward" << std::endl;
+	}
+	if (m_bUseTransparency && (m_pTransparency->Create(width, height, m_loadedTextures + 10) == false))
+	{
+		m_bUseTransparency = false;
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(2.0f, 1.0f, 2.0f); //places the chair leg
+	// creating the targets unbinds the scene texture of the
+	// active unit
+	BindGLTextures();
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  BenchmarkPipelines()
+ *
+ *  This method is used for timing a frame of each pipeline
+ *  with more and more point lights spread over the scene.
+ *  Both record the same queue and are timed from the first
+ *  draw to glFinish(), so only the GPU work and its submit
+ *  cost are compared.  The shadow cascades are rendered
+ *  once in the warm-up of each pipeline and then reused,
+ *  leaving the lighting as the timed work.  The deferred
+ *  lighting has no point light shadows, so they are off
+ *  for both pipelines.  The lights are placed the same way
+ *  every run.
+ ***********************************************************/
+void SceneManager::BenchmarkPipelines(
+	const std::vector<int>& lightCounts,
+	int frameCount)
+{
+	// frames rendered before timing, to settle the drivers
+	// and the ambient occlusion tier
+	const int warmupFrames = 60;
+	const RENDER_PIPELINE pipelines[2] = { PIPELINE_FORWARD, PIPELINE_DEFERRED };
+	RENDER_PIPELINE savedPipeline = m_renderPipeline;
+	bool bUsePointShadows = m_bUsePointShadows;
+
+	// no light gets an atlas slot, so the forward shading
+	// does not sample the atlas either
+	m_bUsePointShadows = false;
+
+	glm::vec3 sceneCenter;
+	float sceneRadius = 0.0f;
+	CalculateSceneBounds(sceneCenter, sceneRadius);
+
+	int maximumCount = 0;
+	for (size_t i = 0; i < lightCounts.size(); i++)
+	{
+		maximumCount = glm::max(maximumCount, lightCounts[i]);
+	}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	// small colored lights, so that each one only covers part
+	// of the scene as in a real light-heavy scene
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::vector<int> lightIndices;
+	for (int i = 0; i < maximumCount; i++)
+	{
+		glm::vec3 offset(unit(random) * 2.0f - 1.0f, unit(random), unit(random) * 2.0f - 1.0f);
+		glm::vec3 color(unit(random), unit(random), unit(random));
+		lightIndices.push_back(m_pLightManager->AddPointLight(
+			sceneCenter + offset * sceneRadius * 0.5f,
+			glm::vec3(0.0f),
+			color,
+			color * 0.5f,
+			sceneRadius * 0.25f));
+	}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+	std::cout << "Lights\tForward ms\tDeferred ms" << std::endl;
+	for (size_t count = 0; count < lightCounts.size(); count++)
+	{
+		for (int i = 0; i < maximumCount; i++)
+		{
+			m_pLightManager->SetLightEnabled(lightIndices[i], i < lightCounts[count]);
+		}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(8.0f, 5.0f, 2.0f); //places the chair leg
+		double milliseconds[2] = { 0.0, 0.0 };
+		for (int pipeline = 0; pipeline < 2; pipeline++)
+		{
+			SetRenderPipeline(pipelines[pipeline]);
+			if ((pipelines[pipeline] == PIPELINE_DEFERRED) && (m_pDeferredRenderer->IsValid() == false))
+			{
+				milliseconds[pipeline] = -1.0;
+				continue;
+			}
+
+			RecordScene(m_pRenderQueue);
+			for (int frame = 0; frame < warmupFrames; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				SubmitScene(m_pRenderQueue);
+
+				// the cascades of the first frame stay bound, so
+				// the later frames only time the lighting
+				m_bReuseShadowMaps = true;
+			}
+			glFinish();
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < frameCount; frame++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				SubmitScene(m_pRenderQueue);
+			}
+			glFinish();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			milliseconds[pipeline] = elapsed.count() / frameCount;
+			m_bReuseShadowMaps = false;
+		}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		std::cout << lightCounts[count] << "\t" << milliseconds[0] << "\t\t" << milliseconds[1] << std::endl;
+	}
+
+	m_bUsePointShadows = bUsePointShadows;
+	SetRenderPipeline(savedPipeline);
+}
+
+/***********************************************************
+ *  SetAmbientOcclusionQuality()
+ *
+ *  This method is used for setting the highest tier of the
+ *  ambient occlusion.  The budget may lower the tier in use.
+ ***********************************************************/
+void SceneManager::SetAmbientOcclusionQuality(AmbientOcclusion::AO_QUALITY quality)
+{
+	m_pAmbientOcclusion->SetQuality(quality);
+}
+
+/***********************************************************
+ *  SetAmbientOcclusionBudget()
+ *
+ *  This method is used for setting the GPU time the ambient
+ *  occlusion may take each frame.
+ ***********************************************************/
+void SceneManager::SetAmbientOcclusionBudget(float milliseconds)
+{
+	m_pAmbientOcclusion->SetBudget(milliseconds);
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  GetAmbientOcclusionQuality()
+ *
+ *  This method is used for getting the highest tier of the
+ *  ambient occlusion.
+ ***********************************************************/
+AmbientOcclusion::AO_QUALITY SceneManager::GetAmbientOcclusionQuality() const
+{
+	return(m_pAmbientOcclusion->GetQuality());
+}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  CreateObjectBuffer()
+ *
+ *  This method is used for creating the triple-buffered object
+ *  buffer, sized for every scene object being drawn.  It is
+ *  only used when the vertex shader declares the block
+ *
+ *    struct ObjectData { mat4 model; vec4 color; };
+ *    layout(std430, binding = 0) buffer ObjectBuffer
+ *    {
+ *        ObjectData objects[];
+ *    };
+ *    uniform int objectIndex;
+ *
+ *  otherwise the model and color uniforms are set per draw.
+ ***********************************************************/
+void SceneManager::CreateObjectBuffer()
+{
+	m_bUseObjectBuffer = false;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(2.0f, 1.0f, -2.0f); //places the chair leg
+	if ((NULL == m_pShaderManager) || (m_sceneObjects.size() == 0))
+	{
+		return;
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// shader storage blocks need OpenGL 4.3
+	if (!GLEW_VERSION_4_3)
+	{
+		return;
+	}
+	GLuint blockIndex = glGetProgramResourceIndex(
+		m_pShaderManager->m_programID,
+		GL_SHADER_STORAGE_BLOCK,
+		g_ObjectBufferName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return;
+	}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	// every object may be in the camera view and in the list
+	// shared by the orthographic views
+	m_bUseObjectBuffer = m_pObjectBuffer->Create(
+		GL_SHADER_STORAGE_BUFFER,
+		2 * m_sceneObjects.size() * sizeof(OBJECT_DATA));
+}
+
+/***********************************************************
+ *  SetShadowQuality()
+ *
+ *  This method is used for setting the resolution of the
+ *  shadow maps and the number of cascades, trading shadow
+ *  detail against frame time.
+ ***********************************************************/
+void SceneManager::SetShadowQuality(int resolution, int cascadeCount)
+{
+	m_pShadowCascades->SetQuality(resolution, cascadeCount);
+}
+
+/***********************************************************
+ *  SetPointShadowQuality()
+ *
+ *  This method is used for setting the size of the point
+ *  light shadow atlas and its face tiles, and how many light
+ *  shadows may be rendered again in one frame.
+ ***********************************************************/
+void SceneManager::SetPointShadowQuality(int atlasSize, int tileSize, int updatesPerFrame)
+{
+	m_pPointShadows->SetQuality(atlasSize, tileSize, updatesPerFrame);
+}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  MoveSceneObject()
+ *
+ *  This method is used for moving an object to a new
+ *  position.  The move is queued and applied at the start
+ *  of the next update, so it never changes an object while
+ *  a frame is being recorded.
+ ***********************************************************/
+void SceneManager::MoveSceneObject(int objectIndex, glm::vec3 positionXYZ)
+{
+	OBJECT_MOVE move;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(8.0f, 1.0f, -2.0f); //places the chair leg
+	move.objectIndex = objectIndex;
+	move.positionXYZ = positionXYZ;
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	std::lock_guard<std::mutex> lock(m_moveMutex);
+	m_pendingMoves.push_back(move);
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  ApplyObjectMoves()
+ *
+ *  This method is used for applying the queued object moves.
+ *  The point light shadows around the old places of the
+ *  objects are marked for rendering again.
+ ***********************************************************/
+void SceneManager::ApplyObjectMoves()
+{
+	std::lock_guard<std::mutex> lock(m_moveMutex);
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+	for (size_t i = 0; i < m_pendingMoves.size(); i++)
+	{
+		const OBJECT_MOVE& move = m_pendingMoves[i];
+		int index = move.objectIndex;
+		if ((index < 0) || (index >= (int)m_sceneObjects.size()))
+		{
+			continue;
+		}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(8.0f, 5.0f, -2.0f); //places the chair leg
+		const glm::vec4& bounds = m_objectBounds[index];
+		m_pPointShadows->InvalidateSphere(glm::vec3(bounds), bounds.w);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		m_objectTransforms.positionX[index] = move.positionXYZ.x;
+		m_objectTransforms.positionY[index] = move.positionXYZ.y;
+		m_objectTransforms.positionZ[index] = move.positionXYZ.z;
+		m_movedObjects.push_back(index);
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+		// the baked light no longer fits a moved object, so it
+		// is lit at runtime from now on
+		if (index < (int)m_objectLightmapRects.size())
+		{
+			m_objectLightmapRects[index] = glm::vec4(0.0f);
+		}
+	}
+	m_pendingMoves.clear();
+}
 
-	scaleXYZ = glm::vec3(6.0f, 0.3f, 0.3f); //scales our chair guard
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  CreatePointShadows()
+ *
+ *  This method is used for creating the point light shadow
+ *  atlas.  The shadow slots are passed to the shaders in
+ *  the light buffer, so the shaders have to read their
+ *  lights from it.
+ ***********************************************************/
+void SceneManager::CreatePointShadows()
+{
+	m_bUsePointShadows = false;
+
+	if (m_pLightManager->IsBufferEnabled() == false)
+	{
+		return;
+	}
+	if (m_pPointShadows->Create(m_pShaderManager->m_programID) == false)
+	{
+		return;
+	}
+
+	// the atlas uses the unit after the cascaded shadow maps
+	m_pointShadowTextureUnit = m_loadedTextures + 1;
+	m_bUsePointShadows = true;
+}
+
+/***********************************************************
+ *  RecordPointShadows()
+ *
+ *  This method is used for scheduling the point light shadows
+ *  that are rendered with the queue and recording the
+ *  objects inside each of their cube faces.
+ ***********************************************************/
+void SceneManager::RecordPointShadows(RenderQueue* pQueue)
+{
+	PointShadowAtlas::SHADOW_FRAME& frame = pQueue->GetPointShadowFrame();
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(m_viewMatrix)[3]);
+
+	m_pPointShadows->ScheduleUpdates(m_frameLights, cameraPosition, frame);
+
+	for (size_t update = 0; update < frame.updates.size(); update++)
+	{
+		for (size_t i = 0; i < m_sceneObjects.size(); i++)
+		{
+			const glm::vec4& bounds = m_objectBounds[i];
+			unsigned int faceMask = PointShadowAtlas::GetFaceMask(
+				frame.updates[update],
+				glm::vec3(bounds),
+				bounds.w);
+			if (faceMask == 0)
+			{
+				continue;
+			}
+
+			// cached shadows are seen for many frames, so the
+			// casters are always drawn at full detail
+			PointShadowAtlas::SHADOW_CASTER caster;
+			caster.model = m_modelMatrices[i];
+			caster.mesh = m_sceneObjects[i].mesh;
+			caster.lodLevel = 0;
+			caster.updateIndex = (int)update;
+			caster.faceMask = faceMask;
+			frame.casters.push_back(caster);
+		}
+	}
+}
+
+/***********************************************************
+ *  RenderPointShadows()
+ *
+ *  This method is used for rendering the scheduled point
+ *  light shadows into their atlas tiles and binding the
+ *  atlas for the scene shaders.  Lights without an update
+ *  keep the shadow rendered in an earlier frame.  The slot
+ *  changes of the queue are passed to the light manager
+ *  here, so the lights never point at tiles that have not
+ *  been rendered yet.
+ ***********************************************************/
+void SceneManager::RenderPointShadows(const RenderQueue* pQueue)
+{
+	const PointShadowAtlas::SHADOW_FRAME& frame = pQueue->GetPointShadowFrame();
+	size_t firstCaster = 0;
+
+	for (size_t update = 0; update < frame.updates.size(); update++)
+	{
+		// the casters of each update are recorded together
+		size_t lastCaster = firstCaster;
+		while ((lastCaster < frame.casters.size()) &&
+			(frame.casters[lastCaster].updateIndex == (int)update))
+		{
+			lastCaster++;
+		}
+
+		for (int face = 0; face < PointShadowAtlas::FACE_COUNT; face++)
+		{
+			unsigned int faceBit = 1u << face;
+
+			m_pPointShadows->BeginFace(frame.updates[update], face);
+			for (size_t i = firstCaster; i < lastCaster; i++)
+			{
+				if (frame.casters[i].faceMask & faceBit)
+				{
+					m_pPointShadows->SetCasterModel(frame.casters[i].model);
+					DrawSceneMesh(frame.casters[i].mesh, frame.casters[i].lodLevel);
+				}
+			}
+		}
+		firstCaster = lastCaster;
+	}
+	m_pPointShadows->EndPass(frame);
+
+	for (size_t i = 0; i < frame.slotChanges.size(); i++)
+	{
+		m_pLightManager->SetShadowSlot(
+			frame.slotChanges[i].lightIndex,
+			frame.slotChanges[i].slot);
+	}
+
+	if (frame.updates.size() > 0)
+	{
+		m_pShaderManager->use();
+	}
+
+	glActiveTexture(GL_TEXTURE0 + m_pointShadowTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pPointShadows->GetDepthTexture());
+	glActiveTexture(GL_TEXTURE0);
+	m_pShaderManager->setSampler2DValue(g_PointShadowAtlasName, m_pointShadowTextureUnit);
+	m_pPointShadows->BindShadowData();
+}
+
+/***********************************************************
+ *  CalculateSceneBounds()
+ *
+ *  This method is used for calculating a sphere around the
+ *  world space bounds of every scene object.
+ ***********************************************************/
+void SceneManager::CalculateSceneBounds(
+	glm::vec3& center,
+	float& radius)
+{
+	int objectCount = (int)m_sceneObjects.size();
+	glm::vec3 minimum(0.0f);
+	glm::vec3 maximum(0.0f);
+
+	center = glm::vec3(0.0f);
+	radius = 0.0f;
+	if (objectCount == 0)
+	{
+		return;
+	}
+
+	TRANSFORM_STREAMS streams;
+	streams.scaleX = m_objectTransforms.scaleX.data();
+	streams.scaleY = m_objectTransforms.scaleY.data();
+	streams.scaleZ = m_objectTransforms.scaleZ.data();
+	streams.rotationX = m_objectTransforms.rotationX.data();
+	streams.rotationY = m_objectTransforms.rotationY.data();
+	streams.rotationZ = m_objectTransforms.rotationZ.data();
+	streams.positionX = m_objectTransforms.positionX.data();
+	streams.positionY = m_objectTransforms.positionY.data();
+	streams.positionZ = m_objectTransforms.positionZ.data();
+	ComposeTransforms(streams, objectCount, m_modelMatrices.data());
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		const glm::mat4& model = m_modelMatrices[i];
+		glm::vec3 localCenter;
+		float localRadius = 0.0f;
+
+		GetMeshBounds(m_sceneObjects[i].mesh, localCenter, localRadius);
+		glm::vec3 objectCenter = glm::vec3(model * glm::vec4(localCenter, 1.0f));
+		float maxScale = glm::max(
+			glm::length(glm::vec3(model[0])),
+			glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		glm::vec3 extent(localRadius * maxScale);
+
+		if (i == 0)
+		{
+			minimum = objectCenter - extent;
+			maximum = objectCenter + extent;
+		}
+		else
+		{
+			minimum = glm::min(minimum, objectCenter - extent);
+			maximum = glm::max(maximum, objectCenter + extent);
+		}
+	}
+
+	center = (minimum + maximum) * 0.5f;
+	radius = glm::length(maximum - minimum) * 0.5f;
+}
+
+/***********************************************************
+ *  CreateShadowMaps()
+ *
+ *  This method is used for creating the cascaded shadow maps
+ *  of the directional light.  They are only used when the
+ *  fragment shader declares
+ *
+ *    uniform sampler2DArrayShadow shadowMap;
+ *    uniform int cascadeCount;
+ *    uniform vec4 cascadeSplits;       // view depth where each ends
+ *    uniform mat4 lightSpaceMatrices[4];
+ *    uniform bool bUseShadows;
+ *
+ *  and picks the first cascade whose split lies beyond the
+ *  fragment's view depth.
+ ***********************************************************/
+void SceneManager::CreateShadowMaps()
+{
+	m_bUseShadows = false;
+
+	if (glGetUniformLocation(m_pShaderManager->m_programID, g_ShadowMapName) < 0)
+	{
+		return;
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.0f, 1.5f, -2.0f); //places the chair guard
+	glm::vec3 sceneCenter;
+	float sceneRadius = 0.0f;
+	CalculateSceneBounds(sceneCenter, sceneRadius);
+	m_pShadowCascades->SetSceneBounds(sceneCenter, sceneRadius);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (m_pShadowCascades->Create() == false)
+	{
+		return;
+	}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	// the shadow maps use the first unit after the textures
+	m_shadowTextureUnit = m_loadedTextures;
+	m_bUseShadows = true;
+	m_pShaderManager->setBoolValue(g_UseShadowsName, true);
+}
 
-	scaleXYZ = glm::vec3(6.0f, 0.3f, 0.3f); //scales our chair guard
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  RenderShadowMaps()
+ *
+ *  This method is used for rendering the recorded shadow
+ *  casters into every cascade with the depth-only program,
+ *  then binding the shadow maps and cascade matrices for the
+ *  scene shaders.
+ ***********************************************************/
+void SceneManager::RenderShadowMaps(const RenderQueue* pQueue)
+{
+	const ShadowCascades::SHADOW_FRAME& frame = pQueue->GetShadowFrame();
+	const std::vector<RenderQueue::DRAW_COMMAND>& casters = pQueue->GetShadowCommands();
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.0f, 1.5f, 2.0f); //places the chair guard
+	if (frame.cascadeCount == 0)
+	{
+		return;
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	for (int cascade = 0; cascade < frame.cascadeCount; cascade++)
+	{
+		unsigned int cascadeBit = 1u << cascade;
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+		m_pShadowCascades->BeginCascade(frame, cascade);
+		for (size_t i = 0; i < casters.size(); i++)
+		{
+			if (casters[i].shadowMask & cascadeBit)
+			{
+				m_pShadowCascades->SetCasterModel(casters[i].model);
+				DrawSceneMesh(casters[i].mesh, casters[i].lodLevel);
+			}
+		}
+	}
+	m_pShadowCascades->EndPass();
 
-	scaleXYZ = glm::vec3(6.5f, 0.7f, 0.5f); //scales our upper chair guard
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	// back to the scene program for the cascade uniforms
+	m_pShaderManager->use();
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(4.9f, 3.5f, -2.0f); //places the upper chair guard
+	glActiveTexture(GL_TEXTURE0 + m_shadowTextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_pShadowCascades->GetDepthTexture());
+	glActiveTexture(GL_TEXTURE0);
+	m_pShaderManager->setSampler2DValue(g_ShadowMapName, m_shadowTextureUnit);
+	SetCascadeUniforms(frame);
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  SetCascadeUniforms()
+ *
+ *  This method is used for setting the light space matrix
+ *  and the far split depth of each cascade of a frame.
+ ***********************************************************/
+void SceneManager::SetCascadeUniforms(const ShadowCascades::SHADOW_FRAME& frame)
+{
+	glm::vec4 splits(0.0f);
+	for (int cascade = 0; cascade < frame.cascadeCount; cascade++)
+	{
+		splits[cascade] = frame.splitDepths[cascade];
+		m_pShaderManager->setMat4Value(
+			std::string(g_LightSpaceMatrixName) + "[" + std::to_string(cascade) + "]",
+			frame.lightViewProjection[cascade]);
+	}
+	m_pShaderManager->setIntValue(g_CascadeCountName, frame.cascadeCount);
+	m_pShaderManager->setVec4Value(g_CascadeSplitsName, splits);
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  SubmitDrawCommands()
+ *
+ *  This method is used for issuing the OpenGL calls for the
+ *  merged and sorted draw commands of the passed in queue.
+ *  The opaque objects are drawn with blending off, then the
+ *  transparent ones in their own pass.  With the object
+ *  buffer, all the matrices and colors are written in one
+ *  pass and each draw only sets its index.  The opaque
+ *  objects are left out after the deferred lighting, which
+ *  has drawn them already.
+ ***********************************************************/
+void SceneManager::SubmitDrawCommands(const RenderQueue* pQueue, bool bOpaque)
+{
+	const std::vector<RenderQueue::DRAW_COMMAND>& commands = pQueue->GetCommands();
+	const std::vector<RenderQueue::DRAW_COMMAND>& transparentCommands = pQueue->GetTransparentCommands();
+	const std::vector<RenderQueue::DRAW_COMMAND>& orthoCommands = pQueue->GetOrthoCommands();
+	const std::vector<RenderQueue::DRAW_COMMAND>& orthoTransparentCommands = pQueue->GetOrthoTransparentCommands();
+	int orthoFirstObject = (int)(commands.size() + transparentCommands.size());
 
-	scaleXYZ = glm::vec3(6.5f, 0.7f, 0.5f); //scales our upper chair guard
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
+	m_framePermutation = GetFramePermutation(pQueue);
+	m_pSubmitQueue = pQueue;
+	m_submitView = -1;
+	m_bTransparentPass = false;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(4.9f, 3.5f, 2.0f); //places the upper chair guard
+	if (m_bUseLightmaps)
+	{
+		glActiveTexture(GL_TEXTURE0 + m_lightmapTextureUnit);
+		glBindTexture(GL_TEXTURE_2D, m_lightmapTextureID);
+		glActiveTexture(GL_TEXTURE0);
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// the transparent objects follow the opaque ones in the
+	// object buffer, then the shared objects of the
+	// orthographic views in the same order
+	if (m_bUseObjectBuffer)
+	{
+		OBJECT_DATA* pObjects = (OBJECT_DATA*)m_pObjectBuffer->BeginRegion();
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			pObjects[i].model = commands[i].model;
+			pObjects[i].color = commands[i].color;
+		}
+		pObjects += commands.size();
+		for (size_t i = 0; i < transparentCommands.size(); i++)
+		{
+			pObjects[i].model = transparentCommands[i].model;
+			pObjects[i].color = transparentCommands[i].color;
+		}
+		pObjects += transparentCommands.size();
+		for (size_t i = 0; i < orthoCommands.size(); i++)
+		{
+			pObjects[i].model = orthoCommands[i].model;
+			pObjects[i].color = orthoCommands[i].color;
+		}
+		pObjects += orthoCommands.size();
+		for (size_t i = 0; i < orthoTransparentCommands.size(); i++)
+		{
+			pObjects[i].model = orthoTransparentCommands[i].model;
+			pObjects[i].color = orthoTransparentCommands[i].color;
+		}
+		m_pObjectBuffer->BindRegionRange(
+			g_ObjectBufferBinding,
+			(orthoFirstObject + orthoCommands.size() + orthoTransparentCommands.size()) * sizeof(OBJECT_DATA));
+	}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	if (bOpaque)
+	{
+		glDisable(GL_BLEND);
+		DrawCommandRange(commands, 0);
+		glEnable(GL_BLEND);
+	}
+	if (transparentCommands.empty() == false)
+	{
+		RenderTransparency(pQueue);
+	}
+	if (pQueue->GetOrthoViewCount() > 0)
+	{
+		RenderOrthoViews(pQueue, orthoFirstObject);
+	}
 
-	scaleXYZ = glm::vec3(6.5f, 0.7f, 3.5f); //scales our chair top
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	if (m_bUseObjectBuffer)
+	{
+		m_pObjectBuffer->EndRegion();
+	}
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.0f, 3.5f, 0.0f); //places the chair top
+/***********************************************************
+ *  DrawCommandRange()
+ *
+ *  This method is used for drawing a list of commands with
+ *  the scene program, or its variant for each command when
+ *  the shaders have them.  Since the commands are grouped
+ *  by state, the program, texture and material uniforms are
+ *  only set when they change.  A variant gets the uniforms
+ *  of the pass the first time the list uses it.  The object
+ *  buffer index of the first command is passed in, and a
+ *  command drawn out of order keeps the index of its place
+ *  in the list.
+ ***********************************************************/
+void SceneManager::DrawCommandRange(
+	const std::vector<RenderQueue::DRAW_COMMAND>& commands,
+	int firstObject,
+	const std::vector<int>* pDrawOrder)
+{
+	const GLuint sceneProgramID = m_pShaderManager->m_programID;
+	bool bVariantReady[ShaderPermutations::PERMUTATION_COUNT] = { false };
+	int currentPermutation = -1;
+	int currentTexture = -2;
+	int currentMaterial = -2;
+
+	size_t drawCount = (NULL != pDrawOrder) ? pDrawOrder->size() : commands.size();
+	for (size_t n = 0; n < drawCount; n++)
+	{
+		size_t i = (NULL != pDrawOrder) ? (size_t)(*pDrawOrder)[n] : n;
+		const RenderQueue::DRAW_COMMAND& command = commands[i];
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		// a variant is given the uniforms of the pass, then
+		// its own per draw uniforms
+		if (m_pPermutations->IsEnabled())
+		{
+			int permutation = m_framePermutation;
+			if (command.textureSlot >= 0)
+			{
+				permutation |= ShaderPermutations::PERMUTATION_TEXTURED;
+			}
+			if (permutation != currentPermutation)
+			{
+				GLuint programID = m_pPermutations->Activate(permutation);
+				m_pShaderManager->m_programID = (programID != 0) ? programID : sceneProgramID;
+				m_pShaderManager->use();
+				if ((programID != 0) && (bVariantReady[permutation] == false))
+				{
+					SetVariantUniforms();
+					bVariantReady[permutation] = true;
+				}
+				currentPermutation = permutation;
+				currentTexture = -2;
+				currentMaterial = -2;
+			}
+		}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("tabletop"); //applies a wood texture
-	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh();
+		if (m_bUseObjectBuffer)
+		{
+			m_pShaderManager->setIntValue(g_ObjectIndexName, firstObject + (int)i);
+		}
+		else
+		{
+			m_pShaderManager->setMat4Value(g_ModelName, command.model);
+			m_pShaderManager->setVec4Value(g_ColorValueName, command.color);
+		}
 
-	scaleXYZ = glm::vec3(4.0f, 0.7f, 0.5f); //scales our chair bar
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 0.0f;
+		if (command.textureSlot != currentTexture)
+		{
+			currentTexture = command.textureSlot;
+			// the variants have no texture switch
+			if (m_pShaderManager->m_programID == sceneProgramID)
+			{
+				m_pShaderManager->setIntValue(g_UseTextureName, currentTexture >= 0);
+			}
+			if (currentTexture >= 0)
+			{
+				m_pShaderManager->setSampler2DValue(g_TextureValueName, currentTexture);
+			}
+		}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(8.0f, 4.5f, 0.0f); //places the chair bar
+		if ((command.materialIndex != currentMaterial) && (command.materialIndex >= 0))
+		{
+			const OBJECT_MATERIAL& material = m_objectMaterials[command.materialIndex];
+			currentMaterial = command.materialIndex;
+			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
+			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
+			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+		}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		if (m_bUseLightmaps)
+		{
+			m_pShaderManager->setVec4Value(g_LightmapRectName, command.lightmapRect);
+		}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+		DrawCommandMesh(command);
+	}
 
-	scaleXYZ = glm::vec3(4.0f, 0.7f, 0.5f); //scales our chair bar
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 0.0f;
+	// the rest of the frame sets the scene program
+	if (m_pShaderManager->m_programID != sceneProgramID)
+	{
+		m_pShaderManager->m_programID = sceneProgramID;
+		m_pShaderManager->use();
+	}
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(8.0f, 5.5f, 0.0f); //places the chair bar
+/***********************************************************
+ *  CreateTransparency()
+ *
+ *  This method is used for creating the order-independent
+ *  transparency targets.  They are only used when the
+ *  fragment shader declares a second output and writes the
+ *  weighted color and the coverage to them in the
+ *  transparent pass:
+ *
+ *    uniform bool bTransparentPass;
+ *    layout(location = 0) out vec4 fragmentColor;
+ *    layout(location = 1) out vec4 revealage;
+ *
+ *    if (bTransparentPass)
+ *    {
+ *        float weight = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) *
+ *            1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+ *        fragmentColor = vec4(color.rgb * color.a, color.a) * weight;
+ *        revealage = vec4(color.a);
+ *    }
+ *
+ *  Otherwise the transparent objects are blended in the
+ *  order they were recorded.
+ ***********************************************************/
+void SceneManager::CreateTransparency()
+{
+	m_bUseTransparency = false;
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (glGetUniformLocation(m_pShaderManager->m_programID, g_TransparentPassName) < 0)
+	{
+		return;
+	}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (m_pTransparency->Create(viewport[2], viewport[3], m_loadedTextures + 10) == false)
+	{
+		return;
+	}
 
-	scaleXYZ = glm::vec3(4.0f, 0.7f, 0.5f); //scales our chair bar
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 0.0f;
+	m_pShaderManager->setBoolValue(g_TransparentPassName, false);
+	m_bUseTransparency = true;
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(8.0f, 6.5f, 0.0f); //places the chair bar
+/***********************************************************
+ *  RenderTransparency()
+ *
+ *  This method is used for drawing the transparent commands
+ *  of a queue over the opaque scene.  They are tested
+ *  against the opaque depth with the default test, since
+ *  the depth prepass may have left the equal test set, and
+ *  never write depth.
+ ***********************************************************/
+void SceneManager::RenderTransparency(const RenderQueue* pQueue)
+{
+	const std::vector<RenderQueue::DRAW_COMMAND>& transparentCommands = pQueue->GetTransparentCommands();
+	int firstObject = (int)pQueue->GetCommands().size();
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (m_bUseTransparency)
+	{
+		m_pTransparency->BeginAccumulation();
+		m_bTransparentPass = true;
+		m_pShaderManager->setBoolValue(g_TransparentPassName, true);
+		DrawCommandRange(transparentCommands, firstObject);
+		m_pShaderManager->setBoolValue(g_TransparentPassName, false);
+		m_bTransparentPass = false;
+		m_pTransparency->EndAccumulation();
+		m_pShaderManager->use();
+		return;
+	}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_FALSE);
+	DrawCommandRange(transparentCommands, firstObject);
+	glDepthMask(GL_TRUE);
+}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  GetLayoutRect()
+ *
+ *  This method is used for getting the quarter of the
+ *  layout viewport that a view covers - the camera view in
+ *  the lower left, then the top view in the upper left, the
+ *  side view in the upper right and the front view in the
+ *  lower right.  The rectangle is x, y, width and height.
+ ***********************************************************/
+void SceneManager::GetLayoutRect(
+	int viewIndex,
+	const GLint* pViewport,
+	GLint* pRect)
+{
+	GLint leftWidth = glm::max(pViewport[2] / 2, 1);
+	GLint lowerHeight = glm::max(pViewport[3] / 2, 1);
+	bool bRight = (viewIndex == 2) || (viewIndex == 3);
+	bool bUpper = (viewIndex == 1) || (viewIndex == 2);
+
+	pRect[0] = pViewport[0] + (bRight ? leftWidth : 0);
+	pRect[1] = pViewport[1] + (bUpper ? lowerHeight : 0);
+	pRect[2] = bRight ? glm::max(pViewport[2] - leftWidth, 1) : leftWidth;
+	pRect[3] = bUpper ? glm::max(pViewport[3] - lowerHeight, 1) : lowerHeight;
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-8.0f, 1.0f, 2.0f); //places the chair leg
+/***********************************************************
+ *  RenderOrthoViews()
+ *
+ *  This method is used for drawing the shared commands of a
+ *  queue into each of its orthographic views, after the
+ *  camera view.  The light clusters, shadow cascades and
+ *  screen space passes are all fitted to the camera, so
+ *  these views are drawn unlit, with the colors and
+ *  textures of the objects.  The shared transparent
+ *  objects are blended back to front along the direction
+ *  of each view.  The camera and the layout viewport are
+ *  set again afterwards.
+ ***********************************************************/
+void SceneManager::RenderOrthoViews(const RenderQueue* pQueue, int firstObject)
+{
+	const std::vector<RenderQueue::DRAW_COMMAND>& orthoCommands = pQueue->GetOrthoCommands();
+	const std::vector<RenderQueue::DRAW_COMMAND>& orthoTransparentCommands = pQueue->GetOrthoTransparentCommands();
+	GLint depthFunc = GL_LESS;
+	GLboolean bDepthWrite = GL_TRUE;
+
+	// the depth prepass may have left the equal test on
+	glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+	glGetBooleanv(GL_DEPTH_WRITEMASK, &bDepthWrite);
+	glDepthFunc(GL_LESS);
+
+	// the unlit variants only differ by texturing
+	m_framePermutation = 0;
+	m_pShaderManager->setBoolValue(g_UseLightingName, false);
+
+	glEnable(GL_SCISSOR_TEST);
+	for (int view = 0; view < pQueue->GetOrthoViewCount(); view++)
+	{
+		GLint rect[4];
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		GetLayoutRect(view + 1, m_layoutViewport, rect);
+		glViewport(rect[0], rect[1], rect[2], rect[3]);
+		glScissor(rect[0], rect[1], rect[2], rect[3]);
+		glDepthMask(GL_TRUE);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+		m_submitView = view;
+		SetViewUniforms(view);
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+		glDisable(GL_BLEND);
+		DrawCommandRange(orthoCommands, firstObject);
+		glEnable(GL_BLEND);
+		if (orthoTransparentCommands.empty() == false)
+		{
+			// the view looks down its negative z axis, so the
+			// farthest centers have the lowest view z
+			const glm::mat4& viewMatrix = pQueue->GetOrthoViewMatrix(view);
+			glm::vec3 viewAxis(viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2]);
+			m_orthoDrawOrder.resize(orthoTransparentCommands.size());
+			m_orthoDrawDepths.resize(orthoTransparentCommands.size());
+			for (size_t i = 0; i < orthoTransparentCommands.size(); i++)
+			{
+				m_orthoDrawOrder[i] = (int)i;
+				m_orthoDrawDepths[i] = glm::dot(glm::vec3(orthoTransparentCommands[i].model[3]), viewAxis);
+			}
+			const std::vector<float>& depths = m_orthoDrawDepths;
+			std::stable_sort(m_orthoDrawOrder.begin(), m_orthoDrawOrder.end(),
+				[&depths](int a, int b) { return(depths[a] < depths[b]); });
+
+			glDepthMask(GL_FALSE);
+			DrawCommandRange(orthoTransparentCommands, firstObject + (int)orthoCommands.size(), &m_orthoDrawOrder);
+		}
+	}
+	glDisable(GL_SCISSOR_TEST);
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-2.0f, 1.0f, 2.0f); //places the chair leg
+	m_submitView = -1;
+	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	SetViewUniforms(-1);
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	glViewport(m_layoutViewport[0], m_layoutViewport[1], m_layoutViewport[2], m_layoutViewport[3]);
+	glDepthFunc(depthFunc);
+	glDepthMask(bDepthWrite);
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  CreateShaderPermutations()
+ *
+ *  This method is used for reading the scene shader files
+ *  for their specialized variants.  They are only built
+ *  when the sources test PERMUTATION_KEY, which is defined
+ *  in every variant together with the features it is built
+ *  for, after the #version line:
+ *
+ *    #define PERMUTATION_KEY 7
+ *    #define USE_TEXTURE 1
+ *    #define USE_LIGHTING 1
+ *    #define USE_SHADOWS 1
+ *    #define LIGHT_COUNT 3
+ *
+ *  The scene program itself is built without the defines
+ *  and keeps the uniform branches, so it still declares
+ *  every uniform the scene detects and sets:
+ *
+ *    #ifdef PERMUTATION_KEY
+ *    #if USE_TEXTURE
+ *        vec4 baseColor = texture(objectTexture, fragmentTextureCoordinate);
+ *    #else
+ *        vec4 baseColor = objectColor;
+ *    #endif
+ *    #else
+ *        vec4 baseColor = bUseTexture ? ... : objectColor;
+ *    #endif
+ *
+ *  The point light loop runs to LIGHT_COUNT instead of the
+ *  size of the fixed light array.
+ ***********************************************************/
+void SceneManager::CreateShaderPermutations()
+{
+	m_pPermutations->Create(
+		m_pProgramCache,
+		m_vertexShaderPath.c_str(),
+		m_fragmentShaderPath.c_str());
+}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  GetFramePermutation()
+ *
+ *  This method is used for getting the variant features
+ *  that every draw of a queue shares - the lighting, the
+ *  shadows and the bucket of its point light count.  The
+ *  texturing is added per draw.
+ ***********************************************************/
+int SceneManager::GetFramePermutation(const RenderQueue* pQueue) const
+{
+	const std::vector<LightManager::LIGHT>& lights = pQueue->GetLights();
+	int pointLightCount = 0;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-8.0f, 5.0f, 2.0f); //places the chair leg
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		// a disabled light adds nothing to the point light loop
+		if ((lights[i].type == LightManager::LIGHT_POINT) && lights[i].bEnabled)
+		{
+			pointLightCount++;
+		}
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	int permutation = ShaderPermutations::PERMUTATION_LIT;
+	if (m_bUseShadows)
+	{
+		permutation |= ShaderPermutations::PERMUTATION_SHADOWED;
+	}
+	permutation |= ShaderPermutations::GetLightBucket(pointLightCount) << ShaderPermutations::LIGHT_BUCKET_SHIFT;
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	return(permutation);
+}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  SetViewUniforms()
+ *
+ *  This method is used for setting the camera matrices and
+ *  position of the camera view (-1) or an orthographic view
+ *  of the queue being submitted.
+ ***********************************************************/
+void SceneManager::SetViewUniforms(int view)
+{
+	glm::mat4 viewMatrix = m_pSubmitQueue->GetViewMatrix();
+	glm::mat4 projectionMatrix = m_pSubmitQueue->GetProjectionMatrix();
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-2.0f, 1.0f, -2.0f); //places the chair leg
+	if (view >= 0)
+	{
+		viewMatrix = m_pSubmitQueue->GetOrthoViewMatrix(view);
+		projectionMatrix = m_pSubmitQueue->GetOrthoProjectionMatrix(view);
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_pShaderManager->setMat4Value("view", viewMatrix);
+	m_pShaderManager->setMat4Value("projection", projectionMatrix);
+	m_pShaderManager->setVec3Value("viewPosition", glm::vec3(glm::inverse(viewMatrix)[3]));
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+/***********************************************************
+ *  SetVariantUniforms()
+ *
+ *  This method is used for setting the uniforms a variant
+ *  shares with the scene program, from the state they were
+ *  set on the scene program from - the view and pass being
+ *  drawn, the shadow maps and light lists of the queue, the
+ *  lights and the samplers.  Nothing is read back from the
+ *  scene program, and uniforms a variant compiled out are
+ *  skipped by their location.
+ ***********************************************************/
+void SceneManager::SetVariantUniforms()
+{
+	const RenderQueue* pQueue = m_pSubmitQueue;
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+	SetViewUniforms(m_submitView);
+	m_pShaderManager->setBoolValue(g_UseLightingName, m_submitView < 0);
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-8.0f, 1.0f, -2.0f); //places the chair leg
+	if (m_bUseShadows)
+	{
+		m_pShaderManager->setBoolValue(g_UseShadowsName, true);
+		m_pShaderManager->setSampler2DValue(g_ShadowMapName, m_shadowTextureUnit);
+		if (pQueue->GetShadowFrame().cascadeCount > 0)
+		{
+			SetCascadeUniforms(pQueue->GetShadowFrame());
+		}
+	}
+	if (m_bUsePointShadows)
+	{
+		m_pShaderManager->setSampler2DValue(g_PointShadowAtlasName, m_pointShadowTextureUnit);
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_pLightManager->SetProgramUniforms();
+	if (m_pLightClusters->IsEnabled())
+	{
+		const LightClusters::LIGHT_GRID& grid = pQueue->GetLightGrid();
+		m_pShaderManager->setBoolValue(g_UseClusteredLightsName, m_pLightManager->IsBufferEnabled());
+		m_pShaderManager->setVec2Value(g_ClusterDepthParamsName, grid.depthParams);
+		m_pShaderManager->setVec2Value(g_ClusterTileScaleName, grid.tileScale / m_renderScale);
+	}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	bool bAmbientOcclusion = m_bUseAmbientOcclusion &&
+		(m_pAmbientOcclusion->GetActiveQuality() != AmbientOcclusion::AO_OFF);
+	m_pShaderManager->setBoolValue(g_UseAmbientOcclusionName, bAmbientOcclusion);
+	if (bAmbientOcclusion)
+	{
+		m_pShaderManager->setSampler2DValue(g_AmbientOcclusionTextureName, m_ambientOcclusionTextureUnit);
+	}
 
-	scaleXYZ = glm::vec3(5.0f, 0.7f, 0.5f); //scales our chair leg
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+	if (m_bUseLightmaps)
+	{
+		m_pShaderManager->setSampler2DValue(g_LightmapTextureName, m_lightmapTextureUnit);
+	}
+	if (m_bUseTransparency)
+	{
+		m_pShaderManager->setBoolValue(g_TransparentPassName, m_bTransparentPass);
+	}
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-8.0f, 5.0f, -2.0f); //places the chair leg
+/***********************************************************
+ *  DrawSceneMesh()
+ *
+ *  This method is used for drawing a basic shape.  Detail
+ *  level 0 is drawn from the basic shapes object and the
+ *  reduced levels from the detail level meshes.
+ ***********************************************************/
+void SceneManager::DrawSceneMesh(int mesh, int lodLevel)
+{
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_CYLINDER:
+		if (lodLevel == 0)
+			m_basicMeshes->DrawCylinderMesh();
+		else
+			m_lodMeshes->DrawLODMesh(LODMeshes::LOD_CYLINDER, lodLevel);
+		break;
+	case MESH_TAPERED_CYLINDER:
+		if (lodLevel == 0)
+			m_basicMeshes->DrawTaperedCylinderMesh();
+		else
+			m_lodMeshes->DrawLODMesh(LODMeshes::LOD_TAPERED_CYLINDER, lodLevel);
+		break;
+	case MESH_TORUS:
+		if (lodLevel == 0)
+			m_basicMeshes->DrawTorusMesh();
+		else
+			m_lodMeshes->DrawLODMesh(LODMeshes::LOD_TORUS, lodLevel);
+		break;
+	}
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  DrawCommandMesh()
+ *
+ *  This method is used for drawing the mesh of a recorded
+ *  command.  Every pass draws through here, so the depth
+ *  of a lightmapped object always comes from the same
+ *  unwrapped mesh.
+ ***********************************************************/
+void SceneManager::DrawCommandMesh(const RenderQueue::DRAW_COMMAND& command)
+{
+	if (m_bUseLightmaps && (command.lightmapRect.z > 0.0f))
+	{
+		m_pLightmapMeshes->DrawMesh(command.mesh);
+		return;
+	}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	DrawSceneMesh(command.mesh, command.lodLevel);
+}
 
-	scaleXYZ = glm::vec3(6.0f, 0.3f, 0.3f); //scales our chair guard
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  GetTextureAverageColor()
+ *
+ *  This method is used for reading the average color of a
+ *  loaded texture, which is its smallest mipmap level.
+ ***********************************************************/
+glm::vec3 SceneManager::GetTextureAverageColor(int textureSlot)
+{
+	GLint width = 0;
+	GLint height = 0;
+	GLfloat color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-5.0f, 1.5f, -2.0f); //places the chair guard
+	if ((textureSlot < 0) || (textureSlot >= m_loadedTextures))
+	{
+		return(glm::vec3(1.0f));
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	glBindTexture(GL_TEXTURE_2D, m_textureIDs[textureSlot].ID);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+	int level = 0;
+	while ((width > 1) || (height > 1))
+	{
+		width = glm::max(width / 2, 1);
+		height = glm::max(height / 2, 1);
+		level++;
+	}
+	glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_FLOAT, color);
+	glBindTexture(GL_TEXTURE_2D, 0);
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	return(glm::vec3(color[0], color[1], color[2]));
+}
 
-	scaleXYZ = glm::vec3(6.0f, 0.3f, 0.3f); //scales our chair guard
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  BakeLightmaps()
+ *
+ *  This method is used for baking the lighting of every
+ *  scene object into a lightmap file.  The scene must be
+ *  prepared first, since the bounce colors are taken from
+ *  the loaded textures and materials.
+ ***********************************************************/
+bool SceneManager::BakeLightmaps(
+	const char* filename,
+	int atlasSize,
+	int samplesPerTexel,
+	int bounceCount)
+{
+	// fail before the bake rather than after it, when the
+	// file cannot be written
+	if (LightmapBaker::PrepareLightmapFile(filename) == false)
+	{
+		return(false);
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-5.0f, 1.5f, 2.0f); //places the chair guard
+	int objectCount = (int)m_sceneObjects.size();
+	std::vector<glm::mat4> models(objectCount);
+	std::vector<LightmapBaker::BAKE_OBJECT> objects(objectCount);
+	std::vector<LightManager::LIGHT> lights;
+	LightmapBaker::LIGHTMAP_DATA lightmap;
+
+	TRANSFORM_STREAMS streams;
+	streams.scaleX = m_objectTransforms.scaleX.data();
+	streams.scaleY = m_objectTransforms.scaleY.data();
+	streams.scaleZ = m_objectTransforms.scaleZ.data();
+	streams.rotationX = m_objectTransforms.rotationX.data();
+	streams.rotationY = m_objectTransforms.rotationY.data();
+	streams.rotationZ = m_objectTransforms.rotationZ.data();
+	streams.positionX = m_objectTransforms.positionX.data();
+	streams.positionY = m_objectTransforms.positionY.data();
+	streams.positionZ = m_objectTransforms.positionZ.data();
+	ComposeTransforms(streams, objectCount, models.data());
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		glm::vec3 albedo = (object.textureSlot >= 0) ?
+			GetTextureAverageColor(object.textureSlot) : glm::vec3(object.color);
+		if (object.materialIndex >= 0)
+		{
+			albedo = albedo * m_objectMaterials[object.materialIndex].diffuseColor;
+		}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		objects[i].shape = object.mesh;
+		objects[i].model = models[i];
+		// no surface sends back all of its light
+		objects[i].albedo = glm::clamp(albedo, 0.0f, 0.95f);
+	}
+	m_pLightManager->CopyLights(lights);
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	LightmapBaker baker(m_pThreadPool);
+	baker.SetQuality(atlasSize, samplesPerTexel, bounceCount);
 
-	scaleXYZ = glm::vec3(6.5f, 0.7f, 0.5f); //scales our upper chair guard
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (baker.Bake(objects, lights, lightmap) == false)
+	{
+		return(false);
+	}
+	std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+	std::cout << "Baked " << objectCount << " objects into a " << lightmap.width << "x" << lightmap.height
+		<< " lightmap in " << seconds.count() << " seconds" << std::endl;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-4.9f, 3.5f, -2.0f); //places the upper chair guard
+	return(LightmapBaker::SaveLightmap(filename, lightmap));
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  LoadLightmaps()
+ *
+ *  This method is used for loading a baked lightmap.  It is
+ *  only used when the shaders declare
+ *
+ *    layout(location = 3) in vec2 lightmapCoordinate;
+ *    uniform sampler2D lightmapTexture;
+ *    uniform vec4 lightmapRect;
+ *
+ *  For objects with a lightmapRect scale above zero, the
+ *  fragment shader reads the light at
+ *  lightmapRect.xy + lightmapCoordinate * lightmapRect.zw and
+ *  uses it times material.diffuseColor in place of the
+ *  ambient and diffuse terms of every light.  Other objects
+ *  are lit as before.
+ ***********************************************************/
+bool SceneManager::LoadLightmaps(const char* filename)
+{
+	LightmapBaker::LIGHTMAP_DATA lightmap;
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	m_bUseLightmaps = false;
 
-	scaleXYZ = glm::vec3(6.5f, 0.7f, 0.5f); //scales our upper chair guard
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	if ((NULL == m_pShaderManager) ||
+		(glGetUniformLocation(m_pShaderManager->m_programID, g_LightmapTextureName) < 0))
+	{
+		return(false);
+	}
+	if (LightmapBaker::LoadLightmap(filename, lightmap) == false)
+	{
+		return(false);
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-4.9f, 3.5f, 2.0f); //places the upper chair guard
+	// the objects are matched by index, so the scene must be
+	// the one that was baked
+	bool bMatches = (lightmap.objectShapes.size() == m_sceneObjects.size());
+	for (size_t i = 0; bMatches && (i < m_sceneObjects.size()); i++)
+	{
+		bMatches = (lightmap.objectShapes[i] == m_sceneObjects[i].mesh);
+	}
+	if (bMatches == false)
+	{
+		std::cout << "Lightmap does not match the scene, bake it again:" << filename << std::endl;
+		return(false);
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (m_lightmapTextureID == 0)
+	{
+		glGenTextures(1, &m_lightmapTextureID);
+	}
+	glBindTexture(GL_TEXTURE_2D, m_lightmapTextureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// rows of 3 half floats are not always 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexImage2D(
+		GL_TEXTURE_2D,
+		0,
+		GL_RGB16F,
+		lightmap.width,
+		lightmap.height,
+		0,
+		GL_RGB,
+		GL_HALF_FLOAT,
+		lightmap.texels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	BindGLTextures();
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	m_pLightmapMeshes->LoadMeshes();
+	m_objectLightmapRects = lightmap.objectRects;
 
-	scaleXYZ = glm::vec3(6.5f, 0.7f, 3.5f); //scales our chair top
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	// the lightmap uses the unit after the point light shadows
+	m_lightmapTextureUnit = m_loadedTextures + 2;
+	m_pShaderManager->setSampler2DValue(g_LightmapTextureName, m_lightmapTextureUnit);
+	m_bUseLightmaps = true;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-5.0f, 3.5f, 0.0f); //places the chair top
+	return(true);
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("tabletop"); //applies a wood texture
-	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh();
+void SceneManager::LoadSceneTextures()
+{
+		bool bReturn = false;
 
-	scaleXYZ = glm::vec3(4.0f, 0.7f, 0.5f); //scales our chair bar
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 0.0f;
+		bReturn = CreateGLTexture(
+			"textures/Floor.jpg",
+			"floor");
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-8.0f, 4.5f, 0.0f); //places the chair bar
+		bReturn = CreateGLTexture(
+			"textures/Leg.jpg",
+			"leg");
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		bReturn = CreateGLTexture(
+			"textures/Tabletop.jpg",
+			"tabletop");
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+		bReturn = CreateGLTexture(
+			"textures/Plate.jpg",
+			"plate");
 
-	scaleXYZ = glm::vec3(4.0f, 0.7f, 0.5f); //scales our chair bar
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 0.0f;
+		bReturn = CreateGLTexture(
+			"textures/Mug.jpg",
+			"mug");
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-8.0f, 5.5f, 0.0f); //places the chair bar
+		
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	BindGLTextures();
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+void SceneManager::DefineObjectMaterials() {
+	OBJECT_MATERIAL gravelMaterial;
 
-	scaleXYZ = glm::vec3(4.0f, 0.7f, 0.5f); //scales our chair bar
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 90.0f;
-	ZrotationDegrees = 0.0f;
+	gravelMaterial.diffuseColor = glm::vec3(0.502f, 0.502f, 0.502f);
+	gravelMaterial.specularColor = glm::vec3(0.502f, 0.502f, 0.502f); //will project more of a grayish hue
+	gravelMaterial.shininess = 20.0;
+	gravelMaterial.tag = "gravel";
+	m_objectMaterials.push_back(gravelMaterial);
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-8.0f, 6.5f, 0.0f); //places the chair bar
+	OBJECT_MATERIAL metalMaterial;
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	metalMaterial.diffuseColor = glm::vec3(0.0f, 0.0f, 0.0f);
+	metalMaterial.specularColor = glm::vec3(0.78f, 0.78f, 0.78f); //projects more of a white-gray hue
+	metalMaterial.shininess = 85.0; //determines the strength of the specular color
+	metalMaterial.tag = "metal";
+	m_objectMaterials.push_back(metalMaterial);
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("leg"); //applies a metal texture
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawBoxMesh();
+	OBJECT_MATERIAL woodMaterial;
 
-	scaleXYZ = glm::vec3(1.0f, -0.4f, 0.5f); //scales our plate
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	woodMaterial.diffuseColor = glm::vec3(0.3f, 0.25f, 0.24f);
+	woodMaterial.specularColor = glm::vec3(0.66f, 0.26f, 0.18f); //should project more of a reddish brown hue
+	woodMaterial.shininess = 80.0;
+	woodMaterial.tag = "wood";
+	m_objectMaterials.push_back(woodMaterial);
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-2.0f, 5.4f, 0.0f); //places the plate
+	OBJECT_MATERIAL porcelainMaterial;
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	porcelainMaterial.diffuseColor = glm::vec3(0.96f, 0.96f, 0.96f);
+	porcelainMaterial.specularColor = glm::vec3(0.78f, 0.78f, 0.78f);
+	porcelainMaterial.shininess = 80.0;
+	porcelainMaterial.tag = "porcelain";
+	m_objectMaterials.push_back(porcelainMaterial);
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("plate");
-	SetShaderMaterial("porcelain");
-	m_basicMeshes->DrawTaperedCylinderMesh();
+	OBJECT_MATERIAL glassMaterial;
 
-	scaleXYZ = glm::vec3(1.0f, -0.4f, 0.5f); //scales our plate
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	glassMaterial.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
+	glassMaterial.specularColor = glm::vec3(0.21f, 0.21f, 0.21f);
+	glassMaterial.shininess = 95.0;
+	glassMaterial.tag = "glass";
+	m_objectMaterials.push_back(glassMaterial);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(2.0f, 5.4f, 0.0f); //places the plate
+void SceneManager::SetupSceneLights() {
+	m_pLightManager->AddDirectionalLight(
+		glm::vec3(-6.0f, 5.0f, 5.0f),		//creates a light that lights up the entire scene in a bright but slightly dim light
+		glm::vec3(0.4f, 0.4f, 0.4f),
+		glm::vec3(0.6f, 0.6f, 0.6f),
+		glm::vec3(0.0f, 0.0f, 0.0f));
+
+	m_pLightManager->AddPointLight(
+		glm::vec3(0.0f, 15.0f, -8.0f),		//creates a light that shines above the table
+		glm::vec3(0.03f, 0.03f, 0.0f),		//projects a constant dim yellow color
+		glm::vec3(0.4f, 0.4f, 0.0f),		//makes the light project yellow color
+		glm::vec3(1.0f, 1.0f, 0.0f));
+
+	m_pLightManager->AddPointLight(
+		glm::vec3(5.0f, 0.0f, 10.0f),		//creates a light that shines to the right of the table
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec3(0.2f, 0.2f, 0.0f),		//makes the light project yellow color
+		glm::vec3(1.0f, 1.0f, 0.0f));		//makes the light appear brighter when coming in contact with an object
+
+	m_pLightManager->AddPointLight(
+		glm::vec3(-5.0f, 0.0f, 10.0f),		//creates a light that shines to the left of the table
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec3(0.2f, 0.2f, 0.0f),		//makes the light project yellow color
+		glm::vec3(1.0f, 1.0f, 0.0f));		//makes the light appear brighter when coming in contact with an object
+
+	// with the light block in the shader, the lights are read
+	// from the light buffer instead of the fixed light uniforms,
+	// and with the cluster blocks as well, every fragment only
+	// reads the lights of its cluster
+	if (m_pLightManager->CreateBuffer(m_pShaderManager->m_programID) &&
+		m_pLightClusters->CreateBuffers(m_pShaderManager->m_programID))
+	{
+		m_pShaderManager->setBoolValue(g_UseClusteredLightsName, true);
+	}
+	m_pLightManager->UploadChanges();
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_pShaderManager->setBoolValue("bUseLighting", true);
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("plate");
-	SetShaderMaterial("porcelain");
-	m_basicMeshes->DrawTaperedCylinderMesh();
 
-	scaleXYZ = glm::vec3(0.3f, 0.02f, 0.2f); //scales our liquid
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(1.0f, 5.68f, -1.0f); //places the liquid
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	LoadSceneTextures(); //load the textures of the scene
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	DefineObjectMaterials();
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	m_basicMeshes->DrawCylinderMesh();
+	SetupSceneLights();
 
-	scaleXYZ = glm::vec3(0.3f, 0.7f, 0.2f); //scales our mug
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadBoxMesh();
+	m_basicMeshes->LoadTaperedCylinderMesh();
+	m_basicMeshes->LoadCylinderMesh();
+	m_basicMeshes->LoadTorusMesh();
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(1.0f, 5.0f, -1.0f); //places the bottom of the mug
+	// generate the reduced detail levels of the curved shapes
+	m_lodMeshes->LoadCylinderMeshLODs();
+	m_lodMeshes->LoadTaperedCylinderMeshLODs();
+	m_lodMeshes->LoadTorusMeshLODs();
+
+	// define the objects after the textures and materials so
+	// their tags can be resolved
+	DefineSceneObjects();
+	m_lodMeshes->SetObjectCount((int)m_sceneObjects.size(), g_LODViewCount);
+
+	CreateObjectBuffer();
+	CreateShadowMaps();
+	CreatePointShadows();
+	CreateAmbientOcclusion();
+	CreateDepthPrepass();
+	if (m_renderPipeline == PIPELINE_DEFERRED)
+	{
+		CreateDeferredRenderer();
+	}
+	CreateTransparency();
+	CreateShaderPermutations();
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	// creating the render targets above bound them to the
+	// active unit, which holds the first scene texture
+	BindGLTextures();
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("mug");
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawCylinderMesh();
+}
 
-	scaleXYZ = glm::vec3(0.3f, 0.02f, 0.2f); //scales our liquid
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  GetRecordThreadCount()
+ *
+ *  This method is used for getting the number of threads
+ *  that record draw commands, which is the number of thread
+ *  lists a render queue needs.
+ ***********************************************************/
+int SceneManager::GetRecordThreadCount() const
+{
+	return(m_pThreadPool->GetThreadCount());
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-1.0f, 5.68f, -1.0f); //places the liquid
+/***********************************************************
+ *  RecordScene()
+ *
+ *  This method is used for recording the draw commands of
+ *  the current view.  The worker threads cull the objects,
+ *  choose detail levels, calculate the model matrices and
+ *  record draw commands, then the lists are merged and
+ *  sorted.  No OpenGL calls are made.
+ ***********************************************************/
+void SceneManager::RecordScene(RenderQueue* pQueue)
+{
+	// objects handled by one worker task - small enough to
+	// balance, large enough to hide the queueing cost
+	const int objectsPerTask = 64;
+
+	pQueue->Reset();
+	pQueue->SetViewMatrices(m_viewMatrix, m_projectionMatrix);
+	pQueue->SetOrthoViews(m_orthoViewCount, m_orthoViews, m_orthoProjections);
+	ApplyObjectMoves();
+	m_pLightManager->CopyLights(m_frameLights);
+	pQueue->GetLights() = m_frameLights;
+
+	// place the shadow cascades before the casters are culled,
+	// along the first directional light that is switched on
+	pQueue->GetShadowFrame().cascadeCount = 0;
+	int sunIndex = -1;
+	for (size_t i = 0; (i < m_frameLights.size()) && (sunIndex < 0); i++)
+	{
+		if ((m_frameLights[i].type == LightManager::LIGHT_DIRECTIONAL) && m_frameLights[i].bEnabled)
+		{
+			sunIndex = (int)i;
+		}
+	}
+	if (m_bUseShadows && (sunIndex >= 0))
+	{
+		m_pShadowCascades->SetLightDirection(m_frameLights[sunIndex].direction);
+		m_pShadowCascades->FitCascades(m_viewMatrix, m_projectionMatrix, pQueue->GetShadowFrame());
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_pThreadPool->ParallelFor(
+		(int)m_sceneObjects.size(),
+		objectsPerTask,
+		[this, pQueue](int begin, int end, int threadIndex) {
+			RecordDrawCommands(begin, end, pQueue, threadIndex);
+		});
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	m_basicMeshes->DrawCylinderMesh();
+	pQueue->MergeAndSort();
 
-	scaleXYZ = glm::vec3(0.3f, 0.7f, 0.2f); //scales our mug
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	// the shadows around the new places of moved objects are
+	// out of date too
+	for (size_t i = 0; i < m_movedObjects.size(); i++)
+	{
+		const glm::vec4& bounds = m_objectBounds[m_movedObjects[i]];
+		m_pPointShadows->InvalidateSphere(glm::vec3(bounds), bounds.w);
+	}
+	m_movedObjects.clear();
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-1.0f, 5.0f, -1.0f); //places the bottom of the mug
+	// build the light lists of the view clusters
+	m_pLightClusters->AssignLights(
+		m_frameLights,
+		m_viewMatrix,
+		m_projectionMatrix,
+		m_viewportHeight,
+		pQueue->GetLightGrid());
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (m_bUsePointShadows)
+	{
+		RecordPointShadows(pQueue);
+	}
+}
 
-	SetShaderColor(0, 0, 1, 1); //sets the color to blue
-	SetShaderTexture("mug");
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawCylinderMesh();
+/***********************************************************
+ *  SubmitScene()
+ *
+ *  This method is used for issuing the OpenGL calls for a
+ *  previously recorded queue, after rendering its shadow
+ *  maps, uploading the changed lights and its light lists
+ *  and rendering its ambient occlusion.  With the depth
+ *  prepass on, the lighting only shades the closest surface
+ *  of each pixel.  The deferred pipeline, when selected,
+ *  replaces the prepass and the forward lighting.  A queue
+ *  with orthographic views renders the camera view into the
+ *  lower left quarter of the viewport, where the screen
+ *  space passes expect it, and the other views around it.
+ ***********************************************************/
+void SceneManager::SubmitScene(const RenderQueue* pQueue)
+{
+	if (pQueue->GetOrthoViewCount() > 0)
+	{
+		GLint rect[4];
+		glGetIntegerv(GL_VIEWPORT, m_layoutViewport);
+		GetLayoutRect(0, m_layoutViewport, rect);
+		glViewport(rect[0], rect[1], rect[2], rect[3]);
+	}
 
-	scaleXYZ = glm::vec3(0.09f, 0.25f, 0.1f); //scales our mug handle
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	if (m_bUseShadows && (m_bReuseShadowMaps == false))
+	{
+		RenderShadowMaps(pQueue);
+	}
+	if (m_bUsePointShadows)
+	{
+		RenderPointShadows(pQueue);
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(-1.3f, 5.35f, -1.0f); //places the mug handle
+	m_pLightManager->UploadChanges();
+	if (m_pLightClusters->IsEnabled())
+	{
+		const LightClusters::LIGHT_GRID& grid = pQueue->GetLightGrid();
+		m_pLightClusters->UploadGrid(grid);
+		m_pShaderManager->setVec2Value(g_ClusterDepthParamsName, grid.depthParams);
+		// the grid was built for the window size, and the
+		// fragments of a scaled viewport cover more of it
+		m_pShaderManager->setVec2Value(g_ClusterTileScaleName, grid.tileScale / m_renderScale);
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if (m_bUseAmbientOcclusion)
+	{
+		RenderAmbientOcclusion(pQueue);
+	}
 
-	SetShaderColor(1, 0, 0, 1); //sets the color to red
-	SetShaderTexture("mug");
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawTorusMesh();
+	if ((m_renderPipeline == PIPELINE_DEFERRED) && m_pDeferredRenderer->IsValid())
+	{
+		RenderDeferred(pQueue);
+		m_pShaderManager->use();
+		SubmitDrawCommands(pQueue, false);
+		return;
+	}
 
-	scaleXYZ = glm::vec3(0.09f, 0.25f, 0.1f); //scales our mug handle
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	if (m_bShowOverdraw && m_pDepthPrepass->IsOverdrawValid())
+	{
+		RenderOverdraw(pQueue);
+		m_pShaderManager->use();
+		// the overdraw is only shown for the camera view
+		if (pQueue->GetOrthoViewCount() > 0)
+		{
+			glViewport(m_layoutViewport[0], m_layoutViewport[1], m_layoutViewport[2], m_layoutViewport[3]);
+		}
+		return;
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(1.3f, 5.35f, -1.0f); //places the mug handle
+	bool bDepthPrepass = m_bUseDepthPrepass && m_pDepthPrepass->IsValid();
+	if (bDepthPrepass)
+	{
+		RenderDepthPrepass(pQueue);
+		// back to the scene program for the lighting pass
+		m_pShaderManager->use();
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	SubmitDrawCommands(pQueue, true);
 
-	SetShaderColor(1, 0, 0, 1); //sets the color to red
-	SetShaderTexture("mug");
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawTorusMesh();
+	if (bDepthPrepass)
+	{
+		m_pDepthPrepass->RestoreDepthState();
+	}
+}
 
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by
+ *  recording the draw commands and then submitting them.
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	RecordScene(m_pRenderQueue);
+	SubmitScene(m_pRenderQueue);
 }
+
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  This method is used for defining the placement and the
+ *  appearance of every object in the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineSceneObjects()
+{
+	// places the floor
+	AddSceneObject(
+		MESH_PLANE,
+		glm::vec3(20.0f, 1.0f, 10.0f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 1.0f), "floor", "gravel");
+
+	// places the table leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(3.0f, 1.5f, 3.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), "leg", "metal");
+
+	// places the table leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(-3.0f, 1.5f, 3.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), "leg", "metal");
+
+	// places the table leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(-3.0f, 1.5f, -3.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), "leg", "metal");
+
+	// places the table leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(3.0f, 1.5f, -3.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), "leg", "metal");
+
+	// places the tabletop
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(8.0f, 1.0f, 7.0f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(0.0f, 4.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "tabletop", "wood");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(8.0f, 1.0f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(2.0f, 1.0f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(8.0f, 5.0f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(2.0f, 1.0f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(8.0f, 1.0f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(8.0f, 5.0f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair guard
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.0f, 0.3f, 0.3f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(5.0f, 1.5f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair guard
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.0f, 0.3f, 0.3f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(5.0f, 1.5f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the upper chair guard
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.5f, 0.7f, 0.5f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(4.9f, 3.5f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the upper chair guard
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.5f, 0.7f, 0.5f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(4.9f, 3.5f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair top
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.5f, 0.7f, 3.5f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(5.0f, 3.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "tabletop", "wood");
+
+	// places the chair bar
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(4.0f, 0.7f, 0.5f), 0.0f, 90.0f, 0.0f,
+		glm::vec3(8.0f, 4.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair bar
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(4.0f, 0.7f, 0.5f), 0.0f, 90.0f, 0.0f,
+		glm::vec3(8.0f, 5.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair bar
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(4.0f, 0.7f, 0.5f), 0.0f, 90.0f, 0.0f,
+		glm::vec3(8.0f, 6.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(-8.0f, 1.0f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(-2.0f, 1.0f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(-8.0f, 5.0f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(-2.0f, 1.0f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(-8.0f, 1.0f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair leg
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(5.0f, 0.7f, 0.5f), 0.0f, 0.0f, 90.0f,
+		glm::vec3(-8.0f, 5.0f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair guard
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.0f, 0.3f, 0.3f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-5.0f, 1.5f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair guard
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.0f, 0.3f, 0.3f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-5.0f, 1.5f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the upper chair guard
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.5f, 0.7f, 0.5f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-4.9f, 3.5f, -2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the upper chair guard
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.5f, 0.7f, 0.5f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-4.9f, 3.5f, 2.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair top
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(6.5f, 0.7f, 3.5f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-5.0f, 3.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "tabletop", "wood");
+
+	// places the chair bar
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(4.0f, 0.7f, 0.5f), 0.0f, 90.0f, 0.0f,
+		glm::vec3(-8.0f, 4.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair bar
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(4.0f, 0.7f, 0.5f), 0.0f, 90.0f, 0.0f,
+		glm::vec3(-8.0f, 5.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the chair bar
+	AddSceneObject(
+		MESH_BOX,
+		glm::vec3(4.0f, 0.7f, 0.5f), 0.0f, 90.0f, 0.0f,
+		glm::vec3(-8.0f, 6.5f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "leg", "metal");
+
+	// places the plate
+	AddSceneObject(
+		MESH_TAPERED_CYLINDER,
+		glm::vec3(1.0f, -0.4f, 0.5f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-2.0f, 5.4f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "plate", "porcelain");
+
+	// places the plate
+	AddSceneObject(
+		MESH_TAPERED_CYLINDER,
+		glm::vec3(1.0f, -0.4f, 0.5f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(2.0f, 5.4f, 0.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "plate", "porcelain");
+
+	// places the liquid
+	AddSceneObject(
+		MESH_CYLINDER,
+		glm::vec3(0.3f, 0.02f, 0.2f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(1.0f, 5.68f, -1.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "", "porcelain");
+
+	// places the bottom of the mug
+	AddSceneObject(
+		MESH_CYLINDER,
+		glm::vec3(0.3f, 0.7f, 0.2f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(1.0f, 5.0f, -1.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "mug", "glass");
+
+	// places the liquid
+	AddSceneObject(
+		MESH_CYLINDER,
+		glm::vec3(0.3f, 0.02f, 0.2f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-1.0f, 5.68f, -1.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "", "glass");
+
+	// places the bottom of the mug
+	AddSceneObject(
+		MESH_CYLINDER,
+		glm::vec3(0.3f, 0.7f, 0.2f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-1.0f, 5.0f, -1.0f),
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), "mug", "glass");
+
+	// places the mug handle
+	AddSceneObject(
+		MESH_TORUS,
+		glm::vec3(0.09f, 0.25f, 0.1f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(-1.3f, 5.35f, -1.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), "mug", "glass");
+
+	// places the mug handle
+	AddSceneObject(
+		MESH_TORUS,
+		glm::vec3(0.09f, 0.25f, 0.1f), 0.0f, 0.0f, 0.0f,
+		glm::vec3(1.3f, 5.35f, -1.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, 1.0f), "mug", "glass");
+
+	// places an untextured see-through box over the tabletop,
+	// only when asked for, to check the transparent pass
+	if (m_bAddGlassTestObject)
+	{
+		AddSceneObject(
+			MESH_BOX,
+			glm::vec3(1.0f, 1.0f, 1.0f), 0.0f, 45.0f, 0.0f,
+			glm::vec3(0.0f, 5.5f, 1.0f),
+			glm::vec4(0.75f, 0.85f, 0.9f, 0.35f), "", "glass");
+	}
+}
\ No newline at end of file
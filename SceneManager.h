@@ -11,7 +11,26 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "AmbientOcclusion.h"
+#include "BatchTransforms.h"
+#include "DeferredRenderer.h"
+#include "DepthPrepass.h"
+#include "LightClusters.h"
+#include "LightManager.h"
+#include "LightmapBaker.h"
+#include "LightmapMeshes.h"
+#include "LODMeshes.h"
+#include "PersistentRingBuffer.h"
+#include "PointShadowAtlas.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "ShaderPermutations.h"
+#include "ShadowCascades.h"
+#include "ThreadPool.h"
+#include "WeightedTransparency.h"
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -33,6 +52,8 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		// true for images with an alpha channel
+		bool bHasAlpha;
 	};
 
 	struct OBJECT_MATERIAL
@@ -43,11 +64,181 @@ public:
 		std::string tag;
 	};
 
+	// basic shapes that scene objects can be drawn with
+	enum SCENE_MESH
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_CYLINDER,
+		MESH_TAPERED_CYLINDER,
+		MESH_TORUS
+	};
+
+	// ways of lighting the scene - forward shades every object
+	// with all the lights of its clusters, deferred writes the
+	// surfaces first and lights them in screen space
+	enum RENDER_PIPELINE
+	{
+		PIPELINE_FORWARD = 0,
+		PIPELINE_DEFERRED
+	};
+
+	// appearance of one object in the scene - the texture and
+	// material tags are resolved up front so worker threads
+	// never search by string
+	struct SCENE_OBJECT
+	{
+		int mesh;
+		glm::vec4 color;
+		int textureSlot;
+		int materialIndex;
+		// true when the color or the texture has alpha, so the
+		// object is blended instead of drawn opaque
+		bool bTransparent;
+	};
+
+	// placement of every object in the scene, stored as one
+	// array per value so the transforms compose in SIMD batches
+	struct OBJECT_TRANSFORMS
+	{
+		std::vector<float> scaleX;
+		std::vector<float> scaleY;
+		std::vector<float> scaleZ;
+		std::vector<float> rotationX;
+		std::vector<float> rotationY;
+		std::vector<float> rotationZ;
+		std::vector<float> positionX;
+		std::vector<float> positionY;
+		std::vector<float> positionZ;
+	};
+
 private:
+	// per-object data written into the object buffer - matches
+	// the std430 layout of the shader storage block
+	struct OBJECT_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+	};
+
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
+	// pointer to reduced detail levels of the curved shapes
+	LODMeshes* m_lodMeshes;
+	// worker threads for recording the draw commands
+	ThreadPool* m_pThreadPool;
+	// recorded draw commands of the current frame
+	RenderQueue* m_pRenderQueue;
+	// every light in the scene, and the copy taken for the
+	// frame being updated
+	LightManager* m_pLightManager;
+	std::vector<LightManager::LIGHT> m_frameLights;
+	// assignment of the lights to view clusters
+	LightClusters* m_pLightClusters;
+	// cascaded shadow maps of the directional light
+	ShadowCascades* m_pShadowCascades;
+	// true when the shaders sample the shadow maps
+	bool m_bUseShadows;
+	// true to keep the cascades of the last submitted frame
+	// instead of rendering them again, for the benchmark
+	bool m_bReuseShadowMaps;
+	// texture unit the shadow maps are bound to
+	int m_shadowTextureUnit;
+	// cached point light shadows
+	PointShadowAtlas* m_pPointShadows;
+	bool m_bUsePointShadows;
+	int m_pointShadowTextureUnit;
+	// baked lighting - the unwrapped shapes, the atlas and the
+	// tile of every object
+	LightmapMeshes* m_pLightmapMeshes;
+	bool m_bUseLightmaps;
+	GLuint m_lightmapTextureID;
+	int m_lightmapTextureUnit;
+	std::vector<glm::vec4> m_objectLightmapRects;
+	// screen-space ambient occlusion
+	AmbientOcclusion* m_pAmbientOcclusion;
+	bool m_bUseAmbientOcclusion;
+	int m_ambientOcclusionTextureUnit;
+	// depth-only prepass before the lighting, and the view of
+	// the fragments shaded per pixel
+	DepthPrepass* m_pDepthPrepass;
+	bool m_bUseDepthPrepass;
+	bool m_bShowOverdraw;
+	// deferred shading, used in place of the forward scene
+	// program when selected
+	DeferredRenderer* m_pDeferredRenderer;
+	RENDER_PIPELINE m_renderPipeline;
+	// order-independent blending of the transparent objects
+	WeightedTransparency* m_pTransparency;
+	bool m_bUseTransparency;
+	// true to add a see-through object to the scene
+	bool m_bAddGlassTestObject;
+	// specialized variants of the scene program, the cache
+	// and files they are built from, and the variant features
+	// shared by every draw of the frame being submitted
+	ShaderPermutations* m_pPermutations;
+	ProgramCache* m_pProgramCache;
+	std::string m_vertexShaderPath;
+	std::string m_fragmentShaderPath;
+	int m_framePermutation;
+	// queue being submitted, the view being drawn (-1 for the
+	// camera, then the orthographic views) and whether it is
+	// the transparent pass, for the uniforms of the variants
+	const RenderQueue* m_pSubmitQueue;
+	int m_submitView;
+	bool m_bTransparentPass;
+	// shared transparent commands of the orthographic views in
+	// the back to front order of the view being drawn, and
+	// their view depths
+	std::vector<int> m_orthoDrawOrder;
+	std::vector<float> m_orthoDrawDepths;
+	// objects that make up the 3D scene
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	OBJECT_TRANSFORMS m_objectTransforms;
+	// model matrix and world space bounding sphere of every
+	// object, calculated each frame
+	std::vector<glm::mat4> m_modelMatrices;
+	std::vector<glm::vec4> m_objectBounds;
+	// object moves waiting for the next update, and the
+	// objects moved in the current one
+	struct OBJECT_MOVE
+	{
+		int objectIndex;
+		glm::vec3 positionXYZ;
+	};
+	std::mutex m_moveMutex;
+	std::vector<OBJECT_MOVE> m_pendingMoves;
+	std::vector<int> m_movedObjects;
+	// view and projection used for culling and detail levels
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	int m_viewportHeight;
+	// scale of the projected size detail levels are chosen by,
+	// set on the main thread and read by the update thread
+	std::atomic<float> m_detailScale;
+	// scale of the viewport the scene is rendered into against
+	// the window, only used on the main thread
+	glm::vec2 m_renderScale;
+	// view frustum planes of the current frame
+	glm::vec4 m_frustumPlanes[6];
+	// fixed orthographic views drawn beside the camera view,
+	// their frustum planes, and the projected height in pixels
+	// of one world unit that their detail levels are chosen by
+	int m_orthoViewCount;
+	glm::mat4 m_orthoViews[RenderQueue::MAX_ORTHO_VIEWS];
+	glm::mat4 m_orthoProjections[RenderQueue::MAX_ORTHO_VIEWS];
+	glm::vec4 m_orthoFrustumPlanes[RenderQueue::MAX_ORTHO_VIEWS][6];
+	float m_orthoPixelScale;
+	// viewport the camera and orthographic views are laid out
+	// in, while a frame with orthographic views is submitted
+	GLint m_layoutViewport[4];
+	// persistently mapped per-object data for each frame
+	PersistentRingBuffer* m_pObjectBuffer;
+	// true when the shaders read the object buffer instead of
+	// the model and color uniforms
+	bool m_bUseObjectBuffer;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
@@ -66,6 +257,15 @@ private:
 	int FindTextureSlot(std::string tag);
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(std::string tag);
+
+	// calculate the model matrix from the transformation values
+	static glm::mat4 CalculateModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -95,8 +295,281 @@ private:
 	void SetShaderMaterial(
 		std::string materialTag);
 
+	// add an object to the scene
+	void AddSceneObject(
+		SCENE_MESH mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		glm::vec4 color,
+		std::string textureTag,
+		std::string materialTag);
+
+	// get the object space bounding sphere of a basic shape
+	static void GetMeshBounds(
+		int mesh,
+		glm::vec3& center,
+		float& radius);
+
+	// get the six normalized frustum planes of a combined
+	// view and projection matrix
+	static void ExtractFrustumPlanes(
+		const glm::mat4& viewProjection,
+		glm::vec4* pPlanes);
+
+	// test a world space bounding sphere against six frustum
+	// planes
+	static bool IsSphereVisible(
+		const glm::vec4* pPlanes,
+		glm::vec3 center,
+		float radius);
+
+	// choose a detail level from the projected size of the
+	// world space bounding sphere of the indexed object
+	int SelectMeshLOD(
+		int objectIndex,
+		glm::vec3 center,
+		float radius);
+
+	// cull, transform and record the draw commands and shadow
+	// casters for the objects [begin, end) into the lists of
+	// the indexed thread - called on the worker threads
+	void RecordDrawCommands(
+		int begin,
+		int end,
+		RenderQueue* pQueue,
+		int threadIndex);
+
+	// calculate the world space sphere around every object
+	void CalculateSceneBounds(
+		glm::vec3& center,
+		float& radius);
+
+	// create the shadow maps when the shaders support them
+	void CreateShadowMaps();
+
+	// render the shadow casters of a recorded queue into the
+	// cascades and bind the result for the scene shaders
+	void RenderShadowMaps(const RenderQueue* pQueue);
+	// set the cascade matrices and splits of a frame on the
+	// bound program
+	void SetCascadeUniforms(const ShadowCascades::SHADOW_FRAME& frame);
+
+	// apply the object moves queued since the last update
+	void ApplyObjectMoves();
+
+	// create the point light shadow atlas when the shaders
+	// support it
+	void CreatePointShadows();
+
+	// schedule the point light shadows to render with a queue
+	// and record their casters
+	void RecordPointShadows(RenderQueue* pQueue);
+
+	// render the scheduled point light shadows of a queue
+	void RenderPointShadows(const RenderQueue* pQueue);
+
+	// create the ambient occlusion targets when the shaders
+	// support them
+	void CreateAmbientOcclusion();
+
+	// render the ambient occlusion of a queue's view and bind
+	// it for the scene shaders
+	void RenderAmbientOcclusion(const RenderQueue* pQueue);
+
+	// create the depth prepass programs and overdraw target
+	void CreateDepthPrepass();
+
+	// fill the depth buffer with the commands of a queue and
+	// set the equal depth test for the lighting pass
+	void RenderDepthPrepass(const RenderQueue* pQueue);
+
+	// draw the fragment counts of a queue in place of the
+	// lit scene
+	void RenderOverdraw(const RenderQueue* pQueue);
+
+	// create the G-buffer and the deferred programs
+	void CreateDeferredRenderer();
+
+	// draw the commands of a queue into the G-buffer and light
+	// them with the lights of the queue
+	void RenderDeferred(const RenderQueue* pQueue);
+
+	// create the object buffer when the shaders support it
+	void CreateObjectBuffer();
+
+	// issue the OpenGL calls for the recorded commands - the
+	// opaque ones only when bOpaque is true
+	void SubmitDrawCommands(const RenderQueue* pQueue, bool bOpaque);
+	// draw a list of commands with the scene program - in the
+	// passed in order of command indices when there is one
+	void DrawCommandRange(
+		const std::vector<RenderQueue::DRAW_COMMAND>& commands,
+		int firstObject,
+		const std::vector<int>* pDrawOrder = NULL);
+
+	// create the transparency targets when the shaders
+	// support them
+	void CreateTransparency();
+
+	// draw the transparent commands of a queue over the
+	// opaque scene
+	void RenderTransparency(const RenderQueue* pQueue);
+
+	// get the part of the layout viewport that the camera view
+	// (index 0) or an orthographic view (1 and up) covers
+	static void GetLayoutRect(
+		int viewIndex,
+		const GLint* pViewport,
+		GLint* pRect);
+
+	// draw the shared commands of a queue into each of its
+	// orthographic views - the index of the first command in
+	// the object buffer is passed in
+	void RenderOrthoViews(const RenderQueue* pQueue, int firstObject);
+
+	// read the scene shader files for their variants when
+	// they support them
+	void CreateShaderPermutations();
+	// get the variant features of a queue that are the same
+	// for every draw
+	int GetFramePermutation(const RenderQueue* pQueue) const;
+	// set the camera of a view of the queue being submitted
+	// on the bound program
+	void SetViewUniforms(int view);
+	// set the uniforms the passes of the frame being submitted
+	// share on a bound variant
+	void SetVariantUniforms();
+
+	// draw a basic shape at the passed in detail level
+	void DrawSceneMesh(int mesh, int lodLevel);
+	// draw the mesh of a recorded command, unwrapped when the
+	// object is lightmapped
+	void DrawCommandMesh(const RenderQueue::DRAW_COMMAND& command);
+
+	// get the average color of a loaded texture from its
+	// smallest mipmap
+	glm::vec3 GetTextureAverageColor(int textureSlot);
+
 public:
 
+	// set the shadow map size and cascade count - must be
+	// called before PrepareScene()
+	void SetShadowQuality(int resolution, int cascadeCount);
+	// set the point light shadow atlas size, the size of one
+	// cube face and how many lights may be rendered per frame
+	// - must be called before PrepareScene()
+	void SetPointShadowQuality(int atlasSize, int tileSize, int updatesPerFrame);
+
+	// set the highest ambient occlusion tier and the GPU time
+	// in milliseconds it may take, zero for no limit - can be
+	// called at runtime from the main thread
+	void SetAmbientOcclusionQuality(AmbientOcclusion::AO_QUALITY quality);
+	void SetAmbientOcclusionBudget(float milliseconds);
+	AmbientOcclusion::AO_QUALITY GetAmbientOcclusionQuality() const;
+
+	// turn the depth prepass and the overdraw view on or off
+	// - can be called at runtime from the main thread
+	void SetDepthPrepass(bool bEnabled) { m_bUseDepthPrepass = bEnabled; }
+	bool IsDepthPrepassEnabled() const { return(m_bUseDepthPrepass); }
+	void SetOverdrawView(bool bEnabled) { m_bShowOverdraw = bEnabled; }
+	bool IsOverdrawViewEnabled() const { return(m_bShowOverdraw); }
+
+	// scale the projected size of the objects when choosing
+	// their detail levels, below 1 for coarser levels - can
+	// be called at runtime from the main thread
+	void SetDetailScale(float scale) { m_detailScale = scale; }
+	float GetDetailScale() const { return(m_detailScale); }
+	// set the scale of the viewport the scene is rendered into
+	// against the window size the view was recorded with -
+	// called on the main thread before each frame is submitted
+	void SetRenderScale(float widthScale, float heightScale) { m_renderScale = glm::vec2(widthScale, heightScale); }
+
+	// add a see-through test object to the scene - must be
+	// called before PrepareScene()
+	void SetGlassTestObject(bool bEnabled) { m_bAddGlassTestObject = bEnabled; }
+
+	// select the forward or deferred pipeline - can be called
+	// at runtime from the main thread
+	void SetRenderPipeline(RENDER_PIPELINE pipeline);
+	RENDER_PIPELINE GetRenderPipeline() const { return(m_renderPipeline); }
+
+	// set the program cache and the files of the scene
+	// program, which its specialized variants are built from
+	// - must be called before PrepareScene()
+	void SetShaderFiles(
+		ProgramCache* pProgramCache,
+		const char* vertexPath,
+		const char* fragmentPath);
+
+	// set the uniforms that are only set once on the scene
+	// program again, after the program was replaced while
+	// running, and take the variants built with it - the
+	// shader features found when the scene was prepared are
+	// kept
+	void OnProgramReloaded(ShaderPermutations& permutations);
+
+	// create the screen sized targets again at the passed in
+	// size, after the window was resized - must be called on
+	// the main thread between frames
+	void ResizeTargets(int width, int height);
+
+	// time both pipelines over the passed in numbers of point
+	// lights from the current view and print the results -
+	// adds the lights to the scene, meant to be run offline
+	void BenchmarkPipelines(
+		const std::vector<int>& lightCounts,
+		int frameCount);
+
+	// move an object - can be called from any thread, the
+	// move is applied with the next update
+	void MoveSceneObject(int objectIndex, glm::vec3 positionXYZ);
+
+	// get the lights of the scene for changing them at runtime
+	// - the changes are applied with the next update
+	LightManager* GetLightManager() { return(m_pLightManager); }
+
+	// path trace the lighting of the prepared scene into a
+	// lightmap file - slow, meant to be run offline
+	bool BakeLightmaps(
+		const char* filename,
+		int atlasSize,
+		int samplesPerTexel,
+		int bounceCount);
+	// load a baked lightmap for the prepared scene - returns
+	// false when the shaders do not support lightmaps or the
+	// file does not match the scene
+	bool LoadLightmaps(const char* filename);
+
+	// set the camera matrices used for detail level selection
+	void SetViewParameters(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		int viewportHeight);
+
+	// set the fixed orthographic views recorded beside the
+	// camera view, none to only record the camera view - must
+	// be called after SetViewParameters()
+	void SetOrthoViews(
+		int viewCount,
+		const glm::mat4* pViews,
+		const glm::mat4* pProjections);
+
+	// get a sphere around every object of the prepared scene
+	// - must be called before the frame pipeline starts
+	void GetSceneBounds(glm::vec3& center, float& radius) { CalculateSceneBounds(center, radius); }
+
+	// number of threads that record into a render queue
+	int GetRecordThreadCount() const;
+	// record the draw commands for the current view into the
+	// passed in queue - makes no OpenGL calls, so it can run
+	// on the frame pipeline update thread
+	void RecordScene(RenderQueue* pQueue);
+	// issue the OpenGL calls for a recorded queue
+	void SubmitScene(const RenderQueue* pQueue);
+
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
@@ -106,5 +579,6 @@ public:
 	void LoadSceneTextures();
 	void DefineObjectMaterials();
 	void SetupSceneLights();
+	void DefineSceneObjects();
 
 };
\ No newline at end of file
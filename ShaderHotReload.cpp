@@ -0,0 +1,349 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderhotreload.cpp
+// ============
+// rebuild the scene program in the background when its GLSL files change
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderHotReload.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// time in milliseconds without further file events before
+	// a change is rebuilt - editors often save in several steps
+	const int g_SettleTimeMs = 100;
+
+	// get the directory of a path, with the trailing slash
+	std::string GetDirectory(const std::string& path)
+	{
+		size_t slash = path.find_last_of('/');
+		if (slash == std::string::npos)
+		{
+			return("./");
+		}
+		return(path.substr(0, slash + 1));
+	}
+
+	// get the file name of a path
+	std::string GetFileName(const std::string& path)
+	{
+		size_t slash = path.find_last_of('/');
+		if (slash == std::string::npos)
+		{
+			return(path);
+		}
+		return(path.substr(slash + 1));
+	}
+}
+
+/***********************************************************
+ *  ShaderHotReload()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderHotReload::ShaderHotReload(ProgramCache* pProgramCache)
+{
+	m_pProgramCache = pProgramCache;
+	m_pContextWindow = NULL;
+	m_watchDescriptor = -1;
+	m_stopPipe[0] = -1;
+	m_stopPipe[1] = -1;
+	m_pendingProgramID = 0;
+	m_pendingFence = 0;
+}
+
+/***********************************************************
+ *  ~ShaderHotReload()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderHotReload::~ShaderHotReload()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for watching the directories of the
+ *  shader files, creating the hidden window whose context
+ *  shares its objects with the main window and starting
+ *  the worker thread.
+ ***********************************************************/
+bool ShaderHotReload::Start(
+	GLFWwindow* pMainWindow,
+	const char* vertexPath,
+	const char* fragmentPath)
+{
+	Stop();
+
+	m_vertexPath = vertexPath;
+	m_fragmentPath = fragmentPath;
+
+#ifdef __linux__
+	m_watchDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_watchDescriptor < 0)
+	{
+		std::cout << "Shader files can not be watched" << std::endl;
+		return(false);
+	}
+	// the directories are watched, since editors often save
+	// by writing a new file and moving it over the old one
+	const std::string paths[2] = { m_vertexPath, m_fragmentPath };
+	for (int i = 0; i < 2; i++)
+	{
+		if (inotify_add_watch(
+			m_watchDescriptor,
+			GetDirectory(paths[i]).c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+		{
+			std::cout << "Shader files can not be watched:" << paths[i] << std::endl;
+			Stop();
+			return(false);
+		}
+	}
+	if (pipe(m_stopPipe) != 0)
+	{
+		m_stopPipe[0] = -1;
+		m_stopPipe[1] = -1;
+		Stop();
+		return(false);
+	}
+
+	// the window is never shown, it only carries the context
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	m_pContextWindow = glfwCreateWindow(1, 1, "", NULL, pMainWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (NULL == m_pContextWindow)
+	{
+		std::cout << "Shader reload context could not be created" << std::endl;
+		Stop();
+		return(false);
+	}
+
+	m_workerThread = std::thread(&ShaderHotReload::WorkerLoop, this);
+
+	return(true);
+#else
+	std::cout << "Shader hot reload is only available on Linux" << std::endl;
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for waking and joining the worker
+ *  thread and freeing the watch, the hidden window and a
+ *  program and variants that were never taken.  Called on the main thread
+ *  with the main context current.
+ ***********************************************************/
+void ShaderHotReload::Stop()
+{
+#ifdef __linux__
+	if (m_workerThread.joinable())
+	{
+		char wake = 0;
+		if (write(m_stopPipe[1], &wake, 1) != 1)
+		{
+			std::cout << "Shader reload thread could not be woken" << std::endl;
+		}
+		m_workerThread.join();
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		if (m_stopPipe[i] >= 0)
+		{
+			close(m_stopPipe[i]);
+			m_stopPipe[i] = -1;
+		}
+	}
+	if (m_watchDescriptor >= 0)
+	{
+		close(m_watchDescriptor);
+		m_watchDescriptor = -1;
+	}
+#endif
+
+	if (NULL != m_pContextWindow)
+	{
+		glfwDestroyWindow(m_pContextWindow);
+		m_pContextWindow = NULL;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_pendingProgramID != 0)
+	{
+		glDeleteSync(m_pendingFence);
+		glDeleteProgram(m_pendingProgramID);
+		m_pendingPermutations.Destroy();
+		m_pendingProgramID = 0;
+		m_pendingFence = 0;
+	}
+}
+
+/***********************************************************
+ *  TakeReloadedProgram()
+ *
+ *  This method is used for handing a rebuilt program and its
+ *  variants to the main thread.  They are only handed over
+ *  once the fence behind their links has signalled, so
+ *  using them can not wait for the worker's commands.
+ ***********************************************************/
+GLuint ShaderHotReload::TakeReloadedProgram(ShaderPermutations& permutations)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_pendingProgramID == 0)
+	{
+		return(0);
+	}
+	GLenum result = glClientWaitSync(m_pendingFence, 0, 0);
+	if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+	{
+		return(0);
+	}
+
+	GLuint programID = m_pendingProgramID;
+	permutations.TakeVariants(m_pendingPermutations);
+	glDeleteSync(m_pendingFence);
+	m_pendingProgramID = 0;
+	m_pendingFence = 0;
+
+	return(programID);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used for running the worker thread.  The
+ *  shared context stays current on it for its whole life.
+ ***********************************************************/
+void ShaderHotReload::WorkerLoop()
+{
+	glfwMakeContextCurrent(m_pContextWindow);
+
+	while (WaitForChange())
+	{
+		ReloadProgram();
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *  WaitForChange()
+ *
+ *  This method is used for blocking until one of the shader
+ *  files was written and no other event followed for the
+ *  settle time.  Events of other files in the directories
+ *  are ignored.
+ ***********************************************************/
+bool ShaderHotReload::WaitForChange()
+{
+#ifdef __linux__
+	const std::string vertexName = GetFileName(m_vertexPath);
+	const std::string fragmentName = GetFileName(m_fragmentPath);
+	alignas(struct inotify_event) char buffer[4096];
+	bool bChanged = false;
+
+	struct pollfd descriptors[2];
+	descriptors[0].fd = m_watchDescriptor;
+	descriptors[0].events = POLLIN;
+	descriptors[1].fd = m_stopPipe[0];
+	descriptors[1].events = POLLIN;
+
+	while (true)
+	{
+		descriptors[0].revents = 0;
+		descriptors[1].revents = 0;
+		int ready = poll(descriptors, 2, bChanged ? g_SettleTimeMs : -1);
+		if (descriptors[1].revents != 0)
+		{
+			return(false);
+		}
+		if (ready == 0)
+		{
+			// settled after a change
+			return(true);
+		}
+		if (ready < 0)
+		{
+			continue;
+		}
+
+		ssize_t length = 0;
+		while ((length = read(m_watchDescriptor, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* pEvent = buffer; pEvent < buffer + length; )
+			{
+				const struct inotify_event* pInfo = (const struct inotify_event*)pEvent;
+				if ((pInfo->len > 0) &&
+					((vertexName == pInfo->name) || (fragmentName == pInfo->name)))
+				{
+					bChanged = true;
+				}
+				pEvent += sizeof(struct inotify_event) + pInfo->len;
+			}
+		}
+	}
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  ReloadProgram()
+ *
+ *  This method is used for building the program and its
+ *  variants from the changed files and queueing them for
+ *  the main thread, so no variant is compiled by the first
+ *  frames that draw with it.  The link status is read here,
+ *  which makes the driver finish the links on this thread
+ *  instead of at the first draw.
+ ***********************************************************/
+void ShaderHotReload::ReloadProgram()
+{
+	GLuint programID = m_pProgramCache->LoadProgram(
+		m_vertexPath.c_str(),
+		m_fragmentPath.c_str());
+	if (programID == 0)
+	{
+		std::cout << "Shader reload failed, keeping the running program" << std::endl;
+		return;
+	}
+
+	// variants that fail to build fall back to the program
+	ShaderPermutations permutations;
+	if (permutations.Create(
+		m_pProgramCache,
+		m_vertexPath.c_str(),
+		m_fragmentPath.c_str()))
+	{
+		permutations.BuildAll();
+	}
+
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// a program the main thread never took is replaced
+	if (m_pendingProgramID != 0)
+	{
+		glDeleteSync(m_pendingFence);
+		glDeleteProgram(m_pendingProgramID);
+	}
+	m_pendingProgramID = programID;
+	m_pendingPermutations.TakeVariants(permutations);
+	m_pendingFence = fence;
+
+	std::cout << "Shaders reloaded" << std::endl;
+}
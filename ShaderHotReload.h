@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderhotreload.h
+// ============
+// rebuild the scene program in the background when its GLSL files change
+//
+//  A worker thread watches the shader files and, after a change, compiles
+//  and links the program and all of its variants in a hidden context
+//  shared with the main window.  The main thread takes the new program and
+//  variants between frames once their fence has signalled, so the compile
+//  never stalls a frame.  A program that fails to build is dropped and the
+//  running one is kept.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ProgramCache.h"
+#include "ShaderPermutations.h"
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <mutex>
+#include <string>
+#include <thread>
+
+/***********************************************************
+ *  ShaderHotReload
+ *
+ *  This class contains the file watch, the worker thread and
+ *  its context, and the program and variants waiting to be
+ *  swapped in.
+ ***********************************************************/
+class ShaderHotReload
+{
+public:
+	// constructor - the rebuilt programs are linked through
+	// the passed in cache, so they are saved for the next run
+	ShaderHotReload(ProgramCache* pProgramCache);
+	// destructor
+	~ShaderHotReload();
+
+	// start watching the shader files - called on the main
+	// thread, which owns the main window.  returns false when
+	// the files can not be watched
+	bool Start(
+		GLFWwindow* pMainWindow,
+		const char* vertexPath,
+		const char* fragmentPath);
+	// stop the worker thread and free its context
+	void Stop();
+
+	// get a rebuilt program that is ready to be used, or 0 -
+	// the caller owns the program and deletes the old one.
+	// the variants built with it are moved into the passed
+	// in permutations
+	GLuint TakeReloadedProgram(ShaderPermutations& permutations);
+
+private:
+	// pointer to the program cache object
+	ProgramCache* m_pProgramCache;
+	// the watched files
+	std::string m_vertexPath;
+	std::string m_fragmentPath;
+	// hidden window that owns the worker's shared context
+	GLFWwindow* m_pContextWindow;
+	// file watch and the pipe that wakes the worker to stop
+	int m_watchDescriptor;
+	int m_stopPipe[2];
+	std::thread m_workerThread;
+	// rebuilt program, its variants and the fence of their
+	// commands, guarded by the mutex
+	std::mutex m_mutex;
+	GLuint m_pendingProgramID;
+	ShaderPermutations m_pendingPermutations;
+	GLsync m_pendingFence;
+
+	// main loop of the worker thread
+	void WorkerLoop();
+	// wait for a change of one of the shader files - returns
+	// false when the worker is stopped
+	bool WaitForChange();
+	// rebuild the program and its variants and hand them to
+	// the main thread
+	void ReloadProgram();
+};
@@ -0,0 +1,263 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.cpp
+// ============
+// specialized variants of the scene program, compiled on first use
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderPermutations.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// point lights looped over in each light bucket - the
+	// fixed point light array of the fragment shader holds 3
+	const int g_LightBucketCounts[ShaderPermutations::LIGHT_BUCKET_COUNT] = { 0, 1, 2, 3 };
+}
+
+/***********************************************************
+ *  ShaderPermutations()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderPermutations::ShaderPermutations()
+{
+	m_pProgramCache = NULL;
+	m_bEnabled = false;
+	for (int i = 0; i < PERMUTATION_COUNT; i++)
+	{
+		m_permutations[i].programID = 0;
+		m_permutations[i].bFailed = false;
+	}
+}
+
+/***********************************************************
+ *  ~ShaderPermutations()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderPermutations::~ShaderPermutations()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for reading the scene shader files
+ *  the variants are built from.
+ ***********************************************************/
+bool ShaderPermutations::Create(
+	ProgramCache* pProgramCache,
+	const char* vertexPath,
+	const char* fragmentPath)
+{
+	Destroy();
+
+	if (NULL == pProgramCache)
+	{
+		return(false);
+	}
+	if ((ProgramCache::ReadSourceFile(vertexPath, m_vertexSource) == false) ||
+		(ProgramCache::ReadSourceFile(fragmentPath, m_fragmentSource) == false))
+	{
+		return(false);
+	}
+	if ((m_vertexSource.find("PERMUTATION_KEY") == std::string::npos) &&
+		(m_fragmentSource.find("PERMUTATION_KEY") == std::string::npos))
+	{
+		return(false);
+	}
+
+	m_sourceName = ProgramCache::MakeSourceName(
+		vertexPath,
+		fragmentPath,
+		m_vertexSource,
+		m_fragmentSource);
+	m_pProgramCache = pProgramCache;
+	m_bEnabled = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the linked variants.
+ ***********************************************************/
+void ShaderPermutations::Destroy()
+{
+	for (int i = 0; i < PERMUTATION_COUNT; i++)
+	{
+		if (m_permutations[i].programID != 0)
+		{
+			glDeleteProgram(m_permutations[i].programID);
+		}
+		m_permutations[i].programID = 0;
+		m_permutations[i].bFailed = false;
+	}
+	m_bEnabled = false;
+}
+
+/***********************************************************
+ *  TakeVariants()
+ *
+ *  This method is used for replacing the variants with the
+ *  ones another object built, for variants linked on another
+ *  thread in a shared context.
+ ***********************************************************/
+void ShaderPermutations::TakeVariants(ShaderPermutations& other)
+{
+	Destroy();
+
+	m_pProgramCache = other.m_pProgramCache;
+	m_vertexSource.swap(other.m_vertexSource);
+	m_fragmentSource.swap(other.m_fragmentSource);
+	m_sourceName.swap(other.m_sourceName);
+	m_bEnabled = other.m_bEnabled;
+	for (int i = 0; i < PERMUTATION_COUNT; i++)
+	{
+		m_permutations[i] = other.m_permutations[i];
+		other.m_permutations[i].programID = 0;
+		other.m_permutations[i].bFailed = false;
+	}
+	other.m_bEnabled = false;
+}
+
+/***********************************************************
+ *  GetLightBucket()
+ *
+ *  This method is used for getting the smallest bucket that
+ *  loops over the passed in number of point lights.
+ ***********************************************************/
+int ShaderPermutations::GetLightBucket(int pointLightCount)
+{
+	for (int bucket = 0; bucket < LIGHT_BUCKET_COUNT - 1; bucket++)
+	{
+		if (pointLightCount <= g_LightBucketCounts[bucket])
+		{
+			return(bucket);
+		}
+	}
+
+	return(LIGHT_BUCKET_COUNT - 1);
+}
+
+/***********************************************************
+ *  Activate()
+ *
+ *  This method is used for getting the variant of a key.
+ *  Its uniforms are left as the last draws with it set
+ *  them.
+ ***********************************************************/
+GLuint ShaderPermutations::Activate(int key)
+{
+	if ((m_bEnabled == false) || (key < 0) || (key >= PERMUTATION_COUNT))
+	{
+		return(0);
+	}
+
+	if (BuildPermutation(key) == false)
+	{
+		return(0);
+	}
+
+	return(m_permutations[key].programID);
+}
+
+/***********************************************************
+ *  BuildAll()
+ *
+ *  This method is used for linking every variant up front,
+ *  which checks that all of them compile and fills the
+ *  program cache for later runs.
+ ***********************************************************/
+int ShaderPermutations::BuildAll()
+{
+	int failedCount = 0;
+
+	if (m_bEnabled == false)
+	{
+		return(0);
+	}
+	for (int key = 0; key < PERMUTATION_COUNT; key++)
+	{
+		if (BuildPermutation(key) == false)
+		{
+			failedCount++;
+		}
+	}
+
+	return(failedCount);
+}
+
+/***********************************************************
+ *  BuildPermutation()
+ *
+ *  This method is used for linking the variant of a key
+ *  through the program cache, so only the first run ever
+ *  compiles it.  A variant that does not build is not tried
+ *  again.
+ ***********************************************************/
+bool ShaderPermutations::BuildPermutation(int key)
+{
+	PERMUTATION& permutation = m_permutations[key];
+
+	if ((permutation.programID == 0) && (permutation.bFailed == false))
+	{
+		permutation.programID = m_pProgramCache->LoadProgramSources(
+			AddDefines(m_vertexSource, key),
+			AddDefines(m_fragmentSource, key),
+			m_sourceName);
+		if (permutation.programID == 0)
+		{
+			std::cout << "Shader permutation " << key << " failed, using the scene program" << std::endl;
+			permutation.bFailed = true;
+			return(false);
+		}
+	}
+
+	return(permutation.programID != 0);
+}
+
+/***********************************************************
+ *  AddDefines()
+ *
+ *  This method is used for specializing a source for a key.
+ *  The defines go after the #version line, which must come
+ *  first, and a #line directive keeps the line numbers of
+ *  compile errors matching the file.
+ ***********************************************************/
+std::string ShaderPermutations::AddDefines(const std::string& source, int key)
+{
+	std::string defines;
+	defines += "#define PERMUTATION_KEY " + std::to_string(key) + "\n";
+	defines += "#define USE_TEXTURE " + std::to_string((key & PERMUTATION_TEXTURED) ? 1 : 0) + "\n";
+	defines += "#define USE_LIGHTING " + std::to_string((key & PERMUTATION_LIT) ? 1 : 0) + "\n";
+	defines += "#define USE_SHADOWS " + std::to_string((key & PERMUTATION_SHADOWED) ? 1 : 0) + "\n";
+	defines += "#define LIGHT_COUNT " + std::to_string(g_LightBucketCounts[key >> LIGHT_BUCKET_SHIFT]) + "\n";
+
+	size_t version = source.find("#version");
+	if (version == std::string::npos)
+	{
+		return(defines + source);
+	}
+	size_t lineEnd = source.find('\n', version);
+	if (lineEnd == std::string::npos)
+	{
+		return(source + "\n" + defines);
+	}
+
+	int nextLine = 2;
+	for (size_t i = 0; i < version; i++)
+	{
+		if (source[i] == '\n')
+		{
+			nextLine++;
+		}
+	}
+	defines += "#line " + std::to_string(nextLine) + "\n";
+
+	return(source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1));
+}
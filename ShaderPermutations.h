@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.h
+// ============
+// specialized variants of the scene program, compiled on first use
+//
+//  Each variant is the scene shader source with a block of #defines after
+//  its #version line, so the branches on texturing, lighting and shadows
+//  and the point light loop are resolved by the compiler instead of per
+//  fragment.  The variants declare the uniforms of the scene program they
+//  still use, and the scene sets the ones its passes share on a variant
+//  when the draws switch to it.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ProgramCache.h"
+
+#include <GL/glew.h>
+
+#include <string>
+
+/***********************************************************
+ *  ShaderPermutations
+ *
+ *  This class contains the scene shader sources and the
+ *  linked variants.
+ ***********************************************************/
+class ShaderPermutations
+{
+public:
+	// features of a variant, combined into its key with the
+	// light bucket above them
+	enum PERMUTATION_FLAGS
+	{
+		PERMUTATION_TEXTURED = 1,
+		PERMUTATION_LIT = 2,
+		PERMUTATION_SHADOWED = 4
+	};
+	static const int LIGHT_BUCKET_SHIFT = 3;
+	static const int LIGHT_BUCKET_COUNT = 4;
+	static const int PERMUTATION_COUNT = LIGHT_BUCKET_COUNT << LIGHT_BUCKET_SHIFT;
+
+	// constructor
+	ShaderPermutations();
+	// destructor
+	~ShaderPermutations();
+
+	// read the scene shader files - the variants are only used
+	// when the sources test PERMUTATION_KEY.  returns false
+	// when they do not
+	bool Create(
+		ProgramCache* pProgramCache,
+		const char* vertexPath,
+		const char* fragmentPath);
+	// free the variants
+	void Destroy();
+	// free the variants and take the sources and variants of
+	// another object, which is left empty
+	void TakeVariants(ShaderPermutations& other);
+	bool IsEnabled() const { return(m_bEnabled); }
+
+	// get the light bucket of a number of point lights
+	static int GetLightBucket(int pointLightCount);
+
+	// get the variant of a key, linking it the first time -
+	// returns 0 when the variant does not build, so the scene
+	// program is used
+	GLuint Activate(int key);
+	// link every variant that is not linked yet - returns the
+	// number that failed to build
+	int BuildAll();
+
+private:
+	// a variant, linked on first use
+	struct PERMUTATION
+	{
+		GLuint programID;
+		bool bFailed;
+	};
+
+	// pointer to the program cache object
+	ProgramCache* m_pProgramCache;
+	// the unspecialized sources, and their name in the
+	// program cache
+	std::string m_vertexSource;
+	std::string m_fragmentSource;
+	std::string m_sourceName;
+	bool m_bEnabled;
+	PERMUTATION m_permutations[PERMUTATION_COUNT];
+
+	// link the variant of a key the first time it is needed -
+	// returns false when it does not build
+	bool BuildPermutation(int key);
+	// insert the defines of a key after the #version line
+	static std::string AddDefines(const std::string& source, int key);
+};
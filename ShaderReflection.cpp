@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderreflection.cpp
+// ============
+// write the interface of a linked program as a C++ header
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderReflection.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// the table types, guarded so several generated headers
+	// can be included together
+	const char* g_TableTypes =
+		"#ifndef SHADER_REFLECTION_TYPES\n"
+		"#define SHADER_REFLECTION_TYPES\n"
+		"// a uniform outside of blocks - types are OpenGL enums\n"
+		"struct SHADER_UNIFORM_INFO\n"
+		"{\n"
+		"\tconst char* name;\n"
+		"\tint location;\n"
+		"\tunsigned int type;\n"
+		"\tint arraySize;\n"
+		"};\n"
+		"// a uniform or shader storage block\n"
+		"struct SHADER_BLOCK_INFO\n"
+		"{\n"
+		"\tconst char* name;\n"
+		"\tunsigned int interfaceType;\n"
+		"\tint binding;\n"
+		"\tint dataSize;\n"
+		"};\n"
+		"// a member of a block, with its offset and strides in bytes\n"
+		"struct SHADER_BLOCK_MEMBER_INFO\n"
+		"{\n"
+		"\tconst char* blockName;\n"
+		"\tconst char* name;\n"
+		"\tint offset;\n"
+		"\tunsigned int type;\n"
+		"\tint arraySize;\n"
+		"\tint arrayStride;\n"
+		"\tint topLevelArrayStride;\n"
+		"};\n"
+		"#endif\n";
+
+	// get the name of a program resource
+	std::string GetResourceName(GLuint programID, GLenum programInterface, GLuint index)
+	{
+		char name[256];
+		GLsizei length = 0;
+
+		glGetProgramResourceName(programID, programInterface, index, sizeof(name), &length, name);
+
+		return(std::string(name, length));
+	}
+
+	// get the number of active resources of an interface
+	GLint GetResourceCount(GLuint programID, GLenum programInterface)
+	{
+		GLint count = 0;
+
+		glGetProgramInterfaceiv(programID, programInterface, GL_ACTIVE_RESOURCES, &count);
+
+		return(count);
+	}
+}
+
+/***********************************************************
+ *  WriteHeader()
+ *
+ *  This method is used for writing the interface of a
+ *  program.  Every table ends with an empty entry, so none
+ *  of them is an empty array, and the count leaves it out.
+ *  The program interface queries came with OpenGL 4.3.
+ ***********************************************************/
+bool ShaderReflection::WriteHeader(
+	GLuint programID,
+	const char* prefix,
+	const char* filename)
+{
+	if ((programID == 0) || !GLEW_VERSION_4_3)
+	{
+		std::cout << "Shader reflection needs a linked program and OpenGL 4.3" << std::endl;
+		return(false);
+	}
+
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not write shader reflection:" << filename << std::endl;
+		return(false);
+	}
+
+	std::string name = filename;
+	size_t slash = name.find_last_of('/');
+	if (slash != std::string::npos)
+	{
+		name = name.substr(slash + 1);
+	}
+
+	file << "///////////////////////////////////////////////////////////////////////////////\n";
+	file << "// " << name << "\n";
+	file << "// ============\n";
+	file << "// interface of the scene program - generated by --validate-shaders, do not\n";
+	file << "// edit\n";
+	file << "///////////////////////////////////////////////////////////////////////////////\n\n";
+	file << "#pragma once\n\n";
+	file << g_TableTypes << "\n";
+
+	WriteUniforms(file, programID, prefix);
+	WriteBlocks(file, programID, prefix);
+	WriteBlockMembers(file, programID, prefix);
+
+	return(file.good());
+}
+
+/***********************************************************
+ *  WriteUniforms()
+ *
+ *  This method is used for writing the uniforms that are
+ *  not in a block, with the location the driver assigned.
+ ***********************************************************/
+void ShaderReflection::WriteUniforms(std::ostream& file, GLuint programID, const char* prefix)
+{
+	const GLenum properties[4] = { GL_BLOCK_INDEX, GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+	GLint uniformCount = GetResourceCount(programID, GL_UNIFORM);
+	int writtenCount = 0;
+
+	file << "const SHADER_UNIFORM_INFO " << prefix << "Uniforms[] =\n{\n";
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLint values[4];
+		glGetProgramResourceiv(programID, GL_UNIFORM, i, 4, properties, 4, NULL, values);
+		if (values[0] >= 0)
+		{
+			continue;
+		}
+
+		file << "\t{ \"" << GetResourceName(programID, GL_UNIFORM, i) << "\", "
+			<< values[1] << ", 0x" << std::hex << values[2] << std::dec << ", "
+			<< values[3] << " },\n";
+		writtenCount++;
+	}
+	file << "\t{ 0, -1, 0, 0 }\n};\n";
+	file << "const int " << prefix << "UniformCount = " << writtenCount << ";\n\n";
+}
+
+/***********************************************************
+ *  WriteBlocks()
+ *
+ *  This method is used for writing the uniform and storage
+ *  blocks with their binding points and data sizes.
+ ***********************************************************/
+void ShaderReflection::WriteBlocks(std::ostream& file, GLuint programID, const char* prefix)
+{
+	const GLenum blockInterfaces[2] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+	const GLenum properties[2] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+	int writtenCount = 0;
+
+	file << "const SHADER_BLOCK_INFO " << prefix << "Blocks[] =\n{\n";
+	for (int blockInterface = 0; blockInterface < 2; blockInterface++)
+	{
+		GLint blockCount = GetResourceCount(programID, blockInterfaces[blockInterface]);
+		for (GLint i = 0; i < blockCount; i++)
+		{
+			GLint values[2];
+			glGetProgramResourceiv(programID, blockInterfaces[blockInterface], i, 2, properties, 2, NULL, values);
+
+			file << "\t{ \"" << GetResourceName(programID, blockInterfaces[blockInterface], i) << "\", 0x"
+				<< std::hex << blockInterfaces[blockInterface] << std::dec << ", "
+				<< values[0] << ", " << values[1] << " },\n";
+			writtenCount++;
+		}
+	}
+	file << "\t{ 0, 0, -1, 0 }\n};\n";
+	file << "const int " << prefix << "BlockCount = " << writtenCount << ";\n\n";
+}
+
+/***********************************************************
+ *  WriteBlockMembers()
+ *
+ *  This method is used for writing the members of the
+ *  blocks with their byte offsets and strides, which is
+ *  what a CPU side struct has to match.
+ ***********************************************************/
+void ShaderReflection::WriteBlockMembers(std::ostream& file, GLuint programID, const char* prefix)
+{
+	const GLenum memberInterfaces[2] = { GL_UNIFORM, GL_BUFFER_VARIABLE };
+	const GLenum blockInterfaces[2] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+	const GLenum properties[6] = { GL_BLOCK_INDEX, GL_OFFSET, GL_TYPE, GL_ARRAY_SIZE, GL_ARRAY_STRIDE, GL_TOP_LEVEL_ARRAY_STRIDE };
+	int writtenCount = 0;
+
+	file << "const SHADER_BLOCK_MEMBER_INFO " << prefix << "BlockMembers[] =\n{\n";
+	for (int memberInterface = 0; memberInterface < 2; memberInterface++)
+	{
+		// uniforms have no top level array stride
+		GLsizei propertyCount = (memberInterfaces[memberInterface] == GL_UNIFORM) ? 5 : 6;
+		GLint memberCount = GetResourceCount(programID, memberInterfaces[memberInterface]);
+		for (GLint i = 0; i < memberCount; i++)
+		{
+			GLint values[6] = { -1, 0, 0, 0, 0, 0 };
+			glGetProgramResourceiv(programID, memberInterfaces[memberInterface], i, propertyCount, properties, 6, NULL, values);
+			if (values[0] < 0)
+			{
+				continue;
+			}
+
+			file << "\t{ \"" << GetResourceName(programID, blockInterfaces[memberInterface], values[0]) << "\", \""
+				<< GetResourceName(programID, memberInterfaces[memberInterface], i) << "\", "
+				<< values[1] << ", 0x" << std::hex << values[2] << std::dec << ", "
+				<< values[3] << ", " << values[4] << ", " << values[5] << " },\n";
+			writtenCount++;
+		}
+	}
+	file << "\t{ 0, 0, 0, 0, 0, 0, 0 }\n};\n";
+	file << "const int " << prefix << "BlockMemberCount = " << writtenCount << ";\n";
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderreflection.h
+// ============
+// write the interface of a linked program as a C++ header
+//
+//  The uniforms, the uniform and storage blocks and the block members of a
+//  program are read with the program interface queries and written as
+//  constant tables, so code can be built against the locations, bindings
+//  and offsets the driver assigned instead of looking them up at runtime.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <ostream>
+
+/***********************************************************
+ *  ShaderReflection
+ *
+ *  This class contains the code for querying the interface
+ *  of a program and writing it out.
+ ***********************************************************/
+class ShaderReflection
+{
+public:
+	// write the interface of a linked program into a header,
+	// with its tables named after the passed in prefix -
+	// returns false when the file can not be written or the
+	// queries are not supported
+	static bool WriteHeader(
+		GLuint programID,
+		const char* prefix,
+		const char* filename);
+
+private:
+	// write the uniforms outside of blocks
+	static void WriteUniforms(std::ostream& file, GLuint programID, const char* prefix);
+	// write the uniform and storage blocks
+	static void WriteBlocks(std::ostream& file, GLuint programID, const char* prefix);
+	// write the members of the uniform and storage blocks
+	static void WriteBlockMembers(std::ostream& file, GLuint programID, const char* prefix);
+};
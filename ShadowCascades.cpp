@@ -0,0 +1,459 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowcascades.cpp
+// ============
+// cascaded shadow maps for the directional light
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowCascades.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// depth-only program - only the vertex position is read
+	const char* g_DepthVertexSource =
+		"#version 330 core\n"
+		"layout(location = 0) in vec3 position;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 lightViewProjection;\n"
+		"void main()\n"
+		"{\n"
+		"    gl_Position = lightViewProjection * model * vec4(position, 1.0);\n"
+		"}\n";
+	const char* g_DepthFragmentSource =
+		"#version 330 core\n"
+		"void main()\n"
+		"{\n"
+		"}\n";
+
+	// depth offset that keeps lit surfaces from shadowing
+	// themselves
+	const float g_PolygonOffsetFactor = 2.0f;
+	const float g_PolygonOffsetUnits = 4.0f;
+
+	// smallest shadow map size that is accepted
+	const int g_MinimumResolution = 256;
+}
+
+/***********************************************************
+ *  ShadowCascades()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowCascades::ShadowCascades()
+{
+	m_resolution = 2048;
+	m_cascadeCount = 3;
+	m_splitLambda = 0.75f;
+	m_shadowDistance = 40.0f;
+	m_lightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	m_sceneCenter = glm::vec3(0.0f);
+	m_sceneRadius = 0.0f;
+	m_framebufferID = 0;
+	m_depthTextureID = 0;
+	m_programID = 0;
+	m_modelLocation = -1;
+	m_lightViewProjectionLocation = -1;
+	m_savedFramebuffer = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		m_savedViewport[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~ShadowCascades()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowCascades::~ShadowCascades()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  SetQuality()
+ *
+ *  This method is used for setting the shadow map size and
+ *  the number of cascades the view is split into.
+ ***********************************************************/
+void ShadowCascades::SetQuality(int resolution, int cascadeCount)
+{
+	m_resolution = glm::max(resolution, g_MinimumResolution);
+	m_cascadeCount = glm::clamp(cascadeCount, 1, MAX_CASCADES);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the depth texture array
+ *  with one layer per cascade, the framebuffer the layers
+ *  are rendered through and the depth-only program.
+ ***********************************************************/
+bool ShadowCascades::Create()
+{
+	Destroy();
+
+	if (CreateDepthProgram() == false)
+	{
+		return(false);
+	}
+
+	glGenTextures(1, &m_depthTextureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTextureID);
+	glTexImage3D(
+		GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24,
+		m_resolution, m_resolution, m_cascadeCount,
+		0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	// hardware depth comparison for sampler2DArrayShadow
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	glGenFramebuffers(1, &m_framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTextureID, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Shadow map framebuffer is not complete" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the shadow map texture,
+ *  framebuffer and program.
+ ***********************************************************/
+void ShadowCascades::Destroy()
+{
+	if (m_framebufferID != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebufferID);
+		m_framebufferID = 0;
+	}
+	if (m_depthTextureID != 0)
+	{
+		glDeleteTextures(1, &m_depthTextureID);
+		m_depthTextureID = 0;
+	}
+	if (m_programID != 0)
+	{
+		glDeleteProgram(m_programID);
+		m_programID = 0;
+	}
+	m_modelLocation = -1;
+	m_lightViewProjectionLocation = -1;
+}
+
+/***********************************************************
+ *  CreateDepthProgram()
+ *
+ *  This method is used for compiling and linking the program
+ *  that writes only the depth of the shadow casters.
+ ***********************************************************/
+bool ShadowCascades::CreateDepthProgram()
+{
+	const char* sources[2] = { g_DepthVertexSource, g_DepthFragmentSource };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint shaders[2] = { 0, 0 };
+	GLint success = 0;
+	char infoLog[512];
+
+	m_programID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+			std::cout << "Shadow depth shader compilation failed\n" << infoLog << std::endl;
+		}
+		glAttachShader(m_programID, shaders[i]);
+	}
+	glLinkProgram(m_programID);
+	for (int i = 0; i < 2; i++)
+	{
+		glDeleteShader(shaders[i]);
+	}
+
+	glGetProgramiv(m_programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(m_programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Shadow depth program linking failed\n" << infoLog << std::endl;
+		glDeleteProgram(m_programID);
+		m_programID = 0;
+		return(false);
+	}
+
+	m_modelLocation = glGetUniformLocation(m_programID, "model");
+	m_lightViewProjectionLocation = glGetUniformLocation(m_programID, "lightViewProjection");
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetLightDirection()
+ *
+ *  This method is used for setting the direction the light
+ *  travels in - the same convention as the direction of the
+ *  directional light in the shader.
+ ***********************************************************/
+void ShadowCascades::SetLightDirection(glm::vec3 direction)
+{
+	if (glm::length(direction) > 0.0f)
+	{
+		m_lightDirection = glm::normalize(direction);
+	}
+}
+
+/***********************************************************
+ *  SetSceneBounds()
+ *
+ *  This method is used for setting the sphere around every
+ *  object that can cast a shadow, so casters outside the
+ *  view are not clipped by the cascade near planes.
+ ***********************************************************/
+void ShadowCascades::SetSceneBounds(glm::vec3 center, float radius)
+{
+	m_sceneCenter = center;
+	m_sceneRadius = radius;
+}
+
+/***********************************************************
+ *  SetShadowDistance()
+ *
+ *  This method is used for setting the view distance that the
+ *  last cascade ends at.
+ ***********************************************************/
+void ShadowCascades::SetShadowDistance(float distance)
+{
+	if (distance > 0.0f)
+	{
+		m_shadowDistance = distance;
+	}
+}
+
+/***********************************************************
+ *  FitCascades()
+ *
+ *  This method is used for splitting the view into cascades
+ *  and fitting a light space box tightly around the corners
+ *  of each split.  The box is snapped to whole shadow map
+ *  texels so the shadow edges do not crawl as the camera
+ *  moves.
+ ***********************************************************/
+void ShadowCascades::FitCascades(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	SHADOW_FRAME& frame) const
+{
+	frame.cascadeCount = m_cascadeCount;
+
+	// recover the clip planes from the projection matrix
+	bool bPerspective = (projection[3][3] == 0.0f);
+	float nearPlane;
+	float farPlane;
+	if (bPerspective)
+	{
+		nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+		farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+	}
+	else
+	{
+		nearPlane = (projection[3][2] + 1.0f) / projection[2][2];
+		farPlane = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+	farPlane = glm::min(farPlane, nearPlane + m_shadowDistance);
+
+	// the light looks along its direction from the origin
+	glm::vec3 up(0.0f, 1.0f, 0.0f);
+	if (std::fabs(glm::dot(up, m_lightDirection)) > 0.99f)
+	{
+		up = glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+	frame.lightView = glm::lookAt(glm::vec3(0.0f), m_lightDirection, up);
+
+	// every caster lies below this light space depth
+	glm::vec4 sceneCenter = frame.lightView * glm::vec4(m_sceneCenter, 1.0f);
+	float sceneNearZ = sceneCenter.z + m_sceneRadius;
+
+	glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+	float splitNear = nearPlane;
+
+	for (int cascade = 0; cascade < m_cascadeCount; cascade++)
+	{
+		// blend the logarithmic and the uniform split distance
+		float fraction = (float)(cascade + 1) / (float)m_cascadeCount;
+		float logSplit = nearPlane * std::pow(farPlane / nearPlane, fraction);
+		float uniformSplit = nearPlane + (farPlane - nearPlane) * fraction;
+		float splitFar = m_splitLambda * logSplit + (1.0f - m_splitLambda) * uniformSplit;
+
+		glm::vec3 minimum(0.0f);
+		glm::vec3 maximum(0.0f);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			// depth of the split plane in normalized device space
+			float depth = (corner & 4) ? splitFar : splitNear;
+			glm::vec4 clip = projection * glm::vec4(0.0f, 0.0f, -depth, 1.0f);
+			glm::vec4 ndc(
+				(corner & 1) ? 1.0f : -1.0f,
+				(corner & 2) ? 1.0f : -1.0f,
+				clip.z / clip.w,
+				1.0f);
+
+			glm::vec4 world = inverseViewProjection * ndc;
+			world = world / world.w;
+			glm::vec3 light = glm::vec3(frame.lightView * world);
+
+			if (corner == 0)
+			{
+				minimum = light;
+				maximum = light;
+			}
+			else
+			{
+				minimum = glm::min(minimum, light);
+				maximum = glm::max(maximum, light);
+			}
+		}
+
+		// snap the box to the texel grid of the shadow map
+		float texelX = (maximum.x - minimum.x) / (float)m_resolution;
+		float texelY = (maximum.y - minimum.y) / (float)m_resolution;
+		if ((texelX > 0.0f) && (texelY > 0.0f))
+		{
+			minimum.x = std::floor(minimum.x / texelX) * texelX;
+			maximum.x = std::ceil(maximum.x / texelX) * texelX;
+			minimum.y = std::floor(minimum.y / texelY) * texelY;
+			maximum.y = std::ceil(maximum.y / texelY) * texelY;
+		}
+
+		// pull the near plane back to the closest caster
+		float nearZ = glm::max(maximum.z, sceneNearZ);
+
+		glm::mat4 lightProjection = glm::ortho(
+			minimum.x, maximum.x,
+			minimum.y, maximum.y,
+			-nearZ, -minimum.z);
+
+		frame.lightViewProjection[cascade] = lightProjection * frame.lightView;
+		frame.bounds[cascade] = glm::vec4(minimum.x, maximum.x, minimum.y, maximum.y);
+		frame.farDepth[cascade] = minimum.z;
+		frame.splitDepths[cascade] = splitFar;
+
+		splitNear = splitFar;
+	}
+}
+
+/***********************************************************
+ *  GetCasterMask()
+ *
+ *  This method is used for finding the cascades that a world
+ *  space bounding sphere can cast a shadow into.  Anything
+ *  between the light and a cascade box counts, so only the
+ *  sides and the far end of the box are tested.
+ ***********************************************************/
+unsigned int ShadowCascades::GetCasterMask(
+	const SHADOW_FRAME& frame,
+	glm::vec3 center,
+	float radius)
+{
+	glm::vec4 light = frame.lightView * glm::vec4(center, 1.0f);
+	unsigned int mask = 0;
+
+	for (int cascade = 0; cascade < frame.cascadeCount; cascade++)
+	{
+		const glm::vec4& bounds = frame.bounds[cascade];
+		if ((light.x + radius >= bounds.x) && (light.x - radius <= bounds.y) &&
+			(light.y + radius >= bounds.z) && (light.y - radius <= bounds.w) &&
+			(light.z + radius >= frame.farDepth[cascade]))
+		{
+			mask |= (1u << cascade);
+		}
+	}
+
+	return(mask);
+}
+
+/***********************************************************
+ *  BeginCascade()
+ *
+ *  This method is used for binding a cascade layer of the
+ *  shadow map, clearing it and preparing the depth-only
+ *  program.  The bound framebuffer and viewport are saved
+ *  on the first cascade.
+ ***********************************************************/
+void ShadowCascades::BeginCascade(const SHADOW_FRAME& frame, int cascade)
+{
+	if (cascade == 0)
+	{
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+		glGetIntegerv(GL_VIEWPORT, m_savedViewport);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+		glViewport(0, 0, m_resolution, m_resolution);
+		glUseProgram(m_programID);
+		glEnable(GL_DEPTH_TEST);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(g_PolygonOffsetFactor, g_PolygonOffsetUnits);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	}
+
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTextureID, 0, cascade);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glUniformMatrix4fv(
+		m_lightViewProjectionLocation, 1, GL_FALSE,
+		glm::value_ptr(frame.lightViewProjection[cascade]));
+}
+
+/***********************************************************
+ *  SetCasterModel()
+ *
+ *  This method is used for setting the model matrix of the
+ *  next shadow caster to be drawn.
+ ***********************************************************/
+void ShadowCascades::SetCasterModel(const glm::mat4& model)
+{
+	glUniformMatrix4fv(m_modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method is used for restoring the render state that
+ *  was in use before the shadow pass.  The caller binds its
+ *  own program again.
+ ***********************************************************/
+void ShadowCascades::EndPass()
+{
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+	glViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+}
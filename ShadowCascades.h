@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowcascades.h
+// ============
+// cascaded shadow maps for the directional light
+//
+//  The view frustum is split in depth and every split gets its own
+//  orthographic shadow map, fitted tightly around the split as seen from
+//  the light.  The cascades are stored as layers of one depth texture
+//  array and rendered with a small depth-only program, so the shadow pass
+//  does not depend on the scene shaders.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ShadowCascades
+ *
+ *  This class contains the shadow map texture array, the
+ *  depth-only program and the code for fitting the cascades
+ *  to the view.
+ ***********************************************************/
+class ShadowCascades
+{
+public:
+	// most cascades a shadow map can be split into
+	static const int MAX_CASCADES = 4;
+
+	// cascade placement for one frame, calculated on the
+	// update thread and used by the shadow pass
+	struct SHADOW_FRAME
+	{
+		int cascadeCount;
+		// light view shared by all cascades
+		glm::mat4 lightView;
+		// light view and projection of each cascade
+		glm::mat4 lightViewProjection[MAX_CASCADES];
+		// light view bounds of each cascade - x/y minimum and
+		// maximum, and the far end of the box in z
+		glm::vec4 bounds[MAX_CASCADES];
+		float farDepth[MAX_CASCADES];
+		// view depth where each cascade ends
+		float splitDepths[MAX_CASCADES];
+	};
+
+	// constructor
+	ShadowCascades();
+	// destructor
+	~ShadowCascades();
+
+	// set the shadow map size and number of cascades - takes
+	// effect the next time the shadow maps are created
+	void SetQuality(int resolution, int cascadeCount);
+	int GetResolution() const { return(m_resolution); }
+	int GetCascadeCount() const { return(m_cascadeCount); }
+
+	// create the shadow map texture array and depth program
+	bool Create();
+	// free the shadow map resources
+	void Destroy();
+	bool IsValid() const { return(m_framebufferID != 0); }
+	GLuint GetDepthTexture() const { return(m_depthTextureID); }
+
+	// set the direction the light travels in
+	void SetLightDirection(glm::vec3 direction);
+	// set the world space sphere around every shadow caster
+	void SetSceneBounds(glm::vec3 center, float radius);
+	// set the view distance past which nothing is shadowed
+	void SetShadowDistance(float distance);
+
+	// fit the cascades around the passed in view - makes no
+	// OpenGL calls, so it can run on the update thread
+	void FitCascades(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		SHADOW_FRAME& frame) const;
+
+	// get a bit for every cascade that a world space sphere
+	// can cast a shadow into
+	static unsigned int GetCasterMask(
+		const SHADOW_FRAME& frame,
+		glm::vec3 center,
+		float radius);
+
+	// bind the indexed cascade for rendering and clear it
+	void BeginCascade(const SHADOW_FRAME& frame, int cascade);
+	// set the model matrix of the next shadow caster
+	void SetCasterModel(const glm::mat4& model);
+	// restore the framebuffer and viewport that were bound
+	// before the shadow pass
+	void EndPass();
+
+private:
+	// shadow map size in texels and number of cascades
+	int m_resolution;
+	int m_cascadeCount;
+	// blend between logarithmic and uniform split distances
+	float m_splitLambda;
+	float m_shadowDistance;
+	glm::vec3 m_lightDirection;
+	glm::vec3 m_sceneCenter;
+	float m_sceneRadius;
+	// OpenGL resources of the shadow pass
+	GLuint m_framebufferID;
+	GLuint m_depthTextureID;
+	GLuint m_programID;
+	GLint m_modelLocation;
+	GLint m_lightViewProjectionLocation;
+	// state restored at the end of the pass
+	GLint m_savedFramebuffer;
+	GLint m_savedViewport[4];
+
+	// compile and link the depth-only program
+	bool CreateDepthProgram();
+};
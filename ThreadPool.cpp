@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.cpp
+// ============
+// work-stealing pool of worker threads for splitting per-frame CPU work
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ThreadPool.h"
+
+/***********************************************************
+ *  ThreadPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ThreadPool::ThreadPool(int workerCount)
+{
+	m_pJob = NULL;
+	m_pendingTasks = 0;
+	m_jobGeneration = 0;
+	m_bShutdown = false;
+
+	if (workerCount < 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+	}
+	if (workerCount < 0)
+	{
+		workerCount = 0;
+	}
+
+	// the last queue belongs to the thread calling ParallelFor()
+	for (int i = 0; i <= workerCount; i++)
+	{
+		m_queues.push_back(new TASK_QUEUE());
+	}
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~ThreadPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bShutdown = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	for (size_t i = 0; i < m_queues.size(); i++)
+	{
+		delete m_queues[i];
+	}
+	m_queues.clear();
+}
+
+/***********************************************************
+ *  GetThreadCount()
+ *
+ *  This method is used for getting the number of threads
+ *  that can run a job, including the calling thread.
+ ***********************************************************/
+int ThreadPool::GetThreadCount() const
+{
+	return((int)m_queues.size());
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for splitting the items into ranges,
+ *  queueing the ranges on every thread and helping to run
+ *  them until all have finished.
+ ***********************************************************/
+void ThreadPool::ParallelFor(int count, int grainSize, const RANGE_JOB& job)
+{
+	int callerIndex = (int)m_queues.size() - 1;
+
+	if (count <= 0)
+	{
+		return;
+	}
+	if (grainSize < 1)
+	{
+		grainSize = 1;
+	}
+
+	// small jobs are not worth waking the workers for
+	if ((m_workers.size() == 0) || (count <= grainSize))
+	{
+		job(0, count, callerIndex);
+		return;
+	}
+
+	int taskCount = (count + grainSize - 1) / grainSize;
+	m_pJob = &job;
+	m_pendingTasks = taskCount;
+
+	// deal the ranges out to the queues in turn
+	for (int i = 0; i < taskCount; i++)
+	{
+		TASK task;
+		task.begin = i * grainSize;
+		task.end = (task.begin + grainSize < count) ? task.begin + grainSize : count;
+
+		TASK_QUEUE* pQueue = m_queues[i % m_queues.size()];
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		pQueue->tasks.push_back(task);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_jobGeneration++;
+	}
+	m_wakeCondition.notify_all();
+
+	// the calling thread works too instead of only waiting
+	RunTasks(callerIndex);
+
+	std::unique_lock<std::mutex> lock(m_wakeMutex);
+	m_doneCondition.wait(lock, [this]() { return(m_pendingTasks.load() == 0); });
+	m_pJob = NULL;
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is the main loop of each worker thread.  It
+ *  sleeps until a job is queued or the pool shuts down.
+ ***********************************************************/
+void ThreadPool::WorkerLoop(int threadIndex)
+{
+	unsigned int seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wakeCondition.wait(lock, [this, seenGeneration]() {
+				return(m_bShutdown || (m_jobGeneration != seenGeneration)); });
+
+			if (m_bShutdown)
+			{
+				return;
+			}
+			seenGeneration = m_jobGeneration;
+		}
+
+		RunTasks(threadIndex);
+	}
+}
+
+/***********************************************************
+ *  RunTasks()
+ *
+ *  This method is used for running queued ranges until no
+ *  queue has any left.  The thread that finishes the last
+ *  range wakes up the caller of ParallelFor().
+ ***********************************************************/
+void ThreadPool::RunTasks(int threadIndex)
+{
+	TASK task;
+
+	while (PopTask(threadIndex, task))
+	{
+		(*m_pJob)(task.begin, task.end, threadIndex);
+
+		if (m_pendingTasks.fetch_sub(1) == 1)
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+			m_doneCondition.notify_all();
+		}
+	}
+}
+
+/***********************************************************
+ *  PopTask()
+ *
+ *  This method is used for taking the newest range from the
+ *  thread's own queue, or the oldest range from another
+ *  thread's queue when its own is empty.
+ ***********************************************************/
+bool ThreadPool::PopTask(int threadIndex, TASK& task)
+{
+	int queueCount = (int)m_queues.size();
+
+	{
+		TASK_QUEUE* pQueue = m_queues[threadIndex];
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		if (!pQueue->tasks.empty())
+		{
+			task = pQueue->tasks.back();
+			pQueue->tasks.pop_back();
+			return(true);
+		}
+	}
+
+	for (int i = 1; i < queueCount; i++)
+	{
+		TASK_QUEUE* pVictim = m_queues[(threadIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(pVictim->mutex);
+		if (!pVictim->tasks.empty())
+		{
+			task = pVictim->tasks.front();
+			pVictim->tasks.pop_front();
+			return(true);
+		}
+	}
+
+	return(false);
+}
@@ -0,0 +1,83 @@
+///////////////////////////////////////////////////////////////////////////////
+// threadpool.h
+// ============
+// work-stealing pool of worker threads for splitting per-frame CPU work
+//
+//  Each thread owns a queue of index ranges.  A thread takes work from the
+//  back of its own queue and, when that is empty, steals from the front of
+//  the other queues, so uneven ranges still keep every core busy.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  ThreadPool
+ *
+ *  This class contains the worker threads and the code for
+ *  running a range job across all of them.
+ ***********************************************************/
+class ThreadPool
+{
+public:
+	// job that processes the items [begin, end) on the thread
+	// with the passed in index
+	typedef std::function<void(int begin, int end, int threadIndex)> RANGE_JOB;
+
+	// constructor - a negative worker count uses one worker
+	// per hardware thread, minus the calling thread
+	ThreadPool(int workerCount = -1);
+	// destructor
+	~ThreadPool();
+
+	// number of threads that can run a job, including the
+	// thread that calls ParallelFor()
+	int GetThreadCount() const;
+
+	// split the items into ranges of grainSize and run the job
+	// on all threads - returns once every range has finished.
+	// only one ParallelFor() may be running at a time
+	void ParallelFor(int count, int grainSize, const RANGE_JOB& job);
+
+private:
+	struct TASK
+	{
+		int begin;
+		int end;
+	};
+
+	struct TASK_QUEUE
+	{
+		std::mutex mutex;
+		std::deque<TASK> tasks;
+	};
+
+	// worker threads
+	std::vector<std::thread> m_workers;
+	// one task queue per worker plus one for the calling thread
+	std::vector<TASK_QUEUE*> m_queues;
+	// job of the running ParallelFor()
+	const RANGE_JOB* m_pJob;
+	// number of ranges that have not finished yet
+	std::atomic<int> m_pendingTasks;
+	// wakes the workers when a new job is queued
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+	unsigned int m_jobGeneration;
+	bool m_bShutdown;
+
+	// main loop of each worker thread
+	void WorkerLoop(int threadIndex);
+	// run ranges until no queue has any left
+	void RunTasks(int threadIndex);
+	// take a range from the own queue or steal from another
+	bool PopTask(int threadIndex, TASK& task);
+};
@@ -18,7 +18,7 @@
 // declaration of the global variables and defines
 namespace
 {
-	// Variables for window width and height
+	// Variables for the starting window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
 	const char* g_ViewName = "view";
@@ -33,15 +33,44 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	// queue the window input events go through to the thread
+	// that updates the view, and the most events taken at once
+	InputQueue* g_pInputQueue = nullptr;
+	const int g_EventBatchSize = 64;
+
+	// size of the window's framebuffer, updated on the main
+	// thread whenever the window is resized - a minimized
+	// window keeps the last size
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
+
+	// default length in seconds of one simulation step
+	const float g_DefaultSimulationStep = 1.0f / 120.0f;
+
+	// default extent of the camera's orthographic view, and of
+	// the sphere the fixed views of the layout frame
+	const float g_DefaultOrthoHalfHeight = 6.0f;
+	const float g_DefaultOrthoNearPlane = 0.1f;
+	const float g_DefaultOrthoFarPlane = 100.0f;
+	const float g_DefaultLayoutRadius = 12.0f;
+
+	// build an orthographic projection that is centered on the
+	// view direction, with the width following the aspect
+	glm::mat4 MakeOrthographic(float halfHeight, float aspect, float nearPlane, float farPlane)
+	{
+		float halfWidth = halfHeight * aspect;
+
+		return(glm::ortho(-halfWidth, halfWidth, -halfHeight, halfHeight, nearPlane, farPlane));
+	}
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
 }
 
+// mouse scroll callback for changing the camera movement speed
+void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+
 /***********************************************************
  *  ViewManager()
  *
@@ -53,6 +82,8 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -60,6 +91,20 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 10;
+	m_simulationStep = g_DefaultSimulationStep;
+	m_simulationSteps = 0;
+	m_viewportWidth = WINDOW_WIDTH;
+	m_viewportHeight = WINDOW_HEIGHT;
+	m_orthoHalfHeight = g_DefaultOrthoHalfHeight;
+	m_orthoNearPlane = g_DefaultOrthoNearPlane;
+	m_orthoFarPlane = g_DefaultOrthoFarPlane;
+	m_viewLayout = LAYOUT_SINGLE;
+	m_layoutCenter = glm::vec3(0.0f);
+	m_layoutRadius = g_DefaultLayoutRadius;
+	m_previousCamera = GetCameraState();
+	m_controls = CONTROL_STATE();
+	g_pInputQueue = new InputQueue();
+	m_pCameraPath = new CameraPath();
 }
 
 /***********************************************************
@@ -77,6 +122,16 @@ ViewManager::~ViewManager()
 		delete g_pCamera;
 		g_pCamera = NULL;
 	}
+	if (NULL != g_pInputQueue)
+	{
+		delete g_pInputQueue;
+		g_pInputQueue = NULL;
+	}
+	if (NULL != m_pCameraPath)
+	{
+		delete m_pCameraPath;
+		m_pCameraPath = NULL;
+	}
 }
 
 /***********************************************************
@@ -107,6 +162,16 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 
 	// this callback is used to receive mouse moving events
 	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
+	// this callback is used to receive mouse scrolling events
+	glfwSetScrollCallback(window, scroll_callback);
+	// this callback is used to receive keyboard events
+	glfwSetKeyCallback(window, &ViewManager::Key_Callback);
+	// this callback is used to receive window resizing events,
+	// starting from the size the window was really given
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+	glfwGetFramebufferSize(window, &gFramebufferWidth, &gFramebufferHeight);
+	m_viewportWidth = gFramebufferWidth;
+	m_viewportHeight = gFramebufferHeight;
 
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
@@ -143,66 +208,251 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	// queue the offsets so the camera is only ever moved by
+	// the thread that updates the view
+	g_pInputQueue->PushMouseMove(xOffset, yOffset);
+}
+
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the framebuffer of the window changes size.  The new size
+ *  is sampled with the input of the next frame.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	// a minimized window reports a zero size
+	if ((width > 0) && (height > 0))
+	{
+		gFramebufferWidth = width;
+		gFramebufferHeight = height;
+	}
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) //gets called when scrolling
 {
+	g_pInputQueue->PushScroll((float)yoffset); //applied to the camera movement speed when the view is updated
+}
 
-	g_pCamera->MovementSpeed -= (float)yoffset; //scrolling up will slow down the movement speed of the camera while scrolling down will increase the speed of the camera
-	if (g_pCamera->MovementSpeed < 1.0)
-		g_pCamera->MovementSpeed = 1.0;
-	if (g_pCamera->MovementSpeed > 45.0)
-		g_pCamera->MovementSpeed = 45.0;
-		
+/***********************************************************
+ *  Key_Callback()
+ *
+ *  This method is automatically called from GLFW whenever a
+ *  key is pressed or released.  The presses and releases
+ *  are queued for the view update, key repeats carry no new
+ *  state.
+ ***********************************************************/
+void ViewManager::Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	// close the window if the escape key has been pressed,
+	// even while a replay ignores the keyboard
+	if ((key == GLFW_KEY_ESCAPE) && (action == GLFW_PRESS))
+	{
+		glfwSetWindowShouldClose(window, true);
+	}
+
+	if (action != GLFW_REPEAT)
+	{
+		g_pInputQueue->PushKey(key, action);
+	}
 }
 
 /***********************************************************
- *  ProcessKeyboardEvents()
+ *  PollInput()
+ *
+ *  This method is used for closing the input of a frame.
+ *  The events that arrived so far belong to it, and the
+ *  ones after it to the next frame.
+ ***********************************************************/
+ViewManager::INPUT_STATE ViewManager::PollInput(int stepCount, float stepBlend)
+{
+	INPUT_STATE input;
+
+	input.inputFrame = g_pInputQueue->EndFrame();
+	input.stepCount = stepCount;
+	input.stepBlend = stepBlend;
+	input.framebufferWidth = gFramebufferWidth;
+	input.framebufferHeight = gFramebufferHeight;
+
+	return(input);
+}
+
+/***********************************************************
+ *  GetInputQueue()
  *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  This method is used for getting the input event queue.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+InputQueue* ViewManager::GetInputQueue() const
 {
-	// close the window if the escape key has been pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	return(g_pInputQueue);
+}
+
+/***********************************************************
+ *  TakeInputEvents()
+ *
+ *  This method is used for applying the queued events up to
+ *  the end of a frame to the camera controls, a batch at a
+ *  time.  The keys hold their state until they are
+ *  released, the mouse movement adds up until a step uses
+ *  it.  Presses of other keys are passed on in the view of
+ *  the frame, so the main thread acts on them with the
+ *  frame they were recorded for.
+ ***********************************************************/
+void ViewManager::TakeInputEvents(uint32_t inputFrame, VIEW_STATE& viewState)
+{
+	InputQueue::INPUT_EVENT events[g_EventBatchSize];
+	int eventCount = 0;
+
+	viewState.keyPressCount = 0;
+
+	do
 	{
-		glfwSetWindowShouldClose(m_pWindow, true);
+		eventCount = g_pInputQueue->TakeEvents(inputFrame, events, g_EventBatchSize);
+		for (int i = 0; i < eventCount; i++)
+		{
+			const InputQueue::INPUT_EVENT& event = events[i];
+			bool bDown = (event.action != GLFW_RELEASE);
+
+			switch (event.type)
+			{
+			case InputQueue::EVENT_KEY:
+				switch (event.key)
+				{
+				case GLFW_KEY_W:
+					m_controls.bForward = bDown;
+					break;
+				case GLFW_KEY_S:
+					m_controls.bBackward = bDown;
+					break;
+				case GLFW_KEY_A:
+					m_controls.bLeft = bDown;
+					break;
+				case GLFW_KEY_D:
+					m_controls.bRight = bDown;
+					break;
+				case GLFW_KEY_Q:
+					m_controls.bUp = bDown;
+					break;
+				case GLFW_KEY_E:
+					m_controls.bDown = bDown;
+					break;
+				case GLFW_KEY_P:
+					m_controls.bPerspective = bDown;
+					break;
+				case GLFW_KEY_O:
+					m_controls.bOrthographic = bDown;
+					break;
+				case GLFW_KEY_L:
+					// switch the layout once per press
+					if (event.action == GLFW_PRESS)
+					{
+						m_viewLayout = (m_viewLayout == LAYOUT_SINGLE) ? LAYOUT_FOUR_VIEWS : LAYOUT_SINGLE;
+					}
+					break;
+				default:
+					if ((event.action == GLFW_PRESS) && (viewState.keyPressCount < MAX_KEY_PRESSES))
+					{
+						viewState.keyPresses[viewState.keyPressCount++] = event.key;
+					}
+					break;
+				}
+				break;
+			case InputQueue::EVENT_MOUSE_MOVE:
+				m_controls.mouseXOffset += event.x;
+				m_controls.mouseYOffset += event.y;
+				break;
+			case InputQueue::EVENT_SCROLL:
+				m_controls.scrollOffset += event.y;
+				break;
+			}
+		}
+	} while (eventCount == g_EventBatchSize);
+}
+
+/***********************************************************
+ *  GetCameraState()
+ *
+ *  This method is used for getting the camera values that
+ *  are blended between simulation steps.
+ ***********************************************************/
+ViewManager::CAMERA_STATE ViewManager::GetCameraState()
+{
+	CAMERA_STATE state;
+
+	state.position = g_pCamera->Position;
+	state.front = g_pCamera->Front;
+	state.up = g_pCamera->Up;
+	state.zoom = g_pCamera->Zoom;
+
+	return(state);
+}
+
+/***********************************************************
+ *  ProcessMouseEvents()
+ *
+ *  This method is called to process the mouse movement that
+ *  was queued up to the frame.  The movement is not scaled
+ *  by time, so it is applied once, with the first step.
+ ***********************************************************/
+void ViewManager::ProcessMouseEvents()
+{
+	// move the 3D camera according to the mouse offsets
+	if ((m_controls.mouseXOffset != 0.0f) || (m_controls.mouseYOffset != 0.0f))
+	{
+		g_pCamera->ProcessMouseMovement(m_controls.mouseXOffset, m_controls.mouseYOffset);
 	}
 
+	//scrolling up will slow down the movement speed of the camera while scrolling down will increase the speed of the camera
+	if (m_controls.scrollOffset != 0.0f)
+	{
+		g_pCamera->MovementSpeed -= m_controls.scrollOffset;
+		if (g_pCamera->MovementSpeed < 1.0)
+			g_pCamera->MovementSpeed = 1.0;
+		if (g_pCamera->MovementSpeed > 45.0)
+			g_pCamera->MovementSpeed = 45.0;
+	}
+}
+
+/***********************************************************
+ *  ProcessKeyboardEvents()
+ *
+ *  This method is called to process the keys the queued
+ *  events left held down, for one simulation step.
+ ***********************************************************/
+void ViewManager::ProcessKeyboardEvents(float deltaTime)
+{
 	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
+	if (m_controls.bForward)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		g_pCamera->ProcessKeyboard(FORWARD, deltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
+	if (m_controls.bBackward)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		g_pCamera->ProcessKeyboard(BACKWARD, deltaTime);
 	}
 
 	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
+	if (m_controls.bLeft)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		g_pCamera->ProcessKeyboard(LEFT, deltaTime);
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
+	if (m_controls.bRight)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		g_pCamera->ProcessKeyboard(RIGHT, deltaTime);
 	}
 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS) //sets the Q key to upwards movement
+	if (m_controls.bUp) //sets the Q key to upwards movement
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		g_pCamera->ProcessKeyboard(UP, deltaTime);
 	}
 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS) //sets the E key to downward movement
+	if (m_controls.bDown) //sets the E key to downward movement
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		g_pCamera->ProcessKeyboard(DOWN, deltaTime);
 	}
 
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS) //toggles perspective view
+	if (m_controls.bPerspective) //toggles perspective view
 	{
 		bOrthographicProjection = false;
 
@@ -211,7 +461,7 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 		g_pCamera->Zoom = 100;
 	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS) //toggles ortho view
+	if (m_controls.bOrthographic) //toggles ortho view
 	{
 		bOrthographicProjection = true;
 		g_pCamera->Position = glm::vec3(6.0f, 4.0f, 5.0f); //sets up the positioning for the camera when entering ortho view
@@ -226,51 +476,251 @@ void ViewManager::ProcessKeyboardEvents()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  Each call runs one simulation step.
  ***********************************************************/
 void ViewManager::PrepareSceneView()
+{
+	VIEW_STATE viewState;
+
+	// process any keyboard events that may be waiting in the 
+	// event queue
+	INPUT_STATE input = PollInput(1, 1.0f);
+
+	UpdateView(input, viewState);
+	ApplyView(viewState);
+}
+
+/***********************************************************
+ *  UpdateView()
+ *
+ *  This method is used for moving the camera with the sampled
+ *  input and calculating the view and projection matrices.
+ *  The camera moves in whole steps of the same length, so
+ *  the same input always moves it the same way, and the view
+ *  is blended between the last two steps so the motion stays
+ *  smooth at any frame rate.  It makes no OpenGL or GLFW
+ *  window calls, so it can run on the frame pipeline update
+ *  thread.
+ ***********************************************************/
+void ViewManager::UpdateView(const INPUT_STATE& input, VIEW_STATE& viewState)
 {
 	glm::mat4 view;
 	glm::mat4 projection;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	// input that was not sampled from the window keeps the
+	// last size
+	if ((input.framebufferWidth > 0) && (input.framebufferHeight > 0))
+	{
+		m_viewportWidth = input.framebufferWidth;
+		m_viewportHeight = input.framebufferHeight;
+	}
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
-	glfwSetScrollCallback(m_pWindow, scroll_callback);  //processes our scroll_callback function
-	
+	// a replayed camera path ignores the input, which is still
+	// taken so the queue does not fill up
+	bool bReplayPath = m_pCameraPath->IsReplaying();
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	TakeInputEvents(input.inputFrame, viewState);
+	for (int step = 0; step < input.stepCount; step++)
+	{
+		m_simulationSteps++;
+		if (bReplayPath)
+		{
+			continue;
+		}
+		m_previousCamera = GetCameraState();
+		if (step == 0)
+		{
+			ProcessMouseEvents();
+			m_controls.mouseXOffset = 0.0f;
+			m_controls.mouseYOffset = 0.0f;
+			m_controls.scrollOffset = 0.0f;
+		}
+		ProcessKeyboardEvents(m_simulationStep);
+	}
+
+	// the view between the last two steps
+	CAMERA_STATE currentCamera = GetCameraState();
+	CAMERA_STATE camera;
+	camera.position = glm::mix(m_previousCamera.position, currentCamera.position, input.stepBlend);
+	camera.front = glm::mix(m_previousCamera.front, currentCamera.front, input.stepBlend);
+	camera.up = glm::mix(m_previousCamera.up, currentCamera.up, input.stepBlend);
+	camera.zoom = glm::mix(m_previousCamera.zoom, currentCamera.zoom, input.stepBlend);
+
+	// the time of the shown view on the simulation clock
+	double clockTime = ((double)m_simulationSteps - 1.0 + input.stepBlend) * m_simulationStep;
+	if (bReplayPath)
+	{
+		// the replayed pose is left in the camera, so the live
+		// input goes on from it when the replay ends
+		CameraPath::CAMERA_POSE pose = m_pCameraPath->SamplePose(clockTime);
+		g_pCamera->Position = pose.position;
+		g_pCamera->Front = pose.front;
+		g_pCamera->Up = pose.up;
+		g_pCamera->Zoom = pose.zoom;
+		bOrthographicProjection = (pose.bOrthographic != 0);
+		camera = GetCameraState();
+		m_previousCamera = camera;
+	}
+	else if (m_pCameraPath->IsRecording())
+	{
+		CameraPath::CAMERA_POSE pose;
+		pose.time = 0.0f;
+		pose.position = camera.position;
+		pose.front = camera.front;
+		pose.up = camera.up;
+		pose.zoom = camera.zoom;
+		pose.bOrthographic = bOrthographicProjection ? 1 : 0;
+		m_pCameraPath->RecordPose(clockTime, pose);
+	}
+
+	view = glm::lookAt(camera.position, camera.position + camera.front, camera.up);
+
+	// the camera view covers the lower left quarter of the
+	// window when the fixed views are shown
+	int cameraWidth = m_viewportWidth;
+	int cameraHeight = m_viewportHeight;
+	viewState.orthoViewCount = 0;
+	if (m_viewLayout == LAYOUT_FOUR_VIEWS)
+	{
+		cameraWidth = glm::max(m_viewportWidth / 2, 1);
+		cameraHeight = glm::max(m_viewportHeight / 2, 1);
+		CalculateLayoutViews(m_viewportWidth, m_viewportHeight, viewState);
+	}
+	GLfloat aspect = (GLfloat)cameraWidth / (GLfloat)cameraHeight;
 
 	// define the current projection matrix
 	if (bOrthographicProjection == false)
 	{	//perspective projection
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+		projection = glm::perspective(glm::radians(camera.zoom), aspect, 0.1f, 100.0f);
 	}
 	else
 	{
-		// front-view orthographic projection
-		double scale = 0.0;
-		if (WINDOW_WIDTH > WINDOW_HEIGHT)
-		{
-			scale = (double)WINDOW_HEIGHT / (double)WINDOW_WIDTH;
-			projection = glm::ortho(-5.0f, 5.0f, -10.0f * (float)scale, 5.0f * (float)scale, 0.1f, 100.0f);
-		}
+		// orthographic projection of the configured extent,
+		// widened to the aspect of the viewport
+		projection = MakeOrthographic(m_orthoHalfHeight, aspect, m_orthoNearPlane, m_orthoFarPlane);
+	}
+
+	// keep the matrices for the scene manager to use for
+	// detail level selection
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+
+	viewState.view = view;
+	viewState.projection = projection;
+	viewState.position = camera.position;
+	viewState.viewportWidth = cameraWidth;
+	viewState.viewportHeight = cameraHeight;
+	viewState.bReplayingPath = bReplayPath && m_pCameraPath->IsReplaying();
+}
+
+/***********************************************************
+ *  CalculateLayoutViews()
+ *
+ *  This method is used for calculating the fixed top, side
+ *  and front orthographic views of the layout.  Each looks
+ *  at the center of the layout sphere from outside it, and
+ *  its extent fits the whole sphere into its quarter of the
+ *  window at any aspect.
+ ***********************************************************/
+void ViewManager::CalculateLayoutViews(int width, int height, VIEW_STATE& viewState) const
+{
+	const glm::vec3 directions[MAX_ORTHO_VIEWS] = {
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f) };
+	// the top view has north up on the screen
+	const glm::vec3 ups[MAX_ORTHO_VIEWS] = {
+		glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f) };
+
+	// the upper quarters take the odd row, the right ones the
+	// odd column
+	int leftWidth = glm::max(width / 2, 1);
+	int lowerHeight = glm::max(height / 2, 1);
+	int rightWidth = glm::max(width - leftWidth, 1);
+	int upperHeight = glm::max(height - lowerHeight, 1);
+	const float aspects[MAX_ORTHO_VIEWS] = {
+		(float)leftWidth / (float)upperHeight,
+		(float)rightWidth / (float)upperHeight,
+		(float)rightWidth / (float)lowerHeight };
+
+	float radius = glm::max(m_layoutRadius, 0.01f);
+	for (int i = 0; i < MAX_ORTHO_VIEWS; i++)
+	{
+		glm::vec3 eye = m_layoutCenter + directions[i] * (2.0f * radius);
+		float halfHeight = radius * glm::max(1.0f, 1.0f / aspects[i]);
+
+		viewState.orthoViews[i] = glm::lookAt(eye, m_layoutCenter, ups[i]);
+		viewState.orthoProjections[i] = MakeOrthographic(halfHeight, aspects[i], radius, 3.0f * radius);
 	}
+	viewState.orthoViewCount = MAX_ORTHO_VIEWS;
+}
+
+/***********************************************************
+ *  SetOrthographicExtent()
+ *
+ *  This method is used for setting the extent of the
+ *  camera's orthographic view.
+ ***********************************************************/
+void ViewManager::SetOrthographicExtent(float halfHeight, float nearPlane, float farPlane)
+{
+	m_orthoHalfHeight = glm::max(halfHeight, 0.01f);
+	m_orthoNearPlane = nearPlane;
+	m_orthoFarPlane = glm::max(farPlane, nearPlane + 0.01f);
+}
 
+/***********************************************************
+ *  SetLayoutBounds()
+ *
+ *  This method is used for setting the sphere that the
+ *  fixed orthographic views of the layout frame.
+ ***********************************************************/
+void ViewManager::SetLayoutBounds(glm::vec3 center, float radius)
+{
+	m_layoutCenter = center;
+	m_layoutRadius = (radius > 0.0f) ? radius : g_DefaultLayoutRadius;
+}
+
+/***********************************************************
+ *  ApplyView()
+ *
+ *  This method is used for setting the view of a frame into
+ *  the shader for proper rendering.
+ ***********************************************************/
+void ViewManager::ApplyView(const VIEW_STATE& viewState)
+{
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
+		m_pShaderManager->setMat4Value(g_ViewName, viewState.view);
 		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
+		m_pShaderManager->setMat4Value(g_ProjectionName, viewState.projection);
 		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pShaderManager->setVec3Value("viewPosition", viewState.position);
 	}
+}
+
+/***********************************************************
+ *  GetViewportHeight()
+ *
+ *  This method is used for getting the height in pixels of
+ *  the viewport that the scene is rendered into.
+ ***********************************************************/
+int ViewManager::GetViewportHeight() const
+{
+	return(gFramebufferHeight);
+}
+
+/***********************************************************
+ *  GetFramebufferSize()
+ *
+ *  This method is used for getting the size in pixels of
+ *  the window's framebuffer, as the last resize left it.
+ ***********************************************************/
+void ViewManager::GetFramebufferSize(int& width, int& height) const
+{
+	width = gFramebufferWidth;
+	height = gFramebufferHeight;
 }
\ No newline at end of file
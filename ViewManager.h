@@ -10,14 +10,73 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "InputQueue.h"
+#include "CameraPath.h"
 #include "camera.h"
 
 // GLFW library
 #include "GLFW/glfw3.h" 
 
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
 class ViewManager
 {
 public:
+	// what drives the camera for one frame - sampled on the
+	// main thread so the camera can be updated on another
+	// thread, which takes the queued input events up to the
+	// end of the frame
+	struct INPUT_STATE
+	{
+		// frame of the input queue whose events are taken
+		uint32_t inputFrame;
+		// fixed simulation steps the camera moves by for the
+		// frame, and how far the shown view is from the step
+		// before the last one to the last one
+		int stepCount;
+		float stepBlend;
+		// size in pixels of the window's framebuffer
+		int framebufferWidth;
+		int framebufferHeight;
+	};
+
+	// ways of laying out the window - the camera view alone,
+	// or in the lower left quarter with fixed top, side and
+	// front orthographic views of the layout bounds in the
+	// other quarters
+	enum VIEW_LAYOUT
+	{
+		LAYOUT_SINGLE = 0,
+		LAYOUT_FOUR_VIEWS
+	};
+	static const int MAX_ORTHO_VIEWS = 3;
+	// most presses of keys the view does not use that a frame
+	// passes on
+	static const int MAX_KEY_PRESSES = 8;
+
+	// camera matrices and position for one frame - the viewport
+	// size is the part of the window the camera view covers
+	struct VIEW_STATE
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 position;
+		int viewportWidth;
+		int viewportHeight;
+		// fixed orthographic views of the layout, in the order
+		// top, side and front
+		int orthoViewCount;
+		glm::mat4 orthoViews[MAX_ORTHO_VIEWS];
+		glm::mat4 orthoProjections[MAX_ORTHO_VIEWS];
+		// presses of the keys the view does not use, in the
+		// order they came, for the main thread to act on
+		int keyPressCount;
+		int keyPresses[MAX_KEY_PRESSES];
+		// true while the camera follows a replayed path
+		bool bReplayingPath;
+	};
+
 	// constructor
 	ViewManager(
 		ShaderManager* pShaderManager);
@@ -26,15 +85,82 @@ public:
 
 	// mouse position callback for mouse interaction with the 3D scene
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
+	// framebuffer size callback for following the window size
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+	// key callback for queueing the camera keys
+	static void Key_Callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// view and projection matrices from the last prepared frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// length in seconds of one simulation step, and the number
+	// of steps run so far, which is the clock of camera paths
+	float m_simulationStep;
+	uint64_t m_simulationSteps;
+	// viewport size the projection is calculated for, set
+	// from the sampled input by the thread updating the view
+	int m_viewportWidth;
+	int m_viewportHeight;
+	// half height in world units and depth range of the
+	// camera's orthographic view
+	float m_orthoHalfHeight;
+	float m_orthoNearPlane;
+	float m_orthoFarPlane;
+	// layout of the window, switched by the thread updating
+	// the view, and the sphere the fixed views frame
+	VIEW_LAYOUT m_viewLayout;
+	glm::vec3 m_layoutCenter;
+	float m_layoutRadius;
+
+	// the camera values that are interpolated between steps
+	struct CAMERA_STATE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float zoom;
+	};
+	// camera before the last simulation step
+	CAMERA_STATE m_previousCamera;
 
+	// the camera controls as the input events left them, and
+	// the mouse movement not applied to a step yet - only used
+	// by the thread updating the view
+	struct CONTROL_STATE
+	{
+		bool bForward;
+		bool bBackward;
+		bool bLeft;
+		bool bRight;
+		bool bUp;
+		bool bDown;
+		bool bPerspective;
+		bool bOrthographic;
+		float mouseXOffset;
+		float mouseYOffset;
+		float scrollOffset;
+	};
+	CONTROL_STATE m_controls;
+	// recording or replay of the camera's path
+	CameraPath* m_pCameraPath;
+
+	// get the interpolated values of the camera
+	static CAMERA_STATE GetCameraState();
+	// take the queued input events of a frame into the controls
+	// and pass the other key presses on with its view
+	void TakeInputEvents(uint32_t inputFrame, VIEW_STATE& viewState);
+	// process mouse events for interaction with the 3D scene
+	void ProcessMouseEvents();
 	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	void ProcessKeyboardEvents(float deltaTime);
+	// calculate the fixed orthographic views of the layout for
+	// a window size
+	void CalculateLayoutViews(int width, int height, VIEW_STATE& viewState) const;
 
 public:
 	// create the initial OpenGL display window
@@ -42,4 +168,45 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// set the length in seconds of one simulation step
+	void SetSimulationStep(float seconds) { m_simulationStep = seconds; }
+	float GetSimulationStep() const { return(m_simulationStep); }
+
+	// set the half height in world units and the depth range
+	// of the camera's orthographic view - the half width
+	// follows the aspect of the viewport
+	void SetOrthographicExtent(float halfHeight, float nearPlane, float farPlane);
+	// set the layout the window starts with, which the L key
+	// switches, and the sphere the fixed orthographic views
+	// frame - must be called before the frame pipeline starts
+	void SetViewLayout(VIEW_LAYOUT layout) { m_viewLayout = layout; }
+	void SetLayoutBounds(glm::vec3 center, float radius);
+
+	// close the input of a frame that runs the passed in
+	// simulation steps - must be called on the main thread.
+	// the mouse movement waits for a frame with at least one
+	// step
+	INPUT_STATE PollInput(int stepCount, float stepBlend);
+	// get the queue the window input events go through, for
+	// recording and replaying them
+	InputQueue* GetInputQueue() const;
+	// get the path the shown camera poses are recorded to, or
+	// that drives the camera in place of the input while it
+	// is replayed
+	CameraPath* GetCameraPath() const { return(m_pCameraPath); }
+	// move the camera in fixed steps from the sampled input and
+	// calculate the view for the frame, blended between the
+	// last two steps - makes no OpenGL calls
+	void UpdateView(const INPUT_STATE& input, VIEW_STATE& viewState);
+	// set the view of a frame into the shader
+	void ApplyView(const VIEW_STATE& viewState);
+
+	// get the matrices and viewport size used for the last prepared frame
+	glm::mat4 GetViewMatrix() const { return(m_viewMatrix); }
+	glm::mat4 GetProjectionMatrix() const { return(m_projectionMatrix); }
+	int GetViewportHeight() const;
+	// get the current size in pixels of the window's
+	// framebuffer - must be called on the main thread
+	void GetFramebufferSize(int& width, int& height) const;
 };
\ No newline at end of file
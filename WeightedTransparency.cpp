@@ -0,0 +1,307 @@
+///////////////////////////////////////////////////////////////////////////////
+// weightedtransparency.cpp
+// ============
+// weighted blended order-independent transparency
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WeightedTransparency.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// one triangle covering the screen, without vertex data
+	const char* g_FullScreenVertexSource =
+		"#version 330 core\n"
+		"void main()\n"
+		"{\n"
+		"    vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"    gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+		"}\n";
+
+	// average transparent color, with the coverage left by the
+	// revealage as its alpha for the usual alpha blending
+	const char* g_CompositeFragmentSource =
+		"#version 330 core\n"
+		"out vec4 fragmentColor;\n"
+		"uniform sampler2D accumulationTexture;\n"
+		"uniform sampler2D revealageTexture;\n"
+		"void main()\n"
+		"{\n"
+		"    ivec2 texel = ivec2(gl_FragCoord.xy);\n"
+		"    float revealage = texelFetch(revealageTexture, texel, 0).r;\n"
+		"    if (revealage >= 1.0)\n"
+		"    {\n"
+		"        discard;\n"
+		"    }\n"
+		"    vec4 accumulation = texelFetch(accumulationTexture, texel, 0);\n"
+		"    vec3 average = accumulation.rgb / max(accumulation.a, 1e-5);\n"
+		"    fragmentColor = vec4(average, 1.0 - revealage);\n"
+		"}\n";
+}
+
+/***********************************************************
+ *  WeightedTransparency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WeightedTransparency::WeightedTransparency()
+{
+	m_width = 0;
+	m_height = 0;
+	m_firstTextureUnit = 0;
+	m_framebufferID = 0;
+	m_accumulationTextureID = 0;
+	m_revealageTextureID = 0;
+	m_depthRenderbufferID = 0;
+	m_compositeProgramID = 0;
+	m_emptyVertexArrayID = 0;
+	m_savedFramebuffer = 0;
+}
+
+/***********************************************************
+ *  ~WeightedTransparency()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WeightedTransparency::~WeightedTransparency()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the accumulation and
+ *  revealage targets, the depth buffer the opaque depth is
+ *  copied into and the composite program.
+ ***********************************************************/
+bool WeightedTransparency::Create(int width, int height, int firstTextureUnit)
+{
+	Destroy();
+
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	m_width = width;
+	m_height = height;
+	m_firstTextureUnit = firstTextureUnit;
+
+	m_compositeProgramID = CreateProgram(g_FullScreenVertexSource, g_CompositeFragmentSource, "composite");
+	if (m_compositeProgramID == 0)
+	{
+		return(false);
+	}
+
+	// the weighted sums need the range of half floats, the
+	// revealage is a product of coverages
+	GLuint textureIDs[2];
+	GLenum formats[2] = { GL_RGBA16F, GL_R8 };
+	glGenTextures(2, textureIDs);
+	for (int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, textureIDs[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, formats[i], m_width, m_height, 0, GL_RGBA, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_accumulationTextureID = textureIDs[0];
+	m_revealageTextureID = textureIDs[1];
+
+	// depth with stencil, the usual format of the window, so
+	// the opaque depth can be copied from it
+	glGenRenderbuffers(1, &m_depthRenderbufferID);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+
+	GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glGenFramebuffers(1, &m_framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_accumulationTextureID, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_revealageTextureID, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbufferID);
+	glDrawBuffers(2, drawBuffers);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Transparency framebuffer is not complete" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	glGenVertexArrays(1, &m_emptyVertexArrayID);
+
+	glUseProgram(m_compositeProgramID);
+	glUniform1i(glGetUniformLocation(m_compositeProgramID, "accumulationTexture"), m_firstTextureUnit);
+	glUniform1i(glGetUniformLocation(m_compositeProgramID, "revealageTexture"), m_firstTextureUnit + 1);
+	glUseProgram(0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the targets and the
+ *  composite program.
+ ***********************************************************/
+void WeightedTransparency::Destroy()
+{
+	if (m_compositeProgramID != 0)
+	{
+		glDeleteProgram(m_compositeProgramID);
+	}
+	if (m_framebufferID != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebufferID);
+	}
+	if (m_accumulationTextureID != 0)
+	{
+		glDeleteTextures(1, &m_accumulationTextureID);
+		glDeleteTextures(1, &m_revealageTextureID);
+	}
+	if (m_depthRenderbufferID != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthRenderbufferID);
+	}
+	if (m_emptyVertexArrayID != 0)
+	{
+		glDeleteVertexArrays(1, &m_emptyVertexArrayID);
+	}
+
+	m_compositeProgramID = 0;
+	m_framebufferID = 0;
+	m_accumulationTextureID = 0;
+	m_revealageTextureID = 0;
+	m_depthRenderbufferID = 0;
+	m_emptyVertexArrayID = 0;
+}
+
+/***********************************************************
+ *  CreateProgram()
+ *
+ *  This method is used for compiling and linking the
+ *  composite program - returns 0 when it fails.
+ ***********************************************************/
+GLuint WeightedTransparency::CreateProgram(
+	const char* vertexSource,
+	const char* fragmentSource,
+	const char* name)
+{
+	const char* sources[2] = { vertexSource, fragmentSource };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	GLuint shaders[2] = { 0, 0 };
+	GLint success = 0;
+	char infoLog[512];
+
+	GLuint programID = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		shaders[i] = glCreateShader(types[i]);
+		glShaderSource(shaders[i], 1, &sources[i], NULL);
+		glCompileShader(shaders[i]);
+		glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+		if (!success)
+		{
+			glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+			std::cout << "Transparency " << name << " shader compilation failed\n" << infoLog << std::endl;
+		}
+		glAttachShader(programID, shaders[i]);
+	}
+	glLinkProgram(programID);
+	for (int i = 0; i < 2; i++)
+	{
+		glDeleteShader(shaders[i]);
+	}
+
+	glGetProgramiv(programID, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		glGetProgramInfoLog(programID, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Transparency " << name << " program linking failed\n" << infoLog << std::endl;
+		glDeleteProgram(programID);
+		return(0);
+	}
+
+	return(programID);
+}
+
+/***********************************************************
+ *  BeginAccumulation()
+ *
+ *  This method is used for copying the opaque depth into
+ *  the transparency targets, so the transparent surfaces
+ *  behind opaque ones are rejected, and setting up the
+ *  blending.  The colors add up in the first target and
+ *  the coverages multiply in the second.  Depth writes are
+ *  off, so transparent surfaces never hide each other.
+ ***********************************************************/
+void WeightedTransparency::BeginAccumulation()
+{
+	const GLfloat clearAccumulation[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLfloat clearRevealage[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	// only the part the viewport covers is copied, which is
+	// less than the targets while the resolution is scaled
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	GLint width = (viewport[2] < m_width) ? viewport[2] : m_width;
+	GLint height = (viewport[3] < m_height) ? viewport[3] : m_height;
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_savedFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_savedFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebufferID);
+	glBlitFramebuffer(
+		0, 0, width, height,
+		0, 0, width, height,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+
+	glClearBufferfv(GL_COLOR, 0, clearAccumulation);
+	glClearBufferfv(GL_COLOR, 1, clearRevealage);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunci(0, GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+}
+
+/***********************************************************
+ *  EndAccumulation()
+ *
+ *  This method is used for blending the average transparent
+ *  color over the framebuffer that was bound before, with
+ *  the usual alpha blending, and restoring the depth state.
+ ***********************************************************/
+void WeightedTransparency::EndAccumulation()
+{
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+
+	glActiveTexture(GL_TEXTURE0 + m_firstTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_accumulationTextureID);
+	glActiveTexture(GL_TEXTURE0 + m_firstTextureUnit + 1);
+	glBindTexture(GL_TEXTURE_2D, m_revealageTextureID);
+	glActiveTexture(GL_TEXTURE0);
+
+	glDisable(GL_DEPTH_TEST);
+	glUseProgram(m_compositeProgramID);
+	glBindVertexArray(m_emptyVertexArrayID);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+}
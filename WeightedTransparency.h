@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// weightedtransparency.h
+// ============
+// weighted blended order-independent transparency
+//
+//  Transparent surfaces are not sorted.  Each one adds its premultiplied
+//  color, weighted by its alpha and depth, into an accumulation target and
+//  multiplies its coverage into a revealage target, both with blending that
+//  does not depend on the draw order.  A full screen pass then divides out
+//  the weights and blends the average color over the opaque scene.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  WeightedTransparency
+ *
+ *  This class contains the accumulation targets, the
+ *  composite program and the code for switching the blend
+ *  state around the transparent pass.
+ ***********************************************************/
+class WeightedTransparency
+{
+public:
+	// constructor
+	WeightedTransparency();
+	// destructor
+	~WeightedTransparency();
+
+	// create the targets at the passed in size and the
+	// composite program - the composite reads the targets
+	// from firstTextureUnit and the unit after it
+	bool Create(int width, int height, int firstTextureUnit);
+	// free the transparency resources
+	void Destroy();
+	bool IsValid() const { return(m_framebufferID != 0); }
+
+	// copy the opaque depth of the bound framebuffer, then
+	// bind and clear the targets and set the order-independent
+	// blending - the transparent draws follow
+	void BeginAccumulation();
+	// blend the accumulated surfaces over the framebuffer that
+	// was bound before and restore the render state - the
+	// caller binds its own program again
+	void EndAccumulation();
+
+private:
+	// size of the targets and the first unit of the composite
+	int m_width;
+	int m_height;
+	int m_firstTextureUnit;
+	// OpenGL resources
+	GLuint m_framebufferID;
+	GLuint m_accumulationTextureID;
+	GLuint m_revealageTextureID;
+	GLuint m_depthRenderbufferID;
+	GLuint m_compositeProgramID;
+	GLuint m_emptyVertexArrayID;
+	// framebuffer restored after the transparent pass
+	GLint m_savedFramebuffer;
+
+	// compile and link a program from inline sources
+	static GLuint CreateProgram(
+		const char* vertexSource,
+		const char* fragmentSource,
+		const char* name);
+};